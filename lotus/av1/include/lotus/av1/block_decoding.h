@@ -42,24 +42,26 @@ namespace lotus::av1::block_decoding {
 		prediction(uninitialized_t) {
 		}
 
-		u32 above_row_val[257]; ///< \p AboveRow with each element offset by 1.
-		u32 left_col_val[257]; ///< \p LeftCol with each element offset by 1.
+		/// \p AboveRow with each element offset by 2. Pixels are at most 12 bits, so they are stored using 16 bits to
+		/// allow more of them to be processed at once.
+		channel_t above_row_val[257];
+		channel_t left_col_val[257]; ///< \p LeftCol with each element offset by 2.
 		u16 pred[64][64]; ///< \p pred.
 
 		/// \p AboveRow.
-		[[nodiscard]] u32 &above_row(std::integral auto i) {
+		[[nodiscard]] channel_t &above_row(std::integral auto i) {
 			return above_row_val[i + 2];
 		}
 		/// \p AboveRow.
-		[[nodiscard]] const u32 &above_row(std::integral auto i) const {
+		[[nodiscard]] const channel_t &above_row(std::integral auto i) const {
 			return above_row_val[i + 2];
 		}
 		/// \p LeftCol.
-		[[nodiscard]] u32 &left_col(std::integral auto i) {
+		[[nodiscard]] channel_t &left_col(std::integral auto i) {
 			return left_col_val[i + 2];
 		}
 		/// \p LeftCol.
-		[[nodiscard]] const u32 &left_col(std::integral auto i) const {
+		[[nodiscard]] const channel_t &left_col(std::integral auto i) const {
 			return left_col_val[i + 2];
 		}
 
@@ -85,9 +87,9 @@ namespace lotus::av1::block_decoding {
 		void predict_intra_smooth(prediction_mode mode, u32 log2w, u32 log2h, u32 w, u32 h);
 
 		/// 7.11.2.7. Filter corner process
-		[[nodiscard]] u32 filter_corner() const {
-			const u32 s = left_col(0) * 5 + above_row(-1) * 6 + above_row(0) * 5;
-			return functions::round2(s, 4);
+		[[nodiscard]] channel_t filter_corner() const {
+			const u32 s = left_col(0) * 5u + above_row(-1) * 6u + above_row(0) * 5u;
+			return static_cast<channel_t>(functions::round2(s, 4));
 		}
 
 		/// 7.11.2.11. Intra edge upsample process
@@ -253,13 +255,14 @@ namespace lotus::av1::block_decoding {
 	);
 
 	/// 7.13.2. 1D transforms
-	/// Struct holding 1D inverse transform data.
-	struct inverse_transform_1d {
-		using value_t = i32; ///< Value type.
+	/// Struct holding 1D inverse transform data. Each element of \ref t either holds a single value, or holds the
+	/// values at the same position of several independent transforms that are computed together using SIMD.
+	template <typename Value> struct basic_inverse_transform_1d {
+		using value_t = Value; ///< Value type.
 		using array_t = std::array<value_t, 64>; ///< Array type.
 
 		/// No initialization.
-		inverse_transform_1d(uninitialized_t) {
+		basic_inverse_transform_1d(uninitialized_t) {
 		}
 
 		array_t t; ///< \p T.
@@ -300,6 +303,8 @@ namespace lotus::av1::block_decoding {
 		/// 7.13.2.15. Inverse identity transform process
 		void inverse_idtx(u32 n);
 	};
+	/// 1D inverse transform operating on a single set of values.
+	using inverse_transform_1d = basic_inverse_transform_1d<i32>;
 
 	/// 7.13.3. 2D inverse transform process
 	void inverse_transform_2d(
@@ -3,6 +3,7 @@
 /// \file
 /// CDF definitions.
 
+#include <type_traits>
 #include <utility>
 
 #include "lotus/types.h"
@@ -551,6 +552,9 @@ namespace lotus::av1::cdf {
 		restoration_type_t restoration_type; ///< RestorationTypeCdf.
 
 		static const non_coeff defaults; ///< Default coefficients.
+
+		/// Sets the symbol counter, i.e., the last element, of every CDF array to zero.
+		void clear_symbol_counters();
 	};
 
 	/// CDF tables used in the \p coeff() syntax structure.
@@ -571,5 +575,8 @@ namespace lotus::av1::cdf {
 
 		/// Returns default CDFs corresponding to the given \p idx value.
 		[[nodiscard]] static coeff get_defaults(u32 idx);
+
+		/// Sets the symbol counter, i.e., the last element, of every CDF array to zero.
+		void clear_symbol_counters();
 	};
 }
@@ -33,6 +33,9 @@ namespace lotus::av1 {
 
 		/// Samples the output image at the given location.
 		[[nodiscard]] cvec3u32 get_sample(cvec2u32) const;
+
+		/// If not \p nullptr, tiles are decoded concurrently using the workers of this manager.
+		job_system::manager *job_manager = nullptr;
 	private:
 		obu::sequence_header _seq_header = zero; ///< Sequence header.
 		obu::uncompressed_header _frame_header = zero; ///< Frame header.
@@ -3,35 +3,64 @@
 /// \file
 /// Reader for AV1 files.
 
-#include "lotus/utils/static_function.h"
+#include <bit>
+#include <cstring>
+#include <span>
 
 #include "lotus/av1/obu.h"
 #include "lotus/av1/state.h"
 
+namespace lotus::job_system {
+	class manager;
+}
+
 namespace lotus::av1 {
 	struct symbol_decoder;
 
-	/// Reader containing convenience functions for reading OBUs.
+	/// Reader containing convenience functions for reading OBUs. Bits are read from a contiguous buffer through a
+	/// 64-bit cache, with the next bit to be read in its most significant bit.
 	struct reader {
 	public:
-		/// Initializes this reader using the given callback.
-		explicit reader(static_function<std::byte()> consume_byte) : _consume_byte(std::move(consume_byte)) {
+		/// Initializes this reader to read from the given buffer. The buffer must outlive this reader.
+		explicit reader(std::span<const std::byte> data) : _data(data) {
 		}
 
 		/// Reads the next byte.
-		[[nodiscard]] u8 read_byte();
+		[[nodiscard]] u8 read_byte() {
+			return static_cast<u8>(read_bits(8));
+		}
 		/// Reads the next bit.
-		[[nodiscard]] bool read_bit();
-		/// Reads a number of bits.
-		[[nodiscard]] u32 read_bits(u32 n);
+		[[nodiscard]] bool read_bit() {
+			return read_bits(1) != 0;
+		}
+		/// Reads a number of bits. At most 32 bits can be read at once.
+		[[nodiscard]] u32 read_bits(u32 n) {
+			crash_if(n > 32);
+			if (_cache_bits < n) {
+				_refill();
+				crash_if(_cache_bits < n); // read past the end of the buffer
+			}
+			// shift twice so that reading zero bits does not shift by 64
+			const auto result = static_cast<u32>((_cache >> 1) >> (63 - n));
+			_cache <<= n;
+			_cache_bits -= n;
+			return result;
+		}
 		/// \overload
 		template <u32 NumBits, typename T = minimum_unsigned_type_bits_t<NumBits>> [[nodiscard]] T read_bits() {
 			static_assert(sizeof(T) * 8 >= NumBits, "Insufficient number of bits");
 			return static_cast<T>(read_bits(NumBits));
 		}
+		/// Skips the given number of bits. Whole bytes are skipped without being read.
+		void skip_bits(u64 n);
+		/// Returns the next \p n bytes without copying them, and skips over them. The current position must be byte
+		/// aligned.
+		[[nodiscard]] std::span<const std::byte> read_byte_span(u64 n);
 
 		/// \p get_position().
-		[[nodiscard]] u64 get_position() const;
+		[[nodiscard]] u64 get_position() const {
+			return _byte_position * 8 - _cache_bits;
+		}
 
 		/// 4.10.3. uvlc()
 		[[nodiscard]] u32 read_uvlc();
@@ -120,13 +149,15 @@ namespace lotus::av1 {
 		);
 
 		/// 5.11.1. General tile group OBU syntax
+		///
+		/// \param job_manager If not \p nullptr, tiles in the group are decoded concurrently using its workers.
 		void read_tile_group(
 			const obu::sequence_header&,
 			const obu::uncompressed_header&,
-			const cdf::non_coeff&,
-			const cdf::coeff&,
+			state::cdf&,
 			state::block&,
-			u64 sz
+			u64 sz,
+			job_system::manager *job_manager = nullptr
 		);
 		/// 5.11.2. Decode tile syntax
 		void decode_tile(
@@ -433,14 +464,37 @@ namespace lotus::av1 {
 			const obu::uncompressed_header&, symbol_decoder&, state::ref_lr&, u32 plane, u32 unit_row, u32 unit_col
 		);
 	private:
-		static_function<std::byte()> _consume_byte; ///< Callback function that consumes a single byte.
-		u64 _byte_position = 0; ///< Current byte position.
-		u32 _residual_bits = 0; ///< Number of remaining bits in \ref _cur_byte.
-		u8 _cur_byte = 0; ///< Remaining bits in the current byte.
+		std::span<const std::byte> _data; ///< The buffer that is being read.
+		/// Bits that have been loaded from \ref _data but not yet read, starting from the most significant bit. Bits
+		/// after the first \ref _cache_bits bits are either zero or equal to the bits that follow in \ref _data, so
+		/// that the same bytes can be loaded again with a bitwise or.
+		u64 _cache = 0;
+		u64 _byte_position = 0; ///< Position of the first byte in \ref _data that has not been loaded.
+		u32 _cache_bits = 0; ///< Number of valid bits in \ref _cache.
+
+		/// Loads as many whole bytes into \ref _cache as possible. When at least 8 bytes remain in the buffer, this
+		/// loads a full word and always leaves at least 56 valid bits.
+		void _refill() {
+			if (_data.size() - _byte_position >= sizeof(u64)) [[likely]] {
+				u64 word = 0;
+				std::memcpy(&word, _data.data() + _byte_position, sizeof(u64));
+				if constexpr (std::endian::native == std::endian::little) {
+					word = std::byteswap(word);
+				}
+				// _cache_bits is at most 63 here, and rounding it up to 56 + (_cache_bits % 8) adds whole bytes
+				_cache |= word >> _cache_bits;
+				_byte_position += (63 - _cache_bits) >> 3;
+				_cache_bits |= 56;
+			} else {
+				_refill_tail();
+			}
+		}
+		/// Loads the remaining bytes at the end of the buffer one by one.
+		void _refill_tail();
 
 		/// Asserts that the current position is byte aligned.
 		void _check_byte_aligned() {
-			crash_if(_residual_bits > 0);
+			crash_if(_cache_bits % 8 != 0);
 		}
 	};
 }
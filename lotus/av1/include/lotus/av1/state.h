@@ -3,6 +3,7 @@
 /// \file
 /// Persistent state variables used across the AV1 decoding process.
 
+#include <memory>
 #include <vector>
 
 #include "lotus/common.h"
@@ -13,22 +14,38 @@
 #include "lotus/av1/cdf.h"
 
 namespace lotus::av1::state {
-	/// Resizable 2D grid.
+	/// Resizable 2D grid. Storage can be shared between multiple grids using \ref share().
 	template <typename T> struct grid2 {
 	public:
 		/// Creates a grid without allocating memory.
 		grid2(zero_t) {
 		}
+		/// Default move constructor.
+		grid2(grid2&&) = default;
+		/// No copy construction.
+		grid2(const grid2&) = delete;
+		/// Default move assignment.
+		grid2 &operator=(grid2&&) = default;
+		/// No copy assignment.
+		grid2 &operator=(const grid2&) = delete;
 
 		/// Allocates a new grid with the given dimensions, and initializes all elements to the given value.
 		[[nodiscard]] static grid2 allocate(u32 w, u32 h, T value) {
 			grid2 result = zero;
 			result._width  = w;
 			result._height = h;
-			result._storage = std::make_unique<T[]>(w * h);
+			result._storage = std::shared_ptr<T[]>(new T[w * h]);
 			std::fill(result._storage.get(), result._storage.get() + w * h, value);
 			return result;
 		}
+		/// Returns a grid that refers to the same storage as this grid.
+		[[nodiscard]] grid2 share() const {
+			grid2 result = zero;
+			result._width   = _width;
+			result._height  = _height;
+			result._storage = _storage;
+			return result;
+		}
 
 		/// Indexing.
 		[[nodiscard]] T &operator()(u32 y, u32 x) {
@@ -51,7 +68,7 @@ namespace lotus::av1::state {
 			return _height;
 		}
 	private:
-		std::unique_ptr<T[]> _storage; ///< Storage.
+		std::shared_ptr<T[]> _storage; ///< Storage.
 		u32 _width = 0; ///< Width.
 		u32 _height = 0; ///< Height.
 	};
@@ -82,8 +99,11 @@ namespace lotus::av1::state {
 		grid2<inverse_transform> tx_types = zero; ///< \p TxTypes.
 		grid2<tx_size> inter_tx_sizes = zero; ///< \p InterTxSizes.
 
-		/// \p BlockDecoded with each element offset by 1 on each direction.
+		/// \p BlockDecoded with each element offset by 1 on each direction. \p BlockDecoded is indexed relative to the
+		/// current superblock, so this only needs to cover the largest superblock and one extra element on each side.
 		grid2<bool> block_decoded_val[3] = { zero, zero, zero };
+		/// The width and height of each grid in \ref block_decoded_val.
+		constexpr static u32 block_decoded_size = constants::max_sb_size / constants::mi_size + 2;
 
 		// left context
 		std::vector<u8> left_level_context[3]; ///< \p LeftLevelContext.
@@ -140,7 +160,7 @@ namespace lotus::av1::state {
 			result.inter_tx_sizes    = grid2<enum tx_size>::allocate(mi_cols, mi_rows, zero);
 
 			for (u32 i = 0; i < 3; ++i) {
-				result.block_decoded_val[i] = grid2<bool>::allocate(mi_cols + 2, mi_rows + 2, zero);
+				result.block_decoded_val[i] = grid2<bool>::allocate(block_decoded_size, block_decoded_size, zero);
 			}
 
 			for (u32 i = 0; i < 3; ++i) {
@@ -157,6 +177,56 @@ namespace lotus::av1::state {
 
 			return result;
 		}
+		/// Creates a state object for decoding a single tile concurrently with other tiles. Frame-wide grids are
+		/// shared with this object, since tiles only write to their own regions. Contexts and \p BlockDecoded are
+		/// separate copies.
+		[[nodiscard]] block create_tile_state() const {
+			block result = zero;
+
+			for (u32 i = 0; i < 3; ++i) {
+				result.curr_frame[i] = curr_frame[i].share();
+			}
+			result.y_modes        = y_modes.share();
+			result.uv_modes       = uv_modes.share();
+			result.is_inters      = is_inters.share();
+			result.skip_modes     = skip_modes.share();
+			result.skips          = skips.share();
+			result.mi_sizes       = mi_sizes.share();
+			result.segment_ids    = segment_ids.share();
+			result.cdef_idx       = cdef_idx.share();
+			result.tx_types       = tx_types.share();
+			result.inter_tx_sizes = inter_tx_sizes.share();
+			for (u32 i = 0; i < 2; ++i) {
+				result.palette_sizes[i]  = palette_sizes[i].share();
+				result.ref_frames[i]     = ref_frames[i].share();
+				result.palette_colors[i] = palette_colors[i].share();
+			}
+			result.prev_segment_ids = prev_segment_ids;
+			result.interp_filters   = interp_filters;
+
+			for (u32 i = 0; i < 3; ++i) {
+				result.block_decoded_val[i] = grid2<bool>::allocate(block_decoded_size, block_decoded_size, false);
+				result.left_level_context[i]  = left_level_context[i];
+				result.left_dc_context[i]     = left_dc_context[i];
+				result.above_level_context[i] = above_level_context[i];
+				result.above_dc_context[i]    = above_dc_context[i];
+			}
+			result.left_seg_pred_context  = left_seg_pred_context;
+			result.above_seg_pred_context = above_seg_pred_context;
+
+			std::ranges::copy(col_starts, result.col_starts);
+			std::ranges::copy(row_starts, result.row_starts);
+			std::ranges::copy(delta_lf, result.delta_lf);
+			result.current_q_index   = current_q_index;
+			result.tx_size           = tx_size;
+			result.plane_tx_type     = plane_tx_type;
+			result.max_luma_h        = max_luma_h;
+			result.max_luma_w        = max_luma_w;
+			result.read_deltas       = read_deltas;
+			result.seen_frame_header = seen_frame_header;
+
+			return result;
+		}
 
 		/// \p BlockDecoded.
 		[[nodiscard]] bool &block_decoded(u32 plane, i32 y, i32 x) {
@@ -264,10 +334,16 @@ namespace lotus::av1::state {
 		cdf(zero_t) {
 			std::memset(&non_coeff, 0, sizeof(non_coeff));
 			std::memset(&coeff, 0, sizeof(coeff));
+			std::memset(&saved_non_coeff, 0, sizeof(saved_non_coeff));
+			std::memset(&saved_coeff, 0, sizeof(saved_coeff));
 		}
 
 		av1::cdf::non_coeff non_coeff; ///< CDF initialized by \p init_non_coeff_cdfs().
 		av1::cdf::coeff coeff; ///< CDF initialized by \p init_coeff_cdfs().
+		/// Non-coefficient CDFs saved at the end of the tile with index \p context_update_tile_id.
+		av1::cdf::non_coeff saved_non_coeff;
+		/// Coefficient CDFs saved at the end of the tile with index \p context_update_tile_id.
+		av1::cdf::coeff saved_coeff;
 
 		/// 6.8.2. Uncompressed header semantics
 		/// \p init_non_coeff_cdfs().
@@ -289,5 +365,13 @@ namespace lotus::av1::state {
 			}
 			coeff = av1::cdf::coeff::get_defaults(idx);
 		}
+		/// 6.10.1. General tile group OBU semantics
+		/// \p frame_end_update_cdf().
+		void frame_end_update_cdf() {
+			saved_non_coeff.clear_symbol_counters();
+			saved_coeff.clear_symbol_counters();
+			non_coeff = saved_non_coeff;
+			coeff = saved_coeff;
+		}
 	};
 }
@@ -21,6 +21,15 @@ namespace lotus::av1 {
 		/// 8.2.4. Exit process for symbol decoder
 		void exit_symbol();
 
+		/// Returns the current non-coefficient CDFs of this tile.
+		[[nodiscard]] const cdf::non_coeff &get_non_coeff_cdf() const {
+			return _tile_non_coeff_cdf;
+		}
+		/// Returns the current coefficient CDFs of this tile.
+		[[nodiscard]] const cdf::coeff &get_coeff_cdf() const {
+			return _tile_coeff_cdf;
+		}
+
 		/// 8.2.3. Boolean decoding process
 		[[nodiscard]] bool read_bool();
 		/// 4.10.8. L(n)
@@ -205,12 +214,26 @@ namespace lotus::av1 {
 		reader &_reader; ///< The bitstream reader.
 
 		i64 _symbol_max_bits = 0; ///< \p SymbolMaxBits.
-		cdf::value_t _symbol_value = 0; ///< \p SymbolValue.
-		cdf::value_t _symbol_range = 0; ///< \p SymbolRange.
+		/// \p SymbolValue in the top 16 bits, followed by \ref _window_bits bits that have already been read from
+		/// \ref _reader, inverted, but have not yet been shifted into \p SymbolValue.
+		u64 _symbol_window = 0;
+		u32 _window_bits = 0; ///< Number of valid bits in \ref _symbol_window below \p SymbolValue.
+		u64 _remaining_bits = 0; ///< Number of bits in the tile that have not been loaded into \ref _symbol_window.
+		u32 _symbol_range = 0; ///< \p SymbolRange.
 
 		/// 8.2.6. Symbol decoding process
 		/// Symbol decoding without CDF update.
 		[[nodiscard]] symbol_t _read_symbol_no_update(std::span<const cdf::value_t>);
+		/// 8.2.3. Boolean decoding process
+		/// Decodes up to eight booleans, which consume at most 16 bits in total, without refilling in between.
+		/// The first boolean is stored in the most significant bit of the result.
+		[[nodiscard]] u32 _read_bools(u32 n);
+		/// Loads as many bits from \ref _reader into \ref _symbol_window as possible. Bits after the end of the tile
+		/// are padded with zeros.
+		void _refill_window();
+		/// Updates \ref _symbol_range and \ref _symbol_window after a symbol has been decoded, then refills
+		/// \ref _symbol_window if necessary.
+		void _renormalize(u32 range, u64 window);
 		/// 8.2.6. Symbol decoding process
 		/// CDF update.
 		static void _update_cdf(std::span<cdf::value_t>, symbol_t symbol);
@@ -3,9 +3,29 @@
 /// \file
 /// Implementation of block decoding routines.
 
+#include <cstring>
+
 #include "lotus/av1/functions.h"
 #include "lotus/av1/quantizer_matrix.h"
 
+#if defined(__AVX2__)
+#	define LOTUS_AV1_TRANSFORM_USE_AVX2
+#	include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#	define LOTUS_AV1_TRANSFORM_USE_SSE
+#	if defined(__SSE4_1__) || defined(__AVX__)
+#		define LOTUS_AV1_TRANSFORM_USE_SSE4_1
+#		include <smmintrin.h>
+#	else
+#		include <emmintrin.h>
+#	endif
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#	define LOTUS_AV1_PREDICTION_USE_SSE
+#	include <emmintrin.h>
+#endif
+
 namespace lotus::av1::block_decoding {
 	void compute_prediction(
 		const obu::sequence_header &seq_header,
@@ -107,23 +127,24 @@ namespace lotus::av1::block_decoding {
 			max_y = ((header.frame_size.get_mi_rows() * constants::mi_size) >> subsampling_y) - 1;
 		}
 		prediction p = uninitialized;
-		for (u32 i = 0; i < w + h; ++i) {
-			if (!have_above && have_left) {
-				p.above_row(i) = sb.curr_frame[plane](y, x - 1);
-			} else if (!have_above && !have_left) {
-				p.above_row(i) = (1 << (seq_header.color_config.bit_depth - 1)) - 1;
-			} else {
-				const u32 above_limit = std::min(max_x, x + (have_above_right ? 2 * w : w) - 1);
+		const auto mid_value = static_cast<channel_t>(1u << (seq_header.color_config.bit_depth - 1));
+		if (!have_above && have_left) {
+			std::fill_n(&p.above_row(0), w + h, sb.curr_frame[plane](y, x - 1));
+		} else if (!have_above && !have_left) {
+			std::fill_n(&p.above_row(0), w + h, static_cast<channel_t>(mid_value - 1));
+		} else {
+			const u32 above_limit = std::min(max_x, x + (have_above_right ? 2 * w : w) - 1);
+			for (u32 i = 0; i < w + h; ++i) {
 				p.above_row(i) = sb.curr_frame[plane](y - 1, std::min(above_limit, x + i));
 			}
 		}
-		for (u32 i = 0; i < w + h; ++i) {
-			if (!have_left && have_above) {
-				p.left_col(i) = sb.curr_frame[plane](y - 1, x);
-			} else if (!have_left && !have_above) {
-				p.left_col(i) = (1 << (seq_header.color_config.bit_depth - 1)) + 1;
-			} else {
-				const u32 left_limit = std::min(max_y, y + (have_below_left ? 2 * h : h) - 1);
+		if (!have_left && have_above) {
+			std::fill_n(&p.left_col(0), w + h, sb.curr_frame[plane](y - 1, x));
+		} else if (!have_left && !have_above) {
+			std::fill_n(&p.left_col(0), w + h, static_cast<channel_t>(mid_value + 1));
+		} else {
+			const u32 left_limit = std::min(max_y, y + (have_below_left ? 2 * h : h) - 1);
+			for (u32 i = 0; i < w + h; ++i) {
 				p.left_col(i) = sb.curr_frame[plane](std::min(left_limit, y + i), x - 1);
 			}
 		}
@@ -134,7 +155,7 @@ namespace lotus::av1::block_decoding {
 		} else if (have_left) {
 			p.above_row(-1) = sb.curr_frame[plane](y, x - 1);
 		} else {
-			p.above_row(-1) = 1 << (seq_header.color_config.bit_depth - 1);
+			p.above_row(-1) = mid_value;
 		}
 		p.left_col(-1) = p.above_row(-1);
 		if (plane == 0 && mode_info.use_filter_intra) {
@@ -162,25 +183,149 @@ namespace lotus::av1::block_decoding {
 			}
 		}
 		for (u32 i = 0; i < h; ++i) {
-			for (u32 j = 0; j < w; ++j) {
-				sb.curr_frame[plane](y + i, x + j) = p.pred[i][j];
-			}
+			std::copy_n(p.pred[i], w, &sb.curr_frame[plane](y + i, x));
 		}
 	}
 
+#ifdef LOTUS_AV1_PREDICTION_USE_SSE
+	/// Four horizontally adjacent pixels of a prediction, or intermediate values used to compute them. Each value is
+	/// held in a 32-bit signed integer.
+	struct _pixel_lanes {
+		using vector_t = __m128i; ///< Vector type.
+		constexpr static u32 count = 4; ///< Number of lanes.
+
+		/// No initialization.
+		_pixel_lanes() = default;
+		/// Initializes the vector.
+		_pixel_lanes(vector_t v) : value(v) {
+		}
+
+		/// Loads consecutive 8-bit values.
+		[[nodiscard]] static _pixel_lanes load(const u8 *ptr) {
+			u32 bits;
+			std::memcpy(&bits, ptr, sizeof(bits));
+			const __m128i zero = _mm_setzero_si128();
+			const __m128i bytes = _mm_cvtsi32_si128(static_cast<i32>(bits));
+			return _mm_unpacklo_epi16(_mm_unpacklo_epi8(bytes, zero), zero);
+		}
+		/// Loads consecutive 16-bit values.
+		[[nodiscard]] static _pixel_lanes load(const u16 *ptr) {
+			const __m128i words = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(ptr));
+			return _mm_unpacklo_epi16(words, _mm_setzero_si128());
+		}
+		/// Loads consecutive 32-bit values.
+		[[nodiscard]] static _pixel_lanes load(const i32 *ptr) {
+			return _mm_loadu_si128(reinterpret_cast<const __m128i*>(ptr));
+		}
+		/// \overload
+		[[nodiscard]] static _pixel_lanes load(const u32 *ptr) {
+			return _mm_loadu_si128(reinterpret_cast<const __m128i*>(ptr));
+		}
+		/// Stores all lanes as consecutive 16-bit values. All values must be within the range of \ref channel_t.
+		void store(u16 *ptr) const {
+			// pixels have at most 12 bits, so signed saturation does not affect the results
+			_mm_storel_epi64(reinterpret_cast<__m128i*>(ptr), _mm_packs_epi32(value, value));
+		}
+		/// Returns a vector with all lanes set to the given value.
+		[[nodiscard]] static _pixel_lanes broadcast(i32 x) {
+			return _mm_set1_epi32(x);
+		}
+
+		/// Computes <tt>a * wa + b * wb</tt>. All inputs must fit in 16-bit signed integers.
+		[[nodiscard]] static _pixel_lanes weighted_sum(
+			_pixel_lanes a, _pixel_lanes wa, _pixel_lanes b, _pixel_lanes wb
+		) {
+			const __m128i values =
+				_mm_unpacklo_epi16(_mm_packs_epi32(a.value, a.value), _mm_packs_epi32(b.value, b.value));
+			const __m128i weights =
+				_mm_unpacklo_epi16(_mm_packs_epi32(wa.value, wa.value), _mm_packs_epi32(wb.value, wb.value));
+			return _mm_madd_epi16(values, weights);
+		}
+		/// Selects lanes from \p a where the corresponding lanes of \p mask are all ones, and from \p b elsewhere.
+		[[nodiscard]] static _pixel_lanes select(_pixel_lanes mask, _pixel_lanes a, _pixel_lanes b) {
+			return _mm_or_si128(_mm_and_si128(mask.value, a.value), _mm_andnot_si128(mask.value, b.value));
+		}
+
+		/// Addition.
+		[[nodiscard]] friend _pixel_lanes operator+(_pixel_lanes lhs, _pixel_lanes rhs) {
+			return _mm_add_epi32(lhs.value, rhs.value);
+		}
+		/// \overload
+		[[nodiscard]] friend _pixel_lanes operator+(_pixel_lanes lhs, i32 rhs) {
+			return lhs + broadcast(rhs);
+		}
+		/// Subtraction.
+		[[nodiscard]] friend _pixel_lanes operator-(_pixel_lanes lhs, _pixel_lanes rhs) {
+			return _mm_sub_epi32(lhs.value, rhs.value);
+		}
+		/// Arithmetic right shift.
+		[[nodiscard]] friend _pixel_lanes operator>>(_pixel_lanes lhs, u32 rhs) {
+			return _mm_sra_epi32(lhs.value, _mm_cvtsi32_si128(static_cast<i32>(rhs)));
+		}
+		/// Bitwise and.
+		[[nodiscard]] friend _pixel_lanes operator&(_pixel_lanes lhs, _pixel_lanes rhs) {
+			return _mm_and_si128(lhs.value, rhs.value);
+		}
+		/// Returns all ones in lanes where the values are equal, and zero elsewhere.
+		[[nodiscard]] friend _pixel_lanes operator==(_pixel_lanes lhs, _pixel_lanes rhs) {
+			return _mm_cmpeq_epi32(lhs.value, rhs.value);
+		}
+		/// Returns all ones in lanes where \p lhs is less than or equal to \p rhs, and zero elsewhere.
+		[[nodiscard]] friend _pixel_lanes operator<=(_pixel_lanes lhs, _pixel_lanes rhs) {
+			return _mm_xor_si128(_mm_cmpgt_epi32(lhs.value, rhs.value), _mm_set1_epi32(-1));
+		}
+
+		/// Absolute value of all lanes.
+		[[nodiscard]] friend _pixel_lanes _abs(_pixel_lanes x) {
+			const __m128i sign = _mm_srai_epi32(x.value, 31);
+			return _mm_sub_epi32(_mm_xor_si128(x.value, sign), sign);
+		}
+		/// Clamps all lanes.
+		[[nodiscard]] friend _pixel_lanes _clamp(_pixel_lanes x, i32 min, i32 max) {
+			const _pixel_lanes lo = broadcast(min);
+			const _pixel_lanes hi = broadcast(max);
+			const _pixel_lanes x1 = select(x <= lo, lo, x);
+			return select(x1 <= hi, x1, hi);
+		}
+
+		vector_t value; ///< The values.
+	};
+#endif
+
 	void prediction::predict_intra_basic(u32 w, u32 h) {
 		for (u32 i = 0; i < h; ++i) {
-			for (u32 j = 0; j < w; ++j) {
+			u32 j = 0;
+#ifdef LOTUS_AV1_PREDICTION_USE_SSE
+			{
+				const _pixel_lanes left = _pixel_lanes::broadcast(left_col(i));
+				const _pixel_lanes top_left = _pixel_lanes::broadcast(above_row(-1));
+				// base - above_row(j) does not depend on j
+				const _pixel_lanes p_top = _abs(left - top_left);
+				for (; j < w; j += _pixel_lanes::count) {
+					const _pixel_lanes top = _pixel_lanes::load(&above_row(j));
+					const _pixel_lanes base = top + left - top_left;
+					const _pixel_lanes p_left = _abs(base - left);
+					const _pixel_lanes p_top_left = _abs(base - top_left);
+					const _pixel_lanes result = _pixel_lanes::select(
+						(p_left <= p_top) & (p_left <= p_top_left),
+						left,
+						_pixel_lanes::select(p_top <= p_top_left, top, top_left)
+					);
+					result.store(&pred[i][j]);
+				}
+			}
+#endif
+			for (; j < w; ++j) {
 				const i32 base = static_cast<i32>(above_row(j) + left_col(i)) - static_cast<i32>(above_row(-1));
 				const i32 p_left = std::abs(base - static_cast<i32>(left_col(i)));
 				const i32 p_top = std::abs(base - static_cast<i32>(above_row(j)));
 				const i32 p_top_left = std::abs(base - static_cast<i32>(above_row(-1)));
 				if (p_left <= p_top && p_left <= p_top_left) {
-					pred[i][j] = static_cast<u16>(left_col(i));
+					pred[i][j] = left_col(i);
 				} else if (p_top <= p_top_left) {
-					pred[i][j] = static_cast<u16>(above_row(j));
+					pred[i][j] = above_row(j);
 				} else {
-					pred[i][j] = static_cast<u16>(above_row(-1));
+					pred[i][j] = above_row(-1);
 				}
 			}
 		}
@@ -193,6 +338,21 @@ namespace lotus::av1::block_decoding {
 	) {
 		const u32 w4 = w >> 2;
 		const u32 h2 = h >> 1;
+		const u32 filter_intra_mode = std::to_underlying(mode_info.filter_intra_mode);
+#ifdef LOTUS_AV1_PREDICTION_USE_SSE
+		// taps of the four pixels in each row of a 4x2 block, one vector for each of the seven input pixels
+		std::array<std::array<_pixel_lanes, 7>, 2> taps;
+		for (u32 i1 = 0; i1 < 2; ++i1) {
+			for (u32 i = 0; i < 7; ++i) {
+				i32 row_taps[_pixel_lanes::count];
+				for (u32 j1 = 0; j1 < _pixel_lanes::count; ++j1) {
+					row_taps[j1] = constants::intra_filter_taps[filter_intra_mode][(i1 << 2) + j1][i];
+				}
+				taps[i1][i] = _pixel_lanes::load(row_taps);
+			}
+		}
+		const i32 max_value = (1 << seq_header.color_config.bit_depth) - 1;
+#endif
 		for (u32 i2 = 0; i2 < h2; ++i2) {
 			for (u32 j4 = 0; j4 < w4; ++j4) {
 				std::array<u32, 7> p;
@@ -213,11 +373,30 @@ namespace lotus::av1::block_decoding {
 						}
 					}
 				}
+#ifdef LOTUS_AV1_PREDICTION_USE_SSE
+				std::array<_pixel_lanes, 7> p_lanes;
+				for (u32 i = 0; i < 7; ++i) {
+					p_lanes[i] = _pixel_lanes::broadcast(static_cast<i32>(p[i]));
+				}
+				const _pixel_lanes zero_lanes = _pixel_lanes::broadcast(0);
+				for (u32 i1 = 0; i1 < 2; ++i1) {
+					const std::array<_pixel_lanes, 7> &t = taps[i1];
+					const _pixel_lanes pr =
+						_pixel_lanes::weighted_sum(p_lanes[0], t[0], p_lanes[1], t[1]) +
+						_pixel_lanes::weighted_sum(p_lanes[2], t[2], p_lanes[3], t[3]) +
+						_pixel_lanes::weighted_sum(p_lanes[4], t[4], p_lanes[5], t[5]) +
+						_pixel_lanes::weighted_sum(p_lanes[6], t[6], zero_lanes, zero_lanes);
+					// negative sums are clipped to zero, so rounding towards negative infinity here is the same as
+					// Round2Signed()
+					const _pixel_lanes result =
+						_clamp(functions::round2(pr, constants::intra_filter_scale_bits), 0, max_value);
+					result.store(&pred[(i2 << 1) + i1][j4 << 2]);
+				}
+#else
 				for (u32 i1 = 0; i1 < 2; ++i1) {
 					for (u32 j1 = 0; j1 < 4; ++j1) {
 						i32 pr = 0;
 						for (u32 i = 0; i < 7; ++i) {
-							const u32 filter_intra_mode = std::to_underlying(mode_info.filter_intra_mode);
 							pr +=
 								constants::intra_filter_taps[filter_intra_mode][(i1 << 2) + j1][i] *
 								static_cast<i32>(p[i]);
@@ -228,6 +407,7 @@ namespace lotus::av1::block_decoding {
 						);
 					}
 				}
+#endif
 			}
 		}
 	}
@@ -289,53 +469,110 @@ namespace lotus::av1::block_decoding {
 			p_angle > 90 && p_angle < 180 ?
 			constants::dr_intra_derivative[p_angle - 90] :
 			(p_angle > 180 ? constants::dr_intra_derivative[270 - p_angle] : 0);
+		// without upsampling, the pixels of a row (or column) that are interpolated from the same edge use the same
+		// shift and consecutive edge pixels, so they are computed several at a time
 		// 7.
 		if (p_angle < 90) {
 			const u32 max_base_x = (w + h - 1) << upsample_above;
 			for (u32 i = 0; i < h; ++i) {
 				const u32 idx = (i + 1) * dx;
 				const u32 shift = ((idx << upsample_above) >> 1) & 0x1F;
-				for (u32 j = 0; j < w; ++j) {
+				u32 j = 0;
+#ifdef LOTUS_AV1_PREDICTION_USE_SSE
+				if (upsample_above == 0) {
+					const u32 base = idx >> 6;
+					const u32 num_interpolated = base < max_base_x ? std::min(w, max_base_x - base) : 0;
+					const _pixel_lanes weight0 = _pixel_lanes::broadcast(static_cast<i32>(32 - shift));
+					const _pixel_lanes weight1 = _pixel_lanes::broadcast(static_cast<i32>(shift));
+					for (; j + _pixel_lanes::count <= num_interpolated; j += _pixel_lanes::count) {
+						const _pixel_lanes a = _pixel_lanes::load(&above_row(base + j));
+						const _pixel_lanes b = _pixel_lanes::load(&above_row(base + j + 1));
+						functions::round2(_pixel_lanes::weighted_sum(a, weight0, b, weight1), 5).store(&pred[i][j]);
+					}
+				}
+#endif
+				for (; j < w; ++j) {
 					const u32 base = (idx >> (6 - upsample_above)) + (j << upsample_above);
 					if (base < max_base_x) {
 						pred[i][j] = static_cast<u16>(functions::round2(
 							above_row(base) * (32 - shift) + above_row(base + 1) * shift, 5
 						));
 					} else {
-						pred[i][j] = static_cast<u16>(above_row(max_base_x));
+						pred[i][j] = above_row(max_base_x);
 					}
 				}
 			}
 		}
 		// 8.
 		if (p_angle > 90 && p_angle < 180) {
+			const auto predict_pixel = [&](u32 i, u32 j) {
+				i32 idx = static_cast<i32>(j << 6) - static_cast<i32>((i + 1) * dx);
+				i32 base = idx >> (6 - upsample_above);
+				if (base >= -(1 << upsample_above)) {
+					const auto shift = static_cast<u32>(((idx << upsample_above) >> 1) & 0x1F);
+					pred[i][j] = static_cast<u16>(functions::round2(
+						above_row(base) * (32 - shift) + above_row(base + 1) * shift, 5
+					));
+				} else {
+					idx = static_cast<i32>(i << 6) - static_cast<i32>((j + 1) * dy);
+					base = idx >> (6 - upsample_left);
+					const auto shift = static_cast<u32>(((idx << upsample_left) >> 1) & 0x1F);
+					pred[i][j] = static_cast<u16>(functions::round2(
+						left_col(base) * (32 - shift) + left_col(base + 1) * shift, 5
+					));
+				}
+			};
 			for (u32 i = 0; i < h; ++i) {
-				for (u32 j = 0; j < w; ++j) {
-					i32 idx = static_cast<i32>(j << 6) - static_cast<i32>((i + 1) * dx);
-					i32 base = idx >> (6 - upsample_above);
-					if (base >= -(1 << upsample_above)) {
-						const auto shift = static_cast<u32>(((idx << upsample_above) >> 1) & 0x1F);
-						pred[i][j] = static_cast<u16>(functions::round2(
-							above_row(base) * (32 - shift) + above_row(base + 1) * shift, 5
-						));
-					} else {
-						idx = static_cast<i32>(i << 6) - static_cast<i32>((j + 1) * dy);
-						base = idx >> (6 - upsample_left);
-						const auto shift = static_cast<u32>(((idx << upsample_left) >> 1) & 0x1F);
-						pred[i][j] = static_cast<u16>(functions::round2(
-							left_col(base) * (32 - shift) + left_col(base + 1) * shift, 5
-						));
+				u32 j = 0;
+#ifdef LOTUS_AV1_PREDICTION_USE_SSE
+				if (upsample_above == 0) {
+					const i32 row_idx = -static_cast<i32>((i + 1) * dx);
+					const i32 row_base = row_idx >> 6;
+					// pixels to the left of this column are interpolated from LeftCol
+					const u32 first_above = std::min(static_cast<u32>(std::max(-1 - row_base, 0)), w);
+					for (; j < first_above; ++j) {
+						predict_pixel(i, j);
+					}
+					const i32 shift = (row_idx >> 1) & 0x1F;
+					const _pixel_lanes weight0 = _pixel_lanes::broadcast(32 - shift);
+					const _pixel_lanes weight1 = _pixel_lanes::broadcast(shift);
+					for (; j + _pixel_lanes::count <= w; j += _pixel_lanes::count) {
+						const i32 base = row_base + static_cast<i32>(j);
+						const _pixel_lanes a = _pixel_lanes::load(&above_row(base));
+						const _pixel_lanes b = _pixel_lanes::load(&above_row(base + 1));
+						functions::round2(_pixel_lanes::weighted_sum(a, weight0, b, weight1), 5).store(&pred[i][j]);
 					}
 				}
+#endif
+				for (; j < w; ++j) {
+					predict_pixel(i, j);
+				}
 			}
 		}
 		// 9.
 		if (p_angle > 180) {
-			for (u32 i = 0; i < h; ++i) {
-				for (u32 j = 0; j < w; ++j) {
-					const u32 idx = (j + 1) * dy;
+			for (u32 j = 0; j < w; ++j) {
+				const u32 idx = (j + 1) * dy;
+				const u32 shift = ((idx << upsample_left) >> 1) & 0x1F;
+				u32 i = 0;
+#ifdef LOTUS_AV1_PREDICTION_USE_SSE
+				if (upsample_left == 0) {
+					const u32 base = idx >> 6;
+					const _pixel_lanes weight0 = _pixel_lanes::broadcast(static_cast<i32>(32 - shift));
+					const _pixel_lanes weight1 = _pixel_lanes::broadcast(static_cast<i32>(shift));
+					for (; i < h; i += _pixel_lanes::count) {
+						const _pixel_lanes a = _pixel_lanes::load(&left_col(base + i));
+						const _pixel_lanes b = _pixel_lanes::load(&left_col(base + i + 1));
+						std::array<u16, _pixel_lanes::count> column;
+						functions::round2(_pixel_lanes::weighted_sum(a, weight0, b, weight1), 5).store(column.data());
+						for (u32 k = 0; k < _pixel_lanes::count; ++k) {
+							pred[i + k][j] = column[k];
+						}
+					}
+				}
+#endif
+				for (; i < h; ++i) {
 					const u32 base = (idx >> (6 - upsample_left)) + (i << upsample_left);
-					const u32 shift = ((idx << upsample_left) >> 1) & 0x1F;
 					pred[i][j] = static_cast<u16>(functions::round2(
 						left_col(base) * (32 - shift) + left_col(base + 1) * shift, 5
 					));
@@ -345,17 +582,13 @@ namespace lotus::av1::block_decoding {
 		// 10.
 		if (p_angle == 90) {
 			for (u32 i = 0; i < h; ++i) {
-				for (u32 j = 0; j < w; ++j) {
-					pred[i][j] = static_cast<u16>(above_row(j));
-				}
+				std::copy_n(&above_row(0), w, pred[i]);
 			}
 		}
 		// 11.
 		if (p_angle == 180) {
 			for (u32 i = 0; i < h; ++i) {
-				for (u32 j = 0; j < w; ++j) {
-					pred[i][j] = static_cast<u16>(left_col(i));
-				}
+				std::fill_n(pred[i], w, left_col(i));
 			}
 		}
 	}
@@ -391,9 +624,7 @@ namespace lotus::av1::block_decoding {
 			avg = 1 << (seq_header.color_config.bit_depth - 1);
 		}
 		for (u32 i = 0; i < h; ++i) {
-			for (u32 j = 0; j < w; ++j) {
-				pred[i][j] = static_cast<u16>(avg);
-			}
+			std::fill_n(pred[i], w, static_cast<u16>(avg));
 		}
 	}
 
@@ -411,9 +642,27 @@ namespace lotus::av1::block_decoding {
 
 		const std::span<const u8> sm_weights_x = get_weights_lut(log2w);
 		const std::span<const u8> sm_weights_y = get_weights_lut(log2h);
+#ifdef LOTUS_AV1_PREDICTION_USE_SSE
+		const _pixel_lanes bottom_left = _pixel_lanes::broadcast(left_col(h - 1));
+		const _pixel_lanes top_right = _pixel_lanes::broadcast(above_row(w - 1));
+		const _pixel_lanes scale = _pixel_lanes::broadcast(256);
+#endif
 		if (mode == prediction_mode::smooth) {
 			for (u32 i = 0; i < h; ++i) {
-				for (u32 j = 0; j < w; ++j) {
+				u32 j = 0;
+#ifdef LOTUS_AV1_PREDICTION_USE_SSE
+				const _pixel_lanes weight_y = _pixel_lanes::broadcast(sm_weights_y[i]);
+				const _pixel_lanes left = _pixel_lanes::broadcast(left_col(i));
+				for (; j < w; j += _pixel_lanes::count) {
+					const _pixel_lanes weight_x = _pixel_lanes::load(&sm_weights_x[j]);
+					const _pixel_lanes above = _pixel_lanes::load(&above_row(j));
+					const _pixel_lanes smooth_pred =
+						_pixel_lanes::weighted_sum(above, weight_y, bottom_left, scale - weight_y) +
+						_pixel_lanes::weighted_sum(left, weight_x, top_right, scale - weight_x);
+					functions::round2(smooth_pred, 9).store(&pred[i][j]);
+				}
+#endif
+				for (; j < w; ++j) {
 					const u32 smooth_pred =
 						sm_weights_y[i] * above_row(j) + (256 - sm_weights_y[i]) * left_col(h - 1) +
 						sm_weights_x[j] * left_col(i)  + (256 - sm_weights_x[j]) * above_row(w - 1);
@@ -422,7 +671,17 @@ namespace lotus::av1::block_decoding {
 			}
 		} else if (mode == prediction_mode::smooth_v) {
 			for (u32 i = 0; i < h; ++i) {
-				for (u32 j = 0; j < w; ++j) {
+				u32 j = 0;
+#ifdef LOTUS_AV1_PREDICTION_USE_SSE
+				const _pixel_lanes weight_y = _pixel_lanes::broadcast(sm_weights_y[i]);
+				for (; j < w; j += _pixel_lanes::count) {
+					const _pixel_lanes smooth_pred = _pixel_lanes::weighted_sum(
+						_pixel_lanes::load(&above_row(j)), weight_y, bottom_left, scale - weight_y
+					);
+					functions::round2(smooth_pred, 8).store(&pred[i][j]);
+				}
+#endif
+				for (; j < w; ++j) {
 					const u32 smooth_pred =
 						sm_weights_y[i] * above_row(j) + (256 - sm_weights_y[i]) * left_col(h - 1);
 					pred[i][j] = static_cast<u16>(functions::round2(smooth_pred, 8));
@@ -431,7 +690,17 @@ namespace lotus::av1::block_decoding {
 		} else {
 			crash_if(mode != prediction_mode::smooth_h);
 			for (u32 i = 0; i < h; ++i) {
-				for (u32 j = 0; j < w; ++j) {
+				u32 j = 0;
+#ifdef LOTUS_AV1_PREDICTION_USE_SSE
+				const _pixel_lanes left = _pixel_lanes::broadcast(left_col(i));
+				for (; j < w; j += _pixel_lanes::count) {
+					const _pixel_lanes weight_x = _pixel_lanes::load(&sm_weights_x[j]);
+					const _pixel_lanes smooth_pred =
+						_pixel_lanes::weighted_sum(left, weight_x, top_right, scale - weight_x);
+					functions::round2(smooth_pred, 8).store(&pred[i][j]);
+				}
+#endif
+				for (; j < w; ++j) {
 					const u32 smooth_pred =
 						sm_weights_x[j] * left_col(i) + (256 - sm_weights_x[j]) * above_row(w - 1);
 					pred[i][j] = static_cast<u16>(functions::round2(smooth_pred, 8));
@@ -441,10 +710,10 @@ namespace lotus::av1::block_decoding {
 	}
 
 	void prediction::intra_edge_upsample(const obu::color_config &color_config, u32 num_px, bool dir) {
-		u32 *buf = dir ? &left_col(0) : &above_row(0);
+		channel_t *buf = dir ? &left_col(0) : &above_row(0);
 
 		// create array dup
-		std::array<u32, 67> dup;
+		std::array<channel_t, 67> dup;
 		dup[0] = buf[-1];
 		for (i32 i = -1; i < static_cast<i32>(num_px); ++i) {
 			dup[static_cast<usize>(i + 2)] = buf[i];
@@ -454,13 +723,12 @@ namespace lotus::av1::block_decoding {
 		// upsample
 		buf[-2] = dup[0];
 		for (u32 i = 0; i < num_px; ++i) {
-			i32 s =
+			const i32 s =
 				-static_cast<i32>(dup[i]) +
 				9 * static_cast<i32>(dup[i + 1]) +
 				9 * static_cast<i32>(dup[i + 2]) -
 				static_cast<i32>(dup[i + 3]);
-			s = functions::clip1(color_config, functions::round2(s, 4));
-			buf[static_cast<i32>(2 * i) - 1] = static_cast<u32>(s);
+			buf[static_cast<i32>(2 * i) - 1] = functions::clip1(color_config, functions::round2(s, 4));
 			buf[2 * i] = dup[i + 2];
 		}
 	}
@@ -479,7 +747,7 @@ namespace lotus::av1::block_decoding {
 				const i32 k = std::clamp(i - 2 + static_cast<i32>(j), 0, static_cast<i32>(sz) - 1);
 				s += constants::intra_edge_kernel[strength - 1][j] * edge[static_cast<usize>(k)];
 			}
-			(left ? left_col(i - 1) : above_row(i - 1)) = (s + 8) >> 4;
+			(left ? left_col(i - 1) : above_row(i - 1)) = static_cast<channel_t>((s + 8) >> 4);
 		}
 	}
 
@@ -493,17 +761,38 @@ namespace lotus::av1::block_decoding {
 		const u32 h = constants::get_tx_height(tx_sz);
 		std::span<const channel_t> palette;
 		if (plane == 0) {
-			palette = mode_info.palette_colors_y;
+			palette = std::span(mode_info.palette_colors_y, mode_info.palette_size_y);
 		} else if (plane == 1) {
-			palette = mode_info.palette_colors_u;
+			palette = std::span(mode_info.palette_colors_u, mode_info.palette_size_uv);
 		} else {
 			crash_if(plane != 2);
-			palette = mode_info.palette_colors_v;
+			palette = std::span(mode_info.palette_colors_v, mode_info.palette_size_uv);
 		}
 		const state::color_map::channel &map = plane == 0 ? scm.color_map_y : scm.color_map_uv;
+#ifdef LOTUS_AV1_PREDICTION_USE_SSE
+		// palettes are small, so each color is selected using a comparison instead of a lookup
+		std::array<_pixel_lanes, constants::palette_colors> colors;
+		for (u32 c = 0; c < palette.size(); ++c) {
+			colors[c] = _pixel_lanes::broadcast(palette[c]);
+		}
+#endif
 		for (u32 i = 0; i < h; ++i) {
-			for (u32 j = 0; j < w; ++j) {
-				sb.curr_frame[plane](start_y + i, start_x + j) = palette[map[y * 4 + i][x * 4 + j]];
+			const u32 *indices = &map[y * 4 + i][x * 4];
+			channel_t *row = &sb.curr_frame[plane](start_y + i, start_x);
+			u32 j = 0;
+#ifdef LOTUS_AV1_PREDICTION_USE_SSE
+			for (; j < w; j += _pixel_lanes::count) {
+				const _pixel_lanes index = _pixel_lanes::load(indices + j);
+				_pixel_lanes result = colors[0];
+				for (u32 c = 1; c < palette.size(); ++c) {
+					const _pixel_lanes mask = index == _pixel_lanes::broadcast(static_cast<i32>(c));
+					result = _pixel_lanes::select(mask, colors[c], result);
+				}
+				result.store(row + j);
+			}
+#endif
+			for (; j < w; ++j) {
+				row[j] = palette[indices[j]];
 			}
 		}
 	}
@@ -633,9 +922,167 @@ namespace lotus::av1::block_decoding {
 		}
 	}
 
-	void inverse_transform_1d::butterfly_rotation(u32 a, u32 b, u32 angle, bool flip) {
-		const i32 x = t[a] * functions::cos128(angle) - t[b] * functions::sin128(angle);
-		const i32 y = t[a] * functions::sin128(angle) + t[b] * functions::cos128(angle);
+	/// Clamps the given value.
+	[[nodiscard]] static i32 _clamp(i32 x, i32 min, i32 max) {
+		return std::clamp(x, min, max);
+	}
+
+#if defined(LOTUS_AV1_TRANSFORM_USE_AVX2) || defined(LOTUS_AV1_TRANSFORM_USE_SSE)
+	/// Values at the same position of several independent 1D transforms. Arithmetic on all lanes matches that of
+	/// 32-bit integers, so transforms computed using this type are bit-exact with scalar ones.
+	struct _transform_lanes {
+#	if defined(LOTUS_AV1_TRANSFORM_USE_AVX2)
+		using vector_t = __m256i; ///< Vector type.
+		constexpr static u32 count = 8; ///< Number of lanes.
+#	elif defined(LOTUS_AV1_TRANSFORM_USE_SSE)
+		using vector_t = __m128i; ///< Vector type.
+		constexpr static u32 count = 4; ///< Number of lanes.
+#	endif
+		/// A square block of lanes.
+		using block_t = std::array<_transform_lanes, count>;
+
+		/// No initialization.
+		_transform_lanes() = default;
+		/// Initializes the vector.
+		_transform_lanes(vector_t v) : value(v) {
+		}
+
+		/// Loads consecutive values.
+		[[nodiscard]] static _transform_lanes load(const i32 *ptr) {
+#	if defined(LOTUS_AV1_TRANSFORM_USE_AVX2)
+			return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(ptr));
+#	elif defined(LOTUS_AV1_TRANSFORM_USE_SSE)
+			return _mm_loadu_si128(reinterpret_cast<const __m128i*>(ptr));
+#	endif
+		}
+		/// Stores consecutive values.
+		void store(i32 *ptr) const {
+#	if defined(LOTUS_AV1_TRANSFORM_USE_AVX2)
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(ptr), value);
+#	elif defined(LOTUS_AV1_TRANSFORM_USE_SSE)
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(ptr), value);
+#	endif
+		}
+		/// Returns a vector with all lanes set to the given value.
+		[[nodiscard]] static _transform_lanes broadcast(i32 x) {
+#	if defined(LOTUS_AV1_TRANSFORM_USE_AVX2)
+			return _mm256_set1_epi32(x);
+#	elif defined(LOTUS_AV1_TRANSFORM_USE_SSE)
+			return _mm_set1_epi32(x);
+#	endif
+		}
+
+		/// Transposes the given block in place.
+		static void transpose(block_t &b) {
+#	if defined(LOTUS_AV1_TRANSFORM_USE_AVX2)
+			__m256i t[8];
+			for (u32 i = 0; i < 8; i += 2) {
+				t[i]     = _mm256_unpacklo_epi32(b[i].value, b[i + 1].value);
+				t[i + 1] = _mm256_unpackhi_epi32(b[i].value, b[i + 1].value);
+			}
+			__m256i u[8];
+			for (u32 i = 0; i < 8; i += 4) {
+				u[i]     = _mm256_unpacklo_epi64(t[i],     t[i + 2]);
+				u[i + 1] = _mm256_unpackhi_epi64(t[i],     t[i + 2]);
+				u[i + 2] = _mm256_unpacklo_epi64(t[i + 1], t[i + 3]);
+				u[i + 3] = _mm256_unpackhi_epi64(t[i + 1], t[i + 3]);
+			}
+			for (u32 i = 0; i < 4; ++i) {
+				b[i]     = _mm256_permute2x128_si256(u[i], u[i + 4], 0x20);
+				b[i + 4] = _mm256_permute2x128_si256(u[i], u[i + 4], 0x31);
+			}
+#	elif defined(LOTUS_AV1_TRANSFORM_USE_SSE)
+			const __m128i t0 = _mm_unpacklo_epi32(b[0].value, b[1].value);
+			const __m128i t1 = _mm_unpackhi_epi32(b[0].value, b[1].value);
+			const __m128i t2 = _mm_unpacklo_epi32(b[2].value, b[3].value);
+			const __m128i t3 = _mm_unpackhi_epi32(b[2].value, b[3].value);
+			b[0] = _mm_unpacklo_epi64(t0, t2);
+			b[1] = _mm_unpackhi_epi64(t0, t2);
+			b[2] = _mm_unpacklo_epi64(t1, t3);
+			b[3] = _mm_unpackhi_epi64(t1, t3);
+#	endif
+		}
+
+		/// Addition.
+		[[nodiscard]] friend _transform_lanes operator+(_transform_lanes lhs, _transform_lanes rhs) {
+#	if defined(LOTUS_AV1_TRANSFORM_USE_AVX2)
+			return _mm256_add_epi32(lhs.value, rhs.value);
+#	elif defined(LOTUS_AV1_TRANSFORM_USE_SSE)
+			return _mm_add_epi32(lhs.value, rhs.value);
+#	endif
+		}
+		/// \overload
+		[[nodiscard]] friend _transform_lanes operator+(_transform_lanes lhs, i32 rhs) {
+			return lhs + broadcast(rhs);
+		}
+		/// Subtraction.
+		[[nodiscard]] friend _transform_lanes operator-(_transform_lanes lhs, _transform_lanes rhs) {
+#	if defined(LOTUS_AV1_TRANSFORM_USE_AVX2)
+			return _mm256_sub_epi32(lhs.value, rhs.value);
+#	elif defined(LOTUS_AV1_TRANSFORM_USE_SSE)
+			return _mm_sub_epi32(lhs.value, rhs.value);
+#	endif
+		}
+		/// Negation.
+		[[nodiscard]] friend _transform_lanes operator-(_transform_lanes v) {
+			return broadcast(0) - v;
+		}
+		/// Multiplication, keeping the lower 32 bits of the results.
+		[[nodiscard]] friend _transform_lanes operator*(_transform_lanes lhs, i32 rhs) {
+			const _transform_lanes r = broadcast(rhs);
+#	if defined(LOTUS_AV1_TRANSFORM_USE_AVX2)
+			return _mm256_mullo_epi32(lhs.value, r.value);
+#	elif defined(LOTUS_AV1_TRANSFORM_USE_SSE)
+#		ifdef LOTUS_AV1_TRANSFORM_USE_SSE4_1
+			return _mm_mullo_epi32(lhs.value, r.value);
+#		else
+			// the lower 32 bits of the products are the same for signed and unsigned operands
+			const __m128i even = _mm_mul_epu32(lhs.value, r.value);
+			const __m128i odd = _mm_mul_epu32(_mm_srli_epi64(lhs.value, 32), _mm_srli_epi64(r.value, 32));
+			return _mm_unpacklo_epi32(
+				_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)), _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0))
+			);
+#		endif
+#	endif
+		}
+		/// \overload
+		[[nodiscard]] friend _transform_lanes operator*(i32 lhs, _transform_lanes rhs) {
+			return rhs * lhs;
+		}
+		/// Arithmetic right shift.
+		[[nodiscard]] friend _transform_lanes operator>>(_transform_lanes lhs, u32 rhs) {
+#	if defined(LOTUS_AV1_TRANSFORM_USE_AVX2)
+			return _mm256_sra_epi32(lhs.value, _mm_cvtsi32_si128(static_cast<i32>(rhs)));
+#	elif defined(LOTUS_AV1_TRANSFORM_USE_SSE)
+			return _mm_sra_epi32(lhs.value, _mm_cvtsi32_si128(static_cast<i32>(rhs)));
+#	endif
+		}
+
+		/// Clamps all lanes.
+		[[nodiscard]] friend _transform_lanes _clamp(_transform_lanes x, i32 min, i32 max) {
+			const _transform_lanes lo = broadcast(min);
+			const _transform_lanes hi = broadcast(max);
+#	if defined(LOTUS_AV1_TRANSFORM_USE_AVX2)
+			return _mm256_min_epi32(_mm256_max_epi32(x.value, lo.value), hi.value);
+#	elif defined(LOTUS_AV1_TRANSFORM_USE_SSE)
+#		ifdef LOTUS_AV1_TRANSFORM_USE_SSE4_1
+			return _mm_min_epi32(_mm_max_epi32(x.value, lo.value), hi.value);
+#		else
+			const __m128i below = _mm_cmplt_epi32(x.value, lo.value);
+			const __m128i x1 = _mm_or_si128(_mm_and_si128(below, lo.value), _mm_andnot_si128(below, x.value));
+			const __m128i above = _mm_cmpgt_epi32(x1, hi.value);
+			return _mm_or_si128(_mm_and_si128(above, hi.value), _mm_andnot_si128(above, x1));
+#		endif
+#	endif
+		}
+
+		vector_t value; ///< The values.
+	};
+#endif
+
+	template <typename Value> void basic_inverse_transform_1d<Value>::butterfly_rotation(u32 a, u32 b, u32 angle, bool flip) {
+		const value_t x = t[a] * functions::cos128(angle) - t[b] * functions::sin128(angle);
+		const value_t y = t[a] * functions::sin128(angle) + t[b] * functions::cos128(angle);
 		t[a] = functions::round2(x, 12);
 		t[b] = functions::round2(y, 12);
 		if (flip) {
@@ -643,24 +1090,24 @@ namespace lotus::av1::block_decoding {
 		}
 	}
 
-	void inverse_transform_1d::hadamard_rotation(u32 a, u32 b, bool flip, u32 r) {
+	template <typename Value> void basic_inverse_transform_1d<Value>::hadamard_rotation(u32 a, u32 b, bool flip, u32 r) {
 		if (flip) {
 			std::swap(a, b);
 		}
-		const i32 x = t[a];
-		const i32 y = t[b];
-		t[a] = std::clamp(x + y, -(1 << (r - 1)), (1 << (r - 1)) - 1);
-		t[b] = std::clamp(x - y, -(1 << (r - 1)), (1 << (r - 1)) - 1);
+		const value_t x = t[a];
+		const value_t y = t[b];
+		t[a] = _clamp(x + y, -(1 << (r - 1)), (1 << (r - 1)) - 1);
+		t[b] = _clamp(x - y, -(1 << (r - 1)), (1 << (r - 1)) - 1);
 	}
 
-	void inverse_transform_1d::permute_dct(u32 n) {
+	template <typename Value> void basic_inverse_transform_1d<Value>::permute_dct(u32 n) {
 		const array_t copy_t = t;
 		for (u32 i = 0; i < (1u << n) - 1; ++i) {
 			t[i] = copy_t[functions::brev(n, i)];
 		}
 	}
 
-	void inverse_transform_1d::inverse_dct(u32 n, u32 r) {
+	template <typename Value> void basic_inverse_transform_1d<Value>::inverse_dct(u32 n, u32 r) {
 		// 1.
 		permute_dct(n);
 		// 2.
@@ -861,7 +1308,7 @@ namespace lotus::av1::block_decoding {
 		}
 	}
 
-	void inverse_transform_1d::permute_adst_input(u32 n) {
+	template <typename Value> void basic_inverse_transform_1d<Value>::permute_adst_input(u32 n) {
 		const u32 n0 = 1u << n;
 		const array_t copy_t = t;
 		for (u32 i = 0; i < n0; ++i) {
@@ -870,7 +1317,7 @@ namespace lotus::av1::block_decoding {
 		}
 	}
 
-	void inverse_transform_1d::permute_adst_output(u32 n) {
+	template <typename Value> void basic_inverse_transform_1d<Value>::permute_adst_output(u32 n) {
 		const u32 n0 = 1u << n;
 		const array_t copy_t = t;
 		for (u32 i = 0; i < n0; ++i) {
@@ -883,9 +1330,9 @@ namespace lotus::av1::block_decoding {
 		}
 	}
 
-	void inverse_transform_1d::inverse_adst4(u32 r) {
-		i32 s[7];
-		i32 x[4];
+	template <typename Value> void basic_inverse_transform_1d<Value>::inverse_adst4(u32 r) {
+		value_t s[7];
+		value_t x[4];
 
 		s[0] = constants::sinpi_1_9 * t[0];
 		s[1] = constants::sinpi_2_9 * t[0];
@@ -894,8 +1341,8 @@ namespace lotus::av1::block_decoding {
 		s[4] = constants::sinpi_1_9 * t[2];
 		s[5] = constants::sinpi_2_9 * t[3];
 		s[6] = constants::sinpi_4_9 * t[3];
-		const i32 a7 = t[0] - t[2];
-		const i32 b7 = a7 + t[3];
+		const value_t a7 = t[0] - t[2];
+		const value_t b7 = a7 + t[3];
 
 		s[0] = s[0] + s[3];
 		s[1] = s[1] - s[4];
@@ -918,7 +1365,7 @@ namespace lotus::av1::block_decoding {
 		t[3] = functions::round2(x[3], 12);
 	}
 
-	void inverse_transform_1d::inverse_adst8(u32 r) {
+	template <typename Value> void basic_inverse_transform_1d<Value>::inverse_adst8(u32 r) {
 		// 1.
 		permute_adst_input(3);
 		// 2.
@@ -947,7 +1394,7 @@ namespace lotus::av1::block_decoding {
 		permute_adst_output(3);
 	}
 
-	void inverse_transform_1d::inverse_adst16(u32 r) {
+	template <typename Value> void basic_inverse_transform_1d<Value>::inverse_adst16(u32 r) {
 		// 1.
 		permute_adst_input(4);
 		// 2.
@@ -989,7 +1436,7 @@ namespace lotus::av1::block_decoding {
 		permute_adst_output(4);
 	}
 
-	void inverse_transform_1d::inverse_adst(u32 n, u32 r) {
+	template <typename Value> void basic_inverse_transform_1d<Value>::inverse_adst(u32 n, u32 r) {
 		if (n == 2) {
 			inverse_adst4(r);
 		} else if (n == 3) {
@@ -1000,31 +1447,31 @@ namespace lotus::av1::block_decoding {
 		}
 	}
 
-	void inverse_transform_1d::inverse_idtx4() {
+	template <typename Value> void basic_inverse_transform_1d<Value>::inverse_idtx4() {
 		for (u32 i = 0; i < 4; ++i) {
 			t[i] = functions::round2(t[i] * 5793, 12);
 		}
 	}
 
-	void inverse_transform_1d::inverse_idtx8() {
+	template <typename Value> void basic_inverse_transform_1d<Value>::inverse_idtx8() {
 		for (u32 i = 0; i < 8; ++i) {
 			t[i] = t[i] * 2;
 		}
 	}
 
-	void inverse_transform_1d::inverse_idtx16() {
+	template <typename Value> void basic_inverse_transform_1d<Value>::inverse_idtx16() {
 		for (u32 i = 0; i < 16; ++i) {
 			t[i] = functions::round2(t[i] * 11586, 12);
 		}
 	}
 
-	void inverse_transform_1d::inverse_idtx32() {
+	template <typename Value> void basic_inverse_transform_1d<Value>::inverse_idtx32() {
 		for (u32 i = 0; i < 32; ++i) {
 			t[i] = t[i] * 4;
 		}
 	}
 
-	void inverse_transform_1d::inverse_idtx(u32 n) {
+	template <typename Value> void basic_inverse_transform_1d<Value>::inverse_idtx(u32 n) {
 		if (n == 2) {
 			inverse_idtx4();
 		} else if (n == 3) {
@@ -1037,6 +1484,198 @@ namespace lotus::av1::block_decoding {
 		}
 	}
 
+	template struct basic_inverse_transform_1d<i32>;
+
+
+	/// Type of a 1D transform.
+	enum class _transform_1d_type : u8 {
+		dct,      ///< Inverse DCT.
+		adst,     ///< Inverse ADST.
+		identity, ///< Inverse identity transform.
+	};
+	/// Returns the type of the row transforms for the given transform type.
+	[[nodiscard]] static _transform_1d_type _get_row_transform_type(inverse_transform type) {
+		switch (type) {
+		case inverse_transform::dct_dct:      [[fallthrough]];
+		case inverse_transform::adst_dct:     [[fallthrough]];
+		case inverse_transform::flipadst_dct: [[fallthrough]];
+		case inverse_transform::h_dct:
+			return _transform_1d_type::dct;
+		case inverse_transform::dct_adst:          [[fallthrough]];
+		case inverse_transform::adst_adst:         [[fallthrough]];
+		case inverse_transform::dct_flipadst:      [[fallthrough]];
+		case inverse_transform::flipadst_flipadst: [[fallthrough]];
+		case inverse_transform::adst_flipadst:     [[fallthrough]];
+		case inverse_transform::flipadst_adst:     [[fallthrough]];
+		case inverse_transform::h_adst:            [[fallthrough]];
+		case inverse_transform::h_flipadst:
+			return _transform_1d_type::adst;
+		default:
+			return _transform_1d_type::identity;
+		}
+	}
+	/// Returns the type of the column transforms for the given transform type.
+	[[nodiscard]] static _transform_1d_type _get_column_transform_type(inverse_transform type) {
+		switch (type) {
+		case inverse_transform::dct_dct:      [[fallthrough]];
+		case inverse_transform::dct_adst:     [[fallthrough]];
+		case inverse_transform::dct_flipadst: [[fallthrough]];
+		case inverse_transform::v_dct:
+			return _transform_1d_type::dct;
+		case inverse_transform::adst_dct:          [[fallthrough]];
+		case inverse_transform::adst_adst:         [[fallthrough]];
+		case inverse_transform::flipadst_dct:      [[fallthrough]];
+		case inverse_transform::flipadst_flipadst: [[fallthrough]];
+		case inverse_transform::adst_flipadst:     [[fallthrough]];
+		case inverse_transform::flipadst_adst:     [[fallthrough]];
+		case inverse_transform::v_adst:            [[fallthrough]];
+		case inverse_transform::v_flipadst:
+			return _transform_1d_type::adst;
+		default:
+			return _transform_1d_type::identity;
+		}
+	}
+	/// Applies the given 1D transform.
+	template <typename Value> static void _inverse_transform(
+		basic_inverse_transform_1d<Value> &t, _transform_1d_type type, u32 n, u32 r
+	) {
+		switch (type) {
+		case _transform_1d_type::dct:
+			t.inverse_dct(n, r);
+			break;
+		case _transform_1d_type::adst:
+			t.inverse_adst(n, r);
+			break;
+		case _transform_1d_type::identity:
+			t.inverse_idtx(n);
+			break;
+		}
+	}
+
+	/// Parameters of a 2D inverse transform.
+	struct _transform_2d_params {
+		u32 log2w = 0; ///< Log2 of the width.
+		u32 log2h = 0; ///< Log2 of the height.
+		_transform_1d_type row_type = _transform_1d_type::dct; ///< Type of the row transforms.
+		_transform_1d_type column_type = _transform_1d_type::dct; ///< Type of the column transforms.
+		u32 row_shift = 0; ///< Shift after row transforms.
+		u32 col_shift = 0; ///< Shift after column transforms.
+		u32 row_clamp_range = 0; ///< Clamping range of row transforms.
+		u32 col_clamp_range = 0; ///< Clamping range of column transforms.
+	};
+
+	/// Loads \p Dequant values of row \p i into the transform.
+	static void _load_rows(inverse_transform_1d &t, const state::coeffs &sc, u32 i, u32 w) {
+		for (u32 j = 0; j < w; ++j) {
+			t.t[j] = j < 32 ? sc.dequant[i][j] : 0;
+		}
+	}
+	/// Stores results of the row transform of row \p i into \p Residual.
+	static void _store_rows(const inverse_transform_1d &t, state::coeffs &sc, u32 i, u32 w) {
+		for (u32 j = 0; j < w; ++j) {
+			sc.residual[i][j] = t.t[j];
+		}
+	}
+	/// Loads \p Residual values of column \p j into the transform.
+	static void _load_columns(inverse_transform_1d &t, const state::coeffs &sc, u32 j, u32 h) {
+		for (u32 i = 0; i < h; ++i) {
+			t.t[i] = sc.residual[i][j];
+		}
+	}
+	/// Stores results of the column transform of column \p j into \p Residual.
+	static void _store_columns(const inverse_transform_1d &t, state::coeffs &sc, u32 j, u32 h) {
+		for (u32 i = 0; i < h; ++i) {
+			sc.residual[i][j] = t.t[i];
+		}
+	}
+#if defined(LOTUS_AV1_TRANSFORM_USE_AVX2) || defined(LOTUS_AV1_TRANSFORM_USE_SSE)
+	/// Loads \p Dequant values of rows \p i to <tt>i + _transform_lanes::count - 1</tt> into the transform, one row
+	/// per lane.
+	static void _load_rows(basic_inverse_transform_1d<_transform_lanes> &t, const state::coeffs &sc, u32 i, u32 w) {
+		const u32 load_width = std::min(w, 32u);
+		for (u32 j = 0; j < load_width; j += _transform_lanes::count) {
+			_transform_lanes::block_t block;
+			for (u32 k = 0; k < _transform_lanes::count; ++k) {
+				block[k] = _transform_lanes::load(&sc.dequant[i + k][j]);
+			}
+			_transform_lanes::transpose(block);
+			std::ranges::copy(block, t.t.begin() + j);
+		}
+		for (u32 j = load_width; j < w; ++j) {
+			t.t[j] = _transform_lanes::broadcast(0);
+		}
+	}
+	/// Stores results of the row transforms of rows \p i to <tt>i + _transform_lanes::count - 1</tt> into
+	/// \p Residual.
+	static void _store_rows(
+		const basic_inverse_transform_1d<_transform_lanes> &t, state::coeffs &sc, u32 i, u32 w
+	) {
+		for (u32 j = 0; j < w; j += _transform_lanes::count) {
+			_transform_lanes::block_t block;
+			std::copy_n(t.t.begin() + j, _transform_lanes::count, block.begin());
+			_transform_lanes::transpose(block);
+			for (u32 k = 0; k < _transform_lanes::count; ++k) {
+				block[k].store(&sc.residual[i + k][j]);
+			}
+		}
+	}
+	/// Loads \p Residual values of columns \p j to <tt>j + _transform_lanes::count - 1</tt> into the transform, one
+	/// column per lane.
+	static void _load_columns(
+		basic_inverse_transform_1d<_transform_lanes> &t, const state::coeffs &sc, u32 j, u32 h
+	) {
+		for (u32 i = 0; i < h; ++i) {
+			t.t[i] = _transform_lanes::load(&sc.residual[i][j]);
+		}
+	}
+	/// Stores results of the column transforms of columns \p j to <tt>j + _transform_lanes::count - 1</tt> into
+	/// \p Residual.
+	static void _store_columns(
+		const basic_inverse_transform_1d<_transform_lanes> &t, state::coeffs &sc, u32 j, u32 h
+	) {
+		for (u32 i = 0; i < h; ++i) {
+			t.t[i].store(&sc.residual[i][j]);
+		}
+	}
+#endif
+
+	/// Computes the row transforms of the row(s) starting from row \p i, applies the row shift, and clamps the
+	/// results to the range of the column transforms.
+	template <typename Value> static void _inverse_transform_rows(
+		const _transform_2d_params &params, state::coeffs &sc, u32 i
+	) {
+		const u32 w = 1u << params.log2w;
+		basic_inverse_transform_1d<Value> t = uninitialized;
+		_load_rows(t, sc, i, w);
+		if (std::abs(static_cast<i32>(params.log2w) - static_cast<i32>(params.log2h)) == 1) {
+			for (u32 j = 0; j < w; ++j) {
+				t.t[j] = functions::round2(t.t[j] * 2896, 12);
+			}
+		}
+		_inverse_transform(t, params.row_type, params.log2w, params.row_clamp_range);
+		for (u32 j = 0; j < w; ++j) {
+			t.t[j] = _clamp(
+				functions::round2(t.t[j], params.row_shift),
+				-(1 << (params.col_clamp_range - 1)),
+				(1 << (params.col_clamp_range - 1)) - 1
+			);
+		}
+		_store_rows(t, sc, i, w);
+	}
+	/// Computes the column transforms of the column(s) starting from column \p j, and applies the column shift.
+	template <typename Value> static void _inverse_transform_columns(
+		const _transform_2d_params &params, state::coeffs &sc, u32 j
+	) {
+		const u32 h = 1u << params.log2h;
+		basic_inverse_transform_1d<Value> t = uninitialized;
+		_load_columns(t, sc, j, h);
+		_inverse_transform(t, params.column_type, params.log2h, params.col_clamp_range);
+		for (u32 i = 0; i < h; ++i) {
+			t.t[i] = functions::round2(t.t[i], params.col_shift);
+		}
+		_store_columns(t, sc, j, h);
+	}
+
 	void inverse_transform_2d(
 		const obu::sequence_header &seq_header,
 		const obu::mode_info &mode_info,
@@ -1044,100 +1683,48 @@ namespace lotus::av1::block_decoding {
 		state::coeffs &sc,
 		tx_size tx_sz
 	) {
-		const u32 log2w = constants::get_tx_width_log2(tx_sz);
-		const u32 log2h = constants::get_tx_height_log2(tx_sz);
-		const u32 w = 1u << log2w;
-		const u32 h = 1u << log2h;
-		const u32 row_shift = mode_info.lossless ? 0 : constants::transform_row_shift[std::to_underlying(tx_sz)];
-		const u32 col_shift = mode_info.lossless ? 0 : 4;
-		const u32 row_clamp_range = seq_header.color_config.bit_depth + 8;
-		const u32 col_clamp_range = std::max(seq_header.color_config.bit_depth + 6u, 16u);
-
-		// row transforms
-		for (u32 i = 0; i < h; ++i) {
-			inverse_transform_1d t = uninitialized;
-			for (u32 j = 0; j < w; ++j) {
-				t.t[j] = i < 32 && j < 32 ? sc.dequant[i][j] : 0;
-			}
-			if (std::abs(static_cast<i32>(log2w) - static_cast<i32>(log2h)) == 1) {
-				for (u32 j = 0; j < w; ++j) {
-					t.t[j] = functions::round2(t.t[j] * 2896, 12);
-				}
-			}
-			if (mode_info.lossless) {
-				std::abort(); // TODO
-			} else {
-				switch (sb.plane_tx_type) {
-				case inverse_transform::dct_dct:      [[fallthrough]];
-				case inverse_transform::adst_dct:     [[fallthrough]];
-				case inverse_transform::flipadst_dct: [[fallthrough]];
-				case inverse_transform::h_dct:
-					t.inverse_dct(log2w, row_clamp_range);
-					break;
-				case inverse_transform::dct_adst:          [[fallthrough]];
-				case inverse_transform::adst_adst:         [[fallthrough]];
-				case inverse_transform::dct_flipadst:      [[fallthrough]];
-				case inverse_transform::flipadst_flipadst: [[fallthrough]];
-				case inverse_transform::adst_flipadst:     [[fallthrough]];
-				case inverse_transform::flipadst_adst:     [[fallthrough]];
-				case inverse_transform::h_adst:            [[fallthrough]];
-				case inverse_transform::h_flipadst:
-					t.inverse_adst(log2w, row_clamp_range);
-					break;
-				default:
-					t.inverse_idtx(log2w);
-					break;
-				}
-			}
-			for (u32 j = 0; j < w; ++j) {
-				sc.residual[i][j] = functions::round2(t.t[j], row_shift);
-			}
+		if (mode_info.lossless) {
+			std::abort(); // TODO
 		}
 
-		for (u32 i = 0; i < h; ++i) {
-			for (u32 j = 0; j < w; ++j) {
-				sc.residual[i][j] = std::clamp(
-					sc.residual[i][j],
-					-(1 << (col_clamp_range - 1)),
-					(1 << (col_clamp_range - 1)) - 1
-				);
+		_transform_2d_params params;
+		params.log2w = constants::get_tx_width_log2(tx_sz);
+		params.log2h = constants::get_tx_height_log2(tx_sz);
+		params.row_type = _get_row_transform_type(sb.plane_tx_type);
+		params.column_type = _get_column_transform_type(sb.plane_tx_type);
+		params.row_shift = constants::transform_row_shift[std::to_underlying(tx_sz)];
+		params.col_shift = 4;
+		params.row_clamp_range = seq_header.color_config.bit_depth + 8;
+		params.col_clamp_range = std::max(seq_header.color_config.bit_depth + 6u, 16u);
+		const u32 w = 1u << params.log2w;
+		const u32 h = 1u << params.log2h;
+
+		// row transforms. only the top left 32x32 coefficients can be nonzero, and the other rows transform to zero
+		const u32 num_nonzero_rows = std::min(h, 32u);
+		u32 i = 0;
+#if defined(LOTUS_AV1_TRANSFORM_USE_AVX2) || defined(LOTUS_AV1_TRANSFORM_USE_SSE)
+		if (w >= _transform_lanes::count) {
+			for (; i + _transform_lanes::count <= num_nonzero_rows; i += _transform_lanes::count) {
+				_inverse_transform_rows<_transform_lanes>(params, sc, i);
 			}
 		}
+#endif
+		for (; i < num_nonzero_rows; ++i) {
+			_inverse_transform_rows<i32>(params, sc, i);
+		}
+		for (; i < h; ++i) {
+			std::fill_n(sc.residual[i], w, 0);
+		}
 
 		// column transforms
-		for (u32 j = 0; j < w; ++j) {
-			inverse_transform_1d t = uninitialized;
-			for (u32 i = 0; i < h; ++i) {
-				t.t[i] = sc.residual[i][j];
-			}
-			if (mode_info.lossless) {
-				std::abort(); // TODO
-			} else {
-				switch (sb.plane_tx_type) {
-				case inverse_transform::dct_dct:      [[fallthrough]];
-				case inverse_transform::dct_adst:     [[fallthrough]];
-				case inverse_transform::dct_flipadst: [[fallthrough]];
-				case inverse_transform::v_dct:
-					t.inverse_dct(log2h, col_clamp_range);
-					break;
-				case inverse_transform::adst_dct:          [[fallthrough]];
-				case inverse_transform::adst_adst:         [[fallthrough]];
-				case inverse_transform::flipadst_dct:      [[fallthrough]];
-				case inverse_transform::flipadst_flipadst: [[fallthrough]];
-				case inverse_transform::adst_flipadst:     [[fallthrough]];
-				case inverse_transform::flipadst_adst:     [[fallthrough]];
-				case inverse_transform::v_adst:            [[fallthrough]];
-				case inverse_transform::v_flipadst:
-					t.inverse_adst(log2h, col_clamp_range);
-					break;
-				default:
-					t.inverse_idtx(log2h);
-					break;
-				}
-			}
-			for (u32 i = 0; i < h; ++i) {
-				sc.residual[i][j] = functions::round2(t.t[i], col_shift);
-			}
+		u32 j = 0;
+#if defined(LOTUS_AV1_TRANSFORM_USE_AVX2) || defined(LOTUS_AV1_TRANSFORM_USE_SSE)
+		for (; j + _transform_lanes::count <= w; j += _transform_lanes::count) {
+			_inverse_transform_columns<_transform_lanes>(params, sc, j);
+		}
+#endif
+		for (; j < w; ++j) {
+			_inverse_transform_columns<i32>(params, sc, j);
 		}
 	}
 }
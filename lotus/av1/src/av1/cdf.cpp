@@ -4405,6 +4405,22 @@ namespace lotus::av1::cdf {
 	}
 
 
+	/// Sets the symbol counters of the given CDF array, array of CDF arrays, or CDF table to zero.
+	template <typename T> static void _clear_symbol_counters(T &cdf) {
+		if constexpr (std::is_same_v<std::remove_extent_t<T>, value_t>) {
+			cdf[std::extent_v<T> - 1] = 0;
+		} else if constexpr (std::is_array_v<T>) {
+			for (auto &elem : cdf) {
+				_clear_symbol_counters(elem);
+			}
+		} else if constexpr (requires { cdf.values; }) {
+			_clear_symbol_counters(cdf.values);
+		} else {
+			_clear_symbol_counters(cdf.value);
+		}
+	}
+
+
 	const non_coeff non_coeff::defaults = {
 		// 155
 		.y_mode                  = defaults::y_mode,
@@ -4485,6 +4501,81 @@ namespace lotus::av1::cdf {
 	};
 
 
+	void non_coeff::clear_symbol_counters() {
+		_clear_symbol_counters(y_mode);
+		_clear_symbol_counters(uv_mode_cfl_not_allowed);
+		_clear_symbol_counters(uv_mode_cfl_allowed);
+		_clear_symbol_counters(angle_delta);
+		_clear_symbol_counters(intrabc);
+		_clear_symbol_counters(partition_w8);
+		_clear_symbol_counters(partition_w16);
+		_clear_symbol_counters(partition_w32);
+		_clear_symbol_counters(partition_w64);
+		_clear_symbol_counters(partition_w128);
+		_clear_symbol_counters(segment_id);
+		_clear_symbol_counters(segment_id_predicted);
+		_clear_symbol_counters(tx_8x8);
+		_clear_symbol_counters(tx_16x16);
+		_clear_symbol_counters(tx_32x32);
+		_clear_symbol_counters(tx_64x64);
+		_clear_symbol_counters(txfm_split);
+		_clear_symbol_counters(filter_intra_mode);
+		_clear_symbol_counters(filter_intra);
+		_clear_symbol_counters(interp_filter);
+		_clear_symbol_counters(new_mv);
+		_clear_symbol_counters(zero_mv);
+		_clear_symbol_counters(ref_mv);
+		_clear_symbol_counters(compound_mode);
+		_clear_symbol_counters(drl_mode);
+		_clear_symbol_counters(is_inter);
+		_clear_symbol_counters(skip_mode);
+		_clear_symbol_counters(skip);
+		_clear_symbol_counters(mv_joint);
+		_clear_symbol_counters(mv_class);
+		_clear_symbol_counters(mv_class0_bit);
+		_clear_symbol_counters(mv_fr);
+		_clear_symbol_counters(mv_class0_fr);
+		_clear_symbol_counters(mv_class0_hp);
+		_clear_symbol_counters(mv_sign);
+		_clear_symbol_counters(mv_bit);
+		_clear_symbol_counters(mv_hp);
+		_clear_symbol_counters(palette_y_mode);
+		_clear_symbol_counters(palette_uv_mode);
+		_clear_symbol_counters(palette_y_size);
+		_clear_symbol_counters(palette_uv_size);
+		_clear_symbol_counters(palette_size_2_y_color);
+		_clear_symbol_counters(palette_size_2_uv_color);
+		_clear_symbol_counters(palette_size_3_y_color);
+		_clear_symbol_counters(palette_size_3_uv_color);
+		_clear_symbol_counters(palette_size_4_y_color);
+		_clear_symbol_counters(palette_size_4_uv_color);
+		_clear_symbol_counters(palette_size_5_y_color);
+		_clear_symbol_counters(palette_size_5_uv_color);
+		_clear_symbol_counters(palette_size_6_y_color);
+		_clear_symbol_counters(palette_size_6_uv_color);
+		_clear_symbol_counters(palette_size_7_y_color);
+		_clear_symbol_counters(palette_size_7_uv_color);
+		_clear_symbol_counters(palette_size_8_y_color);
+		_clear_symbol_counters(palette_size_8_uv_color);
+		_clear_symbol_counters(delta_q);
+		_clear_symbol_counters(delta_lf);
+		_clear_symbol_counters(delta_lf_multi);
+		_clear_symbol_counters(intra_tx_type_set1);
+		_clear_symbol_counters(intra_tx_type_set2);
+		_clear_symbol_counters(inter_tx_type_set1);
+		_clear_symbol_counters(inter_tx_type_set2);
+		_clear_symbol_counters(inter_tx_type_set3);
+		_clear_symbol_counters(inter_intra);
+		_clear_symbol_counters(cfl_sign);
+		_clear_symbol_counters(wedge_inter_intra);
+		_clear_symbol_counters(inter_intra_mode);
+		_clear_symbol_counters(wedge_index);
+		_clear_symbol_counters(cfl_alpha);
+		_clear_symbol_counters(use_wiener);
+		_clear_symbol_counters(use_sgrproj);
+		_clear_symbol_counters(restoration_type);
+	}
+
 	coeff coeff::get_defaults(u32 idx) {
 		return {
 			.txb_skip       = defaults::txb_skip[idx],
@@ -4502,4 +4593,20 @@ namespace lotus::av1::cdf {
 			.coeff_br       = defaults::coeff_br[idx],
 		};
 	}
+
+	void coeff::clear_symbol_counters() {
+		_clear_symbol_counters(txb_skip);
+		_clear_symbol_counters(eob_pt_16);
+		_clear_symbol_counters(eob_pt_32);
+		_clear_symbol_counters(eob_pt_64);
+		_clear_symbol_counters(eob_pt_128);
+		_clear_symbol_counters(eob_pt_256);
+		_clear_symbol_counters(eob_pt_512);
+		_clear_symbol_counters(eob_pt_1024);
+		_clear_symbol_counters(eob_extra);
+		_clear_symbol_counters(dc_sign);
+		_clear_symbol_counters(coeff_base_eob);
+		_clear_symbol_counters(coeff_base);
+		_clear_symbol_counters(coeff_br);
+	}
 }
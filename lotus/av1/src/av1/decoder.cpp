@@ -62,7 +62,7 @@ namespace lotus::av1 {
 		} else if (header.obu_type == obu::type::redundant_frame_header) {
 			process_frame_header_obu(header, r);
 		} else if (header.obu_type == obu::type::tile_group) {
-			r.read_tile_group(_seq_header, _frame_header, _cdf.non_coeff, _cdf.coeff, _sb, obu_size);
+			r.read_tile_group(_seq_header, _frame_header, _cdf, _sb, obu_size, job_manager);
 			_debug_export_image("test.ppm");
 		} else if (header.obu_type == obu::type::metadata) {
 			std::abort(); // TODO
@@ -109,7 +109,7 @@ namespace lotus::av1 {
 		const u64 end_bit_pos = r.get_position();
 		const u64 header_bytes = (end_bit_pos - start_bit_pos) / 8;
 		sz -= header_bytes;
-		r.read_tile_group(_seq_header, _frame_header, _cdf.non_coeff, _cdf.coeff, _sb, sz);
+		r.read_tile_group(_seq_header, _frame_header, _cdf, _sb, sz, job_manager);
 		_debug_export_image("test.ppm");
 	}
 
@@ -4,6 +4,7 @@
 /// Implementation of an AV1 OBU reader.
 
 #include "lotus/logging.h"
+#include "lotus/utils/job_system.h"
 
 #include "lotus/av1/common.h"
 #include "lotus/av1/functions.h"
@@ -12,57 +13,53 @@
 #include "lotus/av1/block_decoding.h"
 
 namespace lotus::av1 {
-	u8 reader::read_byte() {
-		++_byte_position;
-		return static_cast<u8>(_consume_byte());
-	}
-
-	bool reader::read_bit() {
-		if (_residual_bits == 0) {
-			_cur_byte = read_byte();
-			_residual_bits = 8;
-		}
-		--_residual_bits;
-		return _cur_byte & (1 << _residual_bits);
-	}
-
-	u32 reader::read_bits(u32 n) {
-		// fast path: all bits are in the byte that have been read
-		if (n <= _residual_bits) {
-			_residual_bits -= n;
-			return (_cur_byte >> _residual_bits) & ((1 << n) - 1);
-		}
-
-		u32 result = 0;
-		// read residual bits first
-		if (_residual_bits > 0) {
-			result = static_cast<u32>(_cur_byte & ((1 << _residual_bits) - 1)) << (n - _residual_bits);
-			n -= _residual_bits;
-			_residual_bits = 0;
-		}
-		// read whole bytes
-		for (u32 i = 0; i < 4 && n >= 8; ++i) {
-			n -= 8;
-			result |= static_cast<u32>(read_byte()) << n;
+	void reader::skip_bits(u64 n) {
+		if (n <= _cache_bits) {
+			// the cache holds at most 63 valid bits, so this never shifts by 64
+			_cache <<= n;
+			_cache_bits -= static_cast<u32>(n);
+			return;
 		}
-		// read remaining bits
-		if (n > 0) {
-			_cur_byte = read_byte();
-			_residual_bits = 8 - n;
-			result |= _cur_byte >> _residual_bits;
+		// discard the cache and move directly to the byte containing the target bit
+		n -= _cache_bits;
+		_cache = 0;
+		_cache_bits = 0;
+		_byte_position += n / 8;
+		crash_if(_byte_position > _data.size());
+		if (const auto rem_bits = static_cast<u32>(n % 8); rem_bits > 0) {
+			_refill();
+			crash_if(_cache_bits < rem_bits);
+			_cache <<= rem_bits;
+			_cache_bits -= rem_bits;
 		}
-		return result;
 	}
 
-	u64 reader::get_position() const {
-		return _byte_position * 8 - _residual_bits;
+	std::span<const std::byte> reader::read_byte_span(u64 n) {
+		_check_byte_aligned();
+		const u64 begin = get_position() / 8;
+		crash_if(begin + n > _data.size());
+		skip_bits(n * 8);
+		return _data.subspan(begin, n);
 	}
 
 	u32 reader::read_uvlc() {
-		// TODO more efficient implementation?
 		u32 leading_zeros = 0;
-		for (; !read_bit(); ++leading_zeros) {
+		while (true) {
+			if (_cache_bits == 0) {
+				_refill();
+				crash_if(_cache_bits == 0);
+			}
+			// the cache holds at most 63 valid bits, so this never shifts by 64
+			const u32 zeros = std::min(static_cast<u32>(std::countl_zero(_cache)), _cache_bits);
+			leading_zeros += zeros;
+			const bool found_one = zeros < _cache_bits;
+			_cache <<= zeros;
+			_cache_bits -= zeros;
+			if (found_one) {
+				break;
+			}
 		}
+		(void)read_bit(); // the terminating one bit
 		if (leading_zeros >= 32) {
 			return 0xFFFFFFFFu;
 		}
@@ -134,22 +131,24 @@ namespace lotus::av1 {
 		const bool trailing_one_bit = read_bit();
 		crash_if(!trailing_one_bit);
 		--nb_bits;
-		while (nb_bits >= 8) {
-			const u8 trailing_zero_bits = read_byte();
-			crash_if(trailing_zero_bits != 0);
-			nb_bits -= 8;
-		}
 		while (nb_bits > 0) {
-			const bool trailing_zero_bit = read_bit();
-			crash_if(trailing_zero_bit);
-			--nb_bits;
+			const auto num_bits = static_cast<u32>(std::min<u64>(nb_bits, 32));
+			const u32 trailing_zero_bits = read_bits(num_bits);
+			crash_if(trailing_zero_bits != 0);
+			nb_bits -= num_bits;
 		}
 	}
 
 	void reader::read_byte_alignment() {
-		const u8 bits = _cur_byte & ((1u << _residual_bits) - 1);
-		crash_if(bits != 0);
-		_residual_bits = 0;
+		// whole bytes are loaded into the cache, so the bits before the next byte boundary are all in the cache
+		const u32 zero_bits = read_bits(_cache_bits % 8);
+		crash_if(zero_bits != 0);
+	}
+
+	void reader::_refill_tail() {
+		for (; _cache_bits <= 56 && _byte_position < _data.size(); _cache_bits += 8, ++_byte_position) {
+			_cache |= static_cast<u64>(_data[_byte_position]) << (56 - _cache_bits);
+		}
 	}
 
 	obu::sequence_header reader::read_sequence_header() {
@@ -1216,10 +1215,10 @@ namespace lotus::av1 {
 	void reader::read_tile_group(
 		const obu::sequence_header &seq_header,
 		const obu::uncompressed_header &header,
-		const cdf::non_coeff &non_coeff_cdfs,
-		const cdf::coeff &coeff_cdfs,
+		state::cdf &frame_cdf,
 		state::block &sb,
-		u64 sz
+		u64 sz,
+		job_system::manager *job_manager
 	) {
 		const u32 num_tiles = header.tile_info.tile_cols * header.tile_info.tile_rows;
 		const u64 start_bit_pos = get_position();
@@ -1238,9 +1237,9 @@ namespace lotus::av1 {
 		const u64 header_bytes = (end_bit_pos - start_bit_pos) / 8;
 		sz -= header_bytes;
 
+		// tiles are entropy coded independently, so locate all of them first so that they can be decoded in any order
+		std::vector<std::span<const std::byte>> tile_data;
 		for (u32 tile_num = tg_start; tile_num <= tg_end; ++tile_num) {
-			const u32 tile_row = tile_num / header.tile_info.tile_cols;
-			const u32 tile_col = tile_num % header.tile_info.tile_cols;
 			u64 tile_size;
 			if (tile_num == tg_end) {
 				tile_size = sz;
@@ -1248,21 +1247,48 @@ namespace lotus::av1 {
 				tile_size = read_le(header.tile_info.tile_size_bytes) + 1;
 				sz -= tile_size + header.tile_info.tile_size_bytes;
 			}
+			tile_data.emplace_back(read_byte_span(tile_size));
+		}
+
+		const auto decode_tile_data = [&](u32 tile_num, std::span<const std::byte> data, state::block &tile_sb) {
+			const u32 tile_row = tile_num / header.tile_info.tile_cols;
+			const u32 tile_col = tile_num % header.tile_info.tile_cols;
 			state::block_range sbr = zero;
-			sbr.mi_row_start = sb.row_starts[tile_row];
-			sbr.mi_row_end   = sb.row_starts[tile_row + 1];
-			sbr.mi_col_start = sb.col_starts[tile_col];
-			sbr.mi_col_end   = sb.col_starts[tile_col + 1];
-			sb.current_q_index = header.quantization_params.base_q_idx;
+			sbr.mi_row_start = tile_sb.row_starts[tile_row];
+			sbr.mi_row_end   = tile_sb.row_starts[tile_row + 1];
+			sbr.mi_col_start = tile_sb.col_starts[tile_col];
+			sbr.mi_col_end   = tile_sb.col_starts[tile_col + 1];
+			tile_sb.current_q_index = header.quantization_params.base_q_idx;
+			reader tile_reader(data);
 			auto decoder = symbol_decoder::init_symbol(
-				*this, non_coeff_cdfs, coeff_cdfs, header.disable_cdf_update, tile_size
+				tile_reader, frame_cdf.non_coeff, frame_cdf.coeff, header.disable_cdf_update, data.size()
 			);
-			decode_tile(seq_header, header, decoder, sb, sbr);
+			tile_reader.decode_tile(seq_header, header, decoder, tile_sb, sbr);
 			decoder.exit_symbol();
+			if (tile_num == header.tile_info.context_update_tile_id) {
+				frame_cdf.saved_non_coeff = decoder.get_non_coeff_cdf();
+				frame_cdf.saved_coeff     = decoder.get_coeff_cdf();
+			}
+		};
+		if (job_manager && tile_data.size() > 1) {
+			// each tile gets its own contexts; frame-wide state is shared, but tiles only write to their own regions
+			job_manager->parallel_for_blocking(
+				static_cast<u32>(tile_data.size()), 1, [&](job_system::index_range range) {
+					for (u32 i = range.begin; i < range.end; ++i) {
+						state::block tile_sb = sb.create_tile_state();
+						decode_tile_data(tg_start + i, tile_data[i], tile_sb);
+					}
+				}
+			);
+		} else {
+			for (u32 i = 0; i < tile_data.size(); ++i) {
+				decode_tile_data(tg_start + i, tile_data[i], sb);
+			}
 		}
+
 		if (tg_end == num_tiles - 1) {
 			if (!header.disable_frame_end_update_cdf) {
-				// TODO
+				frame_cdf.frame_end_update_cdf();
 			}
 			// TODO decode_frame_wrapup()
 			sb.seen_frame_header = false;
@@ -3,9 +3,16 @@
 /// \file
 /// Implementation of the symbol decoder.
 
+#include <bit>
+
 #include "lotus/av1/functions.h"
 #include "lotus/av1/reader.h"
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#	define LOTUS_AV1_SYMBOL_DECODER_USE_SSE
+#	include <emmintrin.h>
+#endif
+
 namespace lotus::av1 {
 	symbol_decoder symbol_decoder::init_symbol(
 		reader &r,
@@ -16,12 +23,14 @@ namespace lotus::av1 {
 	) {
 		symbol_decoder result(r, tile_non_coeff_cdf, tile_coeff_cdf, disable_cdf_update);
 
-		const auto num_bits = static_cast<u32>(std::min(sz * 8, 15ULL));
+		const auto num_bits = static_cast<u32>(std::min<u64>(sz * 8, 15));
 		const u32 buf = result._reader.read_bits(num_bits);
 		const u32 padded_buf = buf << (15u - num_bits);
-		result._symbol_value = static_cast<cdf::value_t>(((1u << 15) - 1) ^ padded_buf);
+		result._symbol_window = static_cast<u64>(((1u << 15) - 1) ^ padded_buf) << 48;
 		result._symbol_range = 1u << 15;
 		result._symbol_max_bits = 8 * static_cast<i64>(sz) - 15;
+		result._remaining_bits = sz * 8 - num_bits;
+		result._refill_window();
 		// TODO TileIntraFrameYModeCdf
 		// TODO CDF array copies
 		return result;
@@ -29,27 +38,26 @@ namespace lotus::av1 {
 
 	void symbol_decoder::exit_symbol() {
 		crash_if(_symbol_max_bits < -14);
+		// bits in the window have been read from the reader in advance
+		const u64 padding_end_position = _reader.get_position() + _remaining_bits;
+		const u64 padding_position = padding_end_position - static_cast<u64>(std::max<i64>(_symbol_max_bits, 0));
 		const u64 trailing_bit_position =
-			_reader.get_position() - std::min(15ULL, static_cast<u64>(_symbol_max_bits + 15));
-		if (_symbol_max_bits > 0) {
-			_reader.read_bits(_symbol_max_bits); // TODO skip_bits
-		}
-		const u64 padding_end_position = _reader.get_position();
+			padding_position - std::min<u64>(15, static_cast<u64>(_symbol_max_bits + 15));
+		_reader.skip_bits(_remaining_bits);
 		// TODO conformance check - bit at trailing bit position is 1, bits after are 0
-		// TODO saved CDFs
+		// saved CDFs are copied by reader::read_tile_group()
 	}
 
 	bool symbol_decoder::read_bool() {
-		constexpr cdf::value_t cdf[3] = { 1 << 14, 1 << 15, 0 };
-		return std::to_underlying(_read_symbol_no_update(cdf)) == 1;
+		return _read_bools(1) != 0;
 	}
 
 	u32 symbol_decoder::read_literal(u32 n) {
 		u32 x = 0;
-		for (u32 i = 0; i < n; ++i) {
-			x = 2 * x + read_bool();
+		for (; n > 8; n -= 8) {
+			x = (x << 8) | _read_bools(8);
 		}
-		return x;
+		return (x << n) | _read_bools(n);
 	}
 
 	symbol_t symbol_decoder::read_symbol(std::span<cdf::value_t> cdf) {
@@ -525,44 +533,176 @@ namespace lotus::av1 {
 		_reader(r) {
 	}
 
+	/// Computes \p cur for eight consecutive symbols, given their CDF values, <tt>SymbolRange >> 8</tt>, and the
+	/// minimum probability terms.
+#ifdef LOTUS_AV1_SYMBOL_DECODER_USE_SSE
+	static __m128i _compute_symbol_thresholds(__m128i cdf, __m128i range_hi, __m128i min_prob) {
+		const __m128i f = _mm_srli_epi16(
+			_mm_sub_epi16(_mm_set1_epi16(static_cast<i16>(1u << 15)), cdf), constants::ec_prob_shift
+		);
+		// the product has up to 17 bits, but fits in 16 bits after the shift
+		const __m128i product_lo = _mm_mullo_epi16(range_hi, f);
+		const __m128i product_hi = _mm_mulhi_epu16(range_hi, f);
+		const __m128i cur = _mm_or_si128(
+			_mm_srli_epi16(product_lo, 7 - constants::ec_prob_shift),
+			_mm_slli_epi16(product_hi, 16 - (7 - constants::ec_prob_shift))
+		);
+		return _mm_add_epi16(cur, min_prob);
+	}
+	/// Returns the index of the first lane where \p cur is not greater than \p SymbolValue, or 8 if there is none.
+	static u32 _find_first_not_greater(__m128i cur, __m128i value) {
+		const __m128i not_greater = _mm_cmpeq_epi16(_mm_subs_epu16(cur, value), _mm_setzero_si128());
+		const auto mask = static_cast<u32>(_mm_movemask_epi8(not_greater));
+		return mask == 0 ? 8 : static_cast<u32>(std::countr_zero(mask)) / 2;
+	}
+#endif
+
 	symbol_t symbol_decoder::_read_symbol_no_update(std::span<const cdf::value_t> cdf) {
-		const usize n = cdf.size() - 1;
+		const auto n = static_cast<u32>(cdf.size() - 1);
+		const auto value = static_cast<u32>(_symbol_window >> 48);
 
 		// decode symbol
-		cdf::value_t prev;
-		cdf::value_t cur = _symbol_range;
-		u8 symbol = static_cast<u8>(-1);
-		do {
-			++symbol;
-			prev = cur;
-			const cdf::value_t f = (1u << 15) - cdf[symbol];
-			cur = static_cast<cdf::value_t>(
-				(static_cast<u32>(_symbol_range >> 8) * (f >> constants::ec_prob_shift)) >>
-				(7 - constants::ec_prob_shift)
+		u32 prev;
+		u32 cur;
+		u32 symbol;
+#ifdef LOTUS_AV1_SYMBOL_DECODER_USE_SSE
+		if (n >= 8 && n <= 16) {
+			// test the first eight symbols, then the last eight symbols, which may overlap with the first eight.
+			// thresholds are written to the same array, and overlapping lanes have the same values
+			alignas(16) u16 thresholds[16];
+			const u32 offset = n - 8;
+			const __m128i lane_min_prob = _mm_setr_epi16(0, 4, 8, 12, 16, 20, 24, 28);
+			const __m128i range_hi = _mm_set1_epi16(static_cast<i16>(_symbol_range >> 8));
+			const __m128i value_vec = _mm_set1_epi16(static_cast<i16>(value));
+			const __m128i cur_first = _compute_symbol_thresholds(
+				_mm_loadu_si128(reinterpret_cast<const __m128i*>(cdf.data())),
+				range_hi,
+				_mm_sub_epi16(_mm_set1_epi16(static_cast<i16>(constants::ec_min_prob * (n - 1))), lane_min_prob)
 			);
-			cur += constants::ec_min_prob * (n - symbol - 1);
-		} while (cur > _symbol_value);
+			_mm_store_si128(reinterpret_cast<__m128i*>(thresholds), cur_first);
+			symbol = _find_first_not_greater(cur_first, value_vec);
+			if (symbol == 8) { // the threshold of the last symbol is zero, so n > 8 here
+				const __m128i cur_last = _compute_symbol_thresholds(
+					_mm_loadu_si128(reinterpret_cast<const __m128i*>(cdf.data() + offset)),
+					range_hi,
+					_mm_sub_epi16(_mm_set1_epi16(static_cast<i16>(constants::ec_min_prob * 7)), lane_min_prob)
+				);
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(thresholds + offset), cur_last);
+				symbol = offset + _find_first_not_greater(cur_last, value_vec);
+			}
+			cur = thresholds[symbol];
+			prev = symbol == 0 ? _symbol_range : thresholds[symbol - 1];
+		} else
+#endif
+		{
+			cur = _symbol_range;
+			symbol = static_cast<u32>(-1);
+			do {
+				++symbol;
+				prev = cur;
+				const u32 f = (1u << 15) - cdf[symbol];
+				cur = ((_symbol_range >> 8) * (f >> constants::ec_prob_shift)) >> (7 - constants::ec_prob_shift);
+				cur += constants::ec_min_prob * (n - symbol - 1);
+			} while (cur > value);
+		}
 
 		// prepare for next symbol
-		_symbol_range = prev - cur;
-		_symbol_value = _symbol_value - cur;
-		if (const u32 bits = 15 - functions::floor_log2(_symbol_range); bits > 0) {
-			_symbol_range <<= bits;
-			const auto num_bits = static_cast<u32>(std::min<i64>(bits, std::max(0LL, _symbol_max_bits)));
-			const u32 new_data = _reader.read_bits(num_bits);
-			const auto padded_data = static_cast<u16>(new_data << (bits - num_bits));
-			_symbol_value = static_cast<cdf::value_t>(((_symbol_value + 1) << bits) - 1) ^ padded_data;
-			_symbol_max_bits -= static_cast<i32>(bits);
-		}
+		_renormalize(prev - cur, _symbol_window - (static_cast<u64>(cur) << 48));
 		return static_cast<symbol_t>(symbol);
 	}
 
+	u32 symbol_decoder::_read_bools(u32 n) {
+		// with a probability of one half, SymbolRange is at least 2^13 after decoding a boolean, so decoding one
+		// consumes at most two bits, and the window always has at least 16 bits available
+		u32 range = _symbol_range;
+		u64 window = _symbol_window;
+		u32 consumed_bits = 0;
+		u32 result = 0;
+		for (u32 i = 0; i < n; ++i) {
+			// the CDF is { 1 << 14, 1 << 15, 0 }, so the threshold of the first symbol simplifies to this
+			const u32 cur = ((range >> 8) << 7) + constants::ec_min_prob;
+			// the outcome is hard to predict, so avoid branching on it. the mask is zero if the bit is set
+			const bool bit = cur > (window >> 48);
+			const u32 mask = static_cast<u32>(bit) - 1;
+			window -= static_cast<u64>(cur & mask) << 48;
+			range = cur + ((range - 2 * cur) & mask);
+			result = (result << 1) | (bit ? 1 : 0);
+			const auto bits = static_cast<u32>(std::countl_zero(static_cast<u16>(range)));
+			range <<= bits;
+			window <<= bits;
+			consumed_bits += bits;
+		}
+		_symbol_range = range;
+		_symbol_window = window;
+		_window_bits -= consumed_bits;
+		_symbol_max_bits -= consumed_bits;
+		if (_window_bits < 16) {
+			_refill_window();
+		}
+		return result;
+	}
+
+	void symbol_decoder::_refill_window() {
+		const u32 space = 48 - _window_bits;
+		const auto num_bits = static_cast<u32>(std::min<u64>(std::min(space, 32u), _remaining_bits));
+		if (num_bits > 0) {
+			const u32 data = ~_reader.read_bits(num_bits) & (0xFFFFFFFFu >> (32 - num_bits));
+			_symbol_window |= static_cast<u64>(data) << (space - num_bits);
+			_window_bits += num_bits;
+			_remaining_bits -= num_bits;
+		}
+		if (_remaining_bits == 0) {
+			// the data is padded with zeros after the end of the tile, which are ones after inversion
+			_symbol_window |= (1ull << (space - num_bits)) - 1;
+			_window_bits = 48;
+		}
+	}
+
+	void symbol_decoder::_renormalize(u32 range, u64 window) {
+		const auto bits = static_cast<u32>(std::countl_zero(static_cast<u16>(range)));
+		_symbol_range = range << bits;
+		_symbol_window = window << bits;
+		_window_bits -= bits;
+		_symbol_max_bits -= bits;
+		if (_window_bits < 16) {
+			_refill_window();
+		}
+	}
+
 	void symbol_decoder::_update_cdf(std::span<cdf::value_t> cdf, symbol_t symbol) {
 		const u32 n = static_cast<u32>(cdf.size() - 1);
 		const u32 rate = 3 + (cdf[n] > 15 ? 1 : 0) + (cdf[n] > 31 ? 1 : 0) + std::min(functions::floor_log2(n), 2u);
+		const u32 sym = std::to_underlying(symbol);
+#ifdef LOTUS_AV1_SYMBOL_DECODER_USE_SSE
+		if (n >= 8 && n <= 16) {
+			// values before the symbol decay towards zero, and the others towards 2^15. the last value is always 2^15,
+			// so it is left unchanged. both halves are computed before storing because they may overlap
+			const u32 offset = n - 8;
+			const __m128i lane_index = _mm_setr_epi16(0, 1, 2, 3, 4, 5, 6, 7);
+			const __m128i symbol_vec = _mm_set1_epi16(static_cast<i16>(sym));
+			const __m128i one = _mm_set1_epi16(static_cast<i16>(1u << 15));
+			const __m128i rate_vec = _mm_cvtsi32_si128(static_cast<i32>(rate));
+			const auto adapt = [&](__m128i values, __m128i index) {
+				const __m128i below = _mm_cmplt_epi16(index, symbol_vec);
+				const __m128i decreased = _mm_sub_epi16(values, _mm_srl_epi16(values, rate_vec));
+				const __m128i increased = _mm_add_epi16(values, _mm_srl_epi16(_mm_sub_epi16(one, values), rate_vec));
+				return _mm_or_si128(_mm_and_si128(below, decreased), _mm_andnot_si128(below, increased));
+			};
+			auto *first_ptr = reinterpret_cast<__m128i*>(cdf.data());
+			auto *last_ptr = reinterpret_cast<__m128i*>(cdf.data() + offset);
+			const __m128i first = adapt(_mm_loadu_si128(first_ptr), lane_index);
+			const __m128i last = adapt(
+				_mm_loadu_si128(last_ptr), _mm_add_epi16(lane_index, _mm_set1_epi16(static_cast<i16>(offset)))
+			);
+			_mm_storeu_si128(last_ptr, last);
+			_mm_storeu_si128(first_ptr, first);
+			cdf[n] += cdf[n] < 32 ? 1 : 0;
+			return;
+		}
+#endif
 		cdf::value_t tmp = 0;
 		for (u32 i = 0; i < n - 1; ++i) {
-			tmp = i == std::to_underlying(symbol) ? (1u << 15) : tmp;
+			tmp = i == sym ? (1u << 15) : tmp;
 			if (tmp < cdf[i]) {
 				cdf[i] -= (cdf[i] - tmp) >> rate;
 			} else {
@@ -0,0 +1,76 @@
+#pragma once
+
+/// \file
+/// Lock-free single-producer single-consumer ring buffer.
+
+#include <atomic>
+#include <memory>
+
+#include "lotus/common.h"
+
+namespace lotus {
+	/// A fixed-capacity ring buffer with one producer thread and one consumer thread. Elements written by the
+	/// producer only become visible to the consumer after \ref commit() is called, so the producer can publish
+	/// elements in batches. Storage is allocated once on construction; pushing and consuming elements never
+	/// allocates. Elements must be trivially copyable.
+	template <typename T, usize Capacity> class spsc_ring_buffer {
+		static_assert(std::has_single_bit(Capacity), "Capacity of ring buffers must be a power of two");
+		static_assert(std::is_trivially_copyable_v<T>, "Elements of ring buffers must be trivially copyable");
+		static_assert(std::is_trivially_destructible_v<T>, "Elements of ring buffers must be trivially destructible");
+	public:
+		constexpr static usize capacity = Capacity; ///< The capacity of this ring buffer.
+
+		/// Allocates storage for the ring buffer.
+		spsc_ring_buffer() : _storage(std::allocator<T>().allocate(Capacity)) {
+		}
+		/// No copy construction.
+		spsc_ring_buffer(const spsc_ring_buffer&) = delete;
+		/// No copy assignment.
+		spsc_ring_buffer &operator=(const spsc_ring_buffer&) = delete;
+		/// Frees the storage.
+		~spsc_ring_buffer() {
+			std::allocator<T>().deallocate(_storage, Capacity);
+		}
+
+		/// Pushes an element if at least \p reserved elements can still be pushed afterwards. Returns whether the
+		/// element has been pushed. Can only be called by the producer.
+		[[nodiscard]] bool try_push(const T &value, usize reserved = 0) {
+			if (Capacity - (_write - _cached_read) <= reserved) {
+				// refresh our view of the consumer's progress only when necessary to avoid cache line traffic
+				_cached_read = _read.load(std::memory_order::acquire);
+				if (Capacity - (_write - _cached_read) <= reserved) {
+					return false;
+				}
+			}
+			std::construct_at(_storage + (_write & _mask), value);
+			++_write;
+			return true;
+		}
+		/// Makes all pushed elements visible to the consumer. Can only be called by the producer.
+		void commit() {
+			_committed.store(_write, std::memory_order::release);
+		}
+
+		/// Calls the callback for all committed elements in order, then frees their space for the producer. Returns
+		/// the number of elements consumed. Can only be called by the consumer.
+		template <typename Callback> usize consume(Callback &&cb) {
+			const usize end = _committed.load(std::memory_order::acquire);
+			const usize begin = _read.load(std::memory_order::relaxed);
+			for (usize i = begin; i != end; ++i) {
+				cb(_storage[i & _mask]);
+			}
+			_read.store(end, std::memory_order::release);
+			return end - begin;
+		}
+	private:
+		constexpr static usize _mask = Capacity - 1; ///< Mask used to wrap indices.
+
+		T *_storage = nullptr; ///< Storage for all elements.
+
+		alignas(64) std::atomic<usize> _committed = 0; ///< Index past the last committed element.
+		std::atomic<usize> _read = 0; ///< Index of the first element that has not been consumed.
+		// only accessed by the producer
+		alignas(64) usize _write = 0; ///< Index past the last element that has been pushed.
+		usize _cached_read = 0; ///< The last value of \ref _read seen by the producer.
+	};
+}
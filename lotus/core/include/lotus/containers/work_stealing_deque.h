@@ -0,0 +1,129 @@
+#pragma once
+
+/// \file
+/// Lock-free work-stealing deque.
+
+#include <atomic>
+#include <memory>
+#include <optional>
+#include <vector>
+
+#include "lotus/common.h"
+
+namespace lotus {
+	/// A Chase-Lev work-stealing deque. Only the owner thread may call \ref push() and \ref pop(), which operate on
+	/// the bottom of the deque; any thread may call \ref steal(), which takes elements from the top. Elements must be
+	/// trivially copyable (typically pointers). The storage grows as needed; old buffers are retained until the deque
+	/// is destroyed so that concurrent thieves never read from freed memory.
+	template <typename T> class work_stealing_deque {
+		static_assert(std::is_trivially_copyable_v<T>, "Elements of work stealing deques must be trivially copyable");
+	public:
+		constexpr static usize default_capacity = 256; ///< Default initial capacity.
+
+		/// Initializes the deque with the given initial capacity, which must be a power of two.
+		explicit work_stealing_deque(usize capacity = default_capacity) {
+			crash_if(!std::has_single_bit(capacity));
+			_buffers.emplace_back(std::make_unique<_ring_buffer>(capacity));
+			_buffer.store(_buffers.back().get(), std::memory_order::relaxed);
+		}
+		/// No copy construction.
+		work_stealing_deque(const work_stealing_deque&) = delete;
+		/// No copy assignment.
+		work_stealing_deque &operator=(const work_stealing_deque&) = delete;
+
+		/// Pushes an element to the bottom of the deque. Can only be called by the owner thread.
+		void push(T value) {
+			const i64 bottom = _bottom.load(std::memory_order::relaxed);
+			const i64 top = _top.load(std::memory_order::acquire);
+			_ring_buffer *buf = _buffer.load(std::memory_order::relaxed);
+			if (bottom - top > static_cast<i64>(buf->mask)) {
+				buf = _grow(buf, top, bottom);
+			}
+			buf->store(bottom, value);
+			std::atomic_thread_fence(std::memory_order::release);
+			_bottom.store(bottom + 1, std::memory_order::relaxed);
+		}
+		/// Pops an element from the bottom of the deque. Can only be called by the owner thread.
+		[[nodiscard]] std::optional<T> pop() {
+			const i64 bottom = _bottom.load(std::memory_order::relaxed) - 1;
+			_ring_buffer *buf = _buffer.load(std::memory_order::relaxed);
+			_bottom.store(bottom, std::memory_order::relaxed);
+			std::atomic_thread_fence(std::memory_order::seq_cst);
+			i64 top = _top.load(std::memory_order::relaxed);
+
+			if (top > bottom) { // empty
+				_bottom.store(bottom + 1, std::memory_order::relaxed);
+				return std::nullopt;
+			}
+			std::optional<T> result = buf->load(bottom);
+			if (top == bottom) { // last element, race against thieves
+				if (!_top.compare_exchange_strong(
+					top, top + 1, std::memory_order::seq_cst, std::memory_order::relaxed
+				)) {
+					result = std::nullopt;
+				}
+				_bottom.store(bottom + 1, std::memory_order::relaxed);
+			}
+			return result;
+		}
+		/// Steals an element from the top of the deque. Can be called from any thread. Returns \p std::nullopt if the
+		/// deque is empty or if another thread won the race for the element.
+		[[nodiscard]] std::optional<T> steal() {
+			i64 top = _top.load(std::memory_order::acquire);
+			std::atomic_thread_fence(std::memory_order::seq_cst);
+			const i64 bottom = _bottom.load(std::memory_order::acquire);
+			if (top >= bottom) {
+				return std::nullopt;
+			}
+			_ring_buffer *buf = _buffer.load(std::memory_order::acquire);
+			const T result = buf->load(top);
+			if (!_top.compare_exchange_strong(top, top + 1, std::memory_order::seq_cst, std::memory_order::relaxed)) {
+				return std::nullopt;
+			}
+			return result;
+		}
+
+		/// Returns an estimate of the number of elements in this deque.
+		[[nodiscard]] usize get_size_estimate() const {
+			const i64 bottom = _bottom.load(std::memory_order::relaxed);
+			const i64 top = _top.load(std::memory_order::relaxed);
+			return bottom > top ? static_cast<usize>(bottom - top) : 0;
+		}
+	private:
+		/// A circular buffer of atomic elements.
+		struct _ring_buffer {
+			/// Allocates storage for the given number of elements.
+			explicit _ring_buffer(usize capacity) :
+				mask(capacity - 1), elements(std::make_unique<std::atomic<T>[]>(capacity)) {
+			}
+
+			/// Loads the element at the given index.
+			[[nodiscard]] T load(i64 i) const {
+				return elements[static_cast<usize>(i) & mask].load(std::memory_order::relaxed);
+			}
+			/// Stores the element at the given index.
+			void store(i64 i, T value) {
+				elements[static_cast<usize>(i) & mask].store(value, std::memory_order::relaxed);
+			}
+
+			usize mask; ///< Capacity minus one.
+			std::unique_ptr<std::atomic<T>[]> elements; ///< Elements.
+		};
+
+		/// Doubles the capacity of the given buffer, copying elements in [top, bottom).
+		_ring_buffer *_grow(_ring_buffer *old, i64 top, i64 bottom) {
+			auto &buf = _buffers.emplace_back(std::make_unique<_ring_buffer>((old->mask + 1) * 2));
+			for (i64 i = top; i < bottom; ++i) {
+				buf->store(i, old->load(i));
+			}
+			_buffer.store(buf.get(), std::memory_order::release);
+			return buf.get();
+		}
+
+		alignas(64) std::atomic<i64> _top = 0; ///< Index of the top element, modified by thieves.
+		alignas(64) std::atomic<i64> _bottom = 0; ///< Index past the bottom element, modified by the owner.
+		std::atomic<_ring_buffer*> _buffer = nullptr; ///< Current buffer.
+		/// All buffers that have been allocated, including retired ones. Only accessed by the owner.
+		std::vector<std::unique_ptr<_ring_buffer>> _buffers;
+	};
+}
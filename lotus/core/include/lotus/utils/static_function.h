@@ -102,6 +102,7 @@ namespace lotus {
 
 			crash_if(_impl.is_valid());
 			static_assert(sizeof(callable_t) <= StorageSize, "Not enough capacity for static function");
+			_maybe_unpoison_storage();
 			new (_storage.data()) callable_t(std::move(obj));
 			_impl.invoke = [](void *p, Args &&...args) -> Ret {
 				return (*static_cast<callable_t*>(p))(std::forward<Args>(args)...);
@@ -123,6 +124,7 @@ namespace lotus {
 		template <usize OtherSize> void _move_from(static_function<Ret(Args...), OtherSize> &&src) {
 			crash_if(_impl.is_valid());
 			if (src._impl.is_valid()) {
+				_maybe_unpoison_storage();
 				crash_if(!src._impl.move(src._storage.data(), _storage.data(), _storage.size()));
 				_impl = std::exchange(src._impl, nullptr);
 				src._maybe_poison_storage();
@@ -145,6 +147,12 @@ namespace lotus {
 				memory::poison(_storage.data(), _storage.size());
 			}
 		}
+		/// Un-poisons the storage before a function object is placed in it.
+		void _maybe_unpoison_storage() {
+			if constexpr (should_poison_storage) {
+				memory::unpoison(_storage.data(), _storage.size());
+			}
+		}
 
 		alignas(std::max_align_t) std::array<std::byte, StorageSize> _storage; ///< Storage for the callable object.
 		[[no_unique_address]] _impl_t _impl = nullptr; ///< Used to actually invoke and move the function.
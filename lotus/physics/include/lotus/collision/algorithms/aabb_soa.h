@@ -0,0 +1,119 @@
+#pragma once
+
+/// \file
+/// Structure-of-arrays storage for small groups of bounding boxes that are tested against the same query.
+
+#include <array>
+#include <bit>
+
+#if defined(__AVX__)
+#	define LOTUS_COLLISION_AABB_SOA_USE_AVX
+#	include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#	define LOTUS_COLLISION_AABB_SOA_USE_SSE
+#	include <emmintrin.h>
+#endif
+
+#include "lotus/collision/common.h"
+
+namespace lotus::collision {
+	/// A fixed number of bounding boxes stored as separate arrays for each coordinate, so that a query box can be
+	/// tested against all of them at once. Intersection tests use SIMD instructions when they are available and the
+	/// count is a multiple of the vector width, and fall back to a branchless scalar loop otherwise.
+	template <u32 Count> struct aabb_soa {
+		static_assert(Count <= 32, "Intersection masks are stored in 32-bit integers");
+	public:
+		/// Returns the i-th bounding box.
+		[[nodiscard]] aab3s get(u32 i) const {
+			return aab3s::create_from_min_max(
+				vec3(_min[0][i], _min[1][i], _min[2][i]), vec3(_max[0][i], _max[1][i], _max[2][i])
+			);
+		}
+		/// Sets the i-th bounding box.
+		void set(u32 i, aab3s bb) {
+			for (u32 axis = 0; axis < 3; ++axis) {
+				_min[axis][i] = bb.min[axis];
+				_max[axis][i] = bb.max[axis];
+			}
+		}
+
+		/// Returns a mask where the i-th bit is set if the i-th bounding box intersects the given box. The results
+		/// are the same as \ref aab3s::intersects().
+		[[nodiscard]] u32 intersect(aab3s box) const {
+#if defined(LOTUS_COLLISION_AABB_SOA_USE_AVX)
+			if constexpr (Count % 8 == 0) {
+				return _intersect_avx(box);
+			} else if constexpr (Count % 4 == 0) {
+				return _intersect_sse(box);
+			}
+#elif defined(LOTUS_COLLISION_AABB_SOA_USE_SSE)
+			if constexpr (Count % 4 == 0) {
+				return _intersect_sse(box);
+			}
+#endif
+			return _intersect_scalar(box);
+		}
+	private:
+		alignas(16) std::array<std::array<scalar, Count>, 3> _min = {}; ///< Minimum coordinates along each axis.
+		alignas(16) std::array<std::array<scalar, Count>, 3> _max = {}; ///< Maximum coordinates along each axis.
+
+		/// Scalar implementation of \ref intersect().
+		[[nodiscard]] u32 _intersect_scalar(aab3s box) const {
+			u32 result = 0;
+			for (u32 i = 0; i < Count; ++i) {
+				bool hit = true;
+				for (u32 axis = 0; axis < 3; ++axis) {
+					hit = hit & (_min[axis][i] < box.max[axis]) & (_max[axis][i] > box.min[axis]);
+				}
+				result |= static_cast<u32>(hit) << i;
+			}
+			return result;
+		}
+#if defined(LOTUS_COLLISION_AABB_SOA_USE_AVX) || defined(LOTUS_COLLISION_AABB_SOA_USE_SSE)
+		/// SSE implementation of \ref intersect() that processes four boxes at a time.
+		[[nodiscard]] u32 _intersect_sse(aab3s box) const {
+			std::array<__m128, 3> query_min;
+			std::array<__m128, 3> query_max;
+			for (u32 axis = 0; axis < 3; ++axis) {
+				query_min[axis] = _mm_set1_ps(box.min[axis]);
+				query_max[axis] = _mm_set1_ps(box.max[axis]);
+			}
+			u32 result = 0;
+			for (u32 i = 0; i < Count; i += 4) {
+				__m128 hit = _mm_castsi128_ps(_mm_set1_epi32(-1));
+				for (u32 axis = 0; axis < 3; ++axis) {
+					const __m128 child_min = _mm_loadu_ps(_min[axis].data() + i);
+					const __m128 child_max = _mm_loadu_ps(_max[axis].data() + i);
+					hit = _mm_and_ps(hit, _mm_cmplt_ps(child_min, query_max[axis]));
+					hit = _mm_and_ps(hit, _mm_cmpgt_ps(child_max, query_min[axis]));
+				}
+				result |= static_cast<u32>(_mm_movemask_ps(hit)) << i;
+			}
+			return result;
+		}
+#endif
+#if defined(LOTUS_COLLISION_AABB_SOA_USE_AVX)
+		/// AVX implementation of \ref intersect() that processes eight boxes at a time.
+		[[nodiscard]] u32 _intersect_avx(aab3s box) const {
+			std::array<__m256, 3> query_min;
+			std::array<__m256, 3> query_max;
+			for (u32 axis = 0; axis < 3; ++axis) {
+				query_min[axis] = _mm256_set1_ps(box.min[axis]);
+				query_max[axis] = _mm256_set1_ps(box.max[axis]);
+			}
+			u32 result = 0;
+			for (u32 i = 0; i < Count; i += 8) {
+				__m256 hit = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+				for (u32 axis = 0; axis < 3; ++axis) {
+					const __m256 child_min = _mm256_loadu_ps(_min[axis].data() + i);
+					const __m256 child_max = _mm256_loadu_ps(_max[axis].data() + i);
+					hit = _mm256_and_ps(hit, _mm256_cmp_ps(child_min, query_max[axis], _CMP_LT_OQ));
+					hit = _mm256_and_ps(hit, _mm256_cmp_ps(child_max, query_min[axis], _CMP_GT_OQ));
+				}
+				result |= static_cast<u32>(_mm256_movemask_ps(hit)) << i;
+			}
+			return result;
+		}
+#endif
+	};
+}
@@ -3,11 +3,17 @@
 /// \file
 /// Axis aligned bounding box trees.
 
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <span>
+
 #include "lotus/memory/common.h"
 #include "lotus/memory/stack_allocator.h"
 #include "lotus/utils/profiler.h"
 #include "lotus/math/aab.h"
 #include "lotus/collision/common.h"
+#include "lotus/collision/algorithms/aabb_soa.h"
 
 namespace lotus::collision {
 	/// Axis aligned bounding box trees.
@@ -32,7 +38,7 @@ namespace lotus::collision {
 			}
 			/// Returns the bounding box of the i-th child.
 			[[nodiscard]] aab3s get_child_bounding_box(index_t i) const {
-				return _children_aabb[i];
+				return _children_aabb.get(i);
 			}
 			/// Returns the number of primitives in the i-th child.
 			[[nodiscard]] u32 get_child_num_primitives(index_t i) const {
@@ -48,7 +54,7 @@ namespace lotus::collision {
 				aab3s result = aab3s::create_infinity().negated();
 				for (index_t i = 0; i < Order; ++i) {
 					if (_children[i]) {
-						result = aab3s::minimum_containing({ result, _children_aabb[i] });
+						result = aab3s::minimum_containing({ result, _children_aabb.get(i) });
 					}
 				}
 				return result;
@@ -73,7 +79,8 @@ namespace lotus::collision {
 				return result;
 			}
 		private:
-			std::array<aab3s, Order> _children_aabb = {}; ///< The bounding box of all children.
+			/// The bounding box of all children, stored so that they can be tested against a query all at once.
+			aabb_soa<Order> _children_aabb;
 			std::array<node*, Order> _children = {}; ///< Children of this node.
 			/// The total number of primitives in each child.
 			std::array<u32, Order> _children_num_primitives = {};
@@ -82,8 +89,12 @@ namespace lotus::collision {
 			minimum_unsigned_type_bits_t<Order> _is_leaf = 0; ///< Bits indicating whether each child is a leaf.
 
 			/// Fetches AABB information from the parent.
-			[[nodiscard]] aab3s &_aabb_in_parent() const {
-				return _parent->_children_aabb[_parent_index];
+			[[nodiscard]] aab3s _get_aabb_in_parent() const {
+				return _parent->_children_aabb.get(_parent_index);
+			}
+			/// Updates AABB information in the parent.
+			void _set_aabb_in_parent(aab3s bb) const {
+				_parent->_children_aabb.set(_parent_index, bb);
 			}
 			/// Fetches the number of primitives from the parent.
 			[[nodiscard]] u32 &_num_primitives_in_parent() const {
@@ -132,8 +143,12 @@ namespace lotus::collision {
 			index_t _parent_index = 0; ///< Index of this node in the parent.
 
 			/// Fetches AABB information from the parent.
-			[[nodiscard]] aab3s &_aabb_in_parent() const {
-				return _parent->_children_aabb[_parent_index];
+			[[nodiscard]] aab3s _get_aabb_in_parent() const {
+				return _parent->_children_aabb.get(_parent_index);
+			}
+			/// Updates AABB information in the parent.
+			void _set_aabb_in_parent(aab3s bb) const {
+				_parent->_children_aabb.set(_parent_index, bb);
 			}
 			/// Fetches the number of primitives from the parent.
 			[[nodiscard]] u32 &_num_primitives_in_parent() const {
@@ -184,7 +199,7 @@ namespace lotus::collision {
 					if (!cur->_children[i]) {
 						return _insert_at(cur, i, node, bb, num_primitives);
 					}
-					const aab3s cur_bb = cur->_children_aabb[i];
+					const aab3s cur_bb = cur->_children_aabb.get(i);
 					const scalar cur_heuristic = heuristic(cur_bb, cur->get_child_num_primitives(i));
 					const scalar new_heuristic = heuristic(
 						aab3s::minimum_containing({ cur_bb, bb }), cur->get_child_num_primitives(i) + num_primitives
@@ -212,9 +227,9 @@ namespace lotus::collision {
 		}
 		/// Updates the given node to have a new bounding box.
 		void update(leaf_node *n, aab3s new_bb) {
-			n->_aabb_in_parent() = new_bb;
+			n->_set_aabb_in_parent(new_bb);
 			for (intermediate_node *cur = n->_parent; cur->_parent; cur = cur->_parent) {
-				cur->_aabb_in_parent() = cur->compute_aabb();
+				cur->_set_aabb_in_parent(cur->compute_aabb());
 			}
 
 			// optimize the tree
@@ -252,7 +267,7 @@ namespace lotus::collision {
 					std::destroy_at(cur);
 					_allocator.free(cur);
 				} else { // update parent with new abb
-					cur->_aabb_in_parent() = cur->compute_aabb();
+					cur->_set_aabb_in_parent(cur->compute_aabb());
 				}
 
 				cur = parent;
@@ -272,6 +287,112 @@ namespace lotus::collision {
 			_allocator.free(leaf);
 		}
 
+		/// Sets the bounding box of the given leaf without updating its ancestors or optimizing the tree. This is
+		/// cheaper than \ref update() when many leaves move at once, but \ref refit() must be called before the tree
+		/// is queried again.
+		void set_bounding_box_deferred(leaf_node *n, aab3s new_bb) {
+			n->_set_aabb_in_parent(new_bb);
+		}
+		/// Recomputes the bounding boxes of all intermediate nodes from their children in a single bottom-up pass,
+		/// without changing the structure of the tree. Returns the cost of the refitted tree, as computed by
+		/// \ref compute_cost().
+		scalar refit() {
+			if (!_root) {
+				return 0.0f;
+			}
+
+			auto bookmark = get_scratch_bookmark();
+			// in pre-order, children come after their parents, so iterating in reverse updates children first
+			auto nodes = bookmark.create_vector_array<intermediate_node*>(1u, _root);
+			for (usize i = 0; i < nodes.size(); ++i) {
+				const intermediate_node *cur = nodes[i];
+				for (index_t j = 0; j < Order; ++j) {
+					if (cur->_children[j] && !cur->is_child_leaf(j)) {
+						nodes.emplace_back(static_cast<intermediate_node*>(cur->_children[j]));
+					}
+				}
+			}
+			_cost_accumulator cost;
+			for (auto it = nodes.rbegin(); it != nodes.rend(); ++it) {
+				intermediate_node *cur = *it;
+				if (cur->_parent) {
+					cur->_set_aabb_in_parent(cur->compute_aabb());
+				}
+				for (index_t j = 0; j < Order; ++j) {
+					if (cur->_children[j]) {
+						cost.add(cur->_children_aabb.get(j), cur->is_child_leaf(j));
+					}
+				}
+			}
+			return cost.get();
+		}
+		/// Rebuilds the entire tree from its leaves using binned surface area heuristic splits. Leaf nodes are reused,
+		/// so pointers to them stay valid; all intermediate nodes are reallocated. This produces a better tree than
+		/// incremental insertion, at the cost of processing all leaves.
+		void rebuild() {
+			if (!_root) {
+				return;
+			}
+
+			auto bookmark = get_scratch_bookmark();
+			auto items = bookmark.create_reserved_vector_array<_build_item>(_root->compute_num_primitives());
+			{ // collect all leaves and free intermediate nodes
+				auto stack = bookmark.create_vector_array<intermediate_node*>(1u, _root);
+				while (!stack.empty()) {
+					intermediate_node *cur = stack.back();
+					stack.pop_back();
+					for (index_t i = 0; i < Order; ++i) {
+						if (!cur->_children[i]) {
+							continue;
+						}
+						if (cur->is_child_leaf(i)) {
+							auto *leaf = static_cast<leaf_node*>(cur->_children[i]);
+							leaf->_parent = nullptr;
+							items.emplace_back(leaf, cur->_children_aabb.get(i), cur->_children_num_primitives[i]);
+						} else {
+							stack.emplace_back(static_cast<intermediate_node*>(cur->_children[i]));
+						}
+					}
+					std::destroy_at(cur);
+					_allocator.free(cur);
+				}
+				_root = nullptr;
+			}
+			if (items.empty()) {
+				return;
+			}
+
+			_root = new (_allocator.allocate(memory::size_alignment::of<intermediate_node>())) intermediate_node();
+			_build(_root, items);
+		}
+		/// Computes the surface area heuristic cost of this tree, i.e., the total surface area of all nodes relative
+		/// to that of the bounds of all leaves. This is proportional to the expected number of nodes visited by a
+		/// random query, and can be compared before and after refitting to decide when to \ref rebuild(). Nodes with
+		/// infinite bounds, e.g., those containing planes, are ignored.
+		[[nodiscard]] scalar compute_cost() const {
+			if (!_root) {
+				return 0.0f;
+			}
+
+			auto bookmark = get_scratch_bookmark();
+			auto stack = bookmark.create_vector_array<const intermediate_node*>(1u, _root);
+			_cost_accumulator cost;
+			while (!stack.empty()) {
+				const intermediate_node *cur = stack.back();
+				stack.pop_back();
+				for (index_t i = 0; i < Order; ++i) {
+					if (!cur->_children[i]) {
+						continue;
+					}
+					cost.add(cur->_children_aabb.get(i), cur->is_child_leaf(i));
+					if (!cur->is_child_leaf(i)) {
+						stack.emplace_back(static_cast<const intermediate_node*>(cur->_children[i]));
+					}
+				}
+			}
+			return cost.get();
+		}
+
 		/// Calls \p callback with all \ref leaf_node objects that intersect the given box.
 		template <typename Cb> void query_aab(aab3s box, Cb &&callback) const {
 			if (!_root) {
@@ -284,8 +405,9 @@ namespace lotus::collision {
 				intermediate_node *const cur = stack.back();
 				stack.pop_back();
 
-				for (index_t i = 0; i < Order; ++i) {
-					if (!cur->_children[i] || !aab3s::intersects(cur->_children_aabb[i], box)) {
+				for (u32 hits = cur->_children_aabb.intersect(box); hits != 0; hits &= hits - 1) {
+					const auto i = static_cast<index_t>(std::countr_zero(hits));
+					if (!cur->_children[i]) {
 						continue;
 					}
 					if (cur->is_child_leaf(i)) {
@@ -312,15 +434,15 @@ namespace lotus::collision {
 				intermediate_node *const cur = stack.back();
 				stack.pop_back();
 
-				for (index_t i = 0; i < Order; ++i) {
+				const u32 hits1 = cur->_children_aabb.intersect(b1);
+				const u32 hits2 = cur->_children_aabb.intersect(b2);
+				for (u32 hits = hits1 | hits2; hits != 0; hits &= hits - 1) {
+					const auto i = static_cast<index_t>(std::countr_zero(hits));
 					if (!cur->_children[i]) {
 						continue;
 					}
-					const bool intersect1 = aab3s::intersects(cur->_children_aabb[i], b1);
-					const bool intersect2 = aab3s::intersects(cur->_children_aabb[i], b2);
-					if (!intersect1 && !intersect2) {
-						continue;
-					}
+					const bool intersect1 = hits1 & (1u << i);
+					const bool intersect2 = hits2 & (1u << i);
 					if (cur->is_child_leaf(i)) {
 						auto *leaf = static_cast<leaf_node*>(cur->_children[i]);
 						if (!intersect1) {
@@ -407,7 +529,7 @@ namespace lotus::collision {
 						if (child->_parent_index != i) {
 							error_callback(child, u8"Incorrect node parent index");
 						}
-						if (child->compute_aabb() != cur->_children_aabb[i]) {
+						if (child->compute_aabb() != cur->_children_aabb.get(i)) {
 							error_callback(child, u8"Incorrect aabb");
 						}
 						if (child->compute_num_primitives() != cur->_children_num_primitives[i]) {
@@ -426,9 +548,201 @@ namespace lotus::collision {
 			return static_cast<scalar>(num_primitives) * area;
 		}
 	private:
+		/// Number of bins used when looking for the best split during \ref rebuild().
+		constexpr static u32 _num_build_bins = 16;
+
+		/// A leaf being placed during \ref rebuild().
+		struct _build_item {
+			/// Initializes all fields of this struct.
+			_build_item(leaf_node *l, aab3s b, u32 n) :
+				leaf(l), bounding_box(b), num_primitives(n), is_finite(std::isfinite(heuristic(b, 1))) {
+				if (is_finite) {
+					centroid = 0.5f * (bounding_box.min + bounding_box.max);
+				}
+			}
+
+			leaf_node *leaf = nullptr; ///< The leaf.
+			aab3s bounding_box = zero; ///< Bounding box of the leaf.
+			vec3 centroid = zero; ///< Center of \ref bounding_box, or zero if it's infinite.
+			u32 num_primitives = 0; ///< Number of primitives in the leaf.
+			bool is_finite = false; ///< Whether \ref bounding_box has a finite surface area.
+		};
+
 		intermediate_node *_root = nullptr; ///< The root node.
 		[[no_unique_address]] Allocator _allocator; ///< Allocator.
 
+		/// Accumulates the surface area of nodes for \ref compute_cost().
+		struct _cost_accumulator {
+			scalar total_area = 0.0f; ///< Total area of all finite nodes.
+			aab3s leaf_bounds = aab3s::create_infinity().negated(); ///< Bounds of all finite leaves.
+
+			/// Adds a node with the given bounding box.
+			void add(aab3s bb, bool is_leaf) {
+				const scalar area = heuristic(bb, 1);
+				if (!std::isfinite(area)) {
+					return;
+				}
+				total_area += area;
+				if (is_leaf) {
+					leaf_bounds = aab3s::minimum_containing({ leaf_bounds, bb });
+				}
+			}
+			/// Returns the total area relative to the area of \ref leaf_bounds.
+			[[nodiscard]] scalar get() const {
+				const scalar bounds_area = heuristic(leaf_bounds, 1);
+				return bounds_area > 0.0f ? total_area / bounds_area : 0.0f;
+			}
+		};
+
+		/// Fills the given empty node with the given items, recursively creating intermediate nodes as necessary.
+		void _build(intermediate_node *n, std::span<_build_item> items) {
+			// repeatedly split the largest group in two until there are enough groups to fill all children
+			std::array<std::span<_build_item>, Order> groups;
+			usize num_groups = 1;
+			groups[0] = items;
+			while (num_groups < Order) {
+				usize largest = 0;
+				for (usize i = 1; i < num_groups; ++i) {
+					if (groups[i].size() > groups[largest].size()) {
+						largest = i;
+					}
+				}
+				if (groups[largest].size() < 2) {
+					break;
+				}
+				const usize split = _find_split(groups[largest]);
+				groups[num_groups] = groups[largest].subspan(split);
+				groups[largest] = groups[largest].first(split);
+				++num_groups;
+			}
+
+			for (usize gi = 0; gi < num_groups; ++gi) {
+				const auto i = static_cast<index_t>(gi);
+				if (groups[gi].size() == 1) {
+					const _build_item &item = groups[gi][0];
+					n->_children[i] = item.leaf;
+					n->_children_aabb.set(i, item.bounding_box);
+					n->_children_num_primitives[i] = item.num_primitives;
+					n->_set_child_leaf(i);
+					item.leaf->_parent = n;
+					item.leaf->_parent_index = i;
+				} else {
+					auto *child =
+						new (_allocator.allocate(memory::size_alignment::of<intermediate_node>())) intermediate_node();
+					child->_parent = n;
+					child->_parent_index = i;
+					n->_children[i] = child;
+					_build(child, groups[gi]);
+					n->_children_aabb.set(i, child->compute_aabb());
+					n->_children_num_primitives[i] = child->compute_num_primitives();
+				}
+			}
+		}
+		/// Partitions the given items, which must contain at least two elements, using binned surface area
+		/// heuristic. Returns the number of items in the first half, which is always nonzero and less than the total.
+		[[nodiscard]] static usize _find_split(std::span<_build_item> items) {
+			{ // separate infinite leaves (e.g., planes) first, since they overlap everything else anyway
+				const auto finite = std::ranges::partition(items, [](const _build_item &item) {
+					return !item.is_finite;
+				});
+				const auto num_infinite = static_cast<usize>(finite.begin() - items.begin());
+				if (num_infinite > 0 && num_infinite < items.size()) {
+					return num_infinite;
+				}
+			}
+
+			aab3s centroid_bounds = aab3s::create_infinity().negated();
+			for (const _build_item &item : items) {
+				centroid_bounds.min = matm::min(centroid_bounds.min, item.centroid);
+				centroid_bounds.max = matm::max(centroid_bounds.max, item.centroid);
+			}
+			const vec3 extent = centroid_bounds.signed_size();
+			usize axis = 0;
+			if (extent[1] > extent[axis]) {
+				axis = 1;
+			}
+			if (extent[2] > extent[axis]) {
+				axis = 2;
+			}
+
+			const usize middle = items.size() / 2;
+			const auto split_at_median = [&]() {
+				std::ranges::nth_element(
+					items, items.begin() + static_cast<std::ptrdiff_t>(middle),
+					[axis](const _build_item &lhs, const _build_item &rhs) {
+						return lhs.centroid[axis] < rhs.centroid[axis];
+					}
+				);
+				return middle;
+			};
+			if (!(extent[axis] > 0.0f)) { // all centroids coincide
+				return split_at_median();
+			}
+
+			// accumulate bins
+			const scalar bin_scale = static_cast<scalar>(_num_build_bins) / extent[axis];
+			const auto get_bin = [&](const _build_item &item) {
+				const scalar offset = (item.centroid[axis] - centroid_bounds.min[axis]) * bin_scale;
+				return std::min(static_cast<u32>(std::max(offset, 0.0f)), _num_build_bins - 1);
+			};
+			std::array<aab3s, _num_build_bins> bin_bounds;
+			std::array<u32, _num_build_bins> bin_primitives = {};
+			std::ranges::fill(bin_bounds, aab3s::create_infinity().negated());
+			for (const _build_item &item : items) {
+				const u32 bin = get_bin(item);
+				bin_bounds[bin] = aab3s::minimum_containing({ bin_bounds[bin], item.bounding_box });
+				bin_primitives[bin] += item.num_primitives;
+			}
+
+			// sweep from the right to compute the cost of the right half of each split
+			std::array<scalar, _num_build_bins> right_costs;
+			{
+				aab3s right_bounds = aab3s::create_infinity().negated();
+				u32 right_primitives = 0;
+				for (u32 i = _num_build_bins - 1; i > 0; --i) {
+					right_bounds = aab3s::minimum_containing({ right_bounds, bin_bounds[i] });
+					right_primitives += bin_primitives[i];
+					right_costs[i] = right_primitives > 0 ? heuristic(right_bounds, right_primitives) : 0.0f;
+				}
+			}
+			// sweep from the left to find the best split, which is placed after bin best_bin
+			std::optional<u32> best_bin;
+			scalar best_cost = std::numeric_limits<scalar>::max();
+			{
+				aab3s left_bounds = aab3s::create_infinity().negated();
+				u32 left_primitives = 0;
+				u32 right_primitives = 0;
+				for (const u32 n : bin_primitives) {
+					right_primitives += n;
+				}
+				for (u32 i = 0; i + 1 < _num_build_bins; ++i) {
+					left_bounds = aab3s::minimum_containing({ left_bounds, bin_bounds[i] });
+					left_primitives += bin_primitives[i];
+					right_primitives -= bin_primitives[i];
+					if (left_primitives == 0 || right_primitives == 0) {
+						continue;
+					}
+					const scalar cost = heuristic(left_bounds, left_primitives) + right_costs[i + 1];
+					if (cost < best_cost) {
+						best_cost = cost;
+						best_bin = i;
+					}
+				}
+			}
+			if (!best_bin) {
+				return split_at_median();
+			}
+
+			const auto second_half = std::ranges::partition(items, [&](const _build_item &item) {
+				return get_bin(item) <= best_bin.value();
+			});
+			const auto split = static_cast<usize>(second_half.begin() - items.begin());
+			if (split == 0 || split == items.size()) { // can happen with leaves that contain no primitives
+				return split_at_median();
+			}
+			return split;
+		}
+
 		/// Inserts the given node at the given location.
 		void _insert_at(intermediate_node *parent, index_t index, leaf_node *node, aab3s bb, u32 num_primitives) {
 			if (parent->is_child_leaf(index)) {
@@ -442,7 +756,7 @@ namespace lotus::collision {
 				new_child->_parent = parent;
 				new_child->_parent_index = index;
 				new_child->_children[0] = old_child;
-				new_child->_children_aabb[0] = parent->_children_aabb[index];
+				new_child->_children_aabb.set(0, parent->_children_aabb.get(index));
 				new_child->_children_num_primitives[0] = parent->_children_num_primitives[index];
 				new_child->_set_child_leaf(0);
 
@@ -460,22 +774,21 @@ namespace lotus::collision {
 
 			// update parent
 			parent->_children[index] = node;
-			parent->_children_aabb[index] = bb;
+			parent->_children_aabb.set(index, bb);
 			parent->_children_num_primitives[index] = num_primitives;
 			parent->_set_child_leaf(index);
 
 			// update path to root
 			for (intermediate_node *cur = parent; cur->_parent; cur = cur->_parent) {
 				cur->_num_primitives_in_parent() += num_primitives;
-				aab3s &cur_bb = cur->_aabb_in_parent();
-				cur_bb = aab3s::minimum_containing({ cur_bb, bb });
+				cur->_set_aabb_in_parent(aab3s::minimum_containing({ cur->_get_aabb_in_parent(), bb }));
 			}
 		}
 
 		/// Finds the promotion that would result in the most heuristic reduction for the tree.
 		[[nodiscard]] static std::optional<index_t> _find_best_promotion(intermediate_node *node) {
 			// the heuristic of the parent node will not change - we only need to focus on the child node
-			const scalar original_heuristic = heuristic(node->_aabb_in_parent(), node->_num_primitives_in_parent());
+			const scalar original_heuristic = heuristic(node->_get_aabb_in_parent(), node->_num_primitives_in_parent());
 
 			aab3s parent_bb_no_this = aab3s::create_infinity().negated();
 			u32 parent_num_prims_no_this = 0;
@@ -484,7 +797,7 @@ namespace lotus::collision {
 					continue;
 				}
 				parent_bb_no_this =
-					aab3s::minimum_containing({ parent_bb_no_this, node->_parent->_children_aabb[i] });
+					aab3s::minimum_containing({ parent_bb_no_this, node->_parent->_children_aabb.get(i) });
 				parent_num_prims_no_this += node->_parent->_children_num_primitives[i];
 			}
 
@@ -493,7 +806,7 @@ namespace lotus::collision {
 			for (index_t i = 0; i < Order; ++i) {
 				const aab3s new_bb =
 					node->_children[i] ?
-					aab3s::minimum_containing({ parent_bb_no_this, node->_children_aabb[i] }) :
+					aab3s::minimum_containing({ parent_bb_no_this, node->_children_aabb.get(i) }) :
 					parent_bb_no_this;
 				const u32 new_num_primitives = parent_num_prims_no_this + node->_children_num_primitives[i];
 				const scalar new_heuristic = heuristic(new_bb, new_num_primitives);
@@ -541,8 +854,8 @@ namespace lotus::collision {
 			parent->_parent_index = replace_id;
 
 			// update AABB
-			parent->_children_aabb[old_parent_index] = node->_children_aabb[replace_id];
-			node->_children_aabb[replace_id] = parent->compute_aabb();
+			parent->_children_aabb.set(old_parent_index, node->_children_aabb.get(replace_id));
+			node->_children_aabb.set(replace_id, parent->compute_aabb());
 			// update num primitives
 			parent->_children_num_primitives[old_parent_index] = node->_children_num_primitives[replace_id];
 			node->_children_num_primitives[replace_id] = parent->compute_num_primitives();
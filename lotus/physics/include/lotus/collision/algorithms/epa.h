@@ -37,6 +37,11 @@ namespace lotus::collision::epa {
 		[[nodiscard]] type compute_type() const;
 	};
 
-	/// Executes the algorithm.
-	[[nodiscard]] result epa(polyhedron_pair, gjk::result);
+	/// Maximum number of vertices of the expanded polytope. The Minkowski difference of two large polyhedra has far
+	/// more vertices than are needed for the algorithm to converge, so it stops early when this is reached.
+	constexpr usize max_num_vertices = 256;
+
+	/// Executes the algorithm, expanding the polytope to at most the given number of vertices. If this limit is
+	/// reached, the face of the polytope that is closest to the origin is returned.
+	[[nodiscard]] result epa(polyhedron_pair, gjk::result, usize max_vertices = max_num_vertices);
 }
@@ -4,6 +4,7 @@
 /// The Gilbert-Johnson-Kerrthi algorithm.
 
 #include <array>
+#include <optional>
 
 #include "lotus/collision/common.h"
 
@@ -37,6 +38,9 @@ namespace lotus::collision::gjk {
 		/// Vertices of the simplex.
 		std::array<simplex_vertex, 4> simplex{ uninitialized, uninitialized, uninitialized, uninitialized };
 		usize simplex_vertices; ///< The number of valid vertices in \ref simplex.
+		/// If the two shapes do not intersect, the axis in world space along which they were found to be separated;
+		/// otherwise zero. The next update first checks if this axis still separates them.
+		vec3 separating_axis = zero;
 	};
 	/// Result of the algorithm.
 	struct result {
@@ -63,6 +67,11 @@ namespace lotus::collision::gjk {
 		}
 	};
 
-	/// Updates and returns the result of the GJK algorithm.
+	/// Updates and returns the result of the GJK algorithm. Passing in the persistent part of the result of the last
+	/// update for the same pair of shapes allows the algorithm to start from the previous simplex.
 	[[nodiscard]] result gjk(polyhedron_pair, persistent_result = zero);
+	/// Finds the point on the polyhedron that is closest to the given point, both in the local space of the
+	/// polyhedron, using the distance variant of the algorithm. Returns \p std::nullopt if the point is inside the
+	/// polyhedron or touching it.
+	[[nodiscard]] std::optional<vec3> closest_point(const shapes::convex_polyhedron&, vec3);
 }
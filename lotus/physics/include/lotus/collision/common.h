@@ -117,8 +117,10 @@ namespace lotus::collision {
 		const shapes::convex_polyhedron *shape1; ///< The first shape.
 		const shapes::convex_polyhedron *shape2; ///< The second shape.
 
-		/// Returns the support vertex for the given direction.
-		[[nodiscard]] simplex_vertex support_vertex(vec3) const;
+		/// Returns the support vertex for the given direction. The search starts from the given vertex if it is valid.
+		[[nodiscard]] simplex_vertex support_vertex(
+			vec3, simplex_vertex hint = simplex_vertex(vertex_id::invalid, vertex_id::invalid)
+		) const;
 		/// Returns the position, in global coordinates, of the given \ref simplex_vertex.
 		[[nodiscard]] vec3 simplex_vertex_position(simplex_vertex) const;
 		/// Returns the penetration along the given axis.
@@ -5,13 +5,17 @@
 
 #include "lotus/collision/common.h"
 #include "lotus/collision/shape.h"
+#include "lotus/collision/algorithms/gjk.h"
 #include "lotus/collision/algorithms/contact_manifold.h"
 
 namespace lotus::collision::contact {
 	/// Detects collision between two generic shapes. This will be dispatched to one of the \ref detect() functions
 	/// for specific shapes below. The type index of the first shape must be less than that of the second shape.
+	/// If not \p nullptr, \p gjk_state is used to warm start and is updated by algorithms that use GJK; it should
+	/// be kept between calls for the same pair of shapes.
 	[[nodiscard]] std::optional<contact_manifold> detect(
-		const shape&, const body_position&, const shape&, const body_position&
+		const shape&, const body_position&, const shape&, const body_position&,
+		gjk::persistent_result *gjk_state = nullptr
 	);
 
 	/// Detects collision between a sphere and a plane.
@@ -30,9 +34,10 @@ namespace lotus::collision::contact {
 	[[nodiscard]] std::optional<contact_manifold> detect(
 		const shapes::sphere&, const body_position&, const shapes::convex_polyhedron&, const body_position&
 	);
-	/// Detects collision between two polyhedra.
+	/// Detects collision between two polyhedra, optionally warm starting GJK using the given state.
 	[[nodiscard]] std::optional<contact_manifold> detect(
 		const shapes::convex_polyhedron&, const body_position&,
-		const shapes::convex_polyhedron&, const body_position&
+		const shapes::convex_polyhedron&, const body_position&,
+		gjk::persistent_result *gjk_state = nullptr
 	);
 }
@@ -3,6 +3,7 @@
 /// \file
 /// Polyhedrons.
 
+#include <array>
 #include <vector>
 
 #include "lotus/math/vector.h"
@@ -89,12 +90,24 @@ namespace lotus::collision::shapes {
 		constexpr static scalar unique_normal_threshold = 0.99999f;
 		/// Minimum dot product between two edges for them to be considered similar.
 		constexpr static scalar unique_edge_threshold = 0.99999f;
+		/// Polyhedra with at least this many vertices find support vertices by walking along edges; smaller ones
+		/// test all vertices.
+		constexpr static usize hill_climbing_threshold = 32;
+		/// The number of vertices processed at once when testing all vertices. \ref vertex_coordinates are padded
+		/// to a multiple of this.
+		constexpr static usize vertex_batch_size = 4;
 
 		// TODO allocator or pool?
 		std::vector<vec3> vertices; ///< Vertices of this polyhedron.
 		std::vector<face> faces; ///< All faces of the polyhedron.
 		std::vector<vec3> unique_face_normals; ///< List of unique face normals.
 		std::vector<vec3> unique_edge_directions; ///< List of unique edge directions.
+		/// The X, Y, and Z coordinates of all vertices, padded with copies of the first vertex.
+		std::array<std::vector<scalar>, 3> vertex_coordinates;
+		/// Vertices adjacent to the i-th vertex are in range [vertex_adjacency_offsets[i],
+		/// vertex_adjacency_offsets[i + 1]) of \ref vertex_adjacency.
+		std::vector<u32> vertex_adjacency_offsets;
+		std::vector<vertex_id> vertex_adjacency; ///< Vertices connected to each vertex by an edge.
 
 		/// Processes the given list of vertices and creates a polyhedron from its convex hull, computing its rigid
 		/// body properties in the process.
@@ -110,7 +123,11 @@ namespace lotus::collision::shapes {
 		}
 
 		/// Returns the index of the support vertex in the given direction, and its dot product with the direction.
-		[[nodiscard]] std::pair<vertex_id, scalar> get_support_vertex(vec3 dir) const;
+		/// For large polyhedra, the search starts from the given vertex, which should be close to the result (e.g.,
+		/// the support vertex for a similar direction) for the search to be fast.
+		[[nodiscard]] std::pair<vertex_id, scalar> get_support_vertex(
+			vec3 dir, vertex_id hint = vertex_id::invalid
+		) const;
 		/// Returns the range that this polyhedron covers when projected onto the given axis.
 		[[nodiscard]] axis_projection project_onto_axis(vec3) const;
 		/// Returns the range that this polyhedron covers when projected onto the given axis, assuming that it has
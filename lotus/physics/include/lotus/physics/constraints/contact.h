@@ -13,6 +13,13 @@ namespace lotus::physics::constraints {
 		struct point {
 			vec3 local_position1 = zero; ///< Local position of the contact point on the first body.
 			vec3 local_position2 = zero; ///< Local position of the contact point on the second body.
+
+			/// Force or impulse in \ref tangents applied at this point during the previous time step, used by
+			/// solvers for warm starting. Its exact meaning depends on the solver. This is zero for new points.
+			vec3 cached_force = zero;
+			/// Constraint stiffness in \ref tangents used at this point during the previous time step, for solvers
+			/// that need it. This is zero for new points.
+			vec3 cached_stiffness = zero;
 		};
 
 		body *body1 = nullptr; ///< The first body involved.
@@ -3,8 +3,10 @@
 /// \file
 /// The augmented vertex block descent (AVBD) solver.
 
+#include <span>
 #include <vector>
 
+#include "lotus/utils/job_system.h"
 #include "lotus/physics/body.h"
 #include "lotus/physics/world.h"
 #include "lotus/physics/solvers/avbd/constraints/cosserat_rod.h"
@@ -23,6 +25,7 @@ namespace lotus::physics::solvers::avbd {
 	public:
 		constexpr static scalar minimum_stiffness = 1.0f; ///< Minimum value of k.
 		constexpr static scalar maximum_stiffness = 10000000000.0f; ///< Maximum value of k.
+		constexpr static scalar initial_contact_stiffness = 1000.0f; ///< Initial value of k for contacts.
 
 		// not an elegant solution, but works
 		/// Constant added to hinge constraints to allow the stiffness to increase normally. Must be greater than 1.
@@ -35,6 +38,16 @@ namespace lotus::physics::solvers::avbd {
 		u32 num_iterations = 8; ///< The number of iterations per time step.
 		scalar contact_damping = 0.95f; ///< α - explosive error correction prevention.
 		scalar stiffness_ramping = 10.0f; ///< β - the speed at which stiffness increases.
+		/// γ - decay applied to contact stiffness and forces carried over from the previous time step.
+		scalar warm_start_decay = 0.99f;
+
+		/// If not \p nullptr, bodies, particles, and orientations are updated in parallel on the workers of this
+		/// manager. Each is then colored such that no two objects of the same color are connected by a constraint,
+		/// and objects are updated one color at a time. This changes the order of updates compared to the serial
+		/// solver, but the result does not depend on the number of workers.
+		job_system::manager *job_manager = nullptr;
+		/// Minimum number of objects updated by a single batch during parallel updates.
+		u32 parallel_grain_size = 32;
 
 		std::vector<particle> particles; ///< The list of particles.
 		std::vector<orientation> orientations; ///< The list of orientations.
@@ -49,6 +62,14 @@ namespace lotus::physics::solvers::avbd {
 
 		bool has_indefinite_hessians = false; ///< Whether the last step produced indefinite Hessians.
 	private:
+		/// Objects grouped into colors, such that objects of the same color are not connected by any constraint and
+		/// can be updated concurrently.
+		struct _graph_coloring {
+			std::vector<u32> objects; ///< Indices of all objects that need updating, sorted by color.
+			/// Objects of the i-th color are in range [color_offsets[i], color_offsets[i + 1]) of \ref objects.
+			std::vector<u32> color_offsets;
+		};
+
 		/// Clamped contact force.
 		struct _contact_force {
 			/// Zero initialization.
@@ -106,11 +127,19 @@ namespace lotus::physics::solvers::avbd {
 				std::vector<u32> spring_constraints; ///< Related spring constraints.
 				std::vector<u32> pin_constraints; ///< Related pin constraints.
 				std::vector<u32> hinge_constraints; ///< Related hinge constraints.
+
+				/// Clears all lists while keeping their storage.
+				void clear() {
+					contact_constraints.clear();
+					spring_constraints.clear();
+					pin_constraints.clear();
+					hinge_constraints.clear();
+				}
 			};
 
 			// TODO get rid of these two
 			std::vector<world::body_data*> bodies; ///< Body pointers.
-			std::vector<const physics::constraints::rigid_body_contact*> contacts; ///< Contact constraints.
+			std::vector<physics::constraints::rigid_body_contact*> contacts; ///< Contact constraints.
 
 			std::vector<body_position> initial_positions; ///< Initial positions.
 			std::vector<body_position> inertial_positions; ///< Inertial positions.
@@ -119,6 +148,8 @@ namespace lotus::physics::solvers::avbd {
 			std::vector<_contact_dual> contact_duals; ///< Dual variables for contact constraints.
 			std::vector<_pin_dual> pin_duals; ///< Dual variables for pin constraints.
 			std::vector<_hinge_dual> hinge_duals; ///< Dual variables for hinge constraints.
+
+			_graph_coloring coloring; ///< Coloring of dynamic bodies, computed if \ref job_manager is set.
 		};
 		/// Data associated with all particles within a single time step.
 		struct _particle_step_data {
@@ -130,6 +161,8 @@ namespace lotus::physics::solvers::avbd {
 			std::vector<vec3> initial_positions; ///< Initial positions.
 			std::vector<vec3> inertial_positions; ///< Inertial positions.
 			std::vector<constraints> constraint_association; ///< Constraint association.
+
+			_graph_coloring coloring; ///< Coloring of dynamic particles, computed if \ref job_manager is set.
 		};
 		/// Data associated with all orientations within a single time step.
 		struct _orientation_step_data {
@@ -141,8 +174,22 @@ namespace lotus::physics::solvers::avbd {
 			};
 
 			std::vector<constraints> constraint_association; ///< Constraint association.
+
+			_graph_coloring coloring; ///< Coloring of dynamic orientations, computed if \ref job_manager is set.
 		};
 
+		_body_step_data _body_step; ///< Rigid body step data, kept across time steps to reuse its storage.
+
+		/// Greedily colors the graph with the given edges. Only vertices for which \p is_active returns \p true are
+		/// included in the result.
+		template <typename IsActive> [[nodiscard]] static _graph_coloring _color_graph(
+			usize num_vertices, std::span<const std::pair<u32, u32>> edges, const IsActive &is_active
+		);
+		/// Calls \p func with the indices of all \p count objects. If \ref job_manager is set, this is done in
+		/// parallel one color at a time using the given coloring, skipping objects that are not colored; otherwise,
+		/// objects are processed sequentially in order.
+		template <typename Func> void _for_each_object(const _graph_coloring&, usize count, const Func &func) const;
+
 		/// Computes the raw (\ref alpha not applied) contact error at the given contact point.
 		[[nodiscard]] vec3 _compute_raw_contact_error(
 			const constraints::rigid_body_contact&, const constraints::rigid_body_contact::point&
@@ -156,11 +203,14 @@ namespace lotus::physics::solvers::avbd {
 			return _compute_raw_contact_error(contact, contact_point) - contact_damping * dual_point.initial_error;
 		}
 		/// Prepares rigid body simulation by computing body step data for all bodies.
-		[[nodiscard]] _body_step_data _prepare_bodies(scalar dt) const;
+		/// Storage is reused from the previous time step, as the set of bodies and constraints usually changes little.
+		void _prepare_bodies(scalar dt, _body_step_data&) const;
 		/// Updates all rigid bodies by a single iteration.
 		void _solve_bodies(scalar dt, const _body_step_data&);
 		/// Updates all rigid body dual variables.
 		void _update_body_dual_variables(_body_step_data&);
+		/// Stores contact forces and stiffness into the contact points for warm starting the next time step.
+		static void _store_contact_warm_start(const _body_step_data&);
 		/// Updates the velocities of all bodies at the end of a time step.
 		void _compute_body_velocities(scalar dt, const _body_step_data&);
 
@@ -3,14 +3,12 @@
 /// \file
 /// The sequential impulse solver.
 
+#include "lotus/utils/job_system.h"
+#include "lotus/physics/world.h"
 #include "lotus/physics/constraints/contact.h"
 #include "lotus/physics/constraints/hinge.h"
 #include "lotus/physics/constraints/pin.h"
 
-namespace lotus::physics {
-	class world;
-}
-
 namespace lotus::physics::solvers::sequential_impulse {
 	/// The sequential impulse solver.
 	class solver {
@@ -22,6 +20,11 @@ namespace lotus::physics::solvers::sequential_impulse {
 		u32 num_substeps = 4;
 		u32 num_velocity_iterations = 2; ///< The number of velocity iterations per time step.
 		scalar baumgarte_stabilization = 10.0f; ///< Baumgarte stabilization coefficient.
+
+		/// If not \p nullptr, islands are solved concurrently using the workers of this manager.
+		job_system::manager *job_manager = nullptr;
+		/// Minimum number of islands processed by a single batch when solving in parallel.
+		u32 parallel_grain_size = 4;
 	private:
 		/// Precomputed data and state for a contact constraint.
 		struct _contact_constraint_data {
@@ -111,6 +114,9 @@ namespace lotus::physics::solvers::sequential_impulse {
 			void apply_impulses_for_delta_lambda(vec3 delta_lambda, const constraints::pin&) const;
 		};
 
+		/// Solves all constraints in the given island and integrates its bodies.
+		void _solve_island(const world::island&, scalar full_dt) const;
+
 		/// Immediately Applies \p impulse to the \p body1, and \p -impulse to the second \p body2.
 		static void _apply_impulses(
 			body *body1, body *body2, mat33s inv_i1, mat33s inv_i2, vec3 off1, vec3 off2, vec3 impulse
@@ -3,9 +3,10 @@
 /// \file
 /// The XPBD solver.
 
-#include <vector>
 #include <deque>
+#include <vector>
 
+#include "lotus/utils/job_system.h"
 #include "lotus/collision/shape.h"
 #include "lotus/physics/body.h"
 #include "lotus/physics/constraints/contact.h"
@@ -41,6 +42,18 @@ namespace lotus::physics::solvers::xpbd {
 
 		world *physics_world = nullptr; ///< The physics world.
 		u32 num_iterations = 8; ///< The number of iterations per time step.
+		/// Particles are only tested against static bodies whose bounding boxes overlap the particle's movement in
+		/// the current time step, expanded by this distance. Collisions may be missed for particles that are pushed
+		/// further than this by other constraints during a single time step.
+		scalar particle_collision_margin = 0.1f;
+
+		/// If not \p nullptr, particle and rod constraints are projected in parallel on the workers of this manager.
+		/// Constraints are then projected one color at a time, where constraints of the same color share no
+		/// particles or orientations. This changes the order of projection compared to the serial solver, but the
+		/// result does not depend on the number of workers.
+		job_system::manager *job_manager = nullptr;
+		/// Minimum number of constraints projected by a single batch during parallel projection.
+		u32 parallel_grain_size = 256;
 
 		std::vector<particle> particles; ///< The list of particles.
 		std::vector<orientation> orientations; ///< The list of orientations.
@@ -69,5 +82,60 @@ namespace lotus::physics::solvers::xpbd {
 		std::vector<constraints::cosserat_rod::bend_twist> rod_bend_twist_constraints;
 		/// Lagrangians for all bending-twisting constraints.
 		std::vector<constraints::cosserat_rod::bend_twist::lagrangians> rod_bend_twist_lagrangians;
+	private:
+		/// A particle and a static body that it may collide with in the current time step.
+		struct _particle_body_pair {
+			/// Initializes all fields of this struct.
+			_particle_body_pair(u32 p, u32 bi, const body &b) : particle_index(p), body_index(bi), static_body(&b) {
+			}
+
+			u32 particle_index = 0; ///< Index of the particle.
+			u32 body_index = 0; ///< Index of the static body in the world.
+			const body *static_body = nullptr; ///< The static body.
+		};
+
+		/// Constraints of one type grouped into colors, such that constraints of the same color can be projected
+		/// concurrently.
+		struct _constraint_coloring {
+			std::vector<u32> constraints; ///< Indices of all constraints, sorted by color.
+			/// Constraints of the i-th color are in range [color_offsets[i], color_offsets[i + 1]) of
+			/// \ref constraints.
+			std::vector<u32> color_offsets;
+			/// The number of colors whose constraints are independent. If there are more colors, the last one
+			/// contains all constraints that could not be colored and must be projected sequentially.
+			usize num_independent_colors = 0;
+			/// Variables used by each constraint when this coloring was computed. The coloring is recomputed if any
+			/// constraint has been added, removed, or changed to use different variables.
+			std::vector<usize> variables;
+		};
+
+		/// Potential collisions between particles and static bodies in the current time step.
+		std::vector<_particle_body_pair> _particle_collision_candidates;
+
+		_constraint_coloring _spring_coloring; ///< Coloring of \ref particle_spring_constraints.
+		_constraint_coloring _face_coloring; ///< Coloring of \ref face_constraints.
+		_constraint_coloring _bend_coloring; ///< Coloring of \ref bend_constraints.
+		_constraint_coloring _rod_bend_twist_coloring; ///< Coloring of \ref rod_bend_twist_constraints.
+		_constraint_coloring _rod_stretch_shear_coloring; ///< Coloring of \ref rod_stretch_shear_constraints.
+
+		/// Fills \ref _particle_collision_candidates by querying the bounding box of each particle's movement
+		/// against the body BVH of \ref physics_world. The candidates are sorted so that collisions are handled in
+		/// the same order as when testing each body against all particles.
+		void _find_particle_collision_candidates();
+
+		/// Recomputes all constraint colorings that are out-of-date.
+		void _update_constraint_colorings();
+		/// Greedily colors the given constraints if the coloring is out-of-date. \p get_variables returns the
+		/// indices of all particles and orientations used by a constraint, where orientations are offset by the
+		/// number of particles.
+		template <typename Constraint, typename GetVariables> void _update_coloring(
+			_constraint_coloring&, const std::vector<Constraint>&, const GetVariables &get_variables
+		) const;
+		/// Calls \p func with the indices of all \p num_constraints constraints. If \ref job_manager is set, this
+		/// is done in parallel one color at a time using the given coloring; otherwise, constraints are processed
+		/// sequentially in order.
+		template <typename Func> void _for_each_constraint(
+			const _constraint_coloring&, usize num_constraints, const Func &func
+		) const;
 	};
 }
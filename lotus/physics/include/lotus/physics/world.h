@@ -6,7 +6,9 @@
 #include <set>
 #include <unordered_map>
 
+#include "lotus/utils/job_system.h"
 #include "lotus/collision/algorithms/aabb_tree.h"
+#include "lotus/collision/algorithms/gjk.h"
 #include "lotus/physics/body.h"
 #include "lotus/physics/constraints/hinge.h"
 #include "lotus/physics/constraints/spring.h"
@@ -33,7 +35,7 @@ namespace lotus::physics {
 		/// Data associated with a body.
 		struct body_data {
 			/// Initializes \ref this_body;
-			body_data(body b, unique_id_t id) : this_body(std::move(b)), unique_id(id) {
+			body_data(body b, unique_id_t id, u32 idx) : this_body(std::move(b)), unique_id(id), index(idx) {
 			}
 
 			body this_body; ///< The body.
@@ -41,8 +43,31 @@ namespace lotus::physics {
 			/// Timestamp of when this AABB was last updated.
 			[[no_unique_address]] static_optional<timestamp_t, enable_aabb_timestamps> aabb_timestamp;
 			unique_id_t unique_id = unique_id_t::invalid; ///< Unique ID of this object.
+			u32 index = 0; ///< Index of this body in \ref get_bodies().
 			aab3s aabb = zero; ///< The AABB of this body.
 			body_bvh::leaf_node *node = nullptr; ///< Node in the AABB tree.
+			/// How long this body has been moving slower than \ref sleep_linear_velocity and
+			/// \ref sleep_angular_velocity.
+			scalar sleep_timer = 0.0f;
+			/// Whether this body is asleep. Sleeping bodies are not moved by solvers, and collisions between them are
+			/// not updated.
+			bool asleep = false;
+			/// Timestamp of the last call to \ref update_contact_constraints() that inserted this body into the BVH or
+			/// updated its AABB.
+			timestamp_t moved_timestamp = 0;
+
+			/// Returns whether this body can be moved by constraints, i.e., whether it has finite mass.
+			[[nodiscard]] bool is_dynamic() const {
+				return this_body.properties.inverse_mass > 0.0f;
+			}
+			/// Returns whether this body is not expected to move, i.e., if it is asleep or if it is a static body that
+			/// is not moving.
+			[[nodiscard]] bool is_resting() const {
+				if (is_dynamic()) {
+					return asleep;
+				}
+				return this_body.state.velocity.linear == zero && this_body.state.velocity.angular == zero;
+			}
 
 			/// Sets the AABB alongside with \ref aabb_timestamp.
 			void set_aabb(aab3s bb, timestamp_t timestamp) {
@@ -90,15 +115,39 @@ namespace lotus::physics {
 		};
 		/// Data associated with two bodies with overlapping AABBs.
 		struct overlap_data {
-			/// Initializes \ref bodies.
-			explicit overlap_data(body_data_pair bs) : bodies(bs) {
+			/// Initializes \ref bodies and \ref creation_timestamp.
+			overlap_data(body_data_pair bs, timestamp_t timestamp) : bodies(bs), creation_timestamp(timestamp) {
 			}
 
 			body_data_pair bodies; ///< The pair of bodies.
+			timestamp_t creation_timestamp = 0; ///< Timestamp of the step in which this overlap has been found.
 			std::optional<constraints::rigid_body_contact> contact; ///< Contact constraint.
+			/// GJK state from the last update, used to warm start collision detection.
+			collision::gjk::persistent_result gjk_state = zero;
 
-			/// Updates the contact.
-			void update_contact();
+			/// Returns whether this overlap has been found, or whether either body has been added or moved, in the
+			/// step with the given timestamp.
+			[[nodiscard]] bool is_changed(timestamp_t timestamp) const {
+				return
+					creation_timestamp == timestamp ||
+					bodies.first->moved_timestamp == timestamp ||
+					bodies.second->moved_timestamp == timestamp;
+			}
+
+			/// Updates the contact. Cached solver data of contact points from the previous update are carried over
+			/// to new points that are within the given distance of them on both bodies. Contacts between resting
+			/// bodies are only updated if the overlap has changed in the step with the given timestamp.
+			void update_contact(scalar matching_distance, timestamp_t timestamp);
+		};
+		/// A group of awake dynamic bodies that are connected by contacts or joints. Bodies in different islands only
+		/// interact through static or kinematic bodies, so islands can be solved independently. All spans point to
+		/// storage owned by the world, and are valid until the next call to \ref update_contact_constraints().
+		struct island {
+			std::span<body_data *const> bodies; ///< Bodies in this island.
+			std::span<constraints::rigid_body_contact *const> contacts; ///< Contacts between bodies in this island.
+			std::span<const u32> springs; ///< Indices of springs in \ref world::springs attached to this island.
+			std::span<const u32> pins; ///< Indices of pins in \ref world::pins attached to this island.
+			std::span<const u32> hinges; ///< Indices of hinges in \ref world::hinges attached to this island.
 		};
 
 
@@ -106,8 +155,11 @@ namespace lotus::physics {
 		body_data *add_body(body raw_body) {
 			_id_alloc = static_cast<unique_id_t>(std::to_underlying(_id_alloc) + 1);
 
-			body_data *bdata = &*_bodies.emplace_back(std::make_unique<body_data>(std::move(raw_body), _id_alloc));
+			const auto index = static_cast<u32>(_bodies.size());
+			body_data *bdata =
+				&*_bodies.emplace_back(std::make_unique<body_data>(std::move(raw_body), _id_alloc, index));
 			body *b = &bdata->this_body;
+			_body_lookup.emplace(b, bdata);
 
 			const aab3s aabb = _get_expanded_aab(
 				b->body_shape->get_aabb_with_transform(b->state.position), b->state.velocity.linear
@@ -125,18 +177,39 @@ namespace lotus::physics {
 		[[nodiscard]] std::span<const std::unique_ptr<body_data>> get_bodies() const {
 			return _bodies;
 		}
+		/// Returns the \ref body_data that contains the given body.
+		[[nodiscard]] body_data *find_body_data(const body *b) const {
+			auto it = _body_lookup.find(b);
+			crash_if(it == _body_lookup.end());
+			return it->second;
+		}
 
-		/// Calls the given callback for each contact constraint.
+		/// Calls the given callback for each contact constraint, skipping contacts involving sleeping bodies.
 		template <typename Cb> void for_each_contact(Cb &&cb) const {
 			for (const overlap_data &overlap : _overlaps) {
-				if (overlap.contact) {
+				if (overlap.contact && !overlap.bodies.first->asleep && !overlap.bodies.second->asleep) {
+					cb(overlap.contact.value());
+				}
+			}
+		}
+		/// \overload
+		template <typename Cb> void for_each_contact(Cb &&cb) {
+			for (overlap_data &overlap : _overlaps) {
+				if (overlap.contact && !overlap.bodies.first->asleep && !overlap.bodies.second->asleep) {
 					cb(overlap.contact.value());
 				}
 			}
 		}
 
-		/// Detects collisions and updates \ref contacts.
+		/// Detects collisions and updates \ref contacts, then updates \ref get_islands(). Sleeping islands that come
+		/// into contact with awake bodies are woken up.
 		void update_contact_constraints();
+		/// Updates the sleep timers of all awake bodies, and puts islands in which all bodies have been slow for
+		/// \ref time_to_sleep to sleep. Solvers call this at the end of each time step.
+		void update_sleep_states(scalar dt);
+		/// Wakes up the given body. This should be called when the state of a sleeping body is modified externally.
+		/// Other bodies in the same island are woken up by the next call to \ref update_contact_constraints().
+		void wake_body(body_data*);
 
 		/// Marks the body for an AABB update if necessary.
 		void on_body_moved(body_data*);
@@ -149,6 +222,10 @@ namespace lotus::physics {
 		[[nodiscard]] const body_bvh &get_body_bvh() const {
 			return _body_bvh;
 		}
+		/// Returns all islands of awake bodies found by the last call to \ref update_contact_constraints().
+		[[nodiscard]] std::span<const island> get_islands() const {
+			return _islands;
+		}
 		/// Returns the world timestamp.
 		[[nodiscard]] timestamp_t get_timestamp() const {
 			return _timestamp;
@@ -161,6 +238,26 @@ namespace lotus::physics {
 		scalar aabb_prediction = 1.0f / 30.0f;
 		/// Amount to expand AABBs by.
 		scalar aabb_expansion = 0.01f;
+		/// Contact points found in consecutive time steps are considered the same if they are within this distance
+		/// on both bodies, in which case their cached solver data is kept for warm starting.
+		scalar contact_matching_distance = 0.02f;
+
+		/// If at least this many bodies need their AABBs updated in a single step, the BVH is refitted in bulk (and
+		/// rebuilt if its quality has degraded too much) instead of being updated one body at a time.
+		u32 bvh_bulk_update_threshold = 64;
+		/// After a bulk refit, the BVH is rebuilt if its cost exceeds its cost after the last rebuild by this factor.
+		scalar bvh_rebuild_cost_ratio = 1.5f;
+
+		/// If not \p nullptr, narrow phase collision detection is distributed over the workers of this manager.
+		job_system::manager *job_manager = nullptr;
+		/// Minimum number of overlaps processed by a single batch during parallel collision detection.
+		u32 narrow_phase_grain_size = 16;
+
+		bool enable_sleeping = true; ///< Whether bodies at rest are put to sleep.
+		scalar sleep_linear_velocity = 0.05f; ///< Bodies slower than this may be put to sleep.
+		scalar sleep_angular_velocity = 0.05f; ///< Bodies rotating slower than this may be put to sleep.
+		/// Islands are put to sleep after all bodies in them have been slow for this long.
+		scalar time_to_sleep = 0.5f;
 
 		std::vector<constraints::spring> springs; ///< All spring constraints.
 		std::vector<constraints::pin> pins; ///< All pin constraints.
@@ -182,10 +279,22 @@ namespace lotus::physics {
 		timestamp_t _timestamp = 0; ///< Timestamp incremented each time \ref update_contact_constraints() is called.
 		body_bvh _body_bvh; ///< Bodies in this world.
 		std::vector<std::unique_ptr<body_data>> _bodies; ///< All bodies.
+		std::unordered_map<const body*, body_data*> _body_lookup; ///< Mapping from bodies to \ref body_data.
 		unique_id_t _id_alloc = unique_id_t::invalid; ///< ID allocator for bodies.
 		std::vector<_body_aabb_update> _bodies_to_update; ///< Bodies that have invalid overlap data.
 		std::vector<overlap_data> _overlaps; ///< All potential contacts in the current time step.
+		std::vector<island> _islands; ///< Islands of awake bodies.
+		std::vector<body_data*> _island_bodies; ///< Storage for \ref island::bodies.
+		std::vector<constraints::rigid_body_contact*> _island_contacts; ///< Storage for \ref island::contacts.
+		std::vector<u32> _island_springs; ///< Storage for \ref island::springs.
+		std::vector<u32> _island_pins; ///< Storage for \ref island::pins.
+		std::vector<u32> _island_hinges; ///< Storage for \ref island::hinges.
+		/// Cost of \ref _body_bvh right after it was last rebuilt, or zero if it has never been rebuilt.
+		scalar _bvh_reference_cost = 0.0f;
 
+		/// Finds islands over the contact and joint graph, wakes up islands that contain awake bodies, and updates
+		/// \ref _islands.
+		void _update_islands();
 		/// Validates the BVH if enabled.
 		void _maybe_validate_bvh() const;
 
@@ -19,15 +19,18 @@ namespace lotus::collision::epa {
 	}
 
 
-	result epa(polyhedron_pair input, gjk::result gjk_state) {
+	result epa(polyhedron_pair input, gjk::result gjk_state, usize max_vertices) {
 		profiler::scope p1;
 
 		using convex_hull = incremental_convex_hull;
 
 		auto bookmark = get_scratch_bookmark();
 
+		const usize num_verts = std::max<usize>(
+			std::min(input.shape1->vertices.size() * input.shape2->vertices.size(), max_vertices), 4
+		);
 		auto hull_storage = convex_hull::create_storage_for_num_vertices(
-			static_cast<u32>(input.shape1->vertices.size() * input.shape2->vertices.size()),
+			static_cast<u32>(num_verts),
 			bookmark.create_std_allocator<convex_hull::vec3>(),
 			bookmark.create_std_allocator<convex_hull::face_entry>()
 		);
@@ -54,12 +57,11 @@ namespace lotus::collision::epa {
 			hull_data.get(static_cast<convex_hull::vertex_id>(i)) = gjk_state.persistent.simplex[i];
 		}
 
-		convex_hull::face_id nearest_face_id = hull.get_any_face();
-		scalar nearest_face_dist = hull_data.get(nearest_face_id);
-		const usize num_verts = input.shape1->vertices.size() * input.shape2->vertices.size();
-		for (usize iter = 4; iter < num_verts; ++iter) {
+		convex_hull::face_id nearest_face_id = convex_hull::face_id::invalid;
+		scalar nearest_face_dist = std::numeric_limits<scalar>::infinity();
+		for (usize iter = 4; ; ++iter) {
 			// find the closest plane
-			nearest_face_id = incremental_convex_hull::face_id::invalid;
+			nearest_face_id = convex_hull::face_id::invalid;
 			nearest_face_dist = std::numeric_limits<scalar>::infinity();
 			hull.for_each_face([&](convex_hull::face_id fid, const convex_hull::face&) {
 				const scalar cur_dist = hull_data.get(fid);
@@ -68,6 +70,11 @@ namespace lotus::collision::epa {
 					nearest_face_dist = cur_dist;
 				}
 			});
+			// the polytope is full - adding another vertex would overflow the storage, so the nearest face found
+			// above is used as the result
+			if (iter >= num_verts) {
+				break;
+			}
 			// numerical instability
 			if (nearest_face_dist < 0.0f) {
 				break;
@@ -75,7 +82,8 @@ namespace lotus::collision::epa {
 
 			// find new vertex
 			const convex_hull::face &nearest_face = hull.get_face(nearest_face_id);
-			const simplex_vertex new_vert_id = input.support_vertex(nearest_face.normal);
+			const simplex_vertex new_vert_id =
+				input.support_vertex(nearest_face.normal, hull_data.get(nearest_face.vertex_indices[0]));
 			const vec3 new_vert_pos = input.simplex_vertex_position(new_vert_id);
 			const scalar new_dist = vec::dot(vecu::normalize(nearest_face.normal), new_vert_pos);
 			if (new_dist - nearest_face_dist < 1e-6f) { // TODO: threshold
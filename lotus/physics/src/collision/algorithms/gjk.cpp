@@ -3,11 +3,175 @@
 /// \file
 /// Implementation of the GJK and EPA algorithm.
 
+#include <algorithm>
+
 #include "lotus/utils/profiler.h"
 #include "lotus/memory/stack_allocator.h"
 #include "lotus/collision/shapes/convex_polyhedron.h"
 
 namespace lotus::collision::gjk {
+	/// Returns the point on the given segment that is closest to the origin. Bits in \p used are set for the
+	/// vertices that the result depends on.
+	[[nodiscard]] static vec3 _closest_point_on_segment(vec3 a, vec3 b, u32 &used) {
+		const vec3 ab = b - a;
+		const scalar t = -vec::dot(a, ab);
+		if (t <= 0.0f) {
+			used = 0b01;
+			return a;
+		}
+		const scalar len_sqr = ab.squared_norm();
+		if (t >= len_sqr) {
+			used = 0b10;
+			return b;
+		}
+		used = 0b11;
+		return a + ab * (t / len_sqr);
+	}
+
+	/// Returns the point on the given triangle that is closest to the origin, by checking which Voronoi region the
+	/// origin is in. Bits in \p used are set for the vertices that the result depends on.
+	[[nodiscard]] static vec3 _closest_point_on_triangle(vec3 a, vec3 b, vec3 c, u32 &used) {
+		const vec3 ab = b - a;
+		const vec3 ac = c - a;
+
+		const scalar d1 = -vec::dot(ab, a);
+		const scalar d2 = -vec::dot(ac, a);
+		if (d1 <= 0.0f && d2 <= 0.0f) {
+			used = 0b001;
+			return a;
+		}
+		const scalar d3 = -vec::dot(ab, b);
+		const scalar d4 = -vec::dot(ac, b);
+		if (d3 >= 0.0f && d4 <= d3) {
+			used = 0b010;
+			return b;
+		}
+		const scalar vc = d1 * d4 - d3 * d2;
+		if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f) {
+			used = 0b011;
+			return a + ab * (d1 / (d1 - d3));
+		}
+		const scalar d5 = -vec::dot(ab, c);
+		const scalar d6 = -vec::dot(ac, c);
+		if (d6 >= 0.0f && d5 <= d6) {
+			used = 0b100;
+			return c;
+		}
+		const scalar vb = d5 * d2 - d1 * d6;
+		if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f) {
+			used = 0b101;
+			return a + ac * (d2 / (d2 - d6));
+		}
+		const scalar va = d3 * d6 - d5 * d4;
+		if (va <= 0.0f && d4 - d3 >= 0.0f && d5 - d6 >= 0.0f) {
+			used = 0b110;
+			return b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)));
+		}
+		used = 0b111;
+		const scalar denom = 1.0f / (va + vb + vc);
+		return a + ab * (vb * denom) + ac * (vc * denom);
+	}
+
+	/// Returns the point on the given tetrahedron that is closest to the origin, or \p std::nullopt if the origin
+	/// is inside of it. Bits in \p used are set for the vertices that the result depends on.
+	[[nodiscard]] static std::optional<vec3> _closest_point_on_tetrahedron(
+		const std::array<vec3, 4> &verts, u32 &used
+	) {
+		std::optional<vec3> result;
+		scalar result_sqr_dist = std::numeric_limits<scalar>::max();
+		for (u32 i = 0; i < 4; ++i) {
+			const u32 i1 = (i + 1) % 4;
+			const u32 i2 = (i + 2) % 4;
+			const u32 i3 = (i + 3) % 4;
+			const vec3 normal = vec::cross(verts[i1] - verts[i], verts[i2] - verts[i]);
+			// only check faces that separate the origin from the remaining vertex; degenerate tetrahedra check all
+			// faces
+			if (vec::dot(normal, -verts[i]) * vec::dot(normal, verts[i3] - verts[i]) > 0.0f) {
+				continue;
+			}
+			u32 face_used = 0;
+			const vec3 point = _closest_point_on_triangle(verts[i], verts[i1], verts[i2], face_used);
+			const scalar sqr_dist = point.squared_norm();
+			if (sqr_dist < result_sqr_dist) {
+				result = point;
+				result_sqr_dist = sqr_dist;
+				// convert to bits of the tetrahedron - bit j of face_used corresponds to vertex (i + j) % 4
+				used = ((face_used << i) | (face_used >> (4 - i))) & 0b1111;
+			}
+		}
+		return result;
+	}
+
+	std::optional<vec3> closest_point(const shapes::convex_polyhedron &poly, vec3 point) {
+		profiler::scope p1;
+
+		constexpr u32 max_iterations = 64;
+		// relative tolerance on the squared distance for terminating the algorithm
+		constexpr scalar tolerance = 1e-6f;
+		// squared distance below which the point is considered to be touching the polyhedron
+		constexpr scalar touching_sqr_distance = 1e-12f;
+
+		// positions are relative to the query point, so that we're looking for the point closest to the origin
+		std::array<vec3, 4> positions{ uninitialized, uninitialized, uninitialized, uninitialized };
+		std::array<vertex_id, 4> vertices;
+		u32 num_vertices = 1;
+
+		vertices[0] = poly.get_support_vertex(-point).first;
+		positions[0] = poly.get_vertex(vertices[0]) - point;
+		vec3 closest = positions[0];
+		for (u32 iter = 0; iter < max_iterations; ++iter) {
+			const scalar sqr_dist = closest.squared_norm();
+			if (sqr_dist <= touching_sqr_distance) {
+				return std::nullopt;
+			}
+
+			const vertex_id new_vertex = poly.get_support_vertex(-closest, vertices[num_vertices - 1]).first;
+			const vec3 new_position = poly.get_vertex(new_vertex) - point;
+			// no progress can be made along this direction
+			if (sqr_dist - vec::dot(closest, new_position) <= tolerance * sqr_dist) {
+				break;
+			}
+			const auto simplex_end = vertices.begin() + num_vertices;
+			if (std::find(vertices.begin(), simplex_end, new_vertex) != simplex_end) {
+				break;
+			}
+			vertices[num_vertices] = new_vertex;
+			positions[num_vertices] = new_position;
+			++num_vertices;
+
+			u32 used = 0;
+			switch (num_vertices) {
+			case 2:
+				closest = _closest_point_on_segment(positions[0], positions[1], used);
+				break;
+			case 3:
+				closest = _closest_point_on_triangle(positions[0], positions[1], positions[2], used);
+				break;
+			case 4:
+				{
+					const std::optional<vec3> tet_closest = _closest_point_on_tetrahedron(positions, used);
+					if (!tet_closest) {
+						return std::nullopt;
+					}
+					closest = tet_closest.value();
+				}
+				break;
+			}
+
+			// remove vertices that do not contribute to the closest point
+			u32 num_used = 0;
+			for (u32 i = 0; i < num_vertices; ++i) {
+				if (used & (1u << i)) {
+					vertices[num_used] = vertices[i];
+					positions[num_used] = positions[i];
+					++num_used;
+				}
+			}
+			num_vertices = num_used;
+		}
+		return closest + point;
+	}
+
 	result gjk(polyhedron_pair input, persistent_result pstate) {
 		profiler::scope p1;
 
@@ -20,18 +184,31 @@ namespace lotus::collision::gjk {
 			tstate.simplex_positions[i] = input.simplex_vertex_position(pstate.simplex[i]);
 		}
 
-		auto vertex_looked_at = bookmark.create_vector_array<bool>(
-			input.shape1->vertices.size() * input.shape2->vertices.size(), false
-		);
+		// if the pair was separated along some axis, check if that is still the case
+		if (pstate.separating_axis != zero) {
+			const simplex_vertex support_vertex = input.support_vertex(
+				pstate.separating_axis,
+				pstate.simplex_vertices > 0 ? pstate.simplex[0] : simplex_vertex(vertex_id::invalid, vertex_id::invalid)
+			);
+			const vec3 support = input.simplex_vertex_position(support_vertex);
+			if (vec::dot(support, pstate.separating_axis) < 0.0f) {
+				return result::does_not_intersect(pstate, tstate);
+			}
+		}
+		// returns a result indicating that the shapes are separated along the given axis
+		const auto separated_along = [&](vec3 axis) {
+			pstate.separating_axis = axis;
+			return result::does_not_intersect(pstate, tstate);
+		};
+
+		// GJK usually converges within a handful of iterations, so visited vertices are kept in a short list instead
+		// of a table over all pairs of vertices, which would be expensive for polyhedra with many vertices
+		auto vertices_looked_at = bookmark.create_reserved_vector_array<simplex_vertex>(16);
 		auto mark_vert = [&](simplex_vertex v) {
-			const usize index =
-				std::to_underlying(v.index1) * input.shape2->vertices.size() + std::to_underlying(v.index2);
-			vertex_looked_at[index] = true;
+			vertices_looked_at.emplace_back(v);
 		};
 		auto check_vert = [&](simplex_vertex v) {
-			const usize index =
-				std::to_underlying(v.index1) * input.shape2->vertices.size() + std::to_underlying(v.index2);
-			return vertex_looked_at[index];
+			return std::ranges::find(vertices_looked_at, v) != vertices_looked_at.end();
 		};
 		for (usize i = 0; i < pstate.simplex_vertices; ++i) {
 			mark_vert(pstate.simplex[i]);
@@ -51,9 +228,9 @@ namespace lotus::collision::gjk {
 			[[fallthrough]];
 		case 1:
 			{
-				pstate.simplex[1] = input.support_vertex(-tstate.simplex_positions[0]);
+				pstate.simplex[1] = input.support_vertex(-tstate.simplex_positions[0], pstate.simplex[0]);
 				if (check_vert(pstate.simplex[1])) { // this vertex is the closest to the origin - no collision
-					return result::does_not_intersect(pstate, tstate);
+					return separated_along(-tstate.simplex_positions[0]);
 				}
 				mark_vert(pstate.simplex[1]);
 				tstate.simplex_positions[1] = input.simplex_vertex_position(pstate.simplex[1]);
@@ -62,7 +239,7 @@ namespace lotus::collision::gjk {
 				// fast exit: the support vertex does not reach the origin, thus the Minkowski difference does not
 				// contain the origin
 				if (vec::dot(tstate.simplex_positions[0], tstate.simplex_positions[1]) > 0.0f) {
-					return result::does_not_intersect(pstate, tstate);
+					return separated_along(-tstate.simplex_positions[0]);
 				}
 			}
 			[[fallthrough]];
@@ -70,9 +247,9 @@ namespace lotus::collision::gjk {
 			{
 				const vec3 line_diff = tstate.simplex_positions[1] - tstate.simplex_positions[0];
 				const vec3 support = vec::cross(line_diff, vec::cross(line_diff, tstate.simplex_positions[0]));
-				pstate.simplex[2] = input.support_vertex(support);
+				pstate.simplex[2] = input.support_vertex(support, pstate.simplex[1]);
 				if (check_vert(pstate.simplex[2])) {
-					return result::does_not_intersect(pstate, tstate); // no collision
+					return separated_along(support); // no collision
 				}
 				mark_vert(pstate.simplex[2]);
 				tstate.simplex_positions[2] = input.simplex_vertex_position(pstate.simplex[2]);
@@ -80,7 +257,7 @@ namespace lotus::collision::gjk {
 
 				// fast exit
 				if (vec::dot(support, tstate.simplex_positions[2]) < 0.0f) {
-					return result::does_not_intersect(pstate, tstate);
+					return separated_along(support);
 				}
 			}
 			[[fallthrough]];
@@ -93,9 +270,9 @@ namespace lotus::collision::gjk {
 				if (vec::dot(support, tstate.simplex_positions[0]) > 0.0f) {
 					support = -support;
 				}
-				pstate.simplex[3] = input.support_vertex(support);
+				pstate.simplex[3] = input.support_vertex(support, pstate.simplex[2]);
 				if (check_vert(pstate.simplex[3])) {
-					return result::does_not_intersect(pstate, tstate); // no collision
+					return separated_along(support); // no collision
 				}
 				mark_vert(pstate.simplex[3]);
 				tstate.simplex_positions[3] = input.simplex_vertex_position(pstate.simplex[3]);
@@ -136,9 +313,9 @@ namespace lotus::collision::gjk {
 					continue;
 				}
 				// otherwise, use its normal as the support vector to find the next vertex
-				const simplex_vertex new_vertex = input.support_vertex(normal);
+				const simplex_vertex new_vertex = input.support_vertex(normal, pstate.simplex[i]);
 				if (check_vert(new_vertex)) {
-					return result::does_not_intersect(pstate, tstate); // no more vertices to find; no collision
+					return separated_along(normal); // no more vertices to find; no collision
 				}
 				mark_vert(new_vertex);
 				prev_face = i;
@@ -150,7 +327,7 @@ namespace lotus::collision::gjk {
 
 				// fast exit if the new vertex does not reach the origin
 				if (vec::dot(normal, tstate.simplex_positions[replace_index]) <= 0.0f) {
-					return result::does_not_intersect(pstate, tstate);
+					return separated_along(normal);
 				}
 
 				facing_origin = true;
@@ -161,6 +338,7 @@ namespace lotus::collision::gjk {
 				tstate.invert_even_normals = !tstate.invert_even_normals;
 			} else {
 				// none of the faces are facing the origin; it must be contained inside the tetrahedron
+				pstate.separating_axis = zero;
 				return result::intersects(pstate, tstate);
 			}
 		}
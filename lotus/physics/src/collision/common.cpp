@@ -6,10 +6,10 @@
 #include "lotus/collision/shapes/convex_polyhedron.h"
 
 namespace lotus::collision {
-	simplex_vertex polyhedron_pair::support_vertex(vec3 dir) const {
+	simplex_vertex polyhedron_pair::support_vertex(vec3 dir, simplex_vertex hint) const {
 		return simplex_vertex(
-			shape1->get_support_vertex(position1.orientation.inverse().rotate(dir)).first,
-			shape2->get_support_vertex(-position2.orientation.inverse().rotate(dir)).first
+			shape1->get_support_vertex(position1.orientation.inverse().rotate(dir), hint.index1).first,
+			shape2->get_support_vertex(-position2.orientation.inverse().rotate(dir), hint.index2).first
 		);
 	}
 
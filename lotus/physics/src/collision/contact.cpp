@@ -16,27 +16,55 @@ namespace lotus::collision::contact {
 	}
 
 	std::optional<contact_manifold> detect(
-		const shape &s1, const body_position &st1, const shape &s2, const body_position &st2
+		const shape &s1, const body_position &st1, const shape &s2, const body_position &st2,
+		gjk::persistent_result *gjk_state
 	) {
 		crash_if(s1.get_type() > s2.get_type());
-		return std::visit([&](const auto &shape1, const auto &shape2) {
-			return detect(shape1, st1, shape2, st2);
+		return std::visit([&]<typename Shape1, typename Shape2>(const Shape1 &shape1, const Shape2 &shape2) {
+			if constexpr (
+				std::is_same_v<Shape1, shapes::convex_polyhedron> && std::is_same_v<Shape2, shapes::convex_polyhedron>
+			) {
+				return detect(shape1, st1, shape2, st2, gjk_state);
+			} else {
+				return detect(shape1, st1, shape2, st2);
+			}
 		}, s1.value, s2.value);
 	}
 
 	std::optional<contact_manifold> detect(
-		const shapes::plane&, const body_position&, const shapes::sphere&, const body_position&
+		const shapes::plane&, const body_position &s1, const shapes::sphere &sph2, const body_position &s2
 	) {
-		std::abort();
-		return std::nullopt; // TODO
+		const vec3 norm_world = s1.orientation.rotate(vec3(0.0f, 0.0f, 1.0f));
+		const vec3 center = s2.local_to_global(sph2.offset);
+		const scalar dist = vec::dot(center - s1.position, norm_world);
+		if (dist > sph2.radius) {
+			return std::nullopt;
+		}
+		return contact_manifold::create_at(
+			s1.global_to_local(center - norm_world * dist),
+			sph2.offset - s2.orientation.inverse().rotate(norm_world) * sph2.radius,
+			norm_world
+		);
 	}
 
 	std::optional<contact_manifold> detect(
-		const shapes::sphere&, const body_position&,
-		const shapes::sphere&, const body_position&
+		const shapes::sphere &sph1, const body_position &s1,
+		const shapes::sphere &sph2, const body_position &s2
 	) {
-		std::abort();
-		return std::nullopt; // TODO
+		const vec3 offset = s2.local_to_global(sph2.offset) - s1.local_to_global(sph1.offset);
+		const scalar radii = sph1.radius + sph2.radius;
+		const scalar sqr_dist = offset.squared_norm();
+		if (sqr_dist > radii * radii) {
+			return std::nullopt;
+		}
+		// concentric spheres can be separated along any direction
+		const scalar dist = std::sqrt(sqr_dist);
+		const vec3 normal = dist > 0.0f ? offset / dist : vec3(0.0f, 0.0f, 1.0f);
+		return contact_manifold::create_at(
+			sph1.offset + s1.orientation.inverse().rotate(normal) * sph1.radius,
+			sph2.offset - s2.orientation.inverse().rotate(normal) * sph2.radius,
+			normal
+		);
 	}
 
 	std::optional<contact_manifold> detect(
@@ -62,19 +90,52 @@ namespace lotus::collision::contact {
 	}
 
 	std::optional<contact_manifold> detect(
-		const shapes::sphere&, const body_position&,
-		const shapes::convex_polyhedron&, const body_position&
+		const shapes::sphere &sph1, const body_position &s1,
+		const shapes::convex_polyhedron &p2, const body_position &s2
 	) {
-		return std::nullopt; // TODO
+		// work in the local space of the polyhedron
+		const vec3 center = s2.global_to_local(s1.local_to_global(sph1.offset));
+		vec3 normal_local2 = uninitialized; // points from the sphere into the polyhedron
+		vec3 contact2 = uninitialized;
+		if (const std::optional<vec3> closest = gjk::closest_point(p2, center)) {
+			const vec3 offset = closest.value() - center;
+			const scalar sqr_dist = offset.squared_norm();
+			if (sqr_dist > sph1.radius * sph1.radius) {
+				return std::nullopt;
+			}
+			normal_local2 = offset / std::sqrt(sqr_dist);
+			contact2 = closest.value();
+		} else {
+			// the center is inside the polyhedron - push it out through the closest face
+			const shapes::convex_polyhedron::face *closest_face = nullptr;
+			scalar face_dist = -std::numeric_limits<scalar>::max();
+			for (const shapes::convex_polyhedron::face &f : p2.faces) {
+				const scalar dist = vec::dot(center - p2.get_vertex(f.vertex_indices[0]), f.normal);
+				if (dist > face_dist) {
+					closest_face = &f;
+					face_dist = dist;
+				}
+			}
+			normal_local2 = -closest_face->normal;
+			contact2 = center - closest_face->normal * face_dist;
+		}
+		const vec3 normal_world = s2.orientation.rotate(normal_local2);
+		return contact_manifold::create_at(
+			sph1.offset + s1.orientation.inverse().rotate(normal_world) * sph1.radius, contact2, normal_world
+		);
 	}
 
 	std::optional<contact_manifold> detect(
 		const shapes::convex_polyhedron &p1, const body_position &s1,
-		const shapes::convex_polyhedron &p2, const body_position &s2
+		const shapes::convex_polyhedron &p2, const body_position &s2,
+		gjk::persistent_result *gjk_state
 	) {
 		const polyhedron_pair pair(p1, s1, p2, s2);
 
-		const gjk::result gjk_res = gjk::gjk(pair);
+		const gjk::result gjk_res = gjk::gjk(pair, gjk_state ? *gjk_state : gjk::persistent_result(zero));
+		if (gjk_state) {
+			*gjk_state = gjk_res.persistent;
+		}
 		if (!gjk_res.has_intersection) {
 			return std::nullopt;
 		}
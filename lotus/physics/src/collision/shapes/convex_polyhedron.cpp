@@ -3,7 +3,72 @@
 /// \file
 /// Implementation of polyhedron-related functions.
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#	define LOTUS_COLLISION_POLYHEDRON_USE_SSE
+#	include <emmintrin.h>
+#endif
+
 namespace lotus::collision::shapes {
+	/// Finds the first vertex with the largest dot product with the given direction by testing all vertices.
+	static std::pair<vertex_id, scalar> _find_support_vertex_brute_force(
+		const std::array<std::vector<scalar>, 3> &coords, usize num_vertices, vec3 dir
+	) {
+		static_assert(convex_polyhedron::vertex_batch_size == 4, "SIMD code below assumes four lanes");
+		const usize padded_count = coords[0].size();
+		std::array<scalar, 4> lane_max;
+		std::array<u32, 4> lane_index;
+#if defined(LOTUS_COLLISION_POLYHEDRON_USE_SSE)
+		const __m128 dx = _mm_set1_ps(dir[0]);
+		const __m128 dy = _mm_set1_ps(dir[1]);
+		const __m128 dz = _mm_set1_ps(dir[2]);
+		__m128 max = _mm_set1_ps(-std::numeric_limits<scalar>::infinity());
+		__m128i max_index = _mm_setzero_si128();
+		__m128i index = _mm_setr_epi32(0, 1, 2, 3);
+		const __m128i batch = _mm_set1_epi32(4);
+		for (usize i = 0; i < padded_count; i += 4) {
+			const __m128 dot = _mm_add_ps(
+				_mm_add_ps(_mm_mul_ps(_mm_loadu_ps(&coords[0][i]), dx), _mm_mul_ps(_mm_loadu_ps(&coords[1][i]), dy)),
+				_mm_mul_ps(_mm_loadu_ps(&coords[2][i]), dz)
+			);
+			// SSE2 has no blend instruction
+			const __m128 greater = _mm_cmpgt_ps(dot, max);
+			const __m128i greater_int = _mm_castps_si128(greater);
+			max = _mm_or_ps(_mm_and_ps(greater, dot), _mm_andnot_ps(greater, max));
+			max_index = _mm_or_si128(_mm_and_si128(greater_int, index), _mm_andnot_si128(greater_int, max_index));
+			index = _mm_add_epi32(index, batch);
+		}
+		_mm_storeu_ps(lane_max.data(), max);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(lane_index.data()), max_index);
+#else
+		lane_max.fill(-std::numeric_limits<scalar>::infinity());
+		lane_index.fill(0);
+		for (usize i = 0; i < padded_count; i += 4) {
+			for (usize lane = 0; lane < 4; ++lane) {
+				const scalar dot =
+					coords[0][i + lane] * dir[0] + coords[1][i + lane] * dir[1] + coords[2][i + lane] * dir[2];
+				if (dot > lane_max[lane]) {
+					lane_max[lane] = dot;
+					lane_index[lane] = static_cast<u32>(i + lane);
+				}
+			}
+		}
+#endif
+		// among lanes with the same value, pick the smallest index so that the result is the first maximum
+		usize best = 0;
+		for (usize lane = 1; lane < 4; ++lane) {
+			if (
+				lane_max[lane] > lane_max[best] ||
+				(lane_max[lane] == lane_max[best] && lane_index[lane] < lane_index[best])
+			) {
+				best = lane;
+			}
+		}
+		// padding vertices are copies of the first vertex
+		const u32 result = lane_index[best] < num_vertices ? lane_index[best] : 0;
+		return { static_cast<vertex_id>(result), lane_max[best] };
+	}
+
+
 	void convex_polyhedron::properties::add_face(vec3 p1, vec3 p2, vec3 p3) {
 		constexpr static mat33s _canonical{
 			{ 1.0f / 60.0f,  1.0f / 120.0f, 1.0f / 120.0f },
@@ -195,35 +260,88 @@ namespace lotus::collision::shapes {
 			}
 		});
 
-		return { std::move(poly), props };
-	}
+		// store coordinates separately for testing multiple vertices at once
+		const usize padded_count =
+			(poly.vertices.size() + vertex_batch_size - 1) / vertex_batch_size * vertex_batch_size;
+		for (usize axis = 0; axis < 3; ++axis) {
+			std::vector<scalar> &coords = poly.vertex_coordinates[axis];
+			coords.reserve(padded_count);
+			for (const vec3 v : poly.vertices) {
+				coords.emplace_back(v[axis]);
+			}
+			coords.resize(padded_count, poly.vertices[0][axis]);
+		}
 
-	std::pair<vertex_id, scalar> convex_polyhedron::get_support_vertex(vec3 dir) const {
-		usize result = 0;
-		scalar dot1max = vec::dot(vertices[result], dir);
-		for (usize i = 1; i < vertices.size(); ++i) {
-			const scalar dv = vec::dot(vertices[i], dir);
-			if (dv > dot1max) {
-				dot1max = dv;
-				result = i;
+		// gather edges between vertices from the triangulated hull
+		std::vector<std::pair<vertex_id, vertex_id>> edges;
+		hull_state.for_each_face([&](convex_hull::face_id, const convex_hull::face &f) {
+			for (u32 i = 0; i < 3; ++i) {
+				const vertex_id v1 = vert_id_to_index[std::to_underlying(f.vertex_indices[i])];
+				const vertex_id v2 = vert_id_to_index[std::to_underlying(f.vertex_indices[(i + 1) % 3])];
+				edges.emplace_back(std::min(v1, v2), std::max(v1, v2));
+			}
+		});
+		std::ranges::sort(edges);
+		{
+			const auto [erase_beg, erase_end] = std::ranges::unique(edges);
+			edges.erase(erase_beg, erase_end);
+		}
+		poly.vertex_adjacency_offsets.resize(poly.vertices.size() + 1, 0);
+		for (const auto &[v1, v2] : edges) {
+			++poly.vertex_adjacency_offsets[std::to_underlying(v1) + 1];
+			++poly.vertex_adjacency_offsets[std::to_underlying(v2) + 1];
+		}
+		for (usize i = 1; i < poly.vertex_adjacency_offsets.size(); ++i) {
+			poly.vertex_adjacency_offsets[i] += poly.vertex_adjacency_offsets[i - 1];
+		}
+		poly.vertex_adjacency.resize(poly.vertex_adjacency_offsets.back(), vertex_id::invalid);
+		{
+			std::vector<u32> positions(poly.vertex_adjacency_offsets.begin(), poly.vertex_adjacency_offsets.end() - 1);
+			for (const auto &[v1, v2] : edges) {
+				poly.vertex_adjacency[positions[std::to_underlying(v1)]++] = v2;
+				poly.vertex_adjacency[positions[std::to_underlying(v2)]++] = v1;
 			}
 		}
-		return { static_cast<vertex_id>(result), dot1max };
+
+		return { std::move(poly), props };
 	}
 
-	convex_polyhedron::axis_projection convex_polyhedron::project_onto_axis(vec3 dir) const {
-		axis_projection result = std::nullopt;
-		for (usize i = 0; i < vertices.size(); ++i) {
-			const scalar dotv = vec::dot(dir, vertices[i]);
-			if (dotv < result.min) {
-				result.min = dotv;
-				result.min_vertex = static_cast<vertex_id>(i);
+	std::pair<vertex_id, scalar> convex_polyhedron::get_support_vertex(vec3 dir, vertex_id hint) const {
+		if (vertices.size() < hill_climbing_threshold) {
+			return _find_support_vertex_brute_force(vertex_coordinates, vertices.size(), dir);
+		}
+
+		// on a convex polyhedron, a vertex that is not the support vertex always has a neighbor that is further
+		// along the direction, so we can walk towards the support vertex
+		u32 current = hint == vertex_id::invalid ? 0 : std::to_underlying(hint);
+		scalar current_dot = vec::dot(vertices[current], dir);
+		while (true) {
+			u32 next = current;
+			scalar next_dot = current_dot;
+			for (u32 i = vertex_adjacency_offsets[current]; i < vertex_adjacency_offsets[current + 1]; ++i) {
+				const u32 neighbor = std::to_underlying(vertex_adjacency[i]);
+				const scalar dot = vec::dot(vertices[neighbor], dir);
+				if (dot > next_dot) {
+					next = neighbor;
+					next_dot = dot;
+				}
 			}
-			if (dotv > result.max) {
-				result.max = dotv;
-				result.max_vertex = static_cast<vertex_id>(i);
+			if (next == current) {
+				return { static_cast<vertex_id>(current), current_dot };
 			}
+			current = next;
+			current_dot = next_dot;
 		}
+	}
+
+	convex_polyhedron::axis_projection convex_polyhedron::project_onto_axis(vec3 dir) const {
+		const auto [max_vertex, max] = get_support_vertex(dir);
+		const auto [min_vertex, neg_min] = get_support_vertex(-dir);
+		axis_projection result = uninitialized;
+		result.min_vertex = min_vertex;
+		result.max_vertex = max_vertex;
+		result.min        = -neg_min;
+		result.max        = max;
 		return result;
 	}
 
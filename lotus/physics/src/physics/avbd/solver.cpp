@@ -3,6 +3,9 @@
 /// \file
 /// Implementation of the AVBD solver.
 
+#include <atomic>
+#include <optional>
+
 #include "lotus/utils/profiler.h"
 #include "lotus/physics/world.h"
 
@@ -30,9 +33,111 @@ namespace lotus::physics::solvers::avbd {
 	}
 
 
+	template <typename IsActive> solver::_graph_coloring solver::_color_graph(
+		usize num_vertices, std::span<const std::pair<u32, u32>> edges, const IsActive &is_active
+	) {
+		constexpr u32 no_color = std::numeric_limits<u32>::max();
+
+		// build adjacency lists
+		std::vector<u32> adjacency_offsets(num_vertices + 1, 0);
+		for (const auto &[v1, v2] : edges) {
+			if (v1 != v2) {
+				++adjacency_offsets[v1 + 1];
+				++adjacency_offsets[v2 + 1];
+			}
+		}
+		for (usize i = 1; i <= num_vertices; ++i) {
+			adjacency_offsets[i] += adjacency_offsets[i - 1];
+		}
+		std::vector<u32> adjacency(adjacency_offsets.back());
+		{
+			std::vector<u32> positions(adjacency_offsets.begin(), adjacency_offsets.end() - 1);
+			for (const auto &[v1, v2] : edges) {
+				if (v1 != v2) {
+					adjacency[positions[v1]++] = v2;
+					adjacency[positions[v2]++] = v1;
+				}
+			}
+		}
+
+		// greedily assign each vertex the first color not used by any of its neighbors
+		std::vector<u32> colors(num_vertices, no_color);
+		std::vector<usize> color_used_by; // the last vertex that found each color used by a neighbor
+		usize num_colors = 0;
+		for (usize v = 0; v < num_vertices; ++v) {
+			if (!is_active(v)) {
+				continue;
+			}
+			for (u32 i = adjacency_offsets[v]; i < adjacency_offsets[v + 1]; ++i) {
+				const u32 neighbor_color = colors[adjacency[i]];
+				if (neighbor_color != no_color) {
+					color_used_by[neighbor_color] = v;
+				}
+			}
+			u32 color = 0;
+			while (color < num_colors && color_used_by[color] == v) {
+				++color;
+			}
+			if (color == num_colors) {
+				++num_colors;
+				color_used_by.emplace_back(num_vertices);
+			}
+			colors[v] = color;
+		}
+
+		// sort vertices by color
+		_graph_coloring result;
+		result.color_offsets.resize(num_colors + 1, 0);
+		for (const u32 color : colors) {
+			if (color != no_color) {
+				++result.color_offsets[color + 1];
+			}
+		}
+		for (usize i = 1; i <= num_colors; ++i) {
+			result.color_offsets[i] += result.color_offsets[i - 1];
+		}
+		result.objects.resize(result.color_offsets.back());
+		std::vector<u32> positions(result.color_offsets.begin(), result.color_offsets.end() - 1);
+		for (usize v = 0; v < num_vertices; ++v) {
+			if (colors[v] != no_color) {
+				result.objects[positions[colors[v]]++] = static_cast<u32>(v);
+			}
+		}
+		return result;
+	}
+
+	template <typename Func> void solver::_for_each_object(
+		const _graph_coloring &coloring, usize count, const Func &func
+	) const {
+		if (!job_manager) {
+			for (usize i = 0; i < count; ++i) {
+				func(static_cast<u32>(i));
+			}
+			return;
+		}
+
+		for (usize color = 0; color + 1 < coloring.color_offsets.size(); ++color) {
+			const u32 begin = coloring.color_offsets[color];
+			const u32 num_objects = coloring.color_offsets[color + 1] - begin;
+			if (num_objects > parallel_grain_size) {
+				job_manager->parallel_for_blocking(num_objects, parallel_grain_size, [&](job_system::index_range range) {
+					for (u32 i = range.begin; i < range.end; ++i) {
+						func(coloring.objects[begin + i]);
+					}
+				});
+			} else {
+				for (u32 i = 0; i < num_objects; ++i) {
+					func(coloring.objects[begin + i]);
+				}
+			}
+		}
+	}
+
+
 	void solver::timestep(scalar dt) {
 		// prepare rigid bodies
-		_body_step_data body_step_data = _prepare_bodies(dt);
+		_body_step_data &body_step_data = _body_step;
+		_prepare_bodies(dt, body_step_data);
 
 		// prepare particles
 		particle_prev_accelerations.resize(particles.size(), zero);
@@ -50,9 +155,12 @@ namespace lotus::physics::solvers::avbd {
 
 			_update_body_dual_variables(body_step_data);
 		}
+		_store_contact_warm_start(body_step_data);
 
 		_compute_body_velocities(dt, body_step_data);
 		_compute_particle_velocities(dt, particle_step_data);
+
+		physics_world->update_sleep_states(dt);
 	}
 
 	// rigid bodies
@@ -70,17 +178,22 @@ namespace lotus::physics::solvers::avbd {
 		};
 	}
 
-	solver::_body_step_data solver::_prepare_bodies(scalar dt) const {
-		_body_step_data result;
-
+	void solver::_prepare_bodies(scalar dt, _body_step_data &result) const {
 		physics_world->update_contact_constraints();
 
+		result.bodies.clear();
+		result.contacts.clear();
+		result.initial_positions.clear();
+		result.inertial_positions.clear();
+		result.pin_duals.clear();
+		result.hinge_duals.clear();
+
 		const usize num_bodies = physics_world->get_bodies().size();
 		result.bodies.reserve(num_bodies);
 		for (const std::unique_ptr<world::body_data> &body_data : physics_world->get_bodies()) {
 			result.bodies.emplace_back(body_data.get());
 		}
-		physics_world->for_each_contact([&](const constraints::rigid_body_contact &contact) {
+		physics_world->for_each_contact([&](constraints::rigid_body_contact &contact) {
 			result.contacts.emplace_back(&contact);
 		});
 
@@ -108,58 +221,69 @@ namespace lotus::physics::solvers::avbd {
 		}
 
 		// compute inverse constraint association
+		// result.bodies is in the same order as world::get_bodies()
 		const auto find_body_idx = [&](const body *b) -> usize {
-			for (usize ib = 0; ib < result.bodies.size(); ++ib) {
-				if (&result.bodies[ib]->this_body == b) {
-					return ib;
-				}
+			return physics_world->find_body_data(b)->index;
+		};
+		// also record which bodies are connected by constraints for coloring
+		std::vector<std::pair<u32, u32>> body_edges;
+		const auto associate = [&](
+			const body *body1, const body *body2, usize constraint, std::vector<u32> _body_step_data::constraints::*list
+		) {
+			std::optional<usize> index1;
+			std::optional<usize> index2;
+			if (body1) {
+				index1 = find_body_idx(body1);
+				(result.constraint_association[index1.value()].*list).emplace_back(static_cast<u32>(constraint));
+			}
+			if (body2) {
+				index2 = find_body_idx(body2);
+				(result.constraint_association[index2.value()].*list).emplace_back(static_cast<u32>(constraint));
+			}
+			if (job_manager && index1 && index2) {
+				body_edges.emplace_back(static_cast<u32>(index1.value()), static_cast<u32>(index2.value()));
 			}
-			std::abort();
 		};
-		result.constraint_association.resize(result.bodies.size(), {});
+		result.constraint_association.resize(result.bodies.size());
+		for (_body_step_data::constraints &association : result.constraint_association) {
+			association.clear();
+		}
 		for (usize i = 0; i < result.contacts.size(); ++i) {
 			const constraints::rigid_body_contact &contact = *result.contacts[i];
-			result.constraint_association[find_body_idx(contact.body1)].contact_constraints.emplace_back(i);
-			result.constraint_association[find_body_idx(contact.body2)].contact_constraints.emplace_back(i);
+			associate(contact.body1, contact.body2, i, &_body_step_data::constraints::contact_constraints);
 		}
 		for (usize i = 0; i < physics_world->springs.size(); ++i) {
 			const constraints::spring &spring = physics_world->springs[i];
-			if (spring.body1) {
-				result.constraint_association[find_body_idx(spring.body1)].spring_constraints.emplace_back(i);
-			}
-			if (spring.body2) {
-				result.constraint_association[find_body_idx(spring.body2)].spring_constraints.emplace_back(i);
-			}
+			associate(spring.body1, spring.body2, i, &_body_step_data::constraints::spring_constraints);
 		}
 		for (usize i = 0; i < physics_world->pins.size(); ++i) {
 			const constraints::pin &pin = physics_world->pins[i];
-			if (pin.body1) {
-				result.constraint_association[find_body_idx(pin.body1)].pin_constraints.emplace_back(i);
-			}
-			if (pin.body2) {
-				result.constraint_association[find_body_idx(pin.body2)].pin_constraints.emplace_back(i);
-			}
+			associate(pin.body1, pin.body2, i, &_body_step_data::constraints::pin_constraints);
 		}
 		for (usize i = 0; i < physics_world->hinges.size(); ++i) {
 			const constraints::hinge &hinge = physics_world->hinges[i];
-			if (hinge.body1) {
-				result.constraint_association[find_body_idx(hinge.body1)].hinge_constraints.emplace_back(i);
-			}
-			if (hinge.body2) {
-				result.constraint_association[find_body_idx(hinge.body2)].hinge_constraints.emplace_back(i);
-			}
+			associate(hinge.body1, hinge.body2, i, &_body_step_data::constraints::hinge_constraints);
+		}
+		if (job_manager) {
+			result.coloring = _color_graph(result.bodies.size(), body_edges, [&](usize i) {
+				return result.bodies[i]->is_dynamic() && !result.bodies[i]->asleep;
+			});
 		}
 
 		// initialize contact dual variables
-		result.contact_duals.reserve(result.contacts.size());
-		for (const constraints::rigid_body_contact *contact : result.contacts) {
-			_contact_dual &dual = result.contact_duals.emplace_back();
+		result.contact_duals.resize(result.contacts.size());
+		for (usize i = 0; i < result.contacts.size(); ++i) {
+			const constraints::rigid_body_contact *contact = result.contacts[i];
+			_contact_dual &dual = result.contact_duals[i];
+			dual.contact_points.clear();
 			dual.contact_points.reserve(contact->contact_points.size());
 			for (const constraints::rigid_body_contact::point &contact_point : contact->contact_points) {
 				_contact_dual::point &point = dual.contact_points.emplace_back(zero);
-				// TODO warm starting
-				point.stiffness     = vec3::filled(1000.0f);
-				point.force         = zero;
+				// warm start using the decayed values from the last time step; new points have zero cached values
+				point.stiffness     = matm::max(
+					contact_point.cached_stiffness * warm_start_decay, vec3::filled(initial_contact_stiffness)
+				);
+				point.force         = contact_point.cached_force * (contact_damping * warm_start_decay);
 				point.initial_error = _compute_raw_contact_error(*contact, contact_point);
 			}
 		}
@@ -181,8 +305,6 @@ namespace lotus::physics::solvers::avbd {
 			dual.stiffness = 1000.0f;
 			dual.force     = 0.0f;
 		}
-
-		return result;
 	}
 
 	void solver::_solve_bodies(scalar dt, const _body_step_data &bdata) {
@@ -191,13 +313,15 @@ namespace lotus::physics::solvers::avbd {
 
 		profiler::scope p1;
 
-		for (usize bi = 0; bi < bdata.bodies.size(); ++bi) {
+		// bodies may be solved concurrently
+		std::atomic_bool found_indefinite_hessian = false;
+		_for_each_object(bdata.coloring, bdata.bodies.size(), [&](u32 bi) {
 			world::body_data *body_data = bdata.bodies[bi];
 			body *cur_body = &body_data->this_body;
 			crash_if(cur_body->state.position.position.has_nan());
 			body_position &cur_pos = cur_body->state.position;
-			if (cur_body->properties.inverse_mass <= 0.0f) {
-				continue;
+			if (!body_data->is_dynamic() || body_data->asleep) {
+				return;
 			}
 
 			const body_position inertial_pos = bdata.inertial_positions[bi];
@@ -367,8 +491,8 @@ namespace lotus::physics::solvers::avbd {
 			const auto decomposition = lup_decomposition<6, f64>::compute(h);
 			const f64 det = decomposition.determinant();
 			if (!std::isfinite(det) || std::abs(det) < 1e-6) {
-				has_indefinite_hessians = true;
-				continue;
+				found_indefinite_hessian.store(true, std::memory_order::relaxed);
+				return;
 			}
 			const _vec6 delta_x = decomposition.solve(f);
 
@@ -379,6 +503,9 @@ namespace lotus::physics::solvers::avbd {
 			cur_pos.orientation = quatu::normalize(
 				cur_pos.orientation + 0.5f * quat::from_vec3_xyz(delta_q) * cur_pos.orientation
 			);
+		});
+		if (found_indefinite_hessian.load(std::memory_order::relaxed)) {
+			has_indefinite_hessians = true;
 		}
 	}
 
@@ -425,9 +552,23 @@ namespace lotus::physics::solvers::avbd {
 		}
 	}
 
+	void solver::_store_contact_warm_start(const _body_step_data &bdata) {
+		for (usize ci = 0; ci < bdata.contacts.size(); ++ci) {
+			constraints::rigid_body_contact &contact = *bdata.contacts[ci];
+			const _contact_dual &dual = bdata.contact_duals[ci];
+			for (usize cpi = 0; cpi < contact.contact_points.size(); ++cpi) {
+				contact.contact_points[cpi].cached_force     = dual.contact_points[cpi].force;
+				contact.contact_points[cpi].cached_stiffness = dual.contact_points[cpi].stiffness;
+			}
+		}
+	}
+
 	void solver::_compute_body_velocities(scalar dt, const _body_step_data &bdata) {
 		for (usize i = 0; i < bdata.bodies.size(); ++i) {
 			world::body_data *body_data = bdata.bodies[i];
+			if (body_data->asleep) {
+				continue;
+			}
 			body &cur_body = body_data->this_body;
 			cur_body.applied_impulse = zero;
 			cur_body.applied_torque = zero;
@@ -468,6 +609,16 @@ namespace lotus::physics::solvers::avbd {
 			result.constraint_association[sc.particle2].stretch_shear_constraints.emplace_back(static_cast<u32>(i));
 		}
 
+		if (job_manager) {
+			std::vector<std::pair<u32, u32>> edges;
+			for (const constraints::cosserat_rod::stretch_shear &sc : rod_stretch_shear_constraints) {
+				edges.emplace_back(sc.particle1, sc.particle2);
+			}
+			result.coloring = _color_graph(particles.size(), edges, [&](usize i) {
+				return particles[i].properties.inverse_mass > 0.0f;
+			});
+		}
+
 		return result;
 	}
 
@@ -490,10 +641,11 @@ namespace lotus::physics::solvers::avbd {
 	}
 
 	void solver::_solve_particles(scalar dt, const _particle_step_data &pdata) {
-		for (usize index = 0; index < particles.size(); ++index) {
+		// particles may be solved concurrently
+		_for_each_object(pdata.coloring, particles.size(), [&](u32 index) {
 			particle &p = particles[index];
 			if (p.properties.inverse_mass <= 0.0f) {
-				continue;
+				return;
 			}
 
 			vec3 f = (pdata.inertial_positions[index] - p.state.position) / (dt * dt * p.properties.inverse_mass);
@@ -515,7 +667,7 @@ namespace lotus::physics::solvers::avbd {
 			}
 
 			p.state.position += f / h;
-		}
+		});
 	}
 
 	void solver::_compute_particle_velocities(scalar dt, const _particle_step_data &pdata) {
@@ -546,14 +698,25 @@ namespace lotus::physics::solvers::avbd {
 			result.constraint_association[sc.orientation].stretch_shear_constraint = static_cast<u32>(i);
 		}
 
+		if (job_manager) {
+			std::vector<std::pair<u32, u32>> edges;
+			for (const constraints::cosserat_rod::bend_twist &bc : rod_bend_twist_constraints) {
+				edges.emplace_back(bc.orientation1, bc.orientation2);
+			}
+			result.coloring = _color_graph(orientations.size(), edges, [&](usize i) {
+				return orientations[i].inv_inertia > 0.0f;
+			});
+		}
+
 		return result;
 	}
 
 	void solver::_solve_orientations(const _orientation_step_data &odata) {
-		for (usize index = 0; index < orientations.size(); ++index) {
+		// orientations may be solved concurrently
+		_for_each_object(odata.coloring, orientations.size(), [&](u32 index) {
 			orientation &ori = orientations[index];
 			if (ori.inv_inertia <= 0.0f) {
-				continue;
+				return;
 			}
 
 			const _orientation_step_data::constraints &assoc = odata.constraint_association[index];
@@ -583,6 +746,6 @@ namespace lotus::physics::solvers::avbd {
 			const quats qv = quat::from_vec3_xyz(v);
 			const quats qe = quat::from_vec3_xyz(constraints::cosserat_rod::direction_basis);
 			ori.state.orientation = quatu::normalize(qv * b * qe + lambda * b);
-		}
+		});
 	}
 }
@@ -208,24 +208,45 @@ namespace lotus::physics::solvers::sequential_impulse {
 	void solver::timestep(scalar full_dt) {
 		profiler::scope p1;
 
-		const scalar substep_dt = full_dt / static_cast<scalar>(num_substeps);
-		const scalar baumgarte_coeff = baumgarte_stabilization;
-
 		physics_world->update_contact_constraints();
 
-		// TODO ugly
-		u32 num_contacts = 0;
-		physics_world->for_each_contact([&](const constraints::rigid_body_contact&) {
-			++num_contacts;
-		});
+		// islands do not affect each other, so they can be solved concurrently with the same results
+		const std::span<const world::island> islands = physics_world->get_islands();
+		if (job_manager && islands.size() > parallel_grain_size) {
+			job_manager->parallel_for_blocking(
+				static_cast<u32>(islands.size()), parallel_grain_size, [&](job_system::index_range range) {
+					for (u32 i = range.begin; i < range.end; ++i) {
+						_solve_island(islands[i], full_dt);
+					}
+				}
+			);
+		} else {
+			for (const world::island &isl : islands) {
+				_solve_island(isl, full_dt);
+			}
+		}
+		for (const world::island &isl : islands) {
+			for (world::body_data *body_data : isl.bodies) {
+				physics_world->on_body_moved(body_data);
+			}
+		}
+
+		physics_world->update_sleep_states(full_dt);
+	}
 
-		std::vector<_contact_constraint_data> contact_data(num_contacts, zero);
-		std::vector<_hinge_constraint_data> hinge_data(physics_world->hinges.size(), zero);
-		std::vector<_pin_constraint_data> pin_data(physics_world->pins.size(), zero);
+	void solver::_solve_island(const world::island &isl, scalar full_dt) const {
+		profiler::scope p1;
+
+		const scalar substep_dt = full_dt / static_cast<scalar>(num_substeps);
+		const scalar baumgarte_coeff = baumgarte_stabilization;
+
+		std::vector<_contact_constraint_data> contact_data(isl.contacts.size(), zero);
+		std::vector<_hinge_constraint_data> hinge_data(isl.hinges.size(), zero);
+		std::vector<_pin_constraint_data> pin_data(isl.pins.size(), zero);
 
 		for (u32 substep = 0; substep < num_substeps; ++substep) {
 			// advect
-			for (const std::unique_ptr<world::body_data> &body_data : physics_world->get_bodies()) {
+			for (world::body_data *body_data : isl.bodies) {
 				body &b = body_data->this_body;
 				if (substep == 0) {
 					b.state.velocity.linear += b.applied_impulse * b.properties.inverse_mass;
@@ -241,19 +262,20 @@ namespace lotus::physics::solvers::sequential_impulse {
 
 			// apply spring forces
 			// TODO implicit formulation
-			for (const constraints::spring &spring : physics_world->springs) {
+			for (const u32 si : isl.springs) {
+				const constraints::spring &spring = physics_world->springs[si];
 				const vec3 diff = spring.get_global_position1() - spring.get_global_position2();
 				const scalar diff_len = diff.norm();
 				const scalar stretch = diff_len - spring.initial_length;
 				const scalar force_mag =
 					(stretch > 0.0f ? spring.stretched_stiffness : spring.compressed_stiffness) * stretch;
 				const vec3 impulse = diff * (substep_dt * force_mag / diff_len);
-				if (spring.body1) {
+				if (spring.body1 && spring.body1->properties.inverse_mass > 0.0f) {
 					spring.body1->apply_impulse_immediate(
 						spring.body1->state.position.orientation.rotate(spring.local_position1), -impulse
 					);
 				}
-				if (spring.body2) {
+				if (spring.body2 && spring.body2->properties.inverse_mass > 0.0f) {
 					spring.body2->apply_impulse_immediate(
 						spring.body2->state.position.orientation.rotate(spring.local_position2), impulse
 					);
@@ -262,40 +284,42 @@ namespace lotus::physics::solvers::sequential_impulse {
 
 			{
 				profiler::scope p2(u8"Prepare Constraints");
-				u32 contact_index = 0;
-				physics_world->for_each_contact([&](const constraints::rigid_body_contact &contact) {
-					contact_data[contact_index].prepare(
-						contact, baumgarte_coeff, physics_world->collision_threshold
-					);
-					++contact_index;
-				});
-				for (usize hi = 0; hi < physics_world->hinges.size(); ++hi) {
-					const constraints::hinge &hinge = physics_world->hinges[hi];
+				for (usize ci = 0; ci < isl.contacts.size(); ++ci) {
+					const constraints::rigid_body_contact &contact = *isl.contacts[ci];
+					_contact_constraint_data &cdata = contact_data[ci];
+					cdata.prepare(contact, baumgarte_coeff, physics_world->collision_threshold);
+					if (substep == 0) { // warm start using impulses from the last time step
+						for (usize pi = 0; pi < cdata.points.size(); ++pi) {
+							cdata.points[pi].lambda = contact.contact_points[pi].cached_force;
+						}
+					}
+				}
+				for (usize hi = 0; hi < isl.hinges.size(); ++hi) {
+					const constraints::hinge &hinge = physics_world->hinges[isl.hinges[hi]];
 					hinge_data[hi].prepare(hinge, baumgarte_coeff);
 				}
-				for (usize pi = 0; pi < physics_world->pins.size(); ++pi) {
-					const constraints::pin &pin = physics_world->pins[pi];
+				for (usize pi = 0; pi < isl.pins.size(); ++pi) {
+					const constraints::pin &pin = physics_world->pins[isl.pins[pi]];
 					pin_data[pi].prepare(pin, baumgarte_coeff);
 				}
 			}
 
-			if (substep > 0) {
+			{ // during the first substep, only contacts have initial guesses
 				profiler::scope p2(u8"Apply Initial Guess");
-				u32 contact_index = 0;
-				physics_world->for_each_contact([&](const constraints::rigid_body_contact &contact) {
-					const _contact_constraint_data &cdata = contact_data[contact_index];
+				for (usize ci = 0; ci < isl.contacts.size(); ++ci) {
+					const constraints::rigid_body_contact &contact = *isl.contacts[ci];
+					const _contact_constraint_data &cdata = contact_data[ci];
 					for (const _contact_constraint_data::point_data &point : cdata.points) {
 						point.apply_impulses_for_delta_lambda(point.lambda, contact, cdata);
 					}
-					++contact_index;
-				});
-				for (usize hi = 0; hi < physics_world->hinges.size(); ++hi) {
-					const constraints::hinge &hinge = physics_world->hinges[hi];
+				}
+				for (usize hi = 0; hi < isl.hinges.size(); ++hi) {
+					const constraints::hinge &hinge = physics_world->hinges[isl.hinges[hi]];
 					const _hinge_constraint_data &hdata = hinge_data[hi];
 					hdata.apply_impulses_for_delta_lambda(hdata.lambda, hinge);
 				}
-				for (usize pi = 0; pi < physics_world->pins.size(); ++pi) {
-					const constraints::pin &pin = physics_world->pins[pi];
+				for (usize pi = 0; pi < isl.pins.size(); ++pi) {
+					const constraints::pin &pin = physics_world->pins[isl.pins[pi]];
 					const _pin_constraint_data &pdata = pin_data[pi];
 					pdata.apply_impulses_for_delta_lambda(pdata.lambda, pin);
 				}
@@ -303,29 +327,28 @@ namespace lotus::physics::solvers::sequential_impulse {
 
 			for (u32 iter = 0; iter < num_velocity_iterations; ++iter) {
 				profiler::scope p2(u8"Velocity Iteration");
-				{
-					usize ci = 0;
-					physics_world->for_each_contact([&](const constraints::rigid_body_contact &contact) {
-						contact_data[ci].velocity_update(contact);
-						++ci;
-					});
+				for (usize ci = 0; ci < isl.contacts.size(); ++ci) {
+					contact_data[ci].velocity_update(*isl.contacts[ci]);
 				}
-				for (usize ci = 0; ci < physics_world->hinges.size(); ++ci) {
-					hinge_data[ci].velocity_update(physics_world->hinges[ci]);
+				for (usize hi = 0; hi < isl.hinges.size(); ++hi) {
+					hinge_data[hi].velocity_update(physics_world->hinges[isl.hinges[hi]]);
 				}
-				for (usize ci = 0; ci < physics_world->pins.size(); ++ci) {
-					pin_data[ci].velocity_update(physics_world->pins[ci]);
+				for (usize pi = 0; pi < isl.pins.size(); ++pi) {
+					pin_data[pi].velocity_update(physics_world->pins[isl.pins[pi]]);
 				}
 			}
 
-			for (const std::unique_ptr<world::body_data> &body_data : physics_world->get_bodies()) {
-				body &b = body_data->this_body;
-				if (b.properties.inverse_mass > 0.0f) {
-					b.position_integration(substep_dt);
-					if (substep + 1 == num_substeps) {
-						physics_world->on_body_moved(body_data.get());
-					}
-				}
+			for (world::body_data *body_data : isl.bodies) {
+				body_data->this_body.position_integration(substep_dt);
+			}
+		}
+
+		// store contact impulses for warm starting
+		for (usize ci = 0; ci < isl.contacts.size(); ++ci) {
+			const _contact_constraint_data &cdata = contact_data[ci];
+			constraints::rigid_body_contact &contact = *isl.contacts[ci];
+			for (usize pi = 0; pi < cdata.points.size(); ++pi) {
+				contact.contact_points[pi].cached_force = cdata.points[pi].lambda;
 			}
 		}
 	}
@@ -333,11 +356,13 @@ namespace lotus::physics::solvers::sequential_impulse {
 	void solver::_apply_impulses(
 		body *body1, body *body2, mat33s inv_i1, mat33s inv_i2, vec3 off1, vec3 off2, vec3 impulse
 	) {
-		if (body1) {
+		// static and kinematic bodies may be shared between islands that are solved concurrently, so they are not
+		// written to
+		if (body1 && body1->properties.inverse_mass > 0.0f) {
 			body1->state.velocity.linear += body1->properties.inverse_mass * impulse;
 			body1->state.velocity.angular += inv_i1 * vec::cross(off1, impulse);
 		}
-		if (body2) {
+		if (body2 && body2->properties.inverse_mass > 0.0f) {
 			body2->state.velocity.linear += body2->properties.inverse_mass * -impulse;
 			body2->state.velocity.angular += inv_i2 * vec::cross(off2, -impulse);
 		}
@@ -3,22 +3,72 @@
 /// \file
 /// Implementation of the physics world.
 
+#include <numeric>
+
 #include "lotus/logging.h"
 #include "lotus/utils/profiler.h"
 #include "lotus/collision/algorithms/contact_manifold.h"
 #include "lotus/collision/contact.h"
 
 namespace lotus::physics {
-	void world::overlap_data::update_contact() {
+	/// Returns the representative of the set containing the given element, compressing paths along the way.
+	[[nodiscard]] static u32 _find_root(std::vector<u32> &parents, u32 i) {
+		while (parents[i] != i) {
+			parents[i] = parents[parents[i]];
+			i = parents[i];
+		}
+		return i;
+	}
+
+	/// Stores the values of the given (island, value) pairs in \p storage, grouped by island and otherwise in their
+	/// original order. Returns the offset of each island in \p storage, followed by the total number of values.
+	template <typename T> [[nodiscard]] static std::vector<u32> _group_by_island(
+		std::span<const std::pair<u32, T>> items, u32 num_islands, std::vector<T> &storage
+	) {
+		std::vector<u32> offsets(num_islands + 1, 0);
+		for (const auto &[island, value] : items) {
+			++offsets[island + 1];
+		}
+		std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+		std::vector<u32> cursors(offsets.begin(), offsets.end() - 1);
+		storage.resize(items.size());
+		for (const auto &[island, value] : items) {
+			storage[cursors[island]++] = value;
+		}
+		return offsets;
+	}
+
+
+	void world::overlap_data::update_contact(scalar matching_distance, timestamp_t timestamp) {
+		// neither body has moved since the last step, so the old contact is still valid
+		if (!is_changed(timestamp) && bodies.first->is_resting() && bodies.second->is_resting()) {
+			return;
+		}
+
 		body *body1 = &bodies.first->this_body;
 		body *body2 = &bodies.second->this_body;
 		if (body1->body_shape->get_type() > body2->body_shape->get_type()) {
 			std::swap(body1, body2);
 		}
 		const std::optional<collision::contact_manifold> col = collision::contact::detect(
-			*body1->body_shape, body1->state.position, *body2->body_shape, body2->state.position
+			*body1->body_shape, body1->state.position, *body2->body_shape, body2->state.position, &gjk_state
 		);
 		if (col && !col->points.empty()) {
+			// the manifold does not identify the features that generated each point, so old points are instead
+			// matched by proximity; cached data is discarded if the contact normal has changed significantly
+			constexpr scalar min_normal_cosine = 0.9f;
+			short_vector<constraints::rigid_body_contact::point, 6> old_points;
+			tangent_frame<scalar> old_tangents = zero;
+			if (
+				contact && contact->body1 == body1 &&
+				vec::dot(contact->tangents.normal, col->normal) > min_normal_cosine
+			) {
+				old_points = contact->contact_points;
+				old_tangents = contact->tangents;
+			}
+			short_vector<bool, 6> old_point_matched(old_points.size(), false);
+			const scalar sqr_matching_distance = matching_distance * matching_distance;
+
 			constraints::rigid_body_contact &constraint = contact.emplace();
 			constraint.body1 = body1;
 			constraint.body2 = body2;
@@ -27,6 +77,48 @@ namespace lotus::physics {
 				constraints::rigid_body_contact::point &pt = constraint.contact_points.emplace_back();
 				pt.local_position1 = manifold_pt.local_position1;
 				pt.local_position2 = manifold_pt.local_position2;
+
+				// find the closest unmatched old point
+				std::optional<usize> best;
+				scalar best_sqr_distance = sqr_matching_distance;
+				for (usize i = 0; i < old_points.size(); ++i) {
+					if (old_point_matched[i]) {
+						continue;
+					}
+					const scalar sqr_distance = std::max(
+						(old_points[i].local_position1 - pt.local_position1).squared_norm(),
+						(old_points[i].local_position2 - pt.local_position2).squared_norm()
+					);
+					if (sqr_distance <= best_sqr_distance) {
+						best = i;
+						best_sqr_distance = sqr_distance;
+					}
+				}
+				if (best) {
+					old_point_matched[best.value()] = true;
+					const constraints::rigid_body_contact::point &old_pt = old_points[best.value()];
+					// the tangent frame is rebuilt from the new normal, so the friction components are projected
+					// from the old tangent plane onto the new tangent and bitangent
+					const vec3 old_friction =
+						old_pt.cached_force[1] * old_tangents.tangent + old_pt.cached_force[2] * old_tangents.bitangent;
+					const auto project_stiffness = [&](vec3 axis) {
+						const scalar cos_tangent = vec::dot(old_tangents.tangent, axis);
+						const scalar cos_bitangent = vec::dot(old_tangents.bitangent, axis);
+						return
+							old_pt.cached_stiffness[1] * cos_tangent * cos_tangent +
+							old_pt.cached_stiffness[2] * cos_bitangent * cos_bitangent;
+					};
+					pt.cached_force = vec3(
+						old_pt.cached_force[0],
+						vec::dot(old_friction, constraint.tangents.tangent),
+						vec::dot(old_friction, constraint.tangents.bitangent)
+					);
+					pt.cached_stiffness = vec3(
+						old_pt.cached_stiffness[0],
+						project_stiffness(constraint.tangents.tangent),
+						project_stiffness(constraint.tangents.bitangent)
+					);
+				}
 			}
 		} else {
 			contact.reset();
@@ -82,6 +174,7 @@ namespace lotus::physics {
 		std::vector<_body_aabb_update> bodies_to_update;
 		std::vector<_body_aabb_update> bodies_to_add;
 		for (const _body_aabb_update &update : _bodies_to_update) {
+			update.target->moved_timestamp = _timestamp;
 			if (update.target->node->get_parent()) {
 				bodies_to_update.emplace_back(update);
 			} else {
@@ -96,35 +189,86 @@ namespace lotus::physics {
 			// update each body, recording removed and added overlaps
 			std::vector<body_data_pair> add_contacts;
 			std::vector<body_data_pair> remove_contacts;
-			for (const _body_aabb_update &cur : bodies_to_update) {
-				{
-					profiler::scope p3(u8"Dual Query");
-					_body_bvh.query_dual_aab(
-						cur.target->aabb, cur.new_aabb,
-						[&](const body_bvh::leaf_node *other) {
-							if (cur.target != other->value) {
-								remove_contacts.emplace_back(cur.target, other->value);
-							}
-						}, [&](const body_bvh::leaf_node *other) {
-							if (cur.target != other->value) {
-								add_contacts.emplace_back(cur.target, other->value);
-							}
-						}, [](const body_bvh::leaf_node*) {
-							// do nothing if the overlap is still there
+			if (bodies_to_update.size() >= bvh_bulk_update_threshold) {
+				profiler::scope p3(u8"Bulk Update");
+
+				// bodies_to_update is sorted by unique ID
+				const auto is_moved = [&](const body_data *b) {
+					return std::ranges::binary_search(
+						bodies_to_update, b->unique_id, std::less<>(),
+						[](const _body_aabb_update &update) {
+							return update.target->unique_id;
 						}
 					);
+				};
+				// remove all overlaps involving moved bodies, and add back all overlaps found using the new AABBs; the
+				// merge below keeps overlaps that are both removed and added
+				for (const overlap_data &overlap : _overlaps) {
+					if (is_moved(overlap.bodies.first) || is_moved(overlap.bodies.second)) {
+						remove_contacts.emplace_back(overlap.bodies);
+					}
 				}
 
-				{
-					profiler::scope p3(u8"Update");
+				for (const _body_aabb_update &cur : bodies_to_update) {
 					cur.target->set_aabb(cur.new_aabb, _timestamp);
-					if constexpr (use_bvh_updates) {
-						_body_bvh.update(cur.target->node, cur.new_aabb);
-					} else {
-						_body_bvh.detach(cur.target->node);
-						_body_bvh.insert(cur.target->node, cur.new_aabb);
+					_body_bvh.set_bounding_box_deferred(cur.target->node, cur.new_aabb);
+				}
+				const scalar cost = _body_bvh.refit();
+				if (_bvh_reference_cost <= 0.0f || cost > bvh_rebuild_cost_ratio * _bvh_reference_cost) {
+					profiler::scope p4(u8"Rebuild BVH");
+					_body_bvh.rebuild();
+					_bvh_reference_cost = _body_bvh.compute_cost();
+				}
+				_maybe_validate_bvh();
+
+				for (const _body_aabb_update &cur : bodies_to_update) {
+					_body_bvh.query_aab(cur.new_aabb, [&](const body_bvh::leaf_node *other) {
+						body_data *other_body = other->value;
+						if (other_body == cur.target) {
+							return;
+						}
+						// overlaps between two moved bodies are found twice - only keep one of them
+						if (other_body->unique_id < cur.target->unique_id && is_moved(other_body)) {
+							return;
+						}
+						if (is_collision_disabled(cur.target, other_body)) {
+							return;
+						}
+						add_contacts.emplace_back(cur.target, other_body);
+					});
+				}
+			} else {
+				for (const _body_aabb_update &cur : bodies_to_update) {
+					{
+						profiler::scope p3(u8"Dual Query");
+						_body_bvh.query_dual_aab(
+							cur.target->aabb, cur.new_aabb,
+							[&](const body_bvh::leaf_node *other) {
+								// disabled pairs are never added, so they must not be removed either
+								if (cur.target != other->value && !is_collision_disabled(cur.target, other->value)) {
+									remove_contacts.emplace_back(cur.target, other->value);
+								}
+							}, [&](const body_bvh::leaf_node *other) {
+								if (cur.target != other->value && !is_collision_disabled(cur.target, other->value)) {
+									add_contacts.emplace_back(cur.target, other->value);
+								}
+							}, [](const body_bvh::leaf_node*) {
+								// do nothing if the overlap is still there
+							}
+						);
+					}
+
+					{
+						profiler::scope p3(u8"Update");
+						cur.target->set_aabb(cur.new_aabb, _timestamp);
+						if constexpr (use_bvh_updates) {
+							_body_bvh.update(cur.target->node, cur.new_aabb);
+						} else {
+							_body_bvh.detach(cur.target->node);
+							_body_bvh.insert(cur.target->node, cur.new_aabb);
+						}
+						_maybe_validate_bvh();
 					}
-					_maybe_validate_bvh();
 				}
 			}
 
@@ -165,7 +309,7 @@ namespace lotus::physics {
 					(remove_it == remove_contacts.end() || *add_it < *remove_it) &&
 					(overlap_it == old_overlaps.end() || *add_it < overlap_it->bodies)
 				) {
-					_overlaps.emplace_back(*add_it);
+					_overlaps.emplace_back(*add_it, _timestamp);
 					++add_it;
 					continue;
 				}
@@ -183,10 +327,62 @@ namespace lotus::physics {
 
 		{ // finally, update all existing contacts
 			profiler::scope p2(u8"Detect Collisions");
-			for (overlap_data &overlap : _overlaps) {
-				overlap.update_contact();
+			// each overlap only writes to its own contact, so the result does not depend on how work is distributed
+			if (job_manager && _overlaps.size() > narrow_phase_grain_size) {
+				job_manager->parallel_for_blocking(
+					static_cast<u32>(_overlaps.size()), narrow_phase_grain_size,
+					[this](job_system::index_range range) {
+						profiler::scope p3(u8"Detect Collisions Batch");
+						for (u32 i = range.begin; i < range.end; ++i) {
+							_overlaps[i].update_contact(contact_matching_distance, _timestamp);
+						}
+					}
+				);
+			} else {
+				for (overlap_data &overlap : _overlaps) {
+					overlap.update_contact(contact_matching_distance, _timestamp);
+				}
 			}
 		}
+
+		_update_islands();
+	}
+
+	void world::update_sleep_states(scalar dt) {
+		if (!enable_sleeping) {
+			return;
+		}
+		const scalar sqr_linear_threshold = sleep_linear_velocity * sleep_linear_velocity;
+		const scalar sqr_angular_threshold = sleep_angular_velocity * sleep_angular_velocity;
+		for (const island &isl : _islands) {
+			bool can_sleep = true;
+			for (body_data *bdata : isl.bodies) {
+				const body_velocity &velocity = bdata->this_body.state.velocity;
+				if (
+					velocity.linear.squared_norm() > sqr_linear_threshold ||
+					velocity.angular.squared_norm() > sqr_angular_threshold
+				) {
+					bdata->sleep_timer = 0.0f;
+				} else {
+					bdata->sleep_timer += dt;
+				}
+				can_sleep = can_sleep && bdata->sleep_timer >= time_to_sleep;
+			}
+			if (can_sleep) {
+				for (body_data *bdata : isl.bodies) {
+					body &b = bdata->this_body;
+					bdata->asleep = true;
+					b.state.velocity.linear = zero;
+					b.state.velocity.angular = zero;
+					b.prev_state = b.state;
+				}
+			}
+		}
+	}
+
+	void world::wake_body(body_data *bdata) {
+		bdata->asleep = false;
+		bdata->sleep_timer = 0.0f;
 	}
 
 	void world::on_body_moved(body_data *bdata) {
@@ -199,6 +395,138 @@ namespace lotus::physics {
 		}
 	}
 
+	void world::_update_islands() {
+		profiler::scope p1;
+
+		constexpr u32 no_island = std::numeric_limits<u32>::max();
+
+		// join dynamic bodies connected by contacts or joints; static and kinematic bodies do not join islands, but
+		// wake up bodies that they push around
+		std::vector<u32> parents(_bodies.size());
+		std::iota(parents.begin(), parents.end(), 0u);
+		std::vector<bool> pushed(_bodies.size(), false);
+		const auto connect = [&](body_data *bd1, body_data *bd2) {
+			const bool dynamic1 = bd1 && bd1->is_dynamic();
+			const bool dynamic2 = bd2 && bd2->is_dynamic();
+			if (dynamic1 && dynamic2) {
+				parents[_find_root(parents, bd1->index)] = _find_root(parents, bd2->index);
+			} else if (dynamic1 && bd2 && !bd2->is_resting()) {
+				pushed[bd1->index] = true;
+			} else if (dynamic2 && bd1 && !bd1->is_resting()) {
+				pushed[bd2->index] = true;
+			}
+		};
+		const auto find_data = [this](const body *b) {
+			return b ? find_body_data(b) : nullptr;
+		};
+		// contacts between sleeping bodies are kept, so that islands wake up as a whole; new contacts, e.g., with a
+		// static body that has just been added or teleported, wake up the bodies involved
+		for (const overlap_data &overlap : _overlaps) {
+			if (overlap.contact) {
+				connect(overlap.bodies.first, overlap.bodies.second);
+				if (overlap.is_changed(_timestamp)) {
+					pushed[overlap.bodies.first->index] = true;
+					pushed[overlap.bodies.second->index] = true;
+				}
+			}
+		}
+		for (const constraints::spring &spring : springs) {
+			connect(find_data(spring.body1), find_data(spring.body2));
+		}
+		for (const constraints::pin &pin : pins) {
+			connect(find_data(pin.body1), find_data(pin.body2));
+		}
+		for (const constraints::hinge &hinge : hinges) {
+			connect(find_data(hinge.body1), find_data(hinge.body2));
+		}
+
+		// an island is awake if any of its bodies is
+		std::vector<bool> root_awake(_bodies.size(), !enable_sleeping);
+		for (const std::unique_ptr<body_data> &bdata : _bodies) {
+			if (bdata->is_dynamic() && (!bdata->asleep || pushed[bdata->index])) {
+				root_awake[_find_root(parents, bdata->index)] = true;
+			}
+		}
+
+		// wake up bodies and number awake islands in the order of their first bodies
+		std::vector<u32> root_island(_bodies.size(), no_island);
+		std::vector<u32> body_island(_bodies.size(), no_island);
+		std::vector<std::pair<u32, body_data*>> bodies;
+		u32 num_islands = 0;
+		for (const std::unique_ptr<body_data> &bdata : _bodies) {
+			if (!bdata->is_dynamic()) {
+				continue;
+			}
+			const u32 root = _find_root(parents, bdata->index);
+			if (!root_awake[root]) {
+				continue;
+			}
+			if (bdata->asleep) {
+				wake_body(bdata.get());
+			}
+			if (root_island[root] == no_island) {
+				root_island[root] = num_islands;
+				++num_islands;
+			}
+			body_island[bdata->index] = root_island[root];
+			bodies.emplace_back(root_island[root], bdata.get());
+		}
+
+		// assign constraints to the island of their dynamic body
+		const auto find_island = [&](const body_data *bd1, const body_data *bd2) {
+			if (bd1 && bd1->is_dynamic()) {
+				return body_island[bd1->index];
+			}
+			if (bd2 && bd2->is_dynamic()) {
+				return body_island[bd2->index];
+			}
+			return no_island;
+		};
+		std::vector<std::pair<u32, constraints::rigid_body_contact*>> contacts;
+		for (overlap_data &overlap : _overlaps) {
+			if (overlap.contact) {
+				const u32 island = find_island(overlap.bodies.first, overlap.bodies.second);
+				if (island != no_island) {
+					contacts.emplace_back(island, &overlap.contact.value());
+				}
+			}
+		}
+		const auto collect_joints = [&](const auto &joints) {
+			std::vector<std::pair<u32, u32>> result;
+			for (usize i = 0; i < joints.size(); ++i) {
+				const u32 island = find_island(find_data(joints[i].body1), find_data(joints[i].body2));
+				if (island != no_island) {
+					result.emplace_back(island, static_cast<u32>(i));
+				}
+			}
+			return result;
+		};
+		const std::vector<std::pair<u32, u32>> island_springs = collect_joints(springs);
+		const std::vector<std::pair<u32, u32>> island_pins = collect_joints(pins);
+		const std::vector<std::pair<u32, u32>> island_hinges = collect_joints(hinges);
+
+		const std::vector<u32> body_offsets =
+			_group_by_island<body_data*>(bodies, num_islands, _island_bodies);
+		const std::vector<u32> contact_offsets =
+			_group_by_island<constraints::rigid_body_contact*>(contacts, num_islands, _island_contacts);
+		const std::vector<u32> spring_offsets = _group_by_island<u32>(island_springs, num_islands, _island_springs);
+		const std::vector<u32> pin_offsets = _group_by_island<u32>(island_pins, num_islands, _island_pins);
+		const std::vector<u32> hinge_offsets = _group_by_island<u32>(island_hinges, num_islands, _island_hinges);
+		const auto subspan = [](auto &storage, const std::vector<u32> &offsets, u32 i) {
+			return std::span(storage).subspan(offsets[i], offsets[i + 1] - offsets[i]);
+		};
+		_islands.clear();
+		_islands.reserve(num_islands);
+		for (u32 i = 0; i < num_islands; ++i) {
+			island &isl = _islands.emplace_back();
+			isl.bodies   = subspan(_island_bodies, body_offsets, i);
+			isl.contacts = subspan(_island_contacts, contact_offsets, i);
+			isl.springs  = subspan(_island_springs, spring_offsets, i);
+			isl.pins     = subspan(_island_pins, pin_offsets, i);
+			isl.hinges   = subspan(_island_hinges, hinge_offsets, i);
+		}
+	}
+
 	void world::_maybe_validate_bvh() const {
 		if constexpr (validate_bvh) {
 			_body_bvh.validate([](const body_bvh::node *n, const char8_t *msg) {
@@ -3,9 +3,106 @@
 /// \file
 /// Implementation of the XPBD solver.
 
+#include <algorithm>
+#include <span>
+#include <type_traits>
+
+#include "lotus/utils/profiler.h"
 #include "lotus/physics/world.h"
 
 namespace lotus::physics::solvers::xpbd {
+	template <typename Constraint, typename GetVariables> void solver::_update_coloring(
+		_constraint_coloring &coloring, const std::vector<Constraint> &cons, const GetVariables &get_variables
+	) const {
+		// the coloring is kept as long as every constraint still uses the same variables as when it was computed,
+		// which is checked each time step so that changes to constraints can never cause data races
+		constexpr usize num_constraint_variables =
+			std::tuple_size_v<std::invoke_result_t<const GetVariables&, const Constraint&>>;
+		if (coloring.variables.size() == cons.size() * num_constraint_variables) {
+			bool up_to_date = true;
+			for (usize i = 0; up_to_date && i < cons.size(); ++i) {
+				up_to_date = std::ranges::equal(
+					get_variables(cons[i]),
+					std::span(coloring.variables).subspan(i * num_constraint_variables, num_constraint_variables)
+				);
+			}
+			if (up_to_date) {
+				return;
+			}
+		}
+
+		// greedily assign each constraint the first color that's not used by any of its variables
+		constexpr usize max_num_colors = 64;
+		std::vector<u64> variable_colors(particles.size() + orientations.size(), 0);
+		std::vector<u32> constraint_colors(cons.size());
+		usize num_colors = 0;
+		bool has_uncolored = false;
+		coloring.variables.clear();
+		coloring.variables.reserve(cons.size() * num_constraint_variables);
+		for (usize i = 0; i < cons.size(); ++i) {
+			const auto vars = get_variables(cons[i]);
+			coloring.variables.insert(coloring.variables.end(), vars.begin(), vars.end());
+			u64 used = 0;
+			for (const usize var : vars) {
+				used |= variable_colors[var];
+			}
+			const auto color = static_cast<u32>(std::countr_one(used));
+			if (color < max_num_colors) {
+				for (const usize var : vars) {
+					variable_colors[var] |= 1ull << color;
+				}
+				num_colors = std::max<usize>(num_colors, color + 1);
+			} else {
+				has_uncolored = true;
+			}
+			constraint_colors[i] = color;
+		}
+
+		// sort constraints by color, keeping constraints of the same color in their original order
+		coloring.num_independent_colors = num_colors;
+		coloring.color_offsets.assign(num_colors + (has_uncolored ? 2 : 1), 0);
+		for (const u32 color : constraint_colors) {
+			++coloring.color_offsets[std::min<usize>(color, num_colors) + 1];
+		}
+		for (usize i = 1; i < coloring.color_offsets.size(); ++i) {
+			coloring.color_offsets[i] += coloring.color_offsets[i - 1];
+		}
+		coloring.constraints.resize(cons.size());
+		std::vector<u32> positions(coloring.color_offsets.begin(), coloring.color_offsets.end() - 1);
+		for (usize i = 0; i < cons.size(); ++i) {
+			const usize color = std::min<usize>(constraint_colors[i], num_colors);
+			coloring.constraints[positions[color]++] = static_cast<u32>(i);
+		}
+	}
+
+	template <typename Func> void solver::_for_each_constraint(
+		const _constraint_coloring &coloring, usize num_constraints, const Func &func
+	) const {
+		if (!job_manager) {
+			for (usize i = 0; i < num_constraints; ++i) {
+				func(static_cast<u32>(i));
+			}
+			return;
+		}
+
+		for (usize color = 0; color + 1 < coloring.color_offsets.size(); ++color) {
+			const u32 begin = coloring.color_offsets[color];
+			const u32 count = coloring.color_offsets[color + 1] - begin;
+			if (color < coloring.num_independent_colors && count > parallel_grain_size) {
+				job_manager->parallel_for_blocking(count, parallel_grain_size, [&](job_system::index_range range) {
+					for (u32 i = range.begin; i < range.end; ++i) {
+						func(coloring.constraints[begin + i]);
+					}
+				});
+			} else {
+				for (u32 i = 0; i < count; ++i) {
+					func(coloring.constraints[begin + i]);
+				}
+			}
+		}
+	}
+
+
 	void solver::timestep(scalar dt) {
 		scalar dt2 = dt * dt;
 		scalar inv_dt2 = 1.0f / dt2;
@@ -27,6 +124,9 @@ namespace lotus::physics::solvers::xpbd {
 			}
 		}
 		for (const std::unique_ptr<world::body_data> &body_data : physics_world->get_bodies()) {
+			if (body_data->asleep) {
+				continue;
+			}
 			body &b = body_data->this_body;
 			b.prev_state = b.state;
 			// TODO external torque
@@ -50,6 +150,7 @@ namespace lotus::physics::solvers::xpbd {
 					));
 				}
 			});
+			_find_particle_collision_candidates();
 		}
 
 		// solve constraints
@@ -71,6 +172,10 @@ namespace lotus::physics::solvers::xpbd {
 		rod_bend_twist_lagrangians.resize(rod_bend_twist_constraints.size(), zero);
 		std::ranges::fill(rod_bend_twist_lagrangians, zero);
 
+		if (job_manager) {
+			_update_constraint_colorings();
+		}
+
 		for (usize i = 0; i < num_iterations; ++i) {
 			// project body contact constraints
 			for (usize j = 0; j < contact_constraints.size(); ++j) {
@@ -78,22 +183,19 @@ namespace lotus::physics::solvers::xpbd {
 			}
 
 			// handle body-particle collisions
-			for (const std::unique_ptr<world::body_data> &body_data : physics_world->get_bodies()) {
-				body &b = body_data->this_body;
-				if (b.properties.inverse_mass == 0.0f) {
-					for (particle &p : particles) {
-						std::visit(
-							[&](const auto &shape) {
-								handle_shape_particle_collision(shape, b.state, p.state.position);
-							},
-							b.body_shape->value
-						);
-					}
-				}
+			for (const _particle_body_pair &pair : _particle_collision_candidates) {
+				const body &b = *pair.static_body;
+				vec3 &pos = particles[pair.particle_index].state.position;
+				std::visit(
+					[&](const auto &shape) {
+						handle_shape_particle_collision(shape, b.state, pos);
+					},
+					b.body_shape->value
+				);
 			}
 
 			// project spring constraints
-			for (usize j = 0; j < particle_spring_constraints.size(); ++j) {
+			_for_each_constraint(_spring_coloring, particle_spring_constraints.size(), [&](u32 j) {
 				const auto &s = particle_spring_constraints[j];
 				particle &p1 = particles[s.particle1];
 				particle &p2 = particles[s.particle2];
@@ -102,11 +204,11 @@ namespace lotus::physics::solvers::xpbd {
 					p1.properties.inverse_mass, p2.properties.inverse_mass,
 					inv_dt2, spring_lambdas[j]
 				);
-			}
+			});
 
 			// project face constraints
-			for (usize j = 0; j < face_constraints.size(); ++j) {
-				constraints::face &f = face_constraints[j];
+			_for_each_constraint(_face_coloring, face_constraints.size(), [&](u32 j) {
+				const constraints::face &f = face_constraints[j];
 				particle &p1 = particles[f.particle1];
 				particle &p2 = particles[f.particle2];
 				particle &p3 = particles[f.particle3];
@@ -115,11 +217,11 @@ namespace lotus::physics::solvers::xpbd {
 					p1.properties.inverse_mass, p2.properties.inverse_mass, p3.properties.inverse_mass,
 					inv_dt2, face_lambdas[j], face_constraint_projection_type
 				);
-			}
+			});
 
 			// project bend constraints
-			for (usize j = 0; j < bend_constraints.size(); ++j) {
-				constraints::bend &b = bend_constraints[j];
+			_for_each_constraint(_bend_coloring, bend_constraints.size(), [&](u32 j) {
+				const constraints::bend &b = bend_constraints[j];
 				particle &p1 = particles[b.particle_edge1];
 				particle &p2 = particles[b.particle_edge2];
 				particle &p3 = particles[b.particle3];
@@ -130,10 +232,10 @@ namespace lotus::physics::solvers::xpbd {
 					p3.properties.inverse_mass, p4.properties.inverse_mass,
 					inv_dt2, bend_lambdas[j]
 				);
-			}
+			});
 
 			// project rod bend-twist constraints
-			for (usize j = 0; j < rod_bend_twist_constraints.size(); ++j) {
+			_for_each_constraint(_rod_bend_twist_coloring, rod_bend_twist_constraints.size(), [&](u32 j) {
 				const constraints::cosserat_rod::bend_twist &con = rod_bend_twist_constraints[j];
 				con.project(
 					orientations[con.orientation1],
@@ -141,10 +243,10 @@ namespace lotus::physics::solvers::xpbd {
 					inv_dt2,
 					rod_bend_twist_lagrangians[j]
 				);
-			}
+			});
 
 			// project rod stretch-shear constraints
-			for (usize j = 0; j < rod_stretch_shear_constraints.size(); ++j) {
+			_for_each_constraint(_rod_stretch_shear_coloring, rod_stretch_shear_constraints.size(), [&](u32 j) {
 				const constraints::cosserat_rod::stretch_shear &con = rod_stretch_shear_constraints[j];
 				con.project(
 					particles[con.particle1],
@@ -153,7 +255,7 @@ namespace lotus::physics::solvers::xpbd {
 					inv_dt2,
 					rod_stretch_shear_lagrangians[j]
 				);
-			}
+			});
 		}
 
 		for (particle &p : particles) {
@@ -163,6 +265,9 @@ namespace lotus::physics::solvers::xpbd {
 			o.state.angular_velocity = (2.0f / dt) * (o.state.orientation * o.prev_orientation.conjugate()).axis();
 		}
 		for (const std::unique_ptr<world::body_data> &body_data : physics_world->get_bodies()) {
+			if (body_data->asleep) {
+				continue;
+			}
 			body &b = body_data->this_body;
 			b.prev_state.velocity = b.state.velocity;
 
@@ -218,6 +323,74 @@ namespace lotus::physics::solvers::xpbd {
 			);
 			correction.apply_velocity(delta_v_norm);
 		}
+
+		physics_world->update_sleep_states(dt);
+	}
+
+	void solver::_find_particle_collision_candidates() {
+		profiler::scope p(u8"Find Particle Collision Candidates");
+
+		_particle_collision_candidates.clear();
+		const vec3 margin = vec3::filled(particle_collision_margin);
+		for (usize i = 0; i < particles.size(); ++i) {
+			const particle &p = particles[i];
+			const aab3s movement = aab3s::create_from_min_max(
+				matm::min(p.prev_position, p.state.position) - margin,
+				matm::max(p.prev_position, p.state.position) + margin
+			);
+			physics_world->get_body_bvh().query_aab(movement, [&](const world::body_bvh::leaf_node *node) {
+				const body &b = node->value->this_body;
+				if (b.properties.inverse_mass == 0.0f) {
+					_particle_collision_candidates.emplace_back(static_cast<u32>(i), node->value->index, b);
+				}
+			});
+		}
+		// handle collisions body by body, in the same order as testing each static body against all particles
+		std::ranges::sort(
+			_particle_collision_candidates,
+			[](const _particle_body_pair &lhs, const _particle_body_pair &rhs) {
+				if (lhs.body_index != rhs.body_index) {
+					return lhs.body_index < rhs.body_index;
+				}
+				return lhs.particle_index < rhs.particle_index;
+			}
+		);
+	}
+
+	void solver::_update_constraint_colorings() {
+		profiler::scope p(u8"Update Constraint Colorings");
+
+		const usize num_particles = particles.size();
+		_update_coloring(
+			_spring_coloring, particle_spring_constraints,
+			[](const constraints::particle_spring &con) {
+				return std::array<usize, 2>{ con.particle1, con.particle2 };
+			}
+		);
+		_update_coloring(
+			_face_coloring, face_constraints,
+			[](const constraints::face &con) {
+				return std::array<usize, 3>{ con.particle1, con.particle2, con.particle3 };
+			}
+		);
+		_update_coloring(
+			_bend_coloring, bend_constraints,
+			[](const constraints::bend &con) {
+				return std::array<usize, 4>{ con.particle_edge1, con.particle_edge2, con.particle3, con.particle4 };
+			}
+		);
+		_update_coloring(
+			_rod_bend_twist_coloring, rod_bend_twist_constraints,
+			[&](const constraints::cosserat_rod::bend_twist &con) {
+				return std::array<usize, 2>{ num_particles + con.orientation1, num_particles + con.orientation2 };
+			}
+		);
+		_update_coloring(
+			_rod_stretch_shear_coloring, rod_stretch_shear_constraints,
+			[&](const constraints::cosserat_rod::stretch_shear &con) {
+				return std::array<usize, 3>{ con.particle1, con.particle2, num_particles + con.orientation };
+			}
+		);
 	}
 
 	bool solver::handle_shape_particle_collision(
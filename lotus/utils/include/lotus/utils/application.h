@@ -8,6 +8,7 @@
 
 #include <lotus/utils/strings.h>
 #include <lotus/utils/profiler.h>
+#include <lotus/utils/profiler_trace.h>
 #include <lotus/system/application.h>
 #include <lotus/system/window.h>
 #include <lotus/system/thread_handle.h>
@@ -45,6 +46,7 @@ namespace lotus::helpers {
 		/// Initializes GPU resources. This should be called immediately after the constructor.
 		void initialize() {
 			system::thread_handle::current().set_name(u8"Application Thread");
+			profiler::thread_manager::refresh_thread_name();
 
 			gpu::context_options gpu_context_options = gpu::context_options::none;
 
@@ -495,6 +497,8 @@ namespace lotus::helpers {
 		int _profiler_mode = 0; ///< Flame graph or tree view.
 		f32 _profiler_scale = 1.0f; ///< Scale for the profiler view.
 		std::vector<profiler::thread_samples> _profiler_frame; ///< Currently displayed profiler frame.
+		/// When recording, all profiler samples are continuously written to trace files in this directory.
+		std::unique_ptr<profiler::continuous_trace_capture> _profiler_trace;
 
 		std::unique_ptr<system::dear_imgui::context> _imgui_sctx; ///< System context for ImGUI.
 		std::unique_ptr<renderer::dear_imgui::context> _imgui_rctx; ///< Graphics context for ImGUI.
@@ -631,6 +635,20 @@ namespace lotus::helpers {
 				if (ImGui::Button("Capture")) {
 					_profiler_capture = true;
 				}
+				ImGui::SameLine();
+				bool recording = _profiler_trace != nullptr;
+				if (ImGui::Checkbox("Record Trace", &recording)) {
+					if (recording) {
+						_profiler_trace = std::make_unique<profiler::continuous_trace_capture>(
+							"profiler_traces", profiler::trace_format::perfetto
+						);
+					} else {
+						_profiler_trace.reset();
+					}
+				}
+				if (_profiler_trace && ImGui::IsItemHovered()) {
+					ImGui::SetTooltip("%s", _profiler_trace->get_current_file().string().c_str());
+				}
 
 				ImGui::SameLine(0.0f, 20.0f);
 				ImGui::RadioButton("Flame Graph", &_profiler_mode, 0);
@@ -933,6 +951,9 @@ namespace lotus::helpers {
 			profiler::thread_manager::get_thread_data().flush();
 			const std::vector<profiler::thread_samples> profiler_output =
 				profiler::thread_manager::instance().flush();
+			if (_profiler_trace) {
+				_profiler_trace->write(profiler_output);
+			}
 			if (_profiler_running || _profiler_capture) {
 				_profiler_frame = profiler_output;
 				_profiler_capture = false;
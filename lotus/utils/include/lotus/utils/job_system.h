@@ -4,69 +4,309 @@
 /// Job system.
 
 #include <vector>
-#include <queue>
-#include <any>
 #include <memory>
 #include <thread>
 #include <atomic>
 #include <mutex>
-#include <condition_variable>
+#include <typeinfo>
+#include <array>
+
+#include <cstddef>
 
 #include "lotus/types.h"
 #include "lotus/common.h"
+#include "lotus/memory/common.h"
 #include "lotus/utils/static_function.h"
+#include "lotus/containers/short_vector.h"
+#include "lotus/containers/work_stealing_deque.h"
 
 namespace lotus::job_system {
 	class manager;
 
+	using index_range = linear_range<u32>; ///< A range of indices processed by one batch of a parallel job.
+
 	namespace _details {
 		struct job_data;
 
-		/// Resource used as input/output for jobs.
+		/// A pool of objects of a single type. Objects can be allocated by one thread at a time, and freed from any
+		/// thread without locking. Storage is allocated in chunks and only released when the pool is destroyed, so
+		/// once the pool has warmed up, allocating and freeing objects does not touch the heap.
+		template <typename T> class object_pool {
+		public:
+			constexpr static usize chunk_size = 256; ///< The number of objects in a chunk.
+
+			/// Initializes the pool to empty.
+			object_pool() = default;
+			/// No copy construction.
+			object_pool(const object_pool&) = delete;
+			/// No copy assignment.
+			object_pool &operator=(const object_pool&) = delete;
+
+			/// Allocates and constructs an object. Must not be called from multiple threads at the same time.
+			template <typename ...Args> [[nodiscard]] T *allocate(Args &&...args) {
+				if (!_free_list) {
+					// take everything that has been freed by other threads
+					_free_list = _remote_free_list.exchange(nullptr, std::memory_order::acquire);
+					if (!_free_list) {
+						_allocate_chunk();
+					}
+				}
+				_slot *slot = _free_list;
+				_free_list = slot->next;
+				if constexpr (is_debugging) {
+					// the previous object may have poisoned parts of its storage when it was destroyed
+					memory::unpoison(slot->storage, sizeof(T));
+				}
+				return std::construct_at(reinterpret_cast<T*>(slot->storage), std::forward<Args>(args)...);
+			}
+			/// Destroys the given object and returns it to the pool it was allocated from. Can be called from any
+			/// thread.
+			static void free(T *obj) {
+				_slot *slot = reinterpret_cast<_slot*>(reinterpret_cast<std::byte*>(obj) - offsetof(_slot, storage));
+				std::destroy_at(obj);
+				std::atomic<_slot*> &list = slot->owner->_remote_free_list;
+				slot->next = list.load(std::memory_order::relaxed);
+				while (!list.compare_exchange_weak(
+					slot->next, slot, std::memory_order::release, std::memory_order::relaxed
+				)) {
+				}
+			}
+		private:
+			/// Storage for a single object.
+			struct _slot {
+				object_pool *owner; ///< The pool that owns this slot.
+				_slot *next; ///< The next free slot.
+				alignas(T) std::byte storage[sizeof(T)]; ///< Storage for the object.
+			};
+
+			_slot *_free_list = nullptr; ///< Free slots, only accessed by the thread that allocates.
+			std::atomic<_slot*> _remote_free_list = nullptr; ///< Slots that have been freed.
+			std::vector<std::unique_ptr<_slot[]>> _chunks; ///< All allocated chunks.
+
+			/// Allocates a new chunk and adds all of its slots to \ref _free_list.
+			void _allocate_chunk() {
+				_slot *chunk = _chunks.emplace_back(std::make_unique_for_overwrite<_slot[]>(chunk_size)).get();
+				for (usize i = 0; i < chunk_size; ++i) {
+					chunk[i].owner = this;
+					chunk[i].next  = i + 1 < chunk_size ? &chunk[i + 1] : _free_list;
+				}
+				_free_list = chunk;
+			}
+		};
+
+		/// A node in the list of jobs waiting for a resource. Each job has one node for each of its inputs.
+		struct consumer_link {
+			job_data *job = nullptr; ///< The job.
+			consumer_link *next = nullptr; ///< The next node in the list.
+		};
+
+		/// Resource used as input/output for jobs. Small values are stored inline without allocating memory.
 		struct resource_data {
+			/// Values that are at most this large and not over-aligned are stored inline.
+			constexpr static usize inline_storage_size = 64;
+
 			/// Initializes the type of this resource.
 			explicit resource_data(const std::type_info &ty) : type(ty) {
 			}
+			/// No copy construction.
+			resource_data(const resource_data&) = delete;
+			/// No copy assignment.
+			resource_data &operator=(const resource_data&) = delete;
+			/// Destroys the value.
+			~resource_data() {
+				if (_value) {
+					_destroy(_value);
+				}
+			}
 
 			const std::type_info &type; ///< The type of this resource.
-			std::any value; ///< The value, or empty if the job hasn't finished.
+			std::atomic_bool value_ready = false; ///< Whether the value has been computed.
+			std::atomic<u32> num_references = 0; ///< The number of \ref resource_ptr objects referencing this.
+			/// The number of threads waiting for this resource in \ref manager::get_resource_value_blocking().
+			std::atomic<u32> num_waiters = 0;
 
+			std::mutex lock; ///< Lock protecting \ref consumers and \ref has_producer.
 			// these are protected by the lock
-			std::vector<job_data*> consumers; ///< All jobs that depend on this resource.
+			consumer_link *consumers = nullptr; ///< Jobs that are waiting for this resource to become ready.
 			bool has_producer = false; ///< Whether there is a producer task for this resource.
-			bool value_ready = false;
-
-			/// Returns the value cast to the given type. Crashes if it doesn't match.
-			template <typename T> T &get() {
-				crash_if(type != typeid(T));
-				T *ptr = std::any_cast<T>(&value);
-				crash_if(!ptr);
-				return *ptr;
+
+			/// Returns the value cast to the given type. Crashes if there's no value, or, in debug builds, if the
+			/// type doesn't match.
+			template <typename T> [[nodiscard]] T &get() {
+				crash_if_debug(type != typeid(T));
+				crash_if(!_value);
+				return *static_cast<T*>(_value);
+			}
+			/// Constructs the value in place. The \ref value_ready flag is not updated.
+			template <typename T, typename ...Args> T &emplace(Args &&...args) {
+				crash_if_debug(type != typeid(T));
+				crash_if(_value);
+				T *result;
+				if constexpr (sizeof(T) <= inline_storage_size && alignof(T) <= alignof(std::max_align_t)) {
+					result = std::construct_at(reinterpret_cast<T*>(_storage.data()), std::forward<Args>(args)...);
+					_destroy = [](void *ptr) {
+						std::destroy_at(static_cast<T*>(ptr));
+					};
+				} else {
+					result = new T(std::forward<Args>(args)...);
+					_destroy = [](void *ptr) {
+						delete static_cast<T*>(ptr);
+					};
+				}
+				_value = result;
+				return *result;
 			}
 			/// Sets the value. The \ref value_ready flag is not updated.
 			template <typename T> void set(T &&obj) {
-				crash_if(type != typeid(T));
-				crash_if(value.has_value());
-				value.emplace<T>(std::move(obj));
+				emplace<T>(std::move(obj));
+			}
+		private:
+			alignas(std::max_align_t) std::array<std::byte, inline_storage_size> _storage; ///< Inline storage.
+			void *_value = nullptr; ///< Pointer to the value, or \p nullptr if there's none.
+			void (*_destroy)(void*) = nullptr; ///< Destroys \ref _value.
+		};
+		using resource_pool = object_pool<resource_data>; ///< Pool of resources.
+
+		/// Reference-counted pointer to a \ref resource_data. The resource is returned to its pool when the last
+		/// reference is released.
+		class resource_ptr {
+		public:
+			/// Initializes this pointer to empty.
+			resource_ptr(std::nullptr_t) {
+			}
+			/// Adds a reference to the given resource.
+			explicit resource_ptr(resource_data *ptr) : _ptr(ptr) {
+				_add_reference();
+			}
+			/// Copy constructor.
+			resource_ptr(const resource_ptr &src) : _ptr(src._ptr) {
+				_add_reference();
+			}
+			/// Move constructor.
+			resource_ptr(resource_ptr &&src) noexcept : _ptr(std::exchange(src._ptr, nullptr)) {
+			}
+			/// Copy assignment.
+			resource_ptr &operator=(const resource_ptr &src) {
+				if (&src != this) {
+					_release();
+					_ptr = src._ptr;
+					_add_reference();
+				}
+				return *this;
+			}
+			/// Move assignment.
+			resource_ptr &operator=(resource_ptr &&src) noexcept {
+				if (&src != this) {
+					_release();
+					_ptr = std::exchange(src._ptr, nullptr);
+				}
+				return *this;
+			}
+			/// Releases the reference.
+			~resource_ptr() {
+				_release();
+			}
+
+			/// Returns the resource.
+			[[nodiscard]] resource_data *get() const {
+				return _ptr;
+			}
+			/// \overload
+			[[nodiscard]] resource_data *operator->() const {
+				return _ptr;
+			}
+			/// Dereferences the pointer.
+			[[nodiscard]] resource_data &operator*() const {
+				return *_ptr;
+			}
+		private:
+			resource_data *_ptr = nullptr; ///< The resource.
+
+			/// Adds a reference to \ref _ptr if it's not empty.
+			void _add_reference() {
+				if (_ptr) {
+					_ptr->num_references.fetch_add(1, std::memory_order::relaxed);
+				}
+			}
+			/// Releases the reference to \ref _ptr if it's not empty.
+			void _release() {
+				if (_ptr) {
+					if (_ptr->num_references.fetch_sub(1, std::memory_order::acq_rel) == 1) {
+						resource_pool::free(_ptr);
+					}
+					_ptr = nullptr;
+				}
 			}
 		};
-		using resource_ptr = std::shared_ptr<resource_data>; ///< Shared pointer to resource data.
 
 		/// Job data containing the job itself, references to inputs/outputs, and synchronization info.
 		struct job_data {
+			/// Number of inputs or outputs that can be referenced without allocating memory.
+			constexpr static usize num_inline_resources = 4;
+			/// Each worker aims to claim this many batches out of the remaining work of a parallel job. Larger values
+			/// give better load balancing at the cost of more claims.
+			constexpr static u32 batches_per_worker = 4;
+
 			/// The job function. Returns whether all outputs are ready.
 			static_function<bool(job_data&)> job = nullptr;
-			std::vector<resource_ptr> inputs; ///< Job inputs.
-			std::vector<resource_ptr> outputs; ///< Job outputs.
+			short_vector<resource_ptr, num_inline_resources> inputs; ///< Job inputs.
+			short_vector<resource_ptr, num_inline_resources> outputs; ///< Job outputs.
+			/// Nodes used to register this job as a consumer of its inputs.
+			short_vector<consumer_link, num_inline_resources> consumer_links;
 
 			std::optional<u32> count; ///< The number of parallel duplicate instances of this job to run.
 			std::atomic<u32> start_count = 0; ///< The number of instances of this job that has started running.
 			std::atomic<u32> finish_count = 0; ///< The number of instances of this job that has finished running.
+			u32 grain_size = 1; ///< The minimum number of instances claimed at once.
+			u32 num_workers = 1; ///< The number of workers that may run this job in parallel.
+
+			/// Number of inputs that are not ready yet, plus one while the job is still being scheduled.
+			std::atomic<u32> num_pending_inputs = 0;
+			/// Number of references to this job held by job queues and running workers. The job is returned to its
+			/// pool when this reaches zero.
+			std::atomic<u32> num_references = 1;
+			/// Index of this job in the list of waiting jobs, protected by the lock of that list.
+			std::optional<usize> waiting_index;
+
+			/// Returns all inputs.
+			[[nodiscard]] std::span<const resource_ptr> get_inputs() const {
+				return { inputs.begin(), inputs.end() };
+			}
+			/// Returns all outputs.
+			[[nodiscard]] std::span<const resource_ptr> get_outputs() const {
+				return { outputs.begin(), outputs.end() };
+			}
 
-			// protected by the lock
-			u32 num_pending_inputs = 0; ///< Number of inputs that are not ready yet.
+			/// Claims the next batch of instances of a parallel job using a single atomic operation. The batch size
+			/// shrinks as the job nears completion, but is never smaller than \ref grain_size. Returns
+			/// \p std::nullopt if all instances have been claimed.
+			[[nodiscard]] std::optional<index_range> claim_batch() {
+				const u32 total = count.value();
+				const u32 claimed = start_count.load(std::memory_order::relaxed);
+				if (claimed >= total) {
+					return std::nullopt;
+				}
+				const u32 batch_size = std::max(grain_size, (total - claimed) / (num_workers * batches_per_worker));
+				const u32 begin = start_count.fetch_add(batch_size, std::memory_order::relaxed);
+				if (begin >= total) {
+					return std::nullopt;
+				}
+				return index_range(begin, std::min(begin + batch_size, total));
+			}
+			/// Marks the given batch as finished. Returns whether all instances of this job have finished.
+			[[nodiscard]] bool finish_batch(index_range batch) {
+				const u32 size = batch.get_length();
+				return finish_count.fetch_add(size, std::memory_order::acq_rel) + size == count.value();
+			}
+		};
+		using job_pool = object_pool<job_data>; ///< Pool of jobs.
+		using job_queue = work_stealing_deque<job_data*>; ///< Queue of jobs that are ready to run.
+
+		/// Pools used by a single thread to allocate jobs and resources.
+		struct allocation_pools {
+			job_pool jobs; ///< Pool of jobs.
+			resource_pool resources; ///< Pool of resources.
 		};
-		using job_ptr = std::shared_ptr<job_data>; ///< Shared pointer to job data.
 
 		/// Worker data.
 		struct worker_data {
@@ -192,7 +432,7 @@ namespace lotus::job_system {
 			/// End of recursion.
 			template <> struct args_handler<std::tuple<>> {
 				/// Does nothing.
-				static void prepare_inputs(std::span<const resource_ptr>, u32) {
+				static void prepare_outputs(std::span<const resource_ptr>, u32) {
 				}
 				/// Returns empty.
 				[[nodiscard]] static std::tuple<> get_spans(std::span<const resource_ptr>) {
@@ -210,10 +450,10 @@ namespace lotus::job_system {
 			};
 			/// Specialization for tuples.
 			template <typename First, typename ...Rest> struct args_handler<std::tuple<First, Rest...>> {
-				/// Prepares inputs.
-				static void prepare_inputs(std::span<const resource_ptr> outputs, u32 count) {
-					outputs[0]->value.emplace<std::vector<First>>(count);
-					args_handler<std::tuple<Rest...>>::prepare_inputs(outputs.subspan<1>(), count);
+				/// Allocates storage for outputs.
+				static void prepare_outputs(std::span<const resource_ptr> outputs, u32 count) {
+					outputs[0]->emplace<std::vector<First>>(count);
+					args_handler<std::tuple<Rest...>>::prepare_outputs(outputs.subspan<1>(), count);
 				}
 				/// Resolves the given arguments.
 				[[nodiscard]] static std::tuple<std::span<First>, std::span<Rest>...> get_spans(
@@ -232,7 +472,7 @@ namespace lotus::job_system {
 					// TODO use template for
 					constexpr usize tuple_index = std::tuple_size_v<SpanTuple> - 1 - sizeof...(Rest);
 					std::get<tuple_index>(spans)[index] = std::move(std::get<tuple_index>(output));
-					args_handler<std::tuple<Rest...>>::set(std::move(output), spans, index);
+					args_handler<std::tuple<Rest...>>::set(spans, std::move(output), index);
 				}
 				/// Returns the element at \p index in each span.
 				template <typename SpanTuple> static std::tuple<First, Rest...> get(SpanTuple spans, u32 index) {
@@ -244,9 +484,31 @@ namespace lotus::job_system {
 				}
 			};
 		}
+
+		/// Helpers for parallel-for jobs.
+		namespace parallel_for {
+			/// Job function traits.
+			template <typename> struct func_traits;
+			/// Specialization for function pointers.
+			template <typename ...Inputs, typename ...Outputs> struct func_traits<void(*)(
+				index_range, std::tuple<std::span<const Inputs>...>, std::tuple<std::span<Outputs>...>
+			)> {
+				using input_type = std::tuple<Inputs...>; ///< All input element types.
+				using output_type = std::tuple<Outputs...>; ///< All output element types.
+			};
+			/// Shorthand for \ref func_traits::input_type.
+			template <typename T> using func_input_type_t = func_traits<T>::input_type;
+			/// Shorthand for \ref func_traits::output_type.
+			template <typename T> using func_output_type_t = func_traits<T>::output_type;
+			/// Job function input count.
+			template <typename T> constexpr u32 func_input_count_v = std::tuple_size_v<func_input_type_t<T>>;
+			/// Job function output count.
+			template <typename T> constexpr u32 func_output_count_v = std::tuple_size_v<func_output_type_t<T>>;
+		}
 	}
 
-	/// Handle used to reference a resource used as input/output of jobs.
+	/// Handle used to reference a resource used as input/output of jobs. Handles must not outlive the
+	/// \ref manager that created them, since resources are allocated from pools owned by the manager.
 	struct resource_handle {
 		friend manager;
 	public:
@@ -269,7 +531,7 @@ namespace lotus::job_system {
 	/// Manager for a number of job threads.
 	class manager {
 	public:
-		constexpr static u32 default_batch_size = 8; ///< Default batch size for multi jobs.
+		constexpr static u32 default_batch_size = 8; ///< Default minimum batch size for multi and parallel-for jobs.
 
 		/// Default move constructor.
 		manager(manager&&) = default;
@@ -287,19 +549,18 @@ namespace lotus::job_system {
 		/// Creates a new resource and assigns the given value to it.
 		template <typename T> [[nodiscard]] resource_handle create_resource_with_value(T obj) {
 			resource_handle result = create_resource<T>();
-			result._resource->value.emplace<T>(std::move(obj));
+			result._resource->emplace<T>(std::move(obj));
 			// no need to lock since this resource is just being created
 			result._resource->has_producer = true;
 			result._resource->value_ready = true;
 			return result;
 		}
 
-		/// Retrieves the value of the given resource, blocking if it's not ready yet.
+		/// Retrieves the value of the given resource. If it's not ready yet, the calling thread runs other jobs until
+		/// it is, so this can also be called from within jobs to wait for the results of nested jobs.
 		template <typename T> [[nodiscard]] const T &get_resource_value_blocking(resource_handle h) {
 			_control->wait_for_resource(h._resource.get());
-			const T *ptr = std::any_cast<T>(&h._resource->value);
-			crash_if(!ptr);
-			return *ptr;
+			return h._resource->get<T>();
 		}
 
 		/// Schedules a new job. The job will run as soon as all inputs are ready.
@@ -308,33 +569,33 @@ namespace lotus::job_system {
 			_details::array_like_tuple_t<_details::mono::func_input_count_v<JobFunc>, resource_handle> inputs,
 			_details::array_like_tuple_t<_details::mono::func_output_count_v<JobFunc>, resource_handle> outputs
 		) {
-			_details::job_ptr job = std::make_unique<_details::job_data>();
+			_details::job_data *job = _control->create_job();
 			_move_into_vector(inputs, job->inputs);
 			_move_into_vector(outputs, job->outputs);
 			job->job = [job_func](_details::job_data &job_data) {
 				return _mono_job_wrapper(job_func, job_data);
 			};
-			_control->schedule_job(std::move(job));
+			_control->schedule_job(job);
 		}
 		/// Schedules a number of identical independent jobs that can run in parallel. The inputs and outputs must be
-		/// \p std::vector types.
+		/// \p std::vector types. Workers claim adaptively-sized batches of indices that are no smaller than
+		/// \p BatchSize.
 		template <u32 BatchSize, typename JobFunc> void schedule_multi_job(
 			JobFunc job_func,
 			_details::array_like_tuple_t<_details::multi::func_input_count_v<JobFunc>, resource_handle> inputs,
 			_details::array_like_tuple_t<_details::multi::func_output_count_v<JobFunc>, resource_handle> outputs,
 			u32 count
 		) {
-			_details::job_ptr job = std::make_unique<_details::job_data>();
+			_details::job_data *job = _create_parallel_job(count, BatchSize);
 			_move_into_vector(inputs, job->inputs);
 			_move_into_vector(outputs, job->outputs);
-			job->count = count;
 			job->job = [job_func](_details::job_data &job_data) {
-				return _multi_job_wrapper<BatchSize>(job_func, job_data);
+				return _multi_job_wrapper(job_func, job_data);
 			};
 			// TODO do this before running the job to save memory?
-			using output_handler = _details::multi::args_handler<_details::multi::func_input_type_t<JobFunc>>;
-			output_handler::prepare_inputs(job->outputs, count);
-			_control->schedule_job(std::move(job));
+			using output_handler = _details::multi::args_handler<_details::multi::func_output_type_t<JobFunc>>;
+			output_handler::prepare_outputs(job->get_outputs(), count);
+			_control->schedule_job(job);
 		}
 		/// Overload of \ref schedule_multi_job() with a default batch size.
 		template <typename JobFunc> void schedule_multi_job(
@@ -345,34 +606,151 @@ namespace lotus::job_system {
 		) {
 			schedule_multi_job<default_batch_size>(job_func, std::move(inputs), std::move(outputs), count);
 		}
+		/// Schedules a parallel-for job over \p count indices. Instead of being called once per index, the job
+		/// function is called with a range of indices, along with spans of all inputs and outputs. The inputs and
+		/// outputs must be \p std::vector types, and the outputs will be resized to contain \p count elements.
+		///
+		/// \param grain_size The minimum number of indices processed by each call of the job function. Batch sizes
+		///                   start large and shrink as the job nears completion to balance the work between workers.
+		template <typename JobFunc> void schedule_parallel_for(
+			JobFunc job_func,
+			_details::array_like_tuple_t<_details::parallel_for::func_input_count_v<JobFunc>, resource_handle> inputs,
+			_details::array_like_tuple_t<_details::parallel_for::func_output_count_v<JobFunc>, resource_handle> outputs,
+			u32 count,
+			u32 grain_size = default_batch_size
+		) {
+			_details::job_data *job = _create_parallel_job(count, grain_size);
+			_move_into_vector(inputs, job->inputs);
+			_move_into_vector(outputs, job->outputs);
+			job->job = [job_func](_details::job_data &job_data) {
+				return _parallel_for_job_wrapper(job_func, job_data);
+			};
+			using output_handler =
+				_details::multi::args_handler<_details::parallel_for::func_output_type_t<JobFunc>>;
+			output_handler::prepare_outputs(job->get_outputs(), count);
+			_control->schedule_job(job);
+		}
+		/// Calls the given function with ranges of indices covering [0, \p count), and blocks until all of them have
+		/// been processed. The function is called concurrently by workers and by the calling thread, which helps
+		/// instead of idling. Since the function does not outlive this call, it can reference data owned by the
+		/// caller. This can also be called from within jobs.
+		///
+		/// \param grain_size The minimum number of indices processed by each call of the function.
+		template <typename Func> void parallel_for_blocking(u32 count, u32 grain_size, const Func &func) {
+			if (count == 0) {
+				return;
+			}
+			resource_handle done = create_resource<bool>();
+			_details::job_data *job = _create_parallel_job(count, grain_size);
+			job->outputs.emplace_back(done._resource);
+			job->job = [f = &func](_details::job_data &job_data) {
+				while (std::optional<index_range> batch = job_data.claim_batch()) {
+					(*f)(batch.value());
+					if (job_data.finish_batch(batch.value())) {
+						job_data.get_outputs()[0]->emplace<bool>(true);
+						return true;
+					}
+				}
+				return false;
+			};
+			_control->schedule_job(job);
+			_control->wait_for_resource(done._resource.get());
+		}
+
+		/// Returns the number of worker threads.
+		[[nodiscard]] u32 get_num_workers() const {
+			return static_cast<u32>(_workers.size());
+		}
 	private:
 		/// Pinned data shared between all threads.
+		///
+		/// Each worker owns a \ref _details::job_queue. Jobs that become ready on a worker thread are pushed onto
+		/// that worker's queue, and idle workers steal from the other queues. Jobs scheduled from other threads go
+		/// through \ref _injected_jobs. Dependencies are tracked using per-resource locks, so scheduling jobs does
+		/// not serialize on a single global lock.
 		struct _control_block {
 		public:
+			/// Creates queues for the given number of workers.
+			explicit _control_block(u32 num_workers);
+			/// Discards all jobs that have not been executed.
+			~_control_block();
+
 			/// Worker function.
-			void worker_function(std::string thread_name);
-			/// Spawns a new worker.
-			[[nodiscard]] _details::worker_data spawn_worker(std::string thread_name);
+			void worker_function(u32 index, std::string thread_name);
+			/// Spawns a new worker. Each index must be used by exactly one worker.
+			[[nodiscard]] _details::worker_data spawn_worker(u32 index, std::string thread_name);
 
-			/// Schedules the given job.
-			void schedule_job(_details::job_ptr);
+			/// Allocates a new job.
+			[[nodiscard]] _details::job_data *create_job();
+			/// Allocates a new resource with the given type.
+			[[nodiscard]] _details::resource_ptr create_resource(const std::type_info&);
+			/// Schedules the given job, which must have been created using \ref create_job().
+			void schedule_job(_details::job_data*);
 
-			/// Waits for the give resource to be computed.
-			void wait_for_resource(const _details::resource_data*);
+			/// Waits for the given resource to be computed, running other jobs in the meantime.
+			void wait_for_resource(_details::resource_data*);
 
 			/// Signals all threads to terminate.
 			void terminate();
 		private:
-			std::mutex _job_lock; ///< Lock for modifying jobs.
-			std::condition_variable _signal; ///< Condition variable used to signal the worker threads.
-			// protected by the lock
-			std::vector<_details::job_ptr> _waiting_jobs; ///< Jobs that have inputs that are not ready.
-			std::queue<_details::job_ptr> _pending_jobs; ///< Jobs that can run next.
-			bool _terminate = false; ///< Whether or not to terminate.
-
-			/// Marks the given resource as ready without notifying \ref _signal. The caller should be holding the
-			/// lock.
-			void _mark_resource_ready_locked(_details::resource_data*);
+			/// Identifies the worker that the current thread is running.
+			struct _worker_info {
+				_control_block *owner = nullptr; ///< The control block that owns this worker.
+				u32 index = 0; ///< Index of the worker.
+			};
+
+			/// Per-worker job queues. The set of queues does not change after the control block is created.
+			std::vector<std::unique_ptr<_details::job_queue>> _queues;
+
+			/// Pools used by each worker for allocating jobs and resources. Indexed in the same way as \ref _queues.
+			std::vector<std::unique_ptr<_details::allocation_pools>> _worker_pools;
+			std::mutex _external_pools_lock; ///< Lock for \ref _external_pools.
+			_details::allocation_pools _external_pools; ///< Pools used by non-worker threads.
+
+			std::mutex _injected_jobs_lock; ///< Lock for \ref _injected_jobs and \ref _injected_jobs_head.
+			/// Jobs scheduled from non-worker threads. Jobs before \ref _injected_jobs_head have been taken; the
+			/// array is only cleared once it's been fully consumed so that its storage can be reused.
+			std::vector<_details::job_data*> _injected_jobs;
+			usize _injected_jobs_head = 0; ///< Index of the first job in \ref _injected_jobs that has not been taken.
+			/// Number of elements in \ref _injected_jobs, used to avoid locking when there are no such jobs.
+			std::atomic<usize> _num_injected_jobs = 0;
+
+			std::mutex _waiting_jobs_lock; ///< Lock for \ref _waiting_jobs.
+			std::vector<_details::job_data*> _waiting_jobs; ///< Jobs that have inputs that are not ready.
+
+			/// Incremented whenever new jobs are available, when a resource that a thread is waiting for becomes
+			/// ready, or when terminating. Idle threads wait on this value.
+			std::atomic<u64> _epoch = 0;
+			std::atomic<u32> _num_sleeping_threads = 0; ///< Number of threads waiting on \ref _epoch.
+			std::atomic_bool _terminate = false; ///< Whether or not to terminate.
+
+			static thread_local _worker_info _this_worker; ///< Worker information for the current thread.
+
+			/// Calls the given function with the allocation pools of the current thread. For threads that are not
+			/// workers, the external pools are locked while the function is running.
+			template <typename Callback> auto _with_allocation_pools(Callback &&cb) {
+				if (_this_worker.owner == this) {
+					return cb(*_worker_pools[_this_worker.index]);
+				}
+				std::scoped_lock lock(_external_pools_lock);
+				return cb(_external_pools);
+			}
+
+			/// Finds a job to run: first from the current worker's own queue, then from \ref _injected_jobs, then by
+			/// stealing from other workers. Returns \p nullptr if no job is found.
+			[[nodiscard]] _details::job_data *_find_job();
+			/// Runs the given job and releases the reference held by the caller.
+			void _run_job(_details::job_data*);
+			/// Adds the given job to a queue and wakes up workers.
+			void _enqueue_job(_details::job_data*);
+			/// Called when all inputs of a job become ready.
+			void _on_job_ready(_details::job_data*);
+			/// Marks the given resource as ready, and schedules any consumers that become ready.
+			void _mark_resource_ready(_details::resource_data*);
+			/// Releases a reference to the given job, freeing it if that was the last one.
+			static void _release_job(_details::job_data*);
+			/// Wakes up sleeping threads.
+			void _wake_threads(bool all);
 		};
 
 		std::vector<_details::worker_data> _workers; ///< Worker threads.
@@ -383,17 +761,14 @@ namespace lotus::job_system {
 		}
 
 
-		/// Moves resource handles from a \p std::tuple into the given \p std::vector.
-		template <typename Tuple, usize Index = 0> static void _move_into_vector(
-			Tuple &tuple, std::vector<_details::resource_ptr> &vec
+		/// Moves resource handles from a \p std::tuple into the given vector.
+		template <typename Tuple, typename Vector, usize Index = 0> static void _move_into_vector(
+			Tuple &tuple, Vector &vec
 		) {
-			if constexpr (Index == 0) {
-				vec.reserve(std::tuple_size_v<Tuple>);
-			}
 			// TODO use template for
 			if constexpr (Index < std::tuple_size_v<Tuple>) {
 				vec.emplace_back(std::move(std::get<Index>(tuple)._resource));
-				_move_into_vector<Tuple, Index + 1>(tuple, vec);
+				_move_into_vector<Tuple, Vector, Index + 1>(tuple, vec);
 			}
 		}
 
@@ -402,34 +777,33 @@ namespace lotus::job_system {
 			using input_handler = _details::mono::args_handler<_details::mono::func_input_type_t<JobFunc>>;
 			using output_handler = _details::mono::args_handler<_details::mono::func_output_type_t<JobFunc>>;
 			output_handler::apply_outputs(
-				std::apply(job, input_handler::resolve_inputs(job_data.inputs)),
-				job_data.outputs
+				std::apply(job, input_handler::resolve_inputs(job_data.get_inputs())),
+				job_data.get_outputs()
 			);
 			return true;
 		}
 
+		/// Creates a new job that runs \p count instances in parallel.
+		[[nodiscard]] _details::job_data *_create_parallel_job(u32 count, u32 grain_size) {
+			_details::job_data *job = _control->create_job();
+			job->count       = count;
+			job->grain_size  = std::max(grain_size, 1u);
+			job->num_workers = std::max(static_cast<u32>(_workers.size()), 1u);
+			return job;
+		}
+
 		/// Wrapper for a multi job function. Handles input and output parameters.
-		template <u32 BatchSize, typename JobFunc> static bool _multi_job_wrapper(
-			JobFunc job, _details::job_data &job_data
-		) {
+		template <typename JobFunc> static bool _multi_job_wrapper(JobFunc job, _details::job_data &job_data) {
 			using func_input_t = _details::multi::func_input_type_t<JobFunc>;
 			using func_output_t = _details::multi::func_output_type_t<JobFunc>;
 			using input_spans_t = _details::apply_to_tuple_t<func_input_t, _details::const_span_t>;
 			using output_spans_t = _details::apply_to_tuple_t<func_output_t, std::span>;
-			input_spans_t input_spans = _details::multi::args_handler<func_input_t>::get_spans(job_data.inputs);
-			output_spans_t output_spans = _details::multi::args_handler<func_input_t>::get_spans(job_data.outputs);
-			constexpr u32 batch_size = BatchSize;
-
-			const u32 count = job_data.count.value();
-			bool outputs_ready = false;
-			while (true) {
-				const u32 start_index = job_data.start_count.fetch_add(batch_size);
-				if (start_index >= count) {
-					break;
-				}
-				const u32 cur_batch_size = std::min(batch_size, count - start_index);
-				for (u32 i = 0; i < cur_batch_size; ++i) {
-					const u32 cur_index = start_index + i;
+			input_spans_t input_spans = _details::multi::args_handler<func_input_t>::get_spans(job_data.get_inputs());
+			output_spans_t output_spans =
+				_details::multi::args_handler<func_output_t>::get_spans(job_data.get_outputs());
+
+			while (std::optional<index_range> batch = job_data.claim_batch()) {
+				for (u32 cur_index = batch->begin; cur_index < batch->end; ++cur_index) {
 					_details::multi::args_handler<func_output_t>::set(
 						output_spans,
 						std::apply(
@@ -441,13 +815,29 @@ namespace lotus::job_system {
 						cur_index
 					);
 				}
-				const u32 finish_index = job_data.finish_count.fetch_add(cur_batch_size);
-				if (finish_index + cur_batch_size == count) {
-					outputs_ready = true;
-					break;
+				if (job_data.finish_batch(batch.value())) {
+					return true;
+				}
+			}
+			return false;
+		}
+		/// Wrapper for a parallel-for job function. Handles input and output parameters.
+		template <typename JobFunc> static bool _parallel_for_job_wrapper(JobFunc job, _details::job_data &job_data) {
+			using func_input_t = _details::parallel_for::func_input_type_t<JobFunc>;
+			using func_output_t = _details::parallel_for::func_output_type_t<JobFunc>;
+			using input_spans_t = _details::apply_to_tuple_t<func_input_t, _details::const_span_t>;
+			using output_spans_t = _details::apply_to_tuple_t<func_output_t, std::span>;
+			input_spans_t input_spans = _details::multi::args_handler<func_input_t>::get_spans(job_data.get_inputs());
+			output_spans_t output_spans =
+				_details::multi::args_handler<func_output_t>::get_spans(job_data.get_outputs());
+
+			while (std::optional<index_range> batch = job_data.claim_batch()) {
+				job(batch.value(), input_spans, output_spans);
+				if (job_data.finish_batch(batch.value())) {
+					return true;
 				}
 			}
-			return outputs_ready;
+			return false;
 		}
 	};
 }
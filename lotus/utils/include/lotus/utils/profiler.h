@@ -3,39 +3,94 @@
 /// \file
 /// The CPU profiler.
 
+#include <atomic>
 #include <chrono>
 #include <thread>
 #include <mutex>
 #include <deque>
 #include <map>
-#include <unordered_map>
+#include <memory>
 #include <vector>
 
-#ifdef __aarch64__
+#include <ctime>
+
+#if defined(__aarch64__)
 #	include <arm_acle.h>
+#elif defined(__x86_64__) || defined(_M_X64)
+#	define LOTUS_PROFILER_USE_TSC
+#	ifdef _MSC_VER
+#		include <intrin.h>
+#	else
+#		include <x86intrin.h>
+#	endif
 #endif
 
 #include "lotus/common.h"
+#include "lotus/containers/spsc_ring_buffer.h"
 
 namespace lotus::profiler {
 	struct thread_accumulator;
 
 	using time_t = u64; ///< Timer value.
 
+	namespace _details {
+		/// Frequency of \ref get_fallback_timer().
+		constexpr u64 fallback_timer_frequency = 1000000000;
+
+		/// Returns the value of a monotonic timer provided by the OS, in nanoseconds. This is used when there's no
+		/// reliable timer that can be read directly from the CPU.
+		[[nodiscard]] inline time_t get_fallback_timer() {
+#ifdef CLOCK_MONOTONIC_RAW
+			timespec ts;
+			clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+			return static_cast<time_t>(ts.tv_sec) * fallback_timer_frequency + static_cast<time_t>(ts.tv_nsec);
+#else
+			return static_cast<time_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+				std::chrono::steady_clock::now().time_since_epoch()
+			).count());
+#endif
+		}
+
+#ifdef LOTUS_PROFILER_USE_TSC
+		/// Queries CPUID for whether the time stamp counter runs at a constant rate regardless of power states.
+		[[nodiscard]] bool detect_invariant_tsc();
+		/// Determines the frequency of the time stamp counter, either from CPUID or by measuring it against the
+		/// fallback timer.
+		[[nodiscard]] u64 calibrate_tsc_frequency();
+
+		/// Returns whether the time stamp counter is invariant and can be used as the timer.
+		[[nodiscard]] inline bool has_invariant_tsc() {
+			static const bool _result = detect_invariant_tsc();
+			return _result;
+		}
+#endif
+	}
+
 	/// Retrieves the timer.
 	[[nodiscard]] inline time_t get_timer() {
-#ifdef __aarch64__
+#if defined(__aarch64__)
 		return __arm_rsr64("CNTVCT_EL0");
+#elif defined(LOTUS_PROFILER_USE_TSC)
+		if (_details::has_invariant_tsc()) [[likely]] {
+			return __rdtsc();
+		}
+		return _details::get_fallback_timer();
 #else
-#	error "Not implemented"
+		return _details::get_fallback_timer();
 #endif
 	}
 	/// Returns the frequency of \ref get_timer().
 	[[nodiscard]] inline u64 get_timer_frequency() {
-#ifdef __aarch64__
+#if defined(__aarch64__)
 		return __arm_rsr64("CNTFRQ_EL0");
+#elif defined(LOTUS_PROFILER_USE_TSC)
+		if (_details::has_invariant_tsc()) [[likely]] {
+			static const u64 _frequency = _details::calibrate_tsc_frequency();
+			return _frequency;
+		}
+		return _details::fallback_timer_frequency;
 #else
-#	error "Not implemented"
+		return _details::fallback_timer_frequency;
 #endif
 	}
 
@@ -79,18 +134,47 @@ namespace lotus::profiler {
 		std::deque<samples> batches; ///< All batches of samples.
 		std::u8string name; ///< The name of this thread.
 		std::thread::id thread_id; ///< The ID of this thread.
+		/// Identifies the registration of this thread with the \ref thread_manager. Unlike \ref thread_id, this is
+		/// never reused by another thread.
+		u64 registration_id = 0;
+		/// The number of timestamps dropped because the thread's sample buffer was full. Dropped scopes are removed
+		/// as a whole, so that all batches remain balanced.
+		u64 num_dropped_samples = 0;
 	};
 
-	/// Manages data for all threads.
+	/// Manages data for all threads. Each thread writes its timestamps into its own lock-free ring buffer, which is
+	/// drained by whichever thread calls \ref flush(); the lock is only taken when threads are registered and when
+	/// the collector iterates over them, so recording samples never blocks.
 	struct thread_manager {
 		friend thread_accumulator;
 	public:
+		/// The maximum number of timestamps that can be buffered for a single thread between two calls to
+		/// \ref flush(). Additional samples are dropped.
+		constexpr static usize buffer_capacity = 1 << 16;
+		/// The ring buffer type used to transfer timestamps from a thread to the collector.
+		using sample_buffer = spsc_ring_buffer<timestamp, buffer_capacity>;
+
 		/// Data associated with a single thread.
 		struct thread_data {
-			std::deque<samples> samples; ///< Accumulated samples, potentially over multiple frames.
-			std::u8string name; ///< The name of this thread.
-			/// The accumulator for this thread. When the thread terminates, this will be reset to \p nullptr.
-			thread_accumulator *accumulator = nullptr;
+			/// Initializes the thread ID and the registration ID.
+			thread_data(std::thread::id id, u64 reg_id) : thread_id(id), registration_id(reg_id) {
+			}
+
+			sample_buffer buffer; ///< Timestamps written by the thread that have not been collected.
+			/// Number of dropped timestamps. Written by the thread, read by the collector.
+			std::atomic<u64> num_dropped_samples = 0;
+			/// Set by the thread after its last access to this object; the collector can then free this object.
+			std::atomic_bool finished = false;
+			/// The name of this thread. This is read when the thread is registered, and updated by the thread in
+			/// \ref thread_manager::refresh_thread_name().
+			std::u8string name;
+			std::mutex name_lock; ///< Lock for \ref name.
+
+			// only accessed by the collector
+			samples current_batch; ///< Timestamps collected before the end of the current batch has been reached.
+			std::deque<samples> batches; ///< Collected batches, potentially over multiple frames.
+			std::thread::id thread_id; ///< The ID of this thread.
+			u64 registration_id = 0; ///< \ref thread_samples::registration_id.
 		};
 
 		/// Returns all accumulated samples and resets accumulated data.
@@ -101,49 +185,83 @@ namespace lotus::profiler {
 		/// Returns current thread data. If one doesn't exist, it will be allocated from the global
 		/// \ref thread_manager instance.
 		static thread_accumulator &get_thread_data();
+		/// Re-reads the name of the current thread. This should be called after changing the name of a thread that
+		/// may have already been registered; threads that have not been registered are left alone.
+		static void refresh_thread_name();
 	private:
-		/// Mapping between thread IDs and thread data.
-		std::unordered_map<std::thread::id, thread_data> _thread_mapping;
-		std::mutex _lock; ///< Lock for accessing \ref _thread_mapping.
+		/// Label used to mark the end of a batch in the ring buffer.
+		constexpr static char8_t _batch_end_label[] = u8"";
+
+		/// Data of all registered threads, including ones that have finished but whose samples have not been
+		/// collected. Threads are not keyed by their IDs since IDs can be reused.
+		std::vector<std::unique_ptr<thread_data>> _threads;
+		std::mutex _lock; ///< Lock for accessing \ref _threads.
+		std::atomic<u64> _registration_id_alloc = 0; ///< Used to allocate registration IDs.
 
-		/// Registers a thread and returns the new accumulator.
-		[[nodiscard]] std::unique_ptr<thread_accumulator> _register_thread(std::thread::id);
-		/// Uploads samples from the given thread.
-		void _upload_samples(std::thread::id, samples);
-		/// Signals that the given thread has finished execution.
-		void _unregister_thread(std::thread::id, samples);
+		/// Registers the calling thread and returns the new accumulator.
+		[[nodiscard]] std::unique_ptr<thread_accumulator> _register_thread();
+		/// Moves all committed timestamps of the given thread into its batches.
+		static void _collect(thread_data&);
+		/// Updates the name of the given thread. This must be called from that thread.
+		static void _update_thread_name(thread_data&);
 
 		static thread_local std::unique_ptr<thread_accumulator> _this_thread; ///< Thread local profiler data.
 	};
 
-	/// Contains an array of profiler events.
+	/// Records profiler events of a single thread into its ring buffer. Pushing and popping scopes never allocates
+	/// or blocks; if the buffer is full, the scope is dropped as a whole and counted.
 	struct thread_accumulator {
 	public:
-		/// Initializes \ref _manager.
-		explicit thread_accumulator(thread_manager &man) : _manager(man) {
+		/// Initializes \ref _data.
+		explicit thread_accumulator(thread_manager::thread_data &data) : _data(data) {
 		}
-		/// Unregisters this thread.
+		/// Publishes remaining samples and marks the thread as finished.
 		~thread_accumulator() {
-			_manager._unregister_thread(std::this_thread::get_id(), std::move(_samples));
+			flush();
+			_data.finished.store(true, std::memory_order::release);
 		}
 
 		/// Pushes a time stamp.
 		void push(const char8_t *label) {
 			crash_if(!label);
-			_samples.timestamps.emplace_back(timestamp::now(label));
+			// reserve space for the pops of all open scopes including this one, and for the end of the batch
+			if (_num_dropped_scopes > 0 || !_data.buffer.try_push(timestamp::now(label), _num_open_scopes + 2)) {
+				// drop nested scopes along with the parent so that pushes and pops stay balanced
+				++_num_dropped_scopes;
+				_data.num_dropped_samples.fetch_add(1, std::memory_order::relaxed);
+				return;
+			}
+			++_num_open_scopes;
 		}
 		/// Pops a time stamp.
 		void pop() {
-			_samples.timestamps.emplace_back(timestamp::now(nullptr));
+			if (_num_dropped_scopes > 0) {
+				--_num_dropped_scopes;
+				_data.num_dropped_samples.fetch_add(1, std::memory_order::relaxed);
+				return;
+			}
+			crash_if(_num_open_scopes == 0);
+			[[maybe_unused]] const bool pushed = _data.buffer.try_push(timestamp::now(nullptr));
+			crash_if(!pushed); // space has been reserved in push()
+			--_num_open_scopes;
 		}
 
-		/// Flushes this accumulator.
+		/// Ends the current batch and makes all recorded timestamps visible to the collector.
 		void flush() {
-			_manager._upload_samples(std::this_thread::get_id(), std::exchange(_samples, {}));
+			timestamp end = zero;
+			end.label = thread_manager::_batch_end_label;
+			// if there's no space, the batch is merged with the next one
+			(void)_data.buffer.try_push(end, _num_open_scopes);
+			_data.buffer.commit();
+		}
+		/// Re-reads the name of this thread. This must be called from this thread.
+		void refresh_name() {
+			thread_manager::_update_thread_name(_data);
 		}
 	private:
-		samples _samples; ///< All timestamps.
-		thread_manager &_manager; ///< Manager for this object.
+		thread_manager::thread_data &_data; ///< Data of this thread.
+		u32 _num_open_scopes = 0; ///< The number of recorded scopes that have not been popped.
+		u32 _num_dropped_scopes = 0; ///< The number of open scopes that have been dropped.
 	};
 
 	/// A profiler scope.
@@ -182,7 +300,7 @@ namespace lotus::profiler {
 
 	inline thread_accumulator &thread_manager::get_thread_data() {
 		if (!_this_thread) {
-			_this_thread = instance()._register_thread(std::this_thread::get_id());
+			_this_thread = instance()._register_thread();
 		}
 		return *_this_thread;
 	}
@@ -0,0 +1,119 @@
+#pragma once
+
+/// \file
+/// Exporting profiler samples as traces that can be inspected offline in the Chrome trace viewer or Perfetto.
+
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <span>
+#include <unordered_map>
+
+#include "lotus/utils/profiler.h"
+
+namespace lotus::profiler {
+	/// File formats of exported traces.
+	enum class trace_format : u8 {
+		chrome_json, ///< JSON array of Chrome Trace Events.
+		perfetto,    ///< Binary protobuf trace that can be loaded by Perfetto.
+	};
+
+	/// Returns the file extension used for the given trace format, including the dot.
+	[[nodiscard]] std::u8string_view get_trace_file_extension(trace_format);
+
+
+	/// Streams batches of samples into a trace. Each call to \ref write() appends all events in the given samples,
+	/// so samples returned by \ref thread_manager::flush() can be written as they are collected. Events are written
+	/// as begin/end pairs in the order they have been recorded.
+	class trace_writer {
+	public:
+		/// Initializes the writer and writes the header of the trace. Timestamps are converted to nanoseconds using
+		/// the given timer frequency.
+		trace_writer(std::ostream&, trace_format, u64 timer_frequency = get_timer_frequency());
+		/// No copy construction.
+		trace_writer(const trace_writer&) = delete;
+		/// No copy assignment.
+		trace_writer &operator=(const trace_writer&) = delete;
+		/// Calls \ref finish() if necessary.
+		~trace_writer();
+
+		/// Writes all events in the given samples. Threads are described the first time they are encountered.
+		void write(std::span<const thread_samples>);
+		/// Writes the footer of the trace and flushes the stream. No more events can be written afterwards.
+		void finish();
+
+		/// Returns the total number of begin and end events that have been written.
+		[[nodiscard]] u64 get_num_events() const {
+			return _num_events;
+		}
+	private:
+		std::ostream &_out; ///< The output stream.
+		trace_format _format; ///< The output format.
+		u64 _timer_frequency; ///< Frequency of timestamps.
+		/// Indices of all threads that have been described, starting from 1, keyed by
+		/// \ref thread_samples::registration_id since thread IDs can be reused.
+		std::unordered_map<u64, u32> _thread_indices;
+		std::string _packet; ///< Scratch buffer used to encode a Perfetto packet.
+		std::string _message; ///< Scratch buffer used to encode a nested Perfetto message.
+		u64 _num_events = 0; ///< The number of events that have been written.
+		bool _finished = false; ///< Whether \ref finish() has been called.
+		bool _has_json_records = false; ///< Whether a record has been written to a JSON trace.
+
+		/// Converts the given timer value into nanoseconds without overflowing.
+		[[nodiscard]] u64 _to_nanoseconds(time_t) const;
+		/// Returns the index of the given thread, describing it first if it has not been encountered.
+		u32 _get_thread_index(const thread_samples&);
+
+		/// Writes the metadata event that names a thread.
+		void _write_thread_descriptor(u32 index, std::u8string_view name);
+		/// Writes a single begin or end event.
+		void _write_event(u32 thread_index, const timestamp&);
+		/// Writes the separator before a JSON record.
+		void _begin_json_record();
+		/// Writes \ref _packet to the output as a Perfetto \p TracePacket.
+		void _flush_packet();
+	};
+
+	/// Continuously writes samples into a series of trace files in a directory. Once a file contains enough events,
+	/// it is finished and a new file is started; only the most recent files are kept, so that frame spikes can be
+	/// diagnosed after the fact without the trace growing indefinitely.
+	class continuous_trace_capture {
+	public:
+		/// Default number of events in a file before starting a new one.
+		constexpr static u64 default_max_events_per_file = 1 << 20;
+		/// Default number of files to keep.
+		constexpr static u32 default_max_num_files = 8;
+
+		/// Creates the directory if necessary and opens the first file. If \p max_num_files is zero, no files are
+		/// deleted.
+		continuous_trace_capture(
+			std::filesystem::path directory,
+			trace_format,
+			u64 max_events_per_file = default_max_events_per_file,
+			u32 max_num_files = default_max_num_files
+		);
+
+		/// Writes the given samples to the current file, then starts a new file if the current one is full.
+		void write(std::span<const thread_samples>);
+
+		/// Returns the path of the file that's currently being written.
+		[[nodiscard]] const std::filesystem::path &get_current_file() const {
+			return _current_path;
+		}
+	private:
+		std::filesystem::path _directory; ///< Directory containing all trace files.
+		trace_format _format; ///< The output format.
+		u64 _max_events_per_file; ///< The number of events in a file before starting a new one.
+		u32 _max_num_files; ///< The number of files to keep.
+		u32 _file_index = 0; ///< Index of the current file.
+
+		std::filesystem::path _current_path; ///< Path of the current file.
+		std::ofstream _file; ///< The current file.
+		std::unique_ptr<trace_writer> _writer; ///< Writer for the current file.
+
+		/// Returns the path of the file with the given index.
+		[[nodiscard]] std::filesystem::path _get_file_path(u32) const;
+		/// Finishes the current file if one is open, and opens the file with index \ref _file_index.
+		void _open_file();
+	};
+}
@@ -9,143 +9,289 @@
 #include "lotus/system/thread_handle.h"
 
 namespace lotus::job_system {
-	void manager::_control_block::worker_function(std::string thread_name) {
+	manager::_control_block::_control_block(u32 num_workers) {
+		_queues.reserve(num_workers);
+		_worker_pools.reserve(num_workers);
+		for (u32 i = 0; i < num_workers; ++i) {
+			_queues.emplace_back(std::make_unique<_details::job_queue>());
+			_worker_pools.emplace_back(std::make_unique<_details::allocation_pools>());
+		}
+	}
+
+	manager::_control_block::~_control_block() {
+		// all workers have been joined at this point
+		usize num_jobs_discarded = 0;
+		const auto discard_queued_job = [&](_details::job_data *job) {
+			// parallel jobs enqueue extra references so that other workers can help; those that are left behind
+			// after all batches have been claimed are expected and are not counted
+			if (!job->count.has_value() || job->start_count.load(std::memory_order::relaxed) < job->count.value()) {
+				++num_jobs_discarded;
+			}
+			_release_job(job);
+		};
+		for (usize i = _injected_jobs_head; i < _injected_jobs.size(); ++i) {
+			discard_queued_job(_injected_jobs[i]);
+		}
+		for (const std::unique_ptr<_details::job_queue> &queue : _queues) {
+			while (std::optional<_details::job_data*> job = queue->pop()) {
+				discard_queued_job(job.value());
+			}
+		}
+		for (_details::job_data *job : _waiting_jobs) {
+			++num_jobs_discarded;
+			_release_job(job);
+		}
+		if (num_jobs_discarded) {
+			log().warn("Job system shutdown: {} job(s) discarded", num_jobs_discarded);
+		}
+	}
+
+	void manager::_control_block::worker_function(u32 index, std::string thread_name) {
 		system::thread_handle::current().set_name(string::assume_utf8(thread_name));
+		profiler::thread_manager::refresh_thread_name();
 		thread_name = {};
+		_this_worker.owner = this;
+		_this_worker.index = index;
 
-		std::unique_lock lock(_job_lock);
 		while (true) {
 			profiler::thread_manager::get_thread_data().flush();
 			profiler::scope p1(u8"Wake Up");
 
-			if (_terminate) {
+			// the epoch must be read before checking for termination and jobs, so that any signal sent after this
+			// point will prevent the worker from going to sleep
+			const u64 epoch = _epoch.load();
+			if (_terminate.load()) {
 				break;
 			}
-			// wait for a new job
-			if (_pending_jobs.empty()) {
-				p1.end(); // don't profile wait times
-				profiler::thread_manager::get_thread_data().flush();
-				_signal.wait(lock);
+			if (_details::job_data *job = _find_job()) {
+				_run_job(job);
 				continue;
 			}
 
-			_details::job_ptr job;
-			if (_pending_jobs.front()->count.has_value()) {
-				job = _pending_jobs.front();
-				// check if all work has been allocated
-				if (job->start_count >= job->count.value()) {
-					// pop job to start running other jobs, but don't mark ready yet
-					_pending_jobs.pop();
-					continue;
-				}
-			} else {
-				// mono job
-				job = std::move(_pending_jobs.front());
-				_pending_jobs.pop();
-			}
+			// wait for a new job
+			p1.end(); // don't profile wait times
+			profiler::thread_manager::get_thread_data().flush();
+			++_num_sleeping_threads;
+			_epoch.wait(epoch);
+			--_num_sleeping_threads;
+		}
 
-			// run unlocked
-			lock.unlock();
-			const bool mark_finish = job->job(*job);
-			lock.lock();
+		_this_worker = {};
+	}
 
-			// notify other jobs
-			if (mark_finish) {
-				for (const _details::resource_ptr &output : job->outputs) {
-					_mark_resource_ready_locked(output.get());
-				}
-				_signal.notify_all();
-			}
-		}
+	_details::worker_data manager::_control_block::spawn_worker(u32 index, std::string thread_name) {
+		return _details::worker_data(std::thread(
+			&_control_block::worker_function, this, index, std::move(thread_name)
+		));
 	}
 
-	_details::worker_data manager::_control_block::spawn_worker(std::string thread_name) {
-		return _details::worker_data(std::thread(&_control_block::worker_function, this, std::move(thread_name)));
+	_details::job_data *manager::_control_block::create_job() {
+		return _with_allocation_pools([](_details::allocation_pools &pools) {
+			return pools.jobs.allocate();
+		});
 	}
 
-	void manager::_control_block::schedule_job(_details::job_ptr job) {
-		std::scoped_lock lock(_job_lock);
+	_details::resource_ptr manager::_control_block::create_resource(const std::type_info &type) {
+		return _with_allocation_pools([&type](_details::allocation_pools &pools) {
+			return _details::resource_ptr(pools.resources.allocate(type));
+		});
+	}
 
-		// register input dependencies
-		job->num_pending_inputs = 0;
-		for (const _details::resource_ptr &input : job->inputs) {
-			input->consumers.emplace_back(job.get());
-			if (!input->value_ready) {
-				++job->num_pending_inputs;
+	void manager::_control_block::schedule_job(_details::job_data *job) {
+		// hold an extra pending input so that the job cannot be started while its inputs are being registered
+		job->num_pending_inputs.store(1, std::memory_order::relaxed);
+		job->consumer_links.resize(job->inputs.size());
+		bool has_pending_inputs = false;
+		for (usize i = 0; i < job->inputs.size(); ++i) {
+			_details::resource_data &input = *job->inputs[i];
+			std::scoped_lock lock(input.lock);
+			if (!input.value_ready.load(std::memory_order::relaxed)) {
+				_details::consumer_link &link = job->consumer_links[i];
+				link.job        = job;
+				link.next       = input.consumers;
+				input.consumers = &link;
+				job->num_pending_inputs.fetch_add(1, std::memory_order::relaxed);
+				has_pending_inputs = true;
 			}
 		}
 
 		// check and mark outputs
 		for (const _details::resource_ptr &output : job->outputs) {
+			std::scoped_lock lock(output->lock);
 			crash_if(output->has_producer);
 			output->has_producer = true;
 		}
 
-		// add to pending jobs
-		if (job->num_pending_inputs == 0) {
-			const bool is_multi = job->count.has_value();
-			_pending_jobs.emplace(std::move(job));
-			if (is_multi) {
-				_signal.notify_all();
-			} else {
-				_signal.notify_one();
-			}
-		} else {
-			_waiting_jobs.emplace_back(std::move(job));
+		// keep track of the job while it's waiting for its inputs
+		if (has_pending_inputs) {
+			std::scoped_lock lock(_waiting_jobs_lock);
+			job->waiting_index = _waiting_jobs.size();
+			_waiting_jobs.emplace_back(job);
+		}
+
+		if (job->num_pending_inputs.fetch_sub(1, std::memory_order::acq_rel) == 1) {
+			_on_job_ready(job);
 		}
 	}
 
-	void manager::_control_block::wait_for_resource(const _details::resource_data *rsrc) {
-		std::unique_lock lock(_job_lock);
-		while (!rsrc->value_ready) {
-			_signal.wait(lock);
+	void manager::_control_block::wait_for_resource(_details::resource_data *rsrc) {
+		if (rsrc->value_ready.load(std::memory_order::acquire)) {
+			return;
 		}
+
+		// registering as a waiter before checking the flag guarantees that either the check below sees the resource
+		// as ready, or _mark_resource_ready() sees the waiter and bumps the epoch
+		++rsrc->num_waiters;
+		while (true) {
+			const u64 epoch = _epoch.load();
+			if (rsrc->value_ready.load()) {
+				break;
+			}
+			// help with pending jobs instead of blocking; this also handles jobs waiting on nested jobs, since the
+			// nested jobs will eventually be picked up by the waiting thread itself
+			if (_details::job_data *job = _find_job()) {
+				_run_job(job);
+				continue;
+			}
+			++_num_sleeping_threads;
+			_epoch.wait(epoch);
+			--_num_sleeping_threads;
+		}
+		--rsrc->num_waiters;
 	}
 
 	void manager::_control_block::terminate() {
-		std::unique_lock lock(_job_lock);
 		_terminate = true;
+		_wake_threads(true);
+	}
 
-		usize num_jobs_discarded = _waiting_jobs.size();
-		_waiting_jobs.clear();
-		while (!_pending_jobs.empty()) {
-			++num_jobs_discarded;
-			_pending_jobs.pop();
+	_details::job_data *manager::_control_block::_find_job() {
+		const bool is_worker = _this_worker.owner == this;
+		if (is_worker) {
+			if (std::optional<_details::job_data*> job = _queues[_this_worker.index]->pop()) {
+				return job.value();
+			}
 		}
-		if (num_jobs_discarded) {
-			log().warn("Job system shutdown: {} job(s) discarded", num_jobs_discarded);
+
+		if (_num_injected_jobs.load(std::memory_order::acquire) > 0) {
+			std::scoped_lock lock(_injected_jobs_lock);
+			if (_injected_jobs_head < _injected_jobs.size()) {
+				_details::job_data *job = _injected_jobs[_injected_jobs_head];
+				++_injected_jobs_head;
+				if (_injected_jobs_head == _injected_jobs.size()) {
+					_injected_jobs.clear();
+					_injected_jobs_head = 0;
+				}
+				_num_injected_jobs.fetch_sub(1, std::memory_order::relaxed);
+				return job;
+			}
 		}
 
-		_signal.notify_all();
-	}
-
-	void manager::_control_block::_mark_resource_ready_locked(_details::resource_data *rsrc) {
-		rsrc->value_ready = true;
-		for (_details::job_data *consumer : rsrc->consumers) {
-			--consumer->num_pending_inputs;
-			if (consumer->num_pending_inputs == 0) {
-				// move job to pending queue
-				bool found_job = false;
-				for (auto it = _waiting_jobs.begin(); it != _waiting_jobs.end(); ++it) {
-					if (it->get() == consumer) {
-						found_job = true;
-						_pending_jobs.emplace(std::move(*it));
-						std::swap(*it, _waiting_jobs.back());
-						_waiting_jobs.pop_back();
-						break;
-					}
+		const auto num_queues = static_cast<u32>(_queues.size());
+		const u32 first_victim = is_worker ? _this_worker.index + 1 : 0;
+		while (true) {
+			// a steal can fail because another thread took the element; in that case try again as long as there
+			// still seem to be jobs left
+			bool retry = false;
+			for (u32 i = 0; i < num_queues; ++i) {
+				_details::job_queue &victim = *_queues[(first_victim + i) % num_queues];
+				if (std::optional<_details::job_data*> job = victim.steal()) {
+					return job.value();
 				}
-				crash_if(!found_job);
+				retry = retry || victim.get_size_estimate() > 0;
+			}
+			if (!retry) {
+				return nullptr;
+			}
+		}
+	}
+
+	void manager::_control_block::_run_job(_details::job_data *job) {
+		if (job->count.has_value()) {
+			// let other workers help with this job while this thread is running it
+			if (job->start_count.load(std::memory_order::relaxed) < job->count.value()) {
+				job->num_references.fetch_add(1, std::memory_order::relaxed);
+				_enqueue_job(job);
+			}
+		}
+
+		if (job->job(*job)) {
+			for (const _details::resource_ptr &output : job->get_outputs()) {
+				_mark_resource_ready(output.get());
 			}
 		}
+		_release_job(job);
+	}
+
+	void manager::_control_block::_enqueue_job(_details::job_data *job) {
+		if (_this_worker.owner == this) {
+			_queues[_this_worker.index]->push(job);
+		} else {
+			std::scoped_lock lock(_injected_jobs_lock);
+			_injected_jobs.emplace_back(job);
+			_num_injected_jobs.fetch_add(1, std::memory_order::release);
+		}
+		_wake_threads(job->count.has_value());
 	}
 
+	void manager::_control_block::_on_job_ready(_details::job_data *job) {
+		if (job->waiting_index.has_value()) {
+			std::scoped_lock lock(_waiting_jobs_lock);
+			const usize index = job->waiting_index.value();
+			_waiting_jobs[index] = _waiting_jobs.back();
+			_waiting_jobs[index]->waiting_index = index;
+			_waiting_jobs.pop_back();
+			job->waiting_index.reset();
+		}
+		_enqueue_job(job);
+	}
+
+	void manager::_control_block::_mark_resource_ready(_details::resource_data *rsrc) {
+		_details::consumer_link *consumers = nullptr;
+		{
+			std::scoped_lock lock(rsrc->lock);
+			rsrc->value_ready.store(true);
+			consumers = std::exchange(rsrc->consumers, nullptr);
+		}
+		if (rsrc->num_waiters.load() > 0) {
+			_wake_threads(true);
+		}
+
+		while (consumers) {
+			// the job may start running and be freed as soon as it's marked as ready
+			_details::job_data *consumer = consumers->job;
+			consumers = consumers->next;
+			if (consumer->num_pending_inputs.fetch_sub(1, std::memory_order::acq_rel) == 1) {
+				_on_job_ready(consumer);
+			}
+		}
+	}
+
+	void manager::_control_block::_release_job(_details::job_data *job) {
+		if (job->num_references.fetch_sub(1, std::memory_order::acq_rel) == 1) {
+			_details::job_pool::free(job);
+		}
+	}
+
+	void manager::_control_block::_wake_threads(bool all) {
+		++_epoch;
+		if (_num_sleeping_threads.load() > 0) {
+			if (all) {
+				_epoch.notify_all();
+			} else {
+				_epoch.notify_one();
+			}
+		}
+	}
+
+	thread_local manager::_control_block::_worker_info manager::_control_block::_this_worker;
+
 
 	manager manager::spawn_workers(u32 count) {
-		manager result(std::make_unique<_control_block>());
+		manager result(std::make_unique<_control_block>(count));
 		result._workers.reserve(count);
 		for (u32 i = 0; i < count; ++i) {
-			result._workers.emplace_back(result._control->spawn_worker(std::format("Worker Thread {}", i)));
+			result._workers.emplace_back(result._control->spawn_worker(i, std::format("Worker Thread {}", i)));
 		}
 		return result;
 	}
@@ -160,6 +306,6 @@ namespace lotus::job_system {
 	}
 
 	resource_handle manager::create_resource(const std::type_info &type) {
-		return resource_handle(std::make_shared<_details::resource_data>(type));
+		return resource_handle(_control->create_resource(type));
 	}
 }
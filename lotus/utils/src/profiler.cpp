@@ -3,10 +3,67 @@
 /// \file
 /// CPU profiler implementation.
 
+#ifdef LOTUS_PROFILER_USE_TSC
+#	ifndef _MSC_VER
+#		include <cpuid.h>
+#	endif
+#endif
+
 #include "lotus/memory/stack_allocator.h"
 #include "lotus/system/thread_handle.h"
 
 namespace lotus::profiler {
+#ifdef LOTUS_PROFILER_USE_TSC
+	namespace _details {
+		/// Executes CPUID with the given leaf, and returns EAX, EBX, ECX, and EDX.
+		[[nodiscard]] static std::array<u32, 4> _cpuid(u32 leaf) {
+#	ifdef _MSC_VER
+			std::array<int, 4> regs;
+			__cpuid(regs.data(), static_cast<int>(leaf));
+			return std::bit_cast<std::array<u32, 4>>(regs);
+#	else
+			std::array<u32, 4> regs;
+			__cpuid(leaf, regs[0], regs[1], regs[2], regs[3]);
+			return regs;
+#	endif
+		}
+
+		bool detect_invariant_tsc() {
+			constexpr u32 power_management_leaf = 0x80000007;
+			constexpr u32 invariant_tsc_bit = 1u << 8;
+			if (_cpuid(0x80000000)[0] < power_management_leaf) {
+				return false;
+			}
+			return (_cpuid(power_management_leaf)[3] & invariant_tsc_bit) != 0;
+		}
+
+		u64 calibrate_tsc_frequency() {
+			// leaf 0x15 reports the ratio between the TSC and the core crystal clock; this is exact when available
+			constexpr u32 tsc_leaf = 0x15;
+			if (_cpuid(0)[0] >= tsc_leaf) {
+				const auto [denominator, numerator, crystal_frequency, edx] = _cpuid(tsc_leaf);
+				if (denominator != 0 && numerator != 0 && crystal_frequency != 0) {
+					return static_cast<u64>(crystal_frequency) * numerator / denominator;
+				}
+			}
+
+			// otherwise, measure the TSC against the fallback timer
+			constexpr time_t calibration_duration = fallback_timer_frequency / 50; // 20ms
+			const time_t fallback_begin = get_fallback_timer();
+			const u64 tsc_begin = __rdtsc();
+			time_t fallback_end;
+			do {
+				fallback_end = get_fallback_timer();
+			} while (fallback_end - fallback_begin < calibration_duration);
+			const u64 tsc_end = __rdtsc();
+			const f64 elapsed_seconds =
+				static_cast<f64>(fallback_end - fallback_begin) / static_cast<f64>(fallback_timer_frequency);
+			return static_cast<u64>(static_cast<f64>(tsc_end - tsc_begin) / elapsed_seconds);
+		}
+	}
+#endif
+
+
 	void samples::analyze(analysis_stack_frame &result) const {
 		{ // populate the tree
 			/// Information about the current stack frame.
@@ -62,14 +119,27 @@ namespace lotus::profiler {
 	std::vector<thread_samples> thread_manager::flush() {
 		std::scoped_lock lock(_lock);
 		std::vector<thread_samples> result;
-		for (auto it = _thread_mapping.begin(); it != _thread_mapping.end(); ) {
+		for (auto it = _threads.begin(); it != _threads.end(); ) {
+			thread_data &data = **it;
+			// check this before collecting, so that all samples are collected before the data is freed
+			const bool finished = data.finished.load(std::memory_order::acquire);
+			_collect(data);
+			if (finished && !data.current_batch.timestamps.empty()) {
+				data.batches.emplace_back(std::exchange(data.current_batch, {}));
+			}
+
 			thread_samples &s = result.emplace_back();
-			s.batches   = std::move(it->second.samples);
-			s.thread_id = it->first;
-			s.name      = it->second.name;
+			s.batches             = std::exchange(data.batches, {});
+			s.thread_id           = data.thread_id;
+			s.registration_id     = data.registration_id;
+			s.num_dropped_samples = data.num_dropped_samples.exchange(0, std::memory_order::relaxed);
+			{
+				std::scoped_lock name_lock(data.name_lock);
+				s.name = data.name;
+			}
 
-			if (!it->second.accumulator) {
-				it = _thread_mapping.erase(it);
+			if (finished) {
+				it = _threads.erase(it);
 			} else {
 				++it;
 			}
@@ -82,36 +152,41 @@ namespace lotus::profiler {
 		return _instance;
 	}
 
-	std::unique_ptr<thread_accumulator> thread_manager::_register_thread(std::thread::id id) {
-		std::unique_ptr result = std::make_unique<thread_accumulator>(*this);
+	void thread_manager::refresh_thread_name() {
+		if (_this_thread) {
+			_this_thread->refresh_name();
+		}
+	}
+
+	std::unique_ptr<thread_accumulator> thread_manager::_register_thread() {
+		auto data = std::make_unique<thread_data>(
+			std::this_thread::get_id(), _registration_id_alloc.fetch_add(1, std::memory_order::relaxed) + 1
+		);
+		_update_thread_name(*data);
+		auto result = std::make_unique<thread_accumulator>(*data);
 		{
 			std::scoped_lock lock(_lock);
-			auto [it, inserted] = _thread_mapping.emplace(id, thread_data());
-			// TODO handle when thread IDs repeat
-			it->second.accumulator = result.get();
+			_threads.emplace_back(std::move(data));
 		}
 		return result;
 	}
 
-	void thread_manager::_upload_samples(std::thread::id id, samples s) {
-		std::scoped_lock lock(_lock);
-		auto it = _thread_mapping.find(id);
-		crash_if(it == _thread_mapping.end());
-		crash_if(!it->second.accumulator);
-		it->second.samples.emplace_back(std::move(s));
-
-		// also update thread name
-		it->second.name = system::thread_handle::current().get_name();
+	void thread_manager::_collect(thread_data &data) {
+		data.buffer.consume([&](const timestamp &ts) {
+			if (ts.label == _batch_end_label) {
+				if (!data.current_batch.timestamps.empty()) {
+					data.batches.emplace_back(std::exchange(data.current_batch, {}));
+				}
+			} else {
+				data.current_batch.timestamps.emplace_back(ts);
+			}
+		});
 	}
 
-	void thread_manager::_unregister_thread(std::thread::id id, samples s) {
-		std::scoped_lock lock(_lock);
-		auto it = _thread_mapping.find(id);
-		crash_if(it == _thread_mapping.end());
-		crash_if(!it->second.accumulator);
-		it->second.samples.emplace_back(std::move(s));
-		// only difference from _upload_samples
-		it->second.accumulator = nullptr;
+	void thread_manager::_update_thread_name(thread_data &data) {
+		std::u8string name = system::thread_handle::current().get_name();
+		std::scoped_lock lock(data.name_lock);
+		data.name = std::move(name);
 	}
 
 	thread_local std::unique_ptr<thread_accumulator> thread_manager::_this_thread;
@@ -0,0 +1,334 @@
+#include "lotus/utils/profiler_trace.h"
+
+/// \file
+/// Implementation of trace exporters.
+
+#include <charconv>
+
+#include "lotus/logging.h"
+
+namespace lotus::profiler {
+	namespace _details {
+		constexpr u32 trace_process_id = 1; ///< Process ID used for all threads in exported traces.
+		constexpr u32 perfetto_sequence_id = 1; ///< ID of the only packet sequence in Perfetto traces.
+
+		/// Protobuf wire types.
+		enum class wire_type : u8 {
+			varint           = 0, ///< Variable-length integer.
+			length_delimited = 2, ///< Strings, bytes, and nested messages.
+		};
+
+		/// Field numbers of the Perfetto trace protos that are used by the exporter.
+		namespace perfetto_field {
+			constexpr u32 trace_packet = 1; ///< \p Trace.packet
+
+			constexpr u32 packet_timestamp                  = 8;  ///< \p TracePacket.timestamp
+			constexpr u32 packet_trusted_packet_sequence_id = 10; ///< \p TracePacket.trusted_packet_sequence_id
+			constexpr u32 packet_track_event                = 11; ///< \p TracePacket.track_event
+			constexpr u32 packet_sequence_flags             = 13; ///< \p TracePacket.sequence_flags
+			constexpr u32 packet_track_descriptor           = 60; ///< \p TracePacket.track_descriptor
+
+			constexpr u32 track_descriptor_uuid   = 1; ///< \p TrackDescriptor.uuid
+			constexpr u32 track_descriptor_thread = 4; ///< \p TrackDescriptor.thread
+
+			constexpr u32 thread_descriptor_pid         = 1; ///< \p ThreadDescriptor.pid
+			constexpr u32 thread_descriptor_tid         = 2; ///< \p ThreadDescriptor.tid
+			constexpr u32 thread_descriptor_thread_name = 5; ///< \p ThreadDescriptor.thread_name
+
+			constexpr u32 track_event_type       = 9;  ///< \p TrackEvent.type
+			constexpr u32 track_event_track_uuid = 11; ///< \p TrackEvent.track_uuid
+			constexpr u32 track_event_name       = 23; ///< \p TrackEvent.name
+		}
+		constexpr u64 perfetto_slice_begin = 1; ///< \p TrackEvent.TYPE_SLICE_BEGIN
+		constexpr u64 perfetto_slice_end   = 2; ///< \p TrackEvent.TYPE_SLICE_END
+		constexpr u64 perfetto_incremental_state_cleared = 1; ///< \p TracePacket.SEQ_INCREMENTAL_STATE_CLEARED
+
+		/// Appends a base-128 variable-length integer.
+		static void _append_varint(std::string &out, u64 value) {
+			while (value >= 0x80) {
+				out.push_back(static_cast<char>((value & 0x7F) | 0x80));
+				value >>= 7;
+			}
+			out.push_back(static_cast<char>(value));
+		}
+		/// Appends the tag of a field.
+		static void _append_tag(std::string &out, u32 field, wire_type type) {
+			_append_varint(out, (static_cast<u64>(field) << 3) | static_cast<u64>(type));
+		}
+		/// Appends an integer field.
+		static void _append_varint_field(std::string &out, u32 field, u64 value) {
+			_append_tag(out, field, wire_type::varint);
+			_append_varint(out, value);
+		}
+		/// Appends a string, bytes, or nested message field.
+		static void _append_bytes_field(std::string &out, u32 field, std::string_view value) {
+			_append_tag(out, field, wire_type::length_delimited);
+			_append_varint(out, value.size());
+			out.append(value);
+		}
+
+		/// Writes the given string as a JSON string literal, including the quotes.
+		static void _write_json_string(std::ostream &out, std::string_view str) {
+			constexpr static char hex_digits[] = "0123456789abcdef";
+			out.put('"');
+			for (const char c : str) {
+				switch (c) {
+				case '"':
+					out << "\\\"";
+					break;
+				case '\\':
+					out << "\\\\";
+					break;
+				default:
+					if (static_cast<unsigned char>(c) < 0x20) {
+						const auto uc = static_cast<unsigned char>(c);
+						const char escaped[] = { '\\', 'u', '0', '0', hex_digits[uc >> 4], hex_digits[uc & 0xF] };
+						out.write(escaped, std::size(escaped));
+					} else {
+						out.put(c);
+					}
+					break;
+				}
+			}
+			out.put('"');
+		}
+		/// Writes the given integer in decimal.
+		static void _write_integer(std::ostream &out, u64 value) {
+			char buffer[24];
+			const auto result = std::to_chars(std::begin(buffer), std::end(buffer), value);
+			out.write(buffer, result.ptr - buffer);
+		}
+	}
+
+
+	std::u8string_view get_trace_file_extension(trace_format fmt) {
+		switch (fmt) {
+		case trace_format::chrome_json:
+			return u8".json";
+		case trace_format::perfetto:
+			return u8".perfetto-trace";
+		}
+		return u8"";
+	}
+
+
+	trace_writer::trace_writer(std::ostream &out, trace_format fmt, u64 timer_frequency) :
+		_out(out), _format(fmt), _timer_frequency(timer_frequency) {
+
+		switch (_format) {
+		case trace_format::chrome_json:
+			// the closing bracket is optional, so a trace that has not been finished can still be loaded
+			_out << "[";
+			break;
+		case trace_format::perfetto:
+			_packet.clear();
+			_details::_append_varint_field(
+				_packet, _details::perfetto_field::packet_trusted_packet_sequence_id, _details::perfetto_sequence_id
+			);
+			_details::_append_varint_field(
+				_packet, _details::perfetto_field::packet_sequence_flags, _details::perfetto_incremental_state_cleared
+			);
+			_flush_packet();
+			break;
+		}
+	}
+
+	trace_writer::~trace_writer() {
+		if (!_finished) {
+			finish();
+		}
+	}
+
+	void trace_writer::write(std::span<const thread_samples> threads) {
+		crash_if(_finished);
+		for (const thread_samples &thread : threads) {
+			const u32 thread_index = _get_thread_index(thread);
+			for (const samples &batch : thread.batches) {
+				for (const timestamp &ts : batch.timestamps) {
+					_write_event(thread_index, ts);
+				}
+			}
+		}
+	}
+
+	void trace_writer::finish() {
+		crash_if(_finished);
+		if (_format == trace_format::chrome_json) {
+			_out << "\n]\n";
+		}
+		_out.flush();
+		_finished = true;
+	}
+
+	u64 trace_writer::_to_nanoseconds(time_t t) const {
+		constexpr u64 nanoseconds_per_second = 1000000000;
+		return
+			(t / _timer_frequency) * nanoseconds_per_second +
+			(t % _timer_frequency) * nanoseconds_per_second / _timer_frequency;
+	}
+
+	u32 trace_writer::_get_thread_index(const thread_samples &thread) {
+		const auto next_index = static_cast<u32>(_thread_indices.size() + 1);
+		auto [it, inserted] = _thread_indices.try_emplace(thread.registration_id, next_index);
+		if (inserted) {
+			_write_thread_descriptor(it->second, thread.name);
+		}
+		return it->second;
+	}
+
+	void trace_writer::_write_thread_descriptor(u32 index, std::u8string_view name) {
+		const std::string_view name_str(reinterpret_cast<const char*>(name.data()), name.size());
+		switch (_format) {
+		case trace_format::chrome_json:
+			_begin_json_record();
+			_out << R"({"ph":"M","name":"thread_name","pid":)";
+			_details::_write_integer(_out, _details::trace_process_id);
+			_out << R"(,"tid":)";
+			_details::_write_integer(_out, index);
+			_out << R"(,"args":{"name":)";
+			_details::_write_json_string(_out, name_str);
+			_out << "}}";
+			break;
+		case trace_format::perfetto:
+			{
+				_message.clear();
+				_details::_append_varint_field(
+					_message, _details::perfetto_field::thread_descriptor_pid, _details::trace_process_id
+				);
+				_details::_append_varint_field(_message, _details::perfetto_field::thread_descriptor_tid, index);
+				if (!name_str.empty()) {
+					_details::_append_bytes_field(
+						_message, _details::perfetto_field::thread_descriptor_thread_name, name_str
+					);
+				}
+				std::string track;
+				_details::_append_varint_field(track, _details::perfetto_field::track_descriptor_uuid, index);
+				_details::_append_bytes_field(track, _details::perfetto_field::track_descriptor_thread, _message);
+
+				_packet.clear();
+				_details::_append_varint_field(
+					_packet, _details::perfetto_field::packet_trusted_packet_sequence_id, _details::perfetto_sequence_id
+				);
+				_details::_append_bytes_field(_packet, _details::perfetto_field::packet_track_descriptor, track);
+				_flush_packet();
+			}
+			break;
+		}
+	}
+
+	void trace_writer::_write_event(u32 thread_index, const timestamp &ts) {
+		const u64 time_ns = _to_nanoseconds(ts.time);
+		switch (_format) {
+		case trace_format::chrome_json:
+			{
+				_begin_json_record();
+				_out << (ts.label ? R"({"ph":"B","name":)" : R"({"ph":"E")");
+				if (ts.label) {
+					_details::_write_json_string(_out, reinterpret_cast<const char*>(ts.label));
+				}
+				_out << R"(,"pid":)";
+				_details::_write_integer(_out, _details::trace_process_id);
+				_out << R"(,"tid":)";
+				_details::_write_integer(_out, thread_index);
+				// timestamps are in microseconds
+				_out << R"(,"ts":)";
+				_details::_write_integer(_out, time_ns / 1000);
+				const u64 fraction = time_ns % 1000;
+				const char fraction_digits[] = {
+					'.',
+					static_cast<char>('0' + fraction / 100),
+					static_cast<char>('0' + fraction / 10 % 10),
+					static_cast<char>('0' + fraction % 10)
+				};
+				_out.write(fraction_digits, std::size(fraction_digits));
+				_out << "}";
+			}
+			break;
+		case trace_format::perfetto:
+			_message.clear();
+			_details::_append_varint_field(
+				_message, _details::perfetto_field::track_event_type,
+				ts.label ? _details::perfetto_slice_begin : _details::perfetto_slice_end
+			);
+			_details::_append_varint_field(_message, _details::perfetto_field::track_event_track_uuid, thread_index);
+			if (ts.label) {
+				_details::_append_bytes_field(
+					_message, _details::perfetto_field::track_event_name, reinterpret_cast<const char*>(ts.label)
+				);
+			}
+
+			_packet.clear();
+			_details::_append_varint_field(_packet, _details::perfetto_field::packet_timestamp, time_ns);
+			_details::_append_varint_field(
+				_packet, _details::perfetto_field::packet_trusted_packet_sequence_id, _details::perfetto_sequence_id
+			);
+			_details::_append_bytes_field(_packet, _details::perfetto_field::packet_track_event, _message);
+			_flush_packet();
+			break;
+		}
+		++_num_events;
+	}
+
+	void trace_writer::_begin_json_record() {
+		_out << (_has_json_records ? ",\n" : "\n");
+		_has_json_records = true;
+	}
+
+	void trace_writer::_flush_packet() {
+		// a trace is a sequence of packets, so each packet is written as a separate Trace message
+		std::string header;
+		_details::_append_tag(header, _details::perfetto_field::trace_packet, _details::wire_type::length_delimited);
+		_details::_append_varint(header, _packet.size());
+		_out.write(header.data(), static_cast<std::streamsize>(header.size()));
+		_out.write(_packet.data(), static_cast<std::streamsize>(_packet.size()));
+	}
+
+
+	continuous_trace_capture::continuous_trace_capture(
+		std::filesystem::path directory, trace_format fmt, u64 max_events_per_file, u32 max_num_files
+	) :
+		_directory(std::move(directory)),
+		_format(fmt),
+		_max_events_per_file(max_events_per_file),
+		_max_num_files(max_num_files) {
+
+		std::filesystem::create_directories(_directory);
+		_open_file();
+	}
+
+	void continuous_trace_capture::write(std::span<const thread_samples> threads) {
+		_writer->write(threads);
+		if (_writer->get_num_events() >= _max_events_per_file) {
+			++_file_index;
+			_open_file();
+			if (_max_num_files > 0 && _file_index >= _max_num_files) {
+				std::error_code err;
+				std::filesystem::remove(_get_file_path(_file_index - _max_num_files), err);
+			}
+		}
+	}
+
+	std::filesystem::path continuous_trace_capture::_get_file_path(u32 index) const {
+		char name[16];
+		const auto result = std::to_chars(std::begin(name), std::end(name), index);
+		std::u8string file_name = u8"trace_";
+		file_name.append(std::max<std::ptrdiff_t>(6 - (result.ptr - name), 0), u8'0');
+		file_name.append(reinterpret_cast<const char8_t*>(name), reinterpret_cast<const char8_t*>(result.ptr));
+		file_name.append(get_trace_file_extension(_format));
+		return _directory / file_name;
+	}
+
+	void continuous_trace_capture::_open_file() {
+		if (_writer) {
+			_writer->finish();
+			_writer.reset();
+			_file.close();
+		}
+		_current_path = _get_file_path(_file_index);
+		_file.open(_current_path, std::ios::binary | std::ios::trunc);
+		if (!_file) {
+			log().error("Failed to open trace file {}", _current_path.string());
+		}
+		_writer = std::make_unique<trace_writer>(_file, _format);
+	}
+}
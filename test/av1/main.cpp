@@ -3,8 +3,11 @@
 
 #include <iostream>
 #include <fstream>
+#include <optional>
+#include <vector>
 
 #include "lotus/utils/strings.h"
+#include "lotus/utils/job_system.h"
 
 using namespace lotus::types;
 namespace mpeg = lotus::mpeg;
@@ -22,6 +25,7 @@ using pos_t = std::ios::pos_type;
 using off_t = std::ios::off_type;
 
 av1::decoder av1decoder;
+std::vector<std::byte> file_data; ///< Contents of the entire file, used by the AV1 reader.
 
 void parse_box(std::ifstream &reader, pos_t region_end, u32 depth = 0) {
 	auto read_byte = [&reader]() {
@@ -181,15 +185,11 @@ void parse_box(std::ifstream &reader, pos_t region_end, u32 depth = 0) {
 
 				// decode chunks
 				for (const u32 off : stco.chunk_offsets) {
-					const pos_t bitstream_offset = reader.tellg();
-					reader.seekg(off, std::ios::beg);
-
-					av1::reader av1reader(read_byte);
+					const std::span<const std::byte> chunk_data = std::span(file_data).subspan(off);
+					av1::reader av1reader(chunk_data);
 					for (u32 i = 0; i < 10; ++i) {
 						av1decoder.process_open_bitstream_unit(av1reader, 0);
 					}
-
-					reader.seekg(bitstream_offset, std::ios::beg);
 				}
 			}
 			break;
@@ -209,12 +209,26 @@ int main(int argc, char **argv) {
 		return 1;
 	}
 
+	// tiles are decoded concurrently if a number of threads is given
+	std::optional<lotus::job_system::manager> job_manager;
+	if (argc > 2) {
+		if (const auto num_threads = static_cast<u32>(std::atoi(argv[2])); num_threads > 1) {
+			// the calling thread also participates, so spawn one fewer worker
+			job_manager.emplace(lotus::job_system::manager::spawn_workers(num_threads - 1));
+			av1decoder.job_manager = &job_manager.value();
+		}
+	}
+
 	std::ifstream reader(argv[1], std::ios::binary);
 
 	reader.seekg(0, std::ios::end);
 	const pos_t file_size = reader.tellg();
 	reader.seekg(0, std::ios::beg);
 
+	file_data.resize(static_cast<usize>(file_size));
+	reader.read(reinterpret_cast<char*>(file_data.data()), file_size);
+	reader.seekg(0, std::ios::beg);
+
 	parse_box(reader, file_size);
 
 	return 0;
@@ -0,0 +1,141 @@
+#include <chrono>
+#include <random>
+
+#include "lotus/types.h"
+#include "lotus/collision/algorithms/aabb_tree.h"
+#include "lotus/logging.h"
+
+using namespace lotus;
+using namespace lotus::collision::types;
+
+/// Creates boxes scattered uniformly within a cube.
+[[nodiscard]] std::vector<aab3s> create_uniform_scene(u32 count, std::mt19937 &rng) {
+	const scalar extent = std::cbrt(static_cast<scalar>(count)) * 2.0f;
+	std::uniform_real_distribution<scalar> pos_dist(0.0f, extent);
+	std::uniform_real_distribution<scalar> size_dist(0.2f, 1.5f);
+	std::vector<aab3s> result;
+	for (u32 i = 0; i < count; ++i) {
+		const vec3 center(pos_dist(rng), pos_dist(rng), pos_dist(rng));
+		const vec3 half_size(size_dist(rng), size_dist(rng), size_dist(rng));
+		result.emplace_back(aab3s::create_from_center_half_size(center, half_size * 0.5f));
+	}
+	return result;
+}
+
+/// Creates boxes packed into a few dense clusters, similar to piles of objects.
+[[nodiscard]] std::vector<aab3s> create_clustered_scene(u32 count, std::mt19937 &rng) {
+	const scalar extent = std::cbrt(static_cast<scalar>(count)) * 2.0f;
+	constexpr u32 num_clusters = 16;
+	std::uniform_real_distribution<scalar> pos_dist(0.0f, extent);
+	std::normal_distribution<scalar> offset_dist(0.0f, extent * 0.03f);
+	std::uniform_real_distribution<scalar> size_dist(0.2f, 1.5f);
+	std::vector<vec3> clusters;
+	for (u32 i = 0; i < num_clusters; ++i) {
+		clusters.emplace_back(pos_dist(rng), pos_dist(rng), pos_dist(rng));
+	}
+	std::vector<aab3s> result;
+	for (u32 i = 0; i < count; ++i) {
+		const vec3 center = clusters[i % num_clusters] + vec3(offset_dist(rng), offset_dist(rng), offset_dist(rng));
+		const vec3 half_size(size_dist(rng), size_dist(rng), size_dist(rng));
+		result.emplace_back(aab3s::create_from_center_half_size(center, half_size * 0.5f));
+	}
+	return result;
+}
+
+/// Checks that \ref collision::aabb_soa::intersect() agrees with \ref aab3s::intersects() on random boxes,
+/// including empty and touching ones.
+template <u32 Count> void check_soa_intersection(std::mt19937 &rng) {
+	std::uniform_real_distribution<scalar> pos_dist(-2.0f, 2.0f);
+	const auto random_box = [&]() {
+		// round coordinates so that touching boxes are common
+		const vec3 a(std::round(pos_dist(rng)), std::round(pos_dist(rng)), std::round(pos_dist(rng)));
+		const vec3 b(std::round(pos_dist(rng)), std::round(pos_dist(rng)), std::round(pos_dist(rng)));
+		return aab3s::create_from_min_max(matm::min(a, b), matm::max(a, b));
+	};
+	for (u32 iter = 0; iter < 10000; ++iter) {
+		collision::aabb_soa<Count> boxes;
+		std::array<aab3s, Count> reference;
+		for (u32 i = 0; i < Count; ++i) {
+			reference[i] = iter % 7 == 0 && i == 0 ? aab3s::create_infinity().negated() : random_box();
+			boxes.set(i, reference[i]);
+			crash_if(boxes.get(i) != reference[i]);
+		}
+		const aab3s query = random_box();
+		u32 expected = 0;
+		for (u32 i = 0; i < Count; ++i) {
+			expected |= static_cast<u32>(aab3s::intersects(reference[i], query)) << i;
+		}
+		crash_if(boxes.intersect(query) != expected);
+	}
+}
+
+/// Builds a tree of the given order over the scene, then measures query throughput and checks query results
+/// against brute force.
+template <u32 Order> void benchmark_queries(
+	const char *scene_name, std::span<const aab3s> scene, std::span<const aab3s> queries, bool rebuild
+) {
+	collision::aabb_tree<u32, Order> tree;
+	for (u32 i = 0; i < scene.size(); ++i) {
+		[[maybe_unused]] auto *leaf = tree.insert(scene[i], i);
+	}
+	if (rebuild) {
+		tree.rebuild();
+	}
+
+	// check against brute force for a subset of queries
+	for (usize i = 0; i < std::min<usize>(queries.size(), 64); ++i) {
+		u32 expected = 0;
+		for (const aab3s &bb : scene) {
+			expected += aab3s::intersects(bb, queries[i]) ? 1 : 0;
+		}
+		u32 actual = 0;
+		tree.query_aab(queries[i], [&](const auto*) {
+			++actual;
+		});
+		crash_if(actual != expected);
+	}
+
+	u64 num_hits = 0;
+	const auto begin = std::chrono::high_resolution_clock::now();
+	for (const aab3s &query : queries) {
+		tree.query_aab(query, [&](const auto*) {
+			++num_hits;
+		});
+	}
+	const auto end = std::chrono::high_resolution_clock::now();
+	const f64 seconds = std::chrono::duration<f64>(end - begin).count();
+
+	log().info(
+		"{:>9}, order {}, {:>11}: {} queries/s, {} hits/query, cost {}",
+		scene_name, Order, rebuild ? "rebuilt" : "incremental",
+		static_cast<u64>(static_cast<f64>(queries.size()) / seconds),
+		static_cast<f64>(num_hits) / static_cast<f64>(queries.size()), tree.compute_cost()
+	);
+}
+
+int main(int argc, char **argv) {
+	const u32 num_boxes = argc > 1 ? static_cast<u32>(std::atoi(argv[1])) : 100000;
+	const u32 num_queries = argc > 2 ? static_cast<u32>(std::atoi(argv[2])) : 200000;
+
+	std::mt19937 rng(12345);
+	check_soa_intersection<3>(rng);
+	check_soa_intersection<4>(rng);
+	check_soa_intersection<8>(rng);
+
+	const auto run_scene = [&](const char *name, const std::vector<aab3s> &scene) {
+		// query with boxes taken from the scene itself, so that queries are distributed like the objects are
+		std::uniform_int_distribution<u32> index_dist(0, static_cast<u32>(scene.size() - 1));
+		std::vector<aab3s> queries;
+		for (u32 i = 0; i < num_queries; ++i) {
+			queries.emplace_back(scene[index_dist(rng)]);
+		}
+		for (const bool rebuild : { false, true }) {
+			benchmark_queries<4>(name, scene, queries, rebuild);
+			benchmark_queries<8>(name, scene, queries, rebuild);
+		}
+	};
+	run_scene("uniform", create_uniform_scene(num_boxes, rng));
+	run_scene("clustered", create_clustered_scene(num_boxes, rng));
+
+	return 0;
+}
@@ -0,0 +1,675 @@
+#include <chrono>
+#include <memory>
+#include <random>
+
+#include "lotus/types.h"
+#include "lotus/logging.h"
+#include "lotus/av1/block_decoding.h"
+
+using namespace lotus;
+using namespace lotus::types;
+
+/// A copy of the scalar intra predictors that store edge pixels using 32-bit integers, following the specification
+/// literally.
+struct reference_prediction {
+	u32 above_row_val[257]; ///< \p AboveRow with each element offset by 2.
+	u32 left_col_val[257]; ///< \p LeftCol with each element offset by 2.
+	u16 pred[64][64]; ///< \p pred.
+
+	/// \p AboveRow.
+	[[nodiscard]] u32 &above_row(std::integral auto i) {
+		return above_row_val[i + 2];
+	}
+	/// \p AboveRow.
+	[[nodiscard]] const u32 &above_row(std::integral auto i) const {
+		return above_row_val[i + 2];
+	}
+	/// \p LeftCol.
+	[[nodiscard]] u32 &left_col(std::integral auto i) {
+		return left_col_val[i + 2];
+	}
+	/// \p LeftCol.
+	[[nodiscard]] const u32 &left_col(std::integral auto i) const {
+		return left_col_val[i + 2];
+	}
+
+	/// 7.11.2.2. Basic intra prediction process
+	void predict_intra_basic(u32 w, u32 h);
+	/// 7.11.2.3. Recursive intra prediction process
+	void predict_intra_recursive(const av1::obu::sequence_header&, const av1::obu::mode_info&, u32 w, u32 h);
+	/// 7.11.2.4. Directional intra prediction process
+	void predict_intra_directional(
+		const av1::obu::sequence_header&,
+		const av1::obu::mode_info&,
+		const av1::state::block&,
+		const av1::state::block_decoding&,
+		u32 plane, u32 x, u32 y,
+		bool have_left, bool have_above, av1::prediction_mode mode,
+		u32 w, u32 h, u32 max_x, u32 max_y
+	);
+	/// 7.11.2.5. DC intra prediction process
+	void predict_intra_dc(
+		const av1::obu::sequence_header&, bool have_left, bool have_above, u32 log2w, u32 log2h, u32 w, u32 h
+	);
+	/// 7.11.2.6. Smooth intra prediction process
+	void predict_intra_smooth(av1::prediction_mode mode, u32 log2w, u32 log2h, u32 w, u32 h);
+
+	/// 7.11.2.7. Filter corner process
+	[[nodiscard]] u32 filter_corner() const {
+		const u32 s = left_col(0) * 5 + above_row(-1) * 6 + above_row(0) * 5;
+		return av1::functions::round2(s, 4);
+	}
+
+	/// 7.11.2.11. Intra edge upsample process
+	void intra_edge_upsample(const av1::obu::color_config&, u32 num_px, bool dir);
+	/// 7.11.2.12. Intra edge filter process
+	void intra_edge_filter(u32 sz, u32 strength, bool left);
+};
+
+void reference_prediction::predict_intra_basic(u32 w, u32 h) {
+	for (u32 i = 0; i < h; ++i) {
+		for (u32 j = 0; j < w; ++j) {
+			const i32 base = static_cast<i32>(above_row(j) + left_col(i)) - static_cast<i32>(above_row(-1));
+			const i32 p_left = std::abs(base - static_cast<i32>(left_col(i)));
+			const i32 p_top = std::abs(base - static_cast<i32>(above_row(j)));
+			const i32 p_top_left = std::abs(base - static_cast<i32>(above_row(-1)));
+			if (p_left <= p_top && p_left <= p_top_left) {
+				pred[i][j] = static_cast<u16>(left_col(i));
+			} else if (p_top <= p_top_left) {
+				pred[i][j] = static_cast<u16>(above_row(j));
+			} else {
+				pred[i][j] = static_cast<u16>(above_row(-1));
+			}
+		}
+	}
+}
+
+void reference_prediction::predict_intra_recursive(
+	const av1::obu::sequence_header &seq_header,
+	const av1::obu::mode_info &mode_info,
+	u32 w, u32 h
+) {
+	const u32 w4 = w >> 2;
+	const u32 h2 = h >> 1;
+	for (u32 i2 = 0; i2 < h2; ++i2) {
+		for (u32 j4 = 0; j4 < w4; ++j4) {
+			std::array<u32, 7> p;
+			for (u32 i = 0; i < 7; ++i) {
+				if (i < 5) {
+					if (i2 == 0) {
+						p[i] = above_row((j4 << 2) + i - 1);
+					} else if (j4 == 0 && i == 0) {
+						p[i] = left_col((i2 << 1) - 1);
+					} else {
+						p[i] = pred[(i2 << 1) - 1][(j4 << 2) + i - 1];
+					}
+				} else {
+					if (j4 == 0) {
+						p[i] = left_col((i2 << 1) + i - 5);
+					} else {
+						p[i] = pred[(i2 << 1) + i - 5][(j4 << 2) - 1];
+					}
+				}
+			}
+			for (u32 i1 = 0; i1 < 2; ++i1) {
+				for (u32 j1 = 0; j1 < 4; ++j1) {
+					i32 pr = 0;
+					for (u32 i = 0; i < 7; ++i) {
+						const u32 filter_intra_mode = std::to_underlying(mode_info.filter_intra_mode);
+						pr +=
+							av1::constants::intra_filter_taps[filter_intra_mode][(i1 << 2) + j1][i] *
+							static_cast<i32>(p[i]);
+					}
+					pred[(i2 << 1) + i1][(j4 << 2) + j1] = av1::functions::clip1(
+						seq_header.color_config,
+						av1::functions::round2_signed(pr, av1::constants::intra_filter_scale_bits)
+					);
+				}
+			}
+		}
+	}
+}
+
+void reference_prediction::predict_intra_directional(
+	const av1::obu::sequence_header &seq_header,
+	const av1::obu::mode_info &mode_info,
+	const av1::state::block &sb,
+	const av1::state::block_decoding &sbd,
+	u32 plane, u32 x, u32 y,
+	bool have_left, bool have_above, av1::prediction_mode mode,
+	u32 w, u32 h, u32 max_x, u32 max_y
+) {
+	// 1.
+	const i32 angle_delta = plane == 0 ? mode_info.angle_delta_y : mode_info.angle_delta_uv;
+	// 2.
+	const i32 p_angle =
+		static_cast<i32>(av1::constants::mode_to_angle[std::to_underlying(mode)]) +
+		angle_delta * static_cast<i32>(av1::constants::angle_step);
+	// 3.
+	i32 upsample_above = 0;
+	i32 upsample_left = 0;
+	// 4.
+	if (seq_header.enable_intra_edge_filter) {
+		const bool filter_type = av1::functions::get_filter_type(seq_header, sb, sbd, plane);
+		if (p_angle != 90 && p_angle != 180) {
+			if (p_angle > 90 && p_angle < 180 && w + h >= 24) {
+				left_col(-1) = above_row(-1) = filter_corner();
+			}
+			if (have_above) {
+				const u32 strength =
+					av1::block_decoding::select_intra_edge_filter_strength(w, h, filter_type, p_angle - 90);
+				const u32 num_px = std::min(w, max_x - x + 1) + (p_angle < 90 ? h : 0) + 1;
+				intra_edge_filter(num_px, strength, false);
+			}
+			if (have_left) {
+				const u32 strength =
+					av1::block_decoding::select_intra_edge_filter_strength(w, h, filter_type, p_angle - 180);
+				const u32 num_px = std::min(h, max_y - y + 1) + (p_angle > 180 ? w : 0) + 1;
+				intra_edge_filter(num_px, strength, true);
+			}
+		}
+		upsample_above = av1::block_decoding::select_intra_edge_upsample(w, h, filter_type, p_angle - 90) ? 1 : 0;
+		if (upsample_above) {
+			const u32 num_px = w + (p_angle < 90 ? h : 0);
+			intra_edge_upsample(seq_header.color_config, num_px, false);
+		}
+		upsample_left = av1::block_decoding::select_intra_edge_upsample(w, h, filter_type, p_angle - 180) ? 1 : 0;
+		if (upsample_left) {
+			const u32 num_px = h + (p_angle > 180 ? w : 0);
+			intra_edge_upsample(seq_header.color_config, num_px, true);
+		}
+	}
+	// 5.
+	const u32 dx =
+		p_angle < 90 ?
+		av1::constants::dr_intra_derivative[p_angle] :
+		(p_angle > 90 && p_angle < 180 ? av1::constants::dr_intra_derivative[180 - p_angle] : 0);
+	// 6.
+	const u32 dy =
+		p_angle > 90 && p_angle < 180 ?
+		av1::constants::dr_intra_derivative[p_angle - 90] :
+		(p_angle > 180 ? av1::constants::dr_intra_derivative[270 - p_angle] : 0);
+	// 7.
+	if (p_angle < 90) {
+		const u32 max_base_x = (w + h - 1) << upsample_above;
+		for (u32 i = 0; i < h; ++i) {
+			const u32 idx = (i + 1) * dx;
+			const u32 shift = ((idx << upsample_above) >> 1) & 0x1F;
+			for (u32 j = 0; j < w; ++j) {
+				const u32 base = (idx >> (6 - upsample_above)) + (j << upsample_above);
+				if (base < max_base_x) {
+					pred[i][j] = static_cast<u16>(av1::functions::round2(
+						above_row(base) * (32 - shift) + above_row(base + 1) * shift, 5
+					));
+				} else {
+					pred[i][j] = static_cast<u16>(above_row(max_base_x));
+				}
+			}
+		}
+	}
+	// 8.
+	if (p_angle > 90 && p_angle < 180) {
+		for (u32 i = 0; i < h; ++i) {
+			for (u32 j = 0; j < w; ++j) {
+				i32 idx = static_cast<i32>(j << 6) - static_cast<i32>((i + 1) * dx);
+				i32 base = idx >> (6 - upsample_above);
+				if (base >= -(1 << upsample_above)) {
+					const auto shift = static_cast<u32>(((idx << upsample_above) >> 1) & 0x1F);
+					pred[i][j] = static_cast<u16>(av1::functions::round2(
+						above_row(base) * (32 - shift) + above_row(base + 1) * shift, 5
+					));
+				} else {
+					idx = static_cast<i32>(i << 6) - static_cast<i32>((j + 1) * dy);
+					base = idx >> (6 - upsample_left);
+					const auto shift = static_cast<u32>(((idx << upsample_left) >> 1) & 0x1F);
+					pred[i][j] = static_cast<u16>(av1::functions::round2(
+						left_col(base) * (32 - shift) + left_col(base + 1) * shift, 5
+					));
+				}
+			}
+		}
+	}
+	// 9.
+	if (p_angle > 180) {
+		for (u32 i = 0; i < h; ++i) {
+			for (u32 j = 0; j < w; ++j) {
+				const u32 idx = (j + 1) * dy;
+				const u32 base = (idx >> (6 - upsample_left)) + (i << upsample_left);
+				const u32 shift = ((idx << upsample_left) >> 1) & 0x1F;
+				pred[i][j] = static_cast<u16>(av1::functions::round2(
+					left_col(base) * (32 - shift) + left_col(base + 1) * shift, 5
+				));
+			}
+		}
+	}
+	// 10.
+	if (p_angle == 90) {
+		for (u32 i = 0; i < h; ++i) {
+			for (u32 j = 0; j < w; ++j) {
+				pred[i][j] = static_cast<u16>(above_row(j));
+			}
+		}
+	}
+	// 11.
+	if (p_angle == 180) {
+		for (u32 i = 0; i < h; ++i) {
+			for (u32 j = 0; j < w; ++j) {
+				pred[i][j] = static_cast<u16>(left_col(i));
+			}
+		}
+	}
+}
+
+void reference_prediction::predict_intra_dc(
+	const av1::obu::sequence_header &seq_header,
+	bool have_left, bool have_above, u32 log2w, u32 log2h, u32 w, u32 h
+) {
+	u32 avg;
+	if (have_left && have_above) {
+		u32 sum = 0;
+		for (u32 k = 0; k < h; ++k) {
+			sum += left_col(k);
+		}
+		for (u32 k = 0; k < w; ++k) {
+			sum += above_row(k);
+		}
+		sum += (w + h) >> 1;
+		avg = sum / (w + h);
+	} else if (have_left) {
+		u32 sum = 0;
+		for (u32 k = 0; k < h; ++k) {
+			sum += left_col(k);
+		}
+		avg = av1::functions::clip1(seq_header.color_config, (sum + (h >> 1)) >> log2h);
+	} else if (have_above) {
+		u32 sum = 0;
+		for (u32 k = 0; k < w; ++k) {
+			sum += above_row(k);
+		}
+		avg = av1::functions::clip1(seq_header.color_config, (sum + (w >> 1)) >> log2w);
+	} else {
+		avg = 1 << (seq_header.color_config.bit_depth - 1);
+	}
+	for (u32 i = 0; i < h; ++i) {
+		for (u32 j = 0; j < w; ++j) {
+			pred[i][j] = static_cast<u16>(avg);
+		}
+	}
+}
+
+void reference_prediction::predict_intra_smooth(av1::prediction_mode mode, u32 log2w, u32 log2h, u32 w, u32 h) {
+	const auto get_weights_lut = [](u32 log2s) -> std::span<const u8> {
+		switch (log2s) {
+		case 2: return av1::constants::sm_weights_tx_4x4;
+		case 3: return av1::constants::sm_weights_tx_8x8;
+		case 4: return av1::constants::sm_weights_tx_16x16;
+		case 5: return av1::constants::sm_weights_tx_32x32;
+		case 6: return av1::constants::sm_weights_tx_64x64;
+		default: return {};
+		}
+	};
+
+	const std::span<const u8> sm_weights_x = get_weights_lut(log2w);
+	const std::span<const u8> sm_weights_y = get_weights_lut(log2h);
+	if (mode == av1::prediction_mode::smooth) {
+		for (u32 i = 0; i < h; ++i) {
+			for (u32 j = 0; j < w; ++j) {
+				const u32 smooth_pred =
+					sm_weights_y[i] * above_row(j) + (256 - sm_weights_y[i]) * left_col(h - 1) +
+					sm_weights_x[j] * left_col(i)  + (256 - sm_weights_x[j]) * above_row(w - 1);
+				pred[i][j] = static_cast<u16>(av1::functions::round2(smooth_pred, 9));
+			}
+		}
+	} else if (mode == av1::prediction_mode::smooth_v) {
+		for (u32 i = 0; i < h; ++i) {
+			for (u32 j = 0; j < w; ++j) {
+				const u32 smooth_pred =
+					sm_weights_y[i] * above_row(j) + (256 - sm_weights_y[i]) * left_col(h - 1);
+				pred[i][j] = static_cast<u16>(av1::functions::round2(smooth_pred, 8));
+			}
+		}
+	} else {
+		crash_if(mode != av1::prediction_mode::smooth_h);
+		for (u32 i = 0; i < h; ++i) {
+			for (u32 j = 0; j < w; ++j) {
+				const u32 smooth_pred =
+					sm_weights_x[j] * left_col(i) + (256 - sm_weights_x[j]) * above_row(w - 1);
+				pred[i][j] = static_cast<u16>(av1::functions::round2(smooth_pred, 8));
+			}
+		}
+	}
+}
+
+void reference_prediction::intra_edge_upsample(const av1::obu::color_config &color_config, u32 num_px, bool dir) {
+	u32 *buf = dir ? &left_col(0) : &above_row(0);
+
+	// create array dup
+	std::array<u32, 67> dup;
+	dup[0] = buf[-1];
+	for (i32 i = -1; i < static_cast<i32>(num_px); ++i) {
+		dup[static_cast<usize>(i + 2)] = buf[i];
+	}
+	dup[num_px + 2] = buf[num_px - 1];
+
+	// upsample
+	buf[-2] = dup[0];
+	for (u32 i = 0; i < num_px; ++i) {
+		i32 s =
+			-static_cast<i32>(dup[i]) +
+			9 * static_cast<i32>(dup[i + 1]) +
+			9 * static_cast<i32>(dup[i + 2]) -
+			static_cast<i32>(dup[i + 3]);
+		s = av1::functions::clip1(color_config, av1::functions::round2(s, 4));
+		buf[static_cast<i32>(2 * i) - 1] = static_cast<u32>(s);
+		buf[2 * i] = dup[i + 2];
+	}
+}
+
+void reference_prediction::intra_edge_filter(u32 sz, u32 strength, bool left) {
+	if (strength == 0) {
+		return;
+	}
+	std::array<u32, 129> edge;
+	for (i32 i = 0; i < static_cast<i32>(sz); ++i) {
+		edge[static_cast<usize>(i)] = left ? left_col(i - 1) : above_row(i - 1);
+	}
+	for (i32 i = 1; i < static_cast<i32>(sz); ++i) {
+		u32 s = 0;
+		for (u32 j = 0; j < av1::constants::intra_edge_taps; ++j) {
+			const i32 k = std::clamp(i - 2 + static_cast<i32>(j), 0, static_cast<i32>(sz) - 1);
+			s += av1::constants::intra_edge_kernel[strength - 1][j] * edge[static_cast<usize>(k)];
+		}
+		(left ? left_col(i - 1) : above_row(i - 1)) = (s + 8) >> 4;
+	}
+}
+
+void reference_predict_palette(
+	const av1::obu::mode_info &mode_info,
+	av1::state::block &sb,
+	const av1::state::color_map &scm,
+	u32 plane, u32 start_x, u32 start_y, u32 x, u32 y, av1::tx_size tx_sz
+) {
+	const u32 w = av1::constants::get_tx_width(tx_sz);
+	const u32 h = av1::constants::get_tx_height(tx_sz);
+	std::span<const av1::channel_t> palette;
+	if (plane == 0) {
+		palette = mode_info.palette_colors_y;
+	} else if (plane == 1) {
+		palette = mode_info.palette_colors_u;
+	} else {
+		crash_if(plane != 2);
+		palette = mode_info.palette_colors_v;
+	}
+	const av1::state::color_map::channel &map = plane == 0 ? scm.color_map_y : scm.color_map_uv;
+	for (u32 i = 0; i < h; ++i) {
+		for (u32 j = 0; j < w; ++j) {
+			sb.curr_frame[plane](start_y + i, start_x + j) = palette[map[y * 4 + i][x * 4 + j]];
+		}
+	}
+}
+/// Edge pixels of a block.
+struct edges {
+	std::array<u16, 257> above_row; ///< \p AboveRow, offset by 2.
+	std::array<u16, 257> left_col; ///< \p LeftCol, offset by 2.
+
+	/// Creates random edges.
+	[[nodiscard]] static edges random(std::mt19937 &rng, u32 bit_depth) {
+		edges result;
+		for (u32 i = 0; i < 257; ++i) {
+			result.above_row[i] = static_cast<u16>(rng() & ((1u << bit_depth) - 1));
+			result.left_col[i] = static_cast<u16>(rng() & ((1u << bit_depth) - 1));
+		}
+		return result;
+	}
+
+	/// Copies the edges into both predictions.
+	void apply(reference_prediction &ref, av1::block_decoding::prediction &p) const {
+		std::copy(above_row.begin(), above_row.end(), ref.above_row_val);
+		std::copy(left_col.begin(), left_col.end(), ref.left_col_val);
+		std::copy(above_row.begin(), above_row.end(), p.above_row_val);
+		std::copy(left_col.begin(), left_col.end(), p.left_col_val);
+	}
+};
+
+/// Checks that the predicted blocks are identical.
+void check_prediction(const reference_prediction &ref, const av1::block_decoding::prediction &p, u32 w, u32 h) {
+	for (u32 i = 0; i < h; ++i) {
+		crash_if(!std::equal(ref.pred[i], ref.pred[i] + w, p.pred[i]));
+	}
+}
+
+/// All block sizes that intra prediction can be performed on, as log2 of the width and height.
+[[nodiscard]] std::vector<std::pair<u32, u32>> get_block_sizes() {
+	std::vector<std::pair<u32, u32>> result;
+	for (u32 log2w = 2; log2w <= 6; ++log2w) {
+		for (u32 log2h = 2; log2h <= 6; ++log2h) {
+			if (log2w <= log2h + 2 && log2h <= log2w + 2) {
+				result.emplace_back(log2w, log2h);
+			}
+		}
+	}
+	return result;
+}
+
+/// Runs the given function the given number of times, and returns the time per run in nanoseconds.
+template <typename Func> [[nodiscard]] f64 time_runs(u32 num_runs, Func &&func) {
+	const auto begin = std::chrono::high_resolution_clock::now();
+	for (u32 i = 0; i < num_runs; ++i) {
+		func();
+	}
+	const auto end = std::chrono::high_resolution_clock::now();
+	return std::chrono::duration<f64, std::nano>(end - begin).count() / num_runs;
+}
+
+int main(int argc, char **argv) {
+	const u32 num_runs = argc > 1 ? static_cast<u32>(std::atoi(argv[1])) : 200;
+
+	const std::vector<std::pair<u32, u32>> block_sizes = get_block_sizes();
+	auto seq_header = std::make_unique<av1::obu::sequence_header>(zero);
+	auto mode_info = std::make_unique<av1::obu::mode_info>(zero);
+	auto sb = std::make_unique<av1::state::block>(zero);
+	auto reference_sb = std::make_unique<av1::state::block>(zero);
+	const auto sbd = std::make_unique<av1::state::block_decoding>(zero);
+	auto ref = std::make_unique<reference_prediction>();
+	auto p = std::make_unique<av1::block_decoding::prediction>(uninitialized);
+
+	{ // conformance with the scalar predictors
+		std::mt19937 rng(12345);
+		u64 num_blocks = 0;
+		for (const u8 bit_depth : { u8(8), u8(10), u8(12) }) {
+			seq_header->color_config.bit_depth = bit_depth;
+			for (const auto &[log2w, log2h] : block_sizes) {
+				const u32 w = 1u << log2w;
+				const u32 h = 1u << log2h;
+				for (u32 trial = 0; trial < 4; ++trial) {
+					const edges e = edges::random(rng, bit_depth);
+
+					e.apply(*ref, *p);
+					ref->predict_intra_basic(w, h);
+					p->predict_intra_basic(w, h);
+					check_prediction(*ref, *p, w, h);
+					++num_blocks;
+
+					for (const auto mode : {
+						av1::prediction_mode::smooth, av1::prediction_mode::smooth_v, av1::prediction_mode::smooth_h
+					}) {
+						ref->predict_intra_smooth(mode, log2w, log2h, w, h);
+						p->predict_intra_smooth(mode, log2w, log2h, w, h);
+						check_prediction(*ref, *p, w, h);
+						++num_blocks;
+					}
+
+					for (u32 avail = 0; avail < 4; ++avail) {
+						const bool have_left = avail & 1;
+						const bool have_above = avail & 2;
+						ref->predict_intra_dc(*seq_header, have_left, have_above, log2w, log2h, w, h);
+						p->predict_intra_dc(*seq_header, have_left, have_above, log2w, log2h, w, h);
+						check_prediction(*ref, *p, w, h);
+						++num_blocks;
+					}
+
+					if (w <= 32 && h <= 32) {
+						for (u32 mode = 0; mode < av1::constants::intra_filter_modes; ++mode) {
+							mode_info->filter_intra_mode = static_cast<av1::intra_filtering>(mode);
+							ref->predict_intra_recursive(*seq_header, *mode_info, w, h);
+							p->predict_intra_recursive(*seq_header, *mode_info, w, h);
+							check_prediction(*ref, *p, w, h);
+							++num_blocks;
+						}
+					}
+
+					// directional prediction may filter the edges in place, so they are reset before each block
+					const u32 first_directional_mode = std::to_underlying(av1::prediction_mode::v);
+					const u32 last_directional_mode = std::to_underlying(av1::prediction_mode::d67);
+					for (u32 mode = first_directional_mode; mode <= last_directional_mode; ++mode) {
+						for (i8 angle_delta = -3; angle_delta <= 3; ++angle_delta) {
+							mode_info->angle_delta_y = angle_delta;
+							for (u32 flags = 0; flags < 8; ++flags) {
+								const bool have_left = flags & 1;
+								const bool have_above = flags & 2;
+								seq_header->enable_intra_edge_filter = flags & 4;
+								const u32 x = 64;
+								const u32 y = 64;
+								const u32 max_x = x + static_cast<u32>(rng() % (2 * w));
+								const u32 max_y = y + static_cast<u32>(rng() % (2 * h));
+								e.apply(*ref, *p);
+								ref->predict_intra_directional(
+									*seq_header, *mode_info, *sb, *sbd, 0, x, y, have_left, have_above,
+									static_cast<av1::prediction_mode>(mode), w, h, max_x, max_y
+								);
+								p->predict_intra_directional(
+									*seq_header, *mode_info, *sb, *sbd, 0, x, y, have_left, have_above,
+									static_cast<av1::prediction_mode>(mode), w, h, max_x, max_y
+								);
+								check_prediction(*ref, *p, w, h);
+								++num_blocks;
+							}
+						}
+					}
+				}
+			}
+		}
+		mode_info->angle_delta_y = 0;
+		seq_header->enable_intra_edge_filter = false;
+
+		// palette prediction
+		for (u32 plane = 0; plane < 3; ++plane) {
+			sb->curr_frame[plane] = av1::state::grid2<u16>::allocate(64, 64, 0);
+			reference_sb->curr_frame[plane] = av1::state::grid2<u16>::allocate(64, 64, 0);
+		}
+		auto color_map = std::make_unique<av1::state::color_map>(uninitialized);
+		for (u32 size = 0; size < 19; ++size) {
+			const auto tx_sz = static_cast<av1::tx_size>(size);
+			for (u32 trial = 0; trial < 16; ++trial) {
+				mode_info->palette_size_y = static_cast<u8>(2 + rng() % 7);
+				mode_info->palette_size_uv = static_cast<u8>(2 + rng() % 7);
+				for (u32 c = 0; c < av1::constants::palette_colors; ++c) {
+					mode_info->palette_colors_y[c] = static_cast<u16>(rng() & 0xFFF);
+					mode_info->palette_colors_u[c] = static_cast<u16>(rng() & 0xFFF);
+					mode_info->palette_colors_v[c] = static_cast<u16>(rng() & 0xFFF);
+				}
+				for (u32 i = 0; i < 64; ++i) {
+					for (u32 j = 0; j < 64; ++j) {
+						color_map->color_map_y[i][j] = static_cast<u32>(rng() % mode_info->palette_size_y);
+						color_map->color_map_uv[i][j] = static_cast<u32>(rng() % mode_info->palette_size_uv);
+					}
+				}
+				for (u32 plane = 0; plane < 3; ++plane) {
+					reference_predict_palette(*mode_info, *reference_sb, *color_map, plane, 0, 0, 0, 0, tx_sz);
+					av1::block_decoding::predict_palette(*mode_info, *sb, *color_map, plane, 0, 0, 0, 0, tx_sz);
+					for (u32 i = 0; i < av1::constants::get_tx_height(tx_sz); ++i) {
+						for (u32 j = 0; j < av1::constants::get_tx_width(tx_sz); ++j) {
+							crash_if(reference_sb->curr_frame[plane](i, j) != sb->curr_frame[plane](i, j));
+						}
+					}
+					++num_blocks;
+				}
+			}
+		}
+		log().info("Conformance: {} blocks checked", num_blocks);
+	}
+
+	{ // throughput
+		std::mt19937 rng(54321);
+		seq_header->color_config.bit_depth = 8;
+		const edges e = edges::random(rng, 8);
+		e.apply(*ref, *p);
+		// blocks larger than the given size are skipped
+		const auto report = [&](const char *name, u32 max_log2_size, auto &&predict_reference, auto &&predict) {
+			f64 reference_ns = 0.0;
+			f64 ns = 0.0;
+			u32 num_sizes = 0;
+			for (const auto &[log2w, log2h] : block_sizes) {
+				if (log2w > max_log2_size || log2h > max_log2_size) {
+					continue;
+				}
+				const u32 w = 1u << log2w;
+				const u32 h = 1u << log2h;
+				reference_ns += time_runs(num_runs, [&]() {
+					predict_reference(log2w, log2h, w, h);
+				});
+				ns += time_runs(num_runs, [&]() {
+					predict(log2w, log2h, w, h);
+				});
+				++num_sizes;
+			}
+			log().info(
+				"{}: reference {} ns, prediction {} ns per block on average, {}x",
+				name, reference_ns / num_sizes, ns / num_sizes, reference_ns / ns
+			);
+		};
+		report("DC", 6,
+			[&](u32 log2w, u32 log2h, u32 w, u32 h) {
+				ref->predict_intra_dc(*seq_header, true, true, log2w, log2h, w, h);
+			},
+			[&](u32 log2w, u32 log2h, u32 w, u32 h) {
+				p->predict_intra_dc(*seq_header, true, true, log2w, log2h, w, h);
+			}
+		);
+		report("Smooth", 6,
+			[&](u32 log2w, u32 log2h, u32 w, u32 h) {
+				ref->predict_intra_smooth(av1::prediction_mode::smooth, log2w, log2h, w, h);
+			},
+			[&](u32 log2w, u32 log2h, u32 w, u32 h) {
+				p->predict_intra_smooth(av1::prediction_mode::smooth, log2w, log2h, w, h);
+			}
+		);
+		report("Paeth", 6,
+			[&](u32, u32, u32 w, u32 h) {
+				ref->predict_intra_basic(w, h);
+			},
+			[&](u32, u32, u32 w, u32 h) {
+				p->predict_intra_basic(w, h);
+			}
+		);
+		report("Recursive", 5,
+			[&](u32, u32, u32 w, u32 h) {
+				ref->predict_intra_recursive(*seq_header, *mode_info, w, h);
+			},
+			[&](u32, u32, u32 w, u32 h) {
+				p->predict_intra_recursive(*seq_header, *mode_info, w, h);
+			}
+		);
+		// edge filtering is disabled, so the edges are not modified
+		for (const auto &[name, mode] : {
+			std::pair("D45", av1::prediction_mode::d45),
+			std::pair("D135", av1::prediction_mode::d135),
+			std::pair("D203", av1::prediction_mode::d203),
+		}) {
+			report(name, 6,
+				[&](u32, u32, u32 w, u32 h) {
+					ref->predict_intra_directional(
+						*seq_header, *mode_info, *sb, *sbd, 0, 0, 0, true, true, mode, w, h, 4096, 4096
+					);
+				},
+				[&](u32, u32, u32 w, u32 h) {
+					p->predict_intra_directional(
+						*seq_header, *mode_info, *sb, *sbd, 0, 0, 0, true, true, mode, w, h, 4096, 4096
+					);
+				}
+			);
+		}
+	}
+
+	return 0;
+}
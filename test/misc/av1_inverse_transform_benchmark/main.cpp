@@ -0,0 +1,238 @@
+#include <chrono>
+#include <memory>
+#include <random>
+
+#include "lotus/types.h"
+#include "lotus/logging.h"
+#include "lotus/av1/block_decoding.h"
+
+using namespace lotus;
+using namespace lotus::types;
+
+/// Straightforward implementation of the 2D inverse transform that follows the specification literally, transforming
+/// one row or column at a time.
+void reference_inverse_transform_2d(
+	const av1::obu::sequence_header &seq_header,
+	const av1::state::block &sb,
+	av1::state::coeffs &sc,
+	av1::tx_size tx_sz
+) {
+	using av1::inverse_transform;
+
+	const u32 log2w = av1::constants::get_tx_width_log2(tx_sz);
+	const u32 log2h = av1::constants::get_tx_height_log2(tx_sz);
+	const u32 w = 1u << log2w;
+	const u32 h = 1u << log2h;
+	const u32 row_shift = av1::constants::transform_row_shift[std::to_underlying(tx_sz)];
+	const u32 col_shift = 4;
+	const u32 row_clamp_range = seq_header.color_config.bit_depth + 8;
+	const u32 col_clamp_range = std::max(seq_header.color_config.bit_depth + 6u, 16u);
+
+	for (u32 i = 0; i < h; ++i) {
+		av1::block_decoding::inverse_transform_1d t = uninitialized;
+		for (u32 j = 0; j < w; ++j) {
+			t.t[j] = i < 32 && j < 32 ? sc.dequant[i][j] : 0;
+		}
+		if (std::abs(static_cast<i32>(log2w) - static_cast<i32>(log2h)) == 1) {
+			for (u32 j = 0; j < w; ++j) {
+				t.t[j] = av1::functions::round2(t.t[j] * 2896, 12);
+			}
+		}
+		switch (sb.plane_tx_type) {
+		case inverse_transform::dct_dct:      [[fallthrough]];
+		case inverse_transform::adst_dct:     [[fallthrough]];
+		case inverse_transform::flipadst_dct: [[fallthrough]];
+		case inverse_transform::h_dct:
+			t.inverse_dct(log2w, row_clamp_range);
+			break;
+		case inverse_transform::dct_adst:          [[fallthrough]];
+		case inverse_transform::adst_adst:         [[fallthrough]];
+		case inverse_transform::dct_flipadst:      [[fallthrough]];
+		case inverse_transform::flipadst_flipadst: [[fallthrough]];
+		case inverse_transform::adst_flipadst:     [[fallthrough]];
+		case inverse_transform::flipadst_adst:     [[fallthrough]];
+		case inverse_transform::h_adst:            [[fallthrough]];
+		case inverse_transform::h_flipadst:
+			t.inverse_adst(log2w, row_clamp_range);
+			break;
+		default:
+			t.inverse_idtx(log2w);
+			break;
+		}
+		for (u32 j = 0; j < w; ++j) {
+			sc.residual[i][j] = std::clamp(
+				av1::functions::round2(t.t[j], row_shift),
+				-(1 << (col_clamp_range - 1)),
+				(1 << (col_clamp_range - 1)) - 1
+			);
+		}
+	}
+
+	for (u32 j = 0; j < w; ++j) {
+		av1::block_decoding::inverse_transform_1d t = uninitialized;
+		for (u32 i = 0; i < h; ++i) {
+			t.t[i] = sc.residual[i][j];
+		}
+		switch (sb.plane_tx_type) {
+		case inverse_transform::dct_dct:      [[fallthrough]];
+		case inverse_transform::dct_adst:     [[fallthrough]];
+		case inverse_transform::dct_flipadst: [[fallthrough]];
+		case inverse_transform::v_dct:
+			t.inverse_dct(log2h, col_clamp_range);
+			break;
+		case inverse_transform::adst_dct:          [[fallthrough]];
+		case inverse_transform::adst_adst:         [[fallthrough]];
+		case inverse_transform::flipadst_dct:      [[fallthrough]];
+		case inverse_transform::flipadst_flipadst: [[fallthrough]];
+		case inverse_transform::adst_flipadst:     [[fallthrough]];
+		case inverse_transform::flipadst_adst:     [[fallthrough]];
+		case inverse_transform::v_adst:            [[fallthrough]];
+		case inverse_transform::v_flipadst:
+			t.inverse_adst(log2h, col_clamp_range);
+			break;
+		default:
+			t.inverse_idtx(log2h);
+			break;
+		}
+		for (u32 i = 0; i < h; ++i) {
+			sc.residual[i][j] = av1::functions::round2(t.t[i], col_shift);
+		}
+	}
+}
+
+/// Returns whether the given 1D transform type is defined for the given size.
+[[nodiscard]] bool is_1d_transform_valid(bool dct, bool adst, u32 log2_size) {
+	if (dct) {
+		return true;
+	}
+	if (adst) {
+		return log2_size <= 4;
+	}
+	return log2_size <= 5;
+}
+/// Returns whether the given transform type can be used with the given transform size.
+[[nodiscard]] bool is_transform_valid(av1::inverse_transform type, av1::tx_size tx_sz) {
+	using av1::inverse_transform;
+
+	const u32 log2w = av1::constants::get_tx_width_log2(tx_sz);
+	const u32 log2h = av1::constants::get_tx_height_log2(tx_sz);
+	const bool row_dct =
+		type == inverse_transform::dct_dct || type == inverse_transform::adst_dct ||
+		type == inverse_transform::flipadst_dct || type == inverse_transform::h_dct;
+	const bool row_identity =
+		type == inverse_transform::idtx || type == inverse_transform::v_dct ||
+		type == inverse_transform::v_adst || type == inverse_transform::v_flipadst;
+	const bool col_dct =
+		type == inverse_transform::dct_dct || type == inverse_transform::dct_adst ||
+		type == inverse_transform::dct_flipadst || type == inverse_transform::v_dct;
+	const bool col_identity =
+		type == inverse_transform::idtx || type == inverse_transform::h_dct ||
+		type == inverse_transform::h_adst || type == inverse_transform::h_flipadst;
+	return
+		is_1d_transform_valid(row_dct, !row_dct && !row_identity, log2w) &&
+		is_1d_transform_valid(col_dct, !col_dct && !col_identity, log2h);
+}
+
+/// Fills the top left 32x32 dequantized coefficients with random values. Most coefficients are zero, and the
+/// nonzero ones are concentrated in the low frequencies, similar to real content.
+void randomize_coefficients(std::mt19937 &rng, av1::state::coeffs &sc, u32 bit_depth) {
+	const i32 max_magnitude = 1 << bit_depth;
+	for (u32 i = 0; i < 32; ++i) {
+		for (u32 j = 0; j < 32; ++j) {
+			const bool nonzero = rng() % (1 + i + j) < 2;
+			sc.dequant[i][j] = nonzero ? static_cast<i32>(rng() % (2 * max_magnitude + 1)) - max_magnitude : 0;
+		}
+	}
+}
+
+/// Runs the given function the given number of times, and returns the time per run in nanoseconds.
+template <typename Func> [[nodiscard]] f64 time_runs(u32 num_runs, Func &&func) {
+	const auto begin = std::chrono::high_resolution_clock::now();
+	for (u32 i = 0; i < num_runs; ++i) {
+		func();
+	}
+	const auto end = std::chrono::high_resolution_clock::now();
+	return std::chrono::duration<f64, std::nano>(end - begin).count() / num_runs;
+}
+
+int main(int argc, char **argv) {
+	const u32 num_runs = argc > 1 ? static_cast<u32>(std::atoi(argv[1])) : 2000;
+
+	constexpr u32 num_tx_sizes = 19;
+	constexpr u32 num_tx_types = 16;
+
+	auto seq_header = std::make_unique<av1::obu::sequence_header>(zero);
+	const av1::obu::mode_info mode_info = zero;
+	auto sb = std::make_unique<av1::state::block>(zero);
+	auto reference_coeffs = std::make_unique<av1::state::coeffs>(zero);
+	auto coeffs = std::make_unique<av1::state::coeffs>(zero);
+
+	{ // bit-exactness
+		std::mt19937 rng(12345);
+		u64 num_transforms = 0;
+		for (const u8 bit_depth : { u8(8), u8(10), u8(12) }) {
+			seq_header->color_config.bit_depth = bit_depth;
+			for (u32 size = 0; size < num_tx_sizes; ++size) {
+				const auto tx_sz = static_cast<av1::tx_size>(size);
+				for (u32 type = 0; type < num_tx_types; ++type) {
+					sb->plane_tx_type = static_cast<av1::inverse_transform>(type);
+					if (!is_transform_valid(sb->plane_tx_type, tx_sz)) {
+						continue;
+					}
+					for (u32 i = 0; i < 16; ++i) {
+						randomize_coefficients(rng, *reference_coeffs, bit_depth);
+						std::memcpy(coeffs->dequant, reference_coeffs->dequant, sizeof(coeffs->dequant));
+						reference_inverse_transform_2d(*seq_header, *sb, *reference_coeffs, tx_sz);
+						av1::block_decoding::inverse_transform_2d(*seq_header, mode_info, *sb, *coeffs, tx_sz);
+
+						const u32 w = 1u << av1::constants::get_tx_width_log2(tx_sz);
+						const u32 h = 1u << av1::constants::get_tx_height_log2(tx_sz);
+						for (u32 y = 0; y < h; ++y) {
+							crash_if(!std::equal(
+								reference_coeffs->residual[y], reference_coeffs->residual[y] + w, coeffs->residual[y]
+							));
+						}
+						++num_transforms;
+					}
+				}
+			}
+		}
+		log().info("Equivalence: {} transforms checked", num_transforms);
+	}
+
+	{ // throughput
+		std::mt19937 rng(54321);
+		seq_header->color_config.bit_depth = 8;
+		randomize_coefficients(rng, *reference_coeffs, 8);
+		std::memcpy(coeffs->dequant, reference_coeffs->dequant, sizeof(coeffs->dequant));
+		for (u32 size = 0; size < num_tx_sizes; ++size) {
+			const auto tx_sz = static_cast<av1::tx_size>(size);
+			const u32 w = 1u << av1::constants::get_tx_width_log2(tx_sz);
+			const u32 h = 1u << av1::constants::get_tx_height_log2(tx_sz);
+			f64 reference_ns = 0.0;
+			f64 ns = 0.0;
+			u32 num_types = 0;
+			for (u32 type = 0; type < num_tx_types; ++type) {
+				sb->plane_tx_type = static_cast<av1::inverse_transform>(type);
+				if (!is_transform_valid(sb->plane_tx_type, tx_sz)) {
+					continue;
+				}
+				reference_ns += time_runs(num_runs, [&]() {
+					reference_inverse_transform_2d(*seq_header, *sb, *reference_coeffs, tx_sz);
+				});
+				ns += time_runs(num_runs, [&]() {
+					av1::block_decoding::inverse_transform_2d(*seq_header, mode_info, *sb, *coeffs, tx_sz);
+				});
+				++num_types;
+			}
+			reference_ns /= num_types;
+			ns /= num_types;
+			log().info(
+				"{}x{}: {} transform types, reference {} ns, inverse_transform_2d {} ns, {}x",
+				w, h, num_types, reference_ns, ns, reference_ns / ns
+			);
+		}
+	}
+
+	return 0;
+}
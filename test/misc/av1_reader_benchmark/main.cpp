@@ -0,0 +1,230 @@
+#include <bit>
+#include <chrono>
+#include <fstream>
+#include <random>
+
+#include "lotus/types.h"
+#include "lotus/logging.h"
+#include "lotus/av1/reader.h"
+
+using namespace lotus;
+using namespace lotus::types;
+
+/// Writes bits into a buffer, most significant bit first.
+struct bit_writer {
+	/// Writes a single bit.
+	void write_bit(bool bit) {
+		if (num_bits % 8 == 0) {
+			data.emplace_back(std::byte(0));
+		}
+		if (bit) {
+			data.back() |= static_cast<std::byte>(0x80u >> (num_bits % 8));
+		}
+		++num_bits;
+	}
+	/// Writes the lowest \p n bits of the value.
+	void write_bits(u32 value, u32 n) {
+		for (u32 i = n; i > 0; --i) {
+			write_bit((value >> (i - 1)) & 1);
+		}
+	}
+	/// Pads the buffer with zeros to the next byte boundary.
+	void align() {
+		num_bits = data.size() * 8;
+	}
+
+	/// 4.10.3. uvlc()
+	void write_uvlc(u32 value) {
+		const u64 v = static_cast<u64>(value) + 1;
+		const auto leading_zeros = static_cast<u32>(std::bit_width(v) - 1);
+		write_bits(0, leading_zeros);
+		write_bit(true);
+		write_bits(static_cast<u32>(v - (1ull << leading_zeros)), leading_zeros);
+	}
+	/// 4.10.5. leb128()
+	void write_leb128(u64 value) {
+		crash_if(num_bits % 8 != 0);
+		do {
+			const auto byte = static_cast<u8>(value & 0x7F);
+			value >>= 7;
+			write_bits(byte | (value > 0 ? 0x80u : 0u), 8);
+		} while (value > 0);
+	}
+
+	std::vector<std::byte> data; ///< Written bytes.
+	u64 num_bits = 0; ///< Number of bits written.
+};
+
+/// A single syntax element written to the synthetic stream.
+struct syntax_element {
+	/// Type of the element.
+	enum class type : u8 {
+		bits,
+		uvlc,
+		su,
+		leb128,
+	};
+
+	type element_type = type::bits; ///< Type of the element.
+	u32 num_bits = 0; ///< Number of bits for \ref type::bits and \ref type::su.
+	u64 value = 0; ///< The value.
+};
+
+/// Generates a random stream of header syntax elements and returns the elements along with the encoded bytes.
+[[nodiscard]] std::pair<std::vector<syntax_element>, std::vector<std::byte>> generate_stream(usize num_elements) {
+	std::mt19937 rng(12345);
+	std::vector<syntax_element> elements;
+	bit_writer writer;
+	for (usize i = 0; i < num_elements; ++i) {
+		syntax_element &elem = elements.emplace_back();
+		switch (rng() % 8) {
+		case 0:
+			elem.element_type = syntax_element::type::uvlc;
+			elem.value = rng() & ((1u << (rng() % 20)) - 1);
+			writer.write_uvlc(static_cast<u32>(elem.value));
+			break;
+		case 1:
+			elem.element_type = syntax_element::type::su;
+			elem.num_bits = 1 + rng() % 16;
+			elem.value = rng() & ((1u << elem.num_bits) - 1);
+			writer.write_bits(static_cast<u32>(elem.value), elem.num_bits);
+			break;
+		case 2:
+			elem.element_type = syntax_element::type::leb128;
+			elem.value = rng() & ((1u << (rng() % 28)) - 1);
+			writer.align();
+			writer.write_leb128(elem.value);
+			break;
+		default: // fixed-width fields are the most common in headers, and are mostly short
+			elem.element_type = syntax_element::type::bits;
+			elem.num_bits = rng() % 4 == 0 ? 1 + rng() % 32 : 1 + rng() % 4;
+			elem.value = rng() & (elem.num_bits == 32 ? 0xFFFFFFFFu : (1u << elem.num_bits) - 1);
+			writer.write_bits(static_cast<u32>(elem.value), elem.num_bits);
+			break;
+		}
+	}
+	return { std::move(elements), std::move(writer.data) };
+}
+
+/// Reads back all elements of the synthetic stream, and checks that they have the expected values.
+void read_stream(const std::vector<syntax_element> &elements, std::span<const std::byte> data) {
+	av1::reader r(data);
+	for (const syntax_element &elem : elements) {
+		switch (elem.element_type) {
+		case syntax_element::type::bits:
+			crash_if(r.read_bits(elem.num_bits) != elem.value);
+			break;
+		case syntax_element::type::uvlc:
+			crash_if(r.read_uvlc() != elem.value);
+			break;
+		case syntax_element::type::su:
+			{
+				const i32 value = r.read_su(elem.num_bits);
+				crash_if(static_cast<u32>(value) << (32 - elem.num_bits) >> (32 - elem.num_bits) != elem.value);
+			}
+			break;
+		case syntax_element::type::leb128:
+			r.skip_bits((8 - r.get_position() % 8) % 8);
+			crash_if(r.read_leb128().first != elem.value);
+			break;
+		}
+	}
+}
+
+/// Statistics collected while parsing an OBU stream.
+struct obu_stream_stats {
+	u64 num_obus = 0; ///< Total number of OBUs.
+	u64 num_sequence_headers = 0; ///< Number of parsed sequence headers.
+	u64 payload_bytes = 0; ///< Total size of all OBU payloads.
+};
+
+/// Parses a sequence of OBUs in the low overhead bitstream format. Sequence headers are parsed, and all other
+/// payloads are skipped.
+void parse_obus(std::span<const std::byte> data, obu_stream_stats &stats) {
+	av1::reader r(data);
+	while (r.get_position() < data.size() * 8) {
+		const av1::obu::header header = r.read_header();
+		crash_if(!header.has_size_field); // required by the low overhead bitstream format
+		const u64 obu_size = r.read_leb128().first;
+		const u64 payload_end = r.get_position() + obu_size * 8;
+		if (header.obu_type == av1::obu::type::sequence_header) {
+			(void)r.read_sequence_header();
+			++stats.num_sequence_headers;
+		}
+		r.skip_bits(payload_end - r.get_position());
+		++stats.num_obus;
+		stats.payload_bytes += obu_size;
+	}
+}
+
+/// Parses all frames in the given file, which is either an IVF file or a raw stream of OBUs.
+void parse_file(std::span<const std::byte> file, obu_stream_stats &stats) {
+	const auto read_le32 = [&](usize offset) {
+		u32 result = 0;
+		for (u32 i = 0; i < 4; ++i) {
+			result |= static_cast<u32>(file[offset + i]) << (i * 8);
+		}
+		return result;
+	};
+
+	constexpr std::byte ivf_signature[] = { std::byte('D'), std::byte('K'), std::byte('I'), std::byte('F') };
+	if (file.size() < 32 || !std::ranges::equal(file.first(4), ivf_signature)) {
+		parse_obus(file, stats);
+		return;
+	}
+	const u32 ivf_header_size = read_le32(4) >> 16;
+	for (usize offset = ivf_header_size; offset + 12 <= file.size(); ) {
+		const u32 frame_size = read_le32(offset);
+		offset += 12; // frame size and timestamp
+		parse_obus(file.subspan(offset, frame_size), stats);
+		offset += frame_size;
+	}
+}
+
+/// Runs the given function the given number of times, and returns the time per run in milliseconds.
+template <typename Func> [[nodiscard]] f64 time_runs(u32 num_runs, Func &&func) {
+	const auto begin = std::chrono::high_resolution_clock::now();
+	for (u32 i = 0; i < num_runs; ++i) {
+		func();
+	}
+	const auto end = std::chrono::high_resolution_clock::now();
+	return std::chrono::duration<f64, std::milli>(end - begin).count() / num_runs;
+}
+
+int main(int argc, char **argv) {
+	const u32 num_runs = argc > 2 ? static_cast<u32>(std::atoi(argv[2])) : 20;
+
+	{ // synthetic header syntax elements
+		constexpr usize num_elements = 1 << 20;
+		const auto [elements, data] = generate_stream(num_elements);
+		const f64 ms = time_runs(num_runs, [&]() {
+			read_stream(elements, data);
+		});
+		log().info(
+			"Synthetic: {} elements, {} bytes, {} ms, {} ns per element, {} MB/s",
+			num_elements, data.size(), ms, ms * 1e6 / num_elements, static_cast<f64>(data.size()) / (ms * 1000.0)
+		);
+	}
+
+	if (argc > 1) { // a real stream
+		std::ifstream fin(argv[1], std::ios::binary | std::ios::ate);
+		crash_if(!fin.good());
+		std::vector<std::byte> file(static_cast<usize>(fin.tellg()));
+		fin.seekg(0, std::ios::beg);
+		fin.read(reinterpret_cast<char*>(file.data()), static_cast<std::streamsize>(file.size()));
+
+		obu_stream_stats stats;
+		parse_file(file, stats);
+		const f64 ms = time_runs(num_runs, [&]() {
+			obu_stream_stats run_stats;
+			parse_file(file, run_stats);
+		});
+		log().info(
+			"{}: {} OBUs, {} sequence headers, {} payload bytes, {} ms, {} ns per OBU",
+			argv[1], stats.num_obus, stats.num_sequence_headers, stats.payload_bytes, ms,
+			ms * 1e6 / static_cast<f64>(stats.num_obus)
+		);
+	}
+
+	return 0;
+}
@@ -0,0 +1,251 @@
+#include <bit>
+#include <chrono>
+#include <random>
+
+#include "lotus/types.h"
+#include "lotus/logging.h"
+#include "lotus/av1/reader.h"
+#include "lotus/av1/state.h"
+#include "lotus/av1/symbol_decoder.h"
+
+using namespace lotus;
+using namespace lotus::types;
+
+/// A straightforward implementation of the symbol decoder that follows the specification literally, reading the
+/// bitstream one renormalization at a time.
+struct reference_decoder {
+	/// 8.2.2. Initialization process for symbol decoder
+	reference_decoder(av1::reader &r, bool disable_update, u64 sz) : rd(r), disable_cdf_update(disable_update) {
+		const auto num_bits = static_cast<u32>(std::min<u64>(sz * 8, 15));
+		const u32 buf = rd.read_bits(num_bits);
+		const u32 padded_buf = buf << (15u - num_bits);
+		symbol_value = static_cast<u16>(((1u << 15) - 1) ^ padded_buf);
+		symbol_range = 1u << 15;
+		symbol_max_bits = 8 * static_cast<i64>(sz) - 15;
+	}
+
+	/// 8.2.4. Exit process for symbol decoder
+	void exit_symbol() {
+		crash_if(symbol_max_bits < -14);
+		if (symbol_max_bits > 0) {
+			rd.skip_bits(static_cast<u64>(symbol_max_bits));
+		}
+	}
+
+	/// 8.2.3. Boolean decoding process
+	[[nodiscard]] bool read_bool() {
+		constexpr u16 cdf[3] = { 1 << 14, 1 << 15, 0 };
+		return decode(cdf) == 1;
+	}
+	/// 8.2.5. Parsing process for read_literal
+	[[nodiscard]] u32 read_literal(u32 n) {
+		u32 x = 0;
+		for (u32 i = 0; i < n; ++i) {
+			x = 2 * x + (read_bool() ? 1 : 0);
+		}
+		return x;
+	}
+	/// 8.2.6. Symbol decoding process
+	[[nodiscard]] u32 read_symbol(std::span<u16> cdf) {
+		const u32 symbol = decode(cdf);
+		if (!disable_cdf_update) {
+			const auto n = static_cast<u32>(cdf.size() - 1);
+			const u32 rate = 3 + (cdf[n] > 15 ? 1 : 0) + (cdf[n] > 31 ? 1 : 0) + std::min<u32>(std::bit_width(n) - 1, 2);
+			u16 tmp = 0;
+			for (u32 i = 0; i < n - 1; ++i) {
+				tmp = i == symbol ? (1u << 15) : tmp;
+				if (tmp < cdf[i]) {
+					cdf[i] -= (cdf[i] - tmp) >> rate;
+				} else {
+					cdf[i] += (tmp - cdf[i]) >> rate;
+				}
+			}
+			cdf[n] += cdf[n] < 32 ? 1 : 0;
+		}
+		return symbol;
+	}
+
+	/// Decodes a symbol without updating the CDF.
+	[[nodiscard]] u32 decode(std::span<const u16> cdf) {
+		const usize n = cdf.size() - 1;
+		u16 prev;
+		u16 cur = symbol_range;
+		u32 symbol = static_cast<u32>(-1);
+		do {
+			++symbol;
+			prev = cur;
+			const u16 f = (1u << 15) - cdf[symbol];
+			cur = static_cast<u16>((static_cast<u32>(symbol_range >> 8) * (f >> 6)) >> 1);
+			cur += 4 * (n - symbol - 1);
+		} while (cur > symbol_value);
+
+		symbol_range = prev - cur;
+		symbol_value = symbol_value - cur;
+		if (const auto bits = static_cast<u32>(15 - (std::bit_width(symbol_range) - 1)); bits > 0) {
+			symbol_range <<= bits;
+			const auto num_bits = static_cast<u32>(std::min<i64>(bits, std::max<i64>(0, symbol_max_bits)));
+			const u32 new_data = rd.read_bits(num_bits);
+			const auto padded_data = static_cast<u16>(new_data << (bits - num_bits));
+			symbol_value = static_cast<u16>(((symbol_value + 1) << bits) - 1) ^ padded_data;
+			symbol_max_bits -= bits;
+		}
+		return symbol;
+	}
+
+	av1::reader &rd; ///< The bitstream reader.
+	bool disable_cdf_update = false; ///< Whether CDF updates are disabled.
+	i64 symbol_max_bits = 0; ///< \p SymbolMaxBits.
+	u16 symbol_value = 0; ///< \p SymbolValue.
+	u16 symbol_range = 0; ///< \p SymbolRange.
+};
+
+/// Creates a random valid CDF array with the given number of symbols, including the trailing counter.
+[[nodiscard]] std::vector<u16> random_cdf(std::mt19937 &rng, u32 num_symbols) {
+	std::vector<u16> result(num_symbols + 1);
+	for (u32 i = 0; i + 1 < num_symbols; ++i) {
+		result[i] = static_cast<u16>(1 + rng() % ((1u << 15) - 1));
+	}
+	std::sort(result.begin(), result.begin() + (num_symbols - 1));
+	result[num_symbols - 1] = 1u << 15;
+	result[num_symbols] = static_cast<u16>(rng() % 33);
+	return result;
+}
+
+/// Creates random tile data.
+[[nodiscard]] std::vector<std::byte> random_data(std::mt19937 &rng, usize size) {
+	std::vector<std::byte> result(size);
+	for (std::byte &b : result) {
+		b = static_cast<std::byte>(rng() & 0xFF);
+	}
+	return result;
+}
+
+/// Decodes a random sequence of symbols, booleans, and literals from random data using both decoders, and checks that
+/// the decoded values, the adapted CDFs, and the final bitstream positions are identical. Returns the number of
+/// decoded elements.
+[[nodiscard]] u64 check_equivalence(std::mt19937 &rng, usize tile_size, bool disable_cdf_update) {
+	const std::vector<std::byte> data = random_data(rng, tile_size);
+	std::vector<std::vector<u16>> reference_cdfs;
+	for (u32 i = 0; i < 32; ++i) {
+		reference_cdfs.emplace_back(random_cdf(rng, 2 + rng() % 15));
+	}
+	std::vector<std::vector<u16>> cdfs = reference_cdfs;
+
+	const av1::state::cdf zero_cdfs(zero);
+	av1::reader reference_reader(data);
+	av1::reader reader(data);
+	reference_decoder reference(reference_reader, disable_cdf_update, data.size());
+	auto decoder = av1::symbol_decoder::init_symbol(
+		reader, zero_cdfs.non_coeff, zero_cdfs.coeff, disable_cdf_update, data.size()
+	);
+
+	u64 num_elements = 0;
+	// stop early enough so that the longest literal does not read too far past the end of the tile
+	while (reference.symbol_max_bits > 64) {
+		switch (rng() % 4) {
+		case 0:
+			crash_if(reference.read_bool() != decoder.read_bool());
+			break;
+		case 1:
+			{
+				const u32 n = 1 + rng() % 32;
+				crash_if(reference.read_literal(n) != decoder.read_literal(n));
+			}
+			break;
+		default:
+			{
+				const usize index = rng() % cdfs.size();
+				const u32 symbol = reference.read_symbol(reference_cdfs[index]);
+				crash_if(symbol != std::to_underlying(decoder.read_symbol(cdfs[index])));
+				crash_if(reference_cdfs[index] != cdfs[index]);
+			}
+			break;
+		}
+		++num_elements;
+	}
+	// booleans consume at most two bits each, so these can be used to test decoding past the end of the tile
+	while (reference.symbol_max_bits > -12) {
+		crash_if(reference.read_bool() != decoder.read_bool());
+		++num_elements;
+	}
+
+	reference.exit_symbol();
+	decoder.exit_symbol();
+	crash_if(reference_reader.get_position() != reader.get_position());
+	return num_elements;
+}
+
+/// Runs the given decoding function, and returns the number of decoded elements along with the time in milliseconds.
+template <typename Decode> [[nodiscard]] std::pair<u64, f64> time_decoding(Decode &&decode) {
+	const auto begin = std::chrono::high_resolution_clock::now();
+	const u64 num_elements = decode();
+	const auto end = std::chrono::high_resolution_clock::now();
+	return { num_elements, std::chrono::duration<f64, std::milli>(end - begin).count() };
+}
+
+int main(int argc, char **argv) {
+	const usize tile_size = argc > 1 ? static_cast<usize>(std::atoll(argv[1])) : (1 << 20);
+
+	{ // bit-exactness
+		std::mt19937 rng(12345);
+		u64 num_elements = 0;
+		for (u32 i = 0; i < 2000; ++i) {
+			num_elements += check_equivalence(rng, 1 + rng() % 512, i % 4 == 0);
+		}
+		log().info("Equivalence: {} elements checked", num_elements);
+	}
+
+	{ // throughput
+		std::mt19937 rng(54321);
+		const std::vector<std::byte> data = random_data(rng, tile_size);
+		std::vector<std::vector<u16>> initial_cdfs;
+		for (const u32 num_symbols : { 2u, 3u, 4u, 5u, 8u, 13u, 16u, 16u }) {
+			initial_cdfs.emplace_back(random_cdf(rng, num_symbols));
+		}
+		const av1::state::cdf zero_cdfs(zero);
+
+		const auto [reference_elements, reference_ms] = time_decoding([&]() {
+			std::vector<std::vector<u16>> cdfs = initial_cdfs;
+			av1::reader r(data);
+			reference_decoder dec(r, false, data.size());
+			u64 count = 0;
+			for (; dec.symbol_max_bits > 64; ++count) {
+				if (count % 8 == 7) {
+					(void)dec.read_literal(4);
+				} else {
+					(void)dec.read_symbol(cdfs[count % cdfs.size()]);
+				}
+			}
+			dec.exit_symbol();
+			return count;
+		});
+		log().info(
+			"Reference: {} elements, {} ms, {} ns per element",
+			reference_elements, reference_ms, reference_ms * 1e6 / static_cast<f64>(reference_elements)
+		);
+
+		const auto [elements, ms] = time_decoding([&]() {
+			std::vector<std::vector<u16>> cdfs = initial_cdfs;
+			av1::reader r(data);
+			auto dec = av1::symbol_decoder::init_symbol(r, zero_cdfs.non_coeff, zero_cdfs.coeff, false, data.size());
+			u64 count = 0;
+			// the number of elements is taken from the reference, since the fast decoder does not expose the number
+			// of remaining bits
+			for (; count < reference_elements; ++count) {
+				if (count % 8 == 7) {
+					(void)dec.read_literal(4);
+				} else {
+					(void)dec.read_symbol(cdfs[count % cdfs.size()]);
+				}
+			}
+			dec.exit_symbol();
+			return count;
+		});
+		log().info(
+			"symbol_decoder: {} elements, {} ms, {} ns per element, {}x",
+			elements, ms, ms * 1e6 / static_cast<f64>(elements), reference_ms / ms
+		);
+	}
+
+	return 0;
+}
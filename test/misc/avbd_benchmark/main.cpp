@@ -0,0 +1,115 @@
+#include <algorithm>
+#include <chrono>
+#include <optional>
+#include <thread>
+
+#include <cstdlib>
+
+#include "lotus/types.h"
+#include "lotus/physics/world.h"
+#include "lotus/physics/solvers/avbd/solver.h"
+#include "lotus/logging.h"
+
+#include "physics_utils.h"
+
+using namespace lotus;
+using namespace lotus::collision::types;
+
+namespace avbd = lotus::physics::solvers::avbd;
+
+/// Creates a chain of spheres connected by springs, hanging from a kinematic sphere. Spheres are small compared to
+/// the spacing between them, so that they do not collide.
+void create_chain(physics::world &w, collision::shape &shape, vec3 start, vec3 offset, u32 num_bodies) {
+	const auto material = physics::material_properties(0.5f, 0.4f, 0.0f);
+	const auto props = std::get<collision::shapes::sphere>(shape.value).get_body_properties(1000.0f);
+	physics::body *prev = nullptr;
+	for (u32 i = 0; i < num_bodies; ++i) {
+		physics::body *cur = &w.add_body(physics::body::create(
+			shape,
+			material,
+			i == 0 ? physics::body_properties::kinematic() : props,
+			physics::body_state::stationary_at(start + offset * static_cast<scalar>(i), uquats::identity())
+		))->this_body;
+		if (prev) {
+			auto &spring = w.springs.emplace_back();
+			spring.body1 = prev;
+			spring.body2 = cur;
+			spring.initial_length = offset.norm();
+			spring.compressed_stiffness = 10000.0f;
+			spring.stretched_stiffness = 10000.0f;
+			spring.disable_collision = true;
+		}
+		prev = cur;
+	}
+}
+
+int main(int argc, char **argv) {
+	const u32 num_rods = argc > 1 ? static_cast<u32>(std::atoi(argv[1])) : 64;
+	const u32 num_steps = argc > 2 ? static_cast<u32>(std::atoi(argv[2])) : 20;
+	const u32 max_threads =
+		argc > 3 ? static_cast<u32>(std::atoi(argv[3])) : std::max(std::thread::hardware_concurrency(), 2u);
+	constexpr u32 rod_parts = 64;
+	constexpr scalar rod_density = 1000.0f;
+	constexpr scalar rod_diameter = 0.03f;
+	constexpr scalar rod_stiffness = 10000.0f;
+	constexpr u32 chain_bodies = 32;
+
+	collision::shape sphere_shape = collision::shape::create(collision::shapes::sphere::from_radius(0.1f));
+	std::optional<std::vector<vec3>> parallel_reference;
+	for (u32 num_threads = 1; ; num_threads = std::min(num_threads * 2, max_threads)) {
+		physics::world w;
+		w.gravity = vec3(0.0f, -10.0f, 0.0f);
+		avbd::solver solver;
+		solver.physics_world = &w;
+		for (u32 i = 0; i < num_rods; ++i) {
+			const vec3 start(static_cast<scalar>(i), 1.0f, 0.0f);
+			create_straight_rod_avbd(
+				solver, start, start + vec3(0.0f, 0.0f, 1.0f),
+				rod_parts, rod_density, rod_diameter, rod_stiffness, rod_stiffness
+			);
+			create_chain(w, sphere_shape, start + vec3(0.0f, 0.0f, -2.0f), vec3(0.0f, 0.0f, -0.5f), chain_bodies);
+		}
+
+		// the calling thread also participates, so spawn one fewer worker
+		std::optional<job_system::manager> manager;
+		if (num_threads > 1) {
+			manager.emplace(job_system::manager::spawn_workers(num_threads - 1));
+		}
+		solver.job_manager = manager ? &manager.value() : nullptr;
+
+		const auto begin = std::chrono::high_resolution_clock::now();
+		for (u32 i = 0; i < num_steps; ++i) {
+			solver.timestep(1.0f / 60.0f);
+		}
+		const auto end = std::chrono::high_resolution_clock::now();
+		const f64 seconds = std::chrono::duration<f64>(end - begin).count();
+
+		// parallel results depend only on the coloring, not on the number of threads
+		if (manager) {
+			std::vector<vec3> positions;
+			for (const physics::particle &p : solver.particles) {
+				positions.emplace_back(p.state.position);
+			}
+			for (const std::unique_ptr<physics::world::body_data> &b : w.get_bodies()) {
+				positions.emplace_back(b->this_body.state.position.position);
+			}
+			if (parallel_reference) {
+				crash_if(positions != parallel_reference.value());
+			} else {
+				parallel_reference.emplace(std::move(positions));
+			}
+		}
+
+		log().info(
+			"{} threads: {} ms per step, {} particles, {} orientations, {} bodies",
+			num_threads, seconds * 1000.0 / num_steps, solver.particles.size(), solver.orientations.size(),
+			num_rods * chain_bodies
+		);
+
+		if (num_threads == max_threads) {
+			break;
+		}
+	}
+
+	return 0;
+}
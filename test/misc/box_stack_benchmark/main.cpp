@@ -0,0 +1,121 @@
+#include <chrono>
+
+#include <cstdlib>
+
+#include "lotus/types.h"
+#include "lotus/physics/world.h"
+#include "lotus/physics/solvers/avbd/solver.h"
+#include "lotus/physics/solvers/sequential_impulse/solver.h"
+#include "lotus/logging.h"
+
+#include "physics_utils.h"
+
+using namespace lotus;
+using namespace lotus::collision::types;
+
+/// A pyramid of unit boxes resting on a kinematic platform.
+struct scene {
+	/// Creates the scene.
+	explicit scene(u32 base_count) {
+		w.gravity = vec3(0.0f, -10.0f, 0.0f);
+
+		const auto material = physics::material_properties(0.6f, 0.5f, 0.0f);
+		auto [platform_poly, platform_props] = create_box_shape(vec3(100.0f, 1.0f, 100.0f));
+		platform_shape = collision::shape::create(std::move(platform_poly));
+		w.add_body(physics::body::create(
+			platform_shape, material, physics::body_properties::kinematic(),
+			physics::body_state::stationary_at(vec3(0.0f, -0.5f, 0.0f), uquats::identity())
+		));
+
+		auto [box_poly, box_props] = create_box_shape(vec3::filled(1.0f));
+		box_shape = collision::shape::create(std::move(box_poly));
+		constexpr scalar gap = 0.01f;
+		for (u32 y = 0; y < base_count; ++y) {
+			const scalar x0 = -0.5f * static_cast<scalar>(base_count - y - 1) * (1.0f + gap);
+			for (u32 x = 0; x + y < base_count; ++x) {
+				const vec3 pos(x0 + static_cast<scalar>(x) * (1.0f + gap), 0.5f + static_cast<scalar>(y), 0.0f);
+				physics::world::body_data *bdata = w.add_body(physics::body::create(
+					box_shape, material, box_props.get_body_properties(1.0f),
+					physics::body_state::stationary_at(pos, uquats::identity())
+				));
+				initial_positions.emplace_back(bdata, pos);
+			}
+		}
+	}
+
+	/// Returns the largest distance between any box and its initial position.
+	[[nodiscard]] scalar compute_max_drift() const {
+		scalar result = 0.0f;
+		for (const auto &[bdata, pos] : initial_positions) {
+			result = std::max(result, (bdata->this_body.state.position.position - pos).norm());
+		}
+		return result;
+	}
+	/// Returns the number of contact points, and how many of them carry cached solver data.
+	[[nodiscard]] std::pair<u32, u32> count_cached_contact_points() const {
+		u32 num_points = 0;
+		u32 num_cached = 0;
+		w.for_each_contact([&](const physics::constraints::rigid_body_contact &contact) {
+			for (const physics::constraints::rigid_body_contact::point &pt : contact.contact_points) {
+				++num_points;
+				if (pt.cached_force != zero) {
+					++num_cached;
+				}
+			}
+		});
+		return { num_points, num_cached };
+	}
+
+	collision::shape platform_shape; ///< Shape of the platform.
+	collision::shape box_shape; ///< Shape of all boxes.
+	physics::world w; ///< The world.
+	/// All boxes and their initial positions.
+	std::vector<std::pair<const physics::world::body_data*, vec3>> initial_positions;
+};
+
+/// Simulates the scene using the given solver, and logs timing and how far the boxes have drifted.
+template <typename Solver> void run(
+	const char *name, u32 base_count, u32 num_steps, u32 num_iterations, bool warm_start, Solver &solver
+) {
+	scene s(base_count);
+	s.w.enable_sleeping = false; // measure drift of the solver itself
+	solver.physics_world = &s.w;
+
+	const auto begin = std::chrono::high_resolution_clock::now();
+	for (u32 i = 0; i < num_steps; ++i) {
+		solver.timestep(1.0f / 60.0f);
+	}
+	const auto end = std::chrono::high_resolution_clock::now();
+	const f64 seconds = std::chrono::duration<f64>(end - begin).count();
+
+	const auto [num_points, num_cached] = s.count_cached_contact_points();
+	// resting contacts should keep their cached data from one step to the next
+	crash_if(warm_start && num_cached == 0);
+	log().info(
+		"{}, {} iterations, warm start {}: {} ms per step, max drift {}, {}/{} contact points cached",
+		name, num_iterations, warm_start ? "on" : "off", seconds * 1000.0 / num_steps, s.compute_max_drift(),
+		num_cached, num_points
+	);
+}
+
+int main(int argc, char **argv) {
+	const u32 base_count = argc > 1 ? static_cast<u32>(std::atoi(argv[1])) : 10;
+	const u32 num_steps = argc > 2 ? static_cast<u32>(std::atoi(argv[2])) : 300;
+
+	for (const u32 num_iterations : { 1u, 2u, 4u, 8u }) {
+		for (const bool warm_start : { false, true }) {
+			physics::solvers::avbd::solver solver;
+			solver.num_iterations = num_iterations;
+			// zero decay discards all cached data
+			solver.warm_start_decay = warm_start ? solver.warm_start_decay : 0.0f;
+			run("AVBD", base_count, num_steps, num_iterations, warm_start, solver);
+		}
+	}
+	for (const u32 num_iterations : { 1u, 2u, 4u }) {
+		physics::solvers::sequential_impulse::solver solver;
+		solver.num_velocity_iterations = num_iterations;
+		run("Sequential impulse", base_count, num_steps, num_iterations, true, solver);
+	}
+
+	return 0;
+}
@@ -0,0 +1,161 @@
+#include <algorithm>
+#include <chrono>
+#include <optional>
+#include <thread>
+
+#include <cstdlib>
+
+#include "lotus/types.h"
+#include "lotus/physics/world.h"
+#include "lotus/physics/solvers/avbd/solver.h"
+#include "lotus/physics/solvers/sequential_impulse/solver.h"
+#include "lotus/logging.h"
+
+#include "physics_utils.h"
+
+using namespace lotus;
+using namespace lotus::collision::types;
+
+/// A grid of separate short stacks of boxes resting on a kinematic platform.
+struct scene {
+	/// Creates the scene.
+	scene(u32 stacks_per_axis, u32 stack_height) {
+		w.gravity = vec3(0.0f, -10.0f, 0.0f);
+
+		auto [platform_poly, platform_props] = create_box_shape(vec3(1000.0f, 1.0f, 1000.0f));
+		platform_shape = collision::shape::create(std::move(platform_poly));
+		w.add_body(physics::body::create(
+			platform_shape, material, physics::body_properties::kinematic(),
+			physics::body_state::stationary_at(vec3(0.0f, -0.5f, 0.0f), uquats::identity())
+		));
+
+		auto [box_poly, box_props] = create_box_shape(vec3::filled(1.0f));
+		box_shape = collision::shape::create(std::move(box_poly));
+		box_properties = box_props.get_body_properties(1.0f);
+		for (u32 z = 0; z < stacks_per_axis; ++z) {
+			for (u32 x = 0; x < stacks_per_axis; ++x) {
+				std::vector<physics::world::body_data*> &stack = stacks.emplace_back();
+				for (u32 y = 0; y < stack_height; ++y) {
+					const vec3 pos(
+						static_cast<scalar>(x) * stack_spacing,
+						0.5f + static_cast<scalar>(y),
+						static_cast<scalar>(z) * stack_spacing
+					);
+					stack.emplace_back(add_box(pos));
+				}
+			}
+		}
+	}
+
+	constexpr static scalar stack_spacing = 3.0f; ///< Distance between neighboring stacks.
+
+	/// Adds a stationary box at the given position.
+	physics::world::body_data *add_box(vec3 pos) {
+		return w.add_body(physics::body::create(
+			box_shape, material, box_properties, physics::body_state::stationary_at(pos, uquats::identity())
+		));
+	}
+	/// Returns the number of sleeping bodies.
+	[[nodiscard]] usize count_sleeping_bodies() const {
+		usize result = 0;
+		for (const std::unique_ptr<physics::world::body_data> &bdata : w.get_bodies()) {
+			result += bdata->asleep ? 1 : 0;
+		}
+		return result;
+	}
+	/// Returns the positions of all bodies.
+	[[nodiscard]] std::vector<vec3> collect_positions() const {
+		std::vector<vec3> result;
+		for (const std::unique_ptr<physics::world::body_data> &bdata : w.get_bodies()) {
+			result.emplace_back(bdata->this_body.state.position.position);
+		}
+		return result;
+	}
+
+	physics::material_properties material = physics::material_properties(0.6f, 0.5f, 0.0f); ///< Material.
+	collision::shape platform_shape; ///< Shape of the platform.
+	collision::shape box_shape; ///< Shape of all boxes.
+	physics::body_properties box_properties = uninitialized; ///< Properties of all boxes.
+	physics::world w; ///< The world.
+	std::vector<std::vector<physics::world::body_data*>> stacks; ///< Boxes in each stack, from bottom to top.
+};
+
+/// Runs the given number of time steps and returns the time per step in milliseconds.
+template <typename Solver> [[nodiscard]] f64 run_steps(Solver &solver, u32 num_steps) {
+	const auto begin = std::chrono::high_resolution_clock::now();
+	for (u32 i = 0; i < num_steps; ++i) {
+		solver.timestep(1.0f / 60.0f);
+	}
+	const auto end = std::chrono::high_resolution_clock::now();
+	return std::chrono::duration<f64, std::milli>(end - begin).count() / num_steps;
+}
+
+/// Lets the stacks settle until they fall asleep, then drops a box onto one of them, and checks that only that stack
+/// wakes up. Returns the final positions of all bodies.
+template <typename Solver> [[nodiscard]] std::vector<vec3> run(
+	const char *name, u32 num_threads, Solver &solver, u32 stacks_per_axis, u32 num_steps
+) {
+	scene s(stacks_per_axis, 3);
+	solver.physics_world = &s.w;
+	const usize num_boxes = s.w.get_bodies().size() - 1;
+
+	const f64 awake_ms = run_steps(solver, 10);
+	crash_if(s.count_sleeping_bodies() != 0);
+	(void)run_steps(solver, num_steps);
+	crash_if(s.count_sleeping_bodies() != num_boxes);
+	const f64 asleep_ms = run_steps(solver, 10);
+
+	// drop a box onto the first stack
+	const std::vector<physics::world::body_data*> &stack = s.stacks[0];
+	physics::world::body_data *dropped =
+		s.add_box(stack.back()->this_body.state.position.position + vec3(0.0f, 1.5f, 0.0f));
+	(void)run_steps(solver, 40);
+	crash_if(dropped->asleep);
+	for (const physics::world::body_data *bdata : stack) {
+		crash_if(bdata->asleep);
+	}
+	crash_if(s.count_sleeping_bodies() != num_boxes - stack.size());
+
+	log().info(
+		"{}, {} threads: {} boxes, {} ms per step awake, {} ms per step asleep",
+		name, num_threads, num_boxes, awake_ms, asleep_ms
+	);
+	return s.collect_positions();
+}
+
+int main(int argc, char **argv) {
+	const u32 stacks_per_axis = argc > 1 ? static_cast<u32>(std::atoi(argv[1])) : 16;
+	const u32 num_steps = argc > 2 ? static_cast<u32>(std::atoi(argv[2])) : 240;
+	const u32 max_threads =
+		argc > 3 ? static_cast<u32>(std::atoi(argv[3])) : std::max(std::thread::hardware_concurrency(), 2u);
+
+	{
+		physics::solvers::avbd::solver solver;
+		(void)run("AVBD", 1, solver, stacks_per_axis, num_steps);
+	}
+
+	std::optional<std::vector<vec3>> reference;
+	for (u32 num_threads = 1; ; num_threads = std::min(num_threads * 2, max_threads)) {
+		// the calling thread also participates, so spawn one fewer worker
+		std::optional<job_system::manager> manager;
+		if (num_threads > 1) {
+			manager.emplace(job_system::manager::spawn_workers(num_threads - 1));
+		}
+		physics::solvers::sequential_impulse::solver solver;
+		solver.job_manager = manager ? &manager.value() : nullptr;
+		std::vector<vec3> positions = run("Sequential impulse", num_threads, solver, stacks_per_axis, num_steps);
+
+		// islands are solved independently, so the results do not depend on the number of threads
+		if (reference) {
+			crash_if(positions != reference.value());
+		} else {
+			reference.emplace(std::move(positions));
+		}
+
+		if (num_threads == max_threads) {
+			break;
+		}
+	}
+
+	return 0;
+}
@@ -12,6 +12,20 @@ std::tuple<i32> add_1(u32, i32 x) {
 	return { x + 1 };
 }
 
+job_system::manager *nested_manager = nullptr; ///< Manager used by \ref sum_with_nested_job().
+
+/// Schedules a nested job that doubles all elements, and waits for its result from within this job.
+std::tuple<i64> sum_with_nested_job(const std::vector<i32> &in) {
+	job_system::resource_handle in_handle = nested_manager->create_resource_with_value<std::vector<i32>>(in);
+	job_system::resource_handle out_handle = nested_manager->create_resource<std::vector<i32>>();
+	nested_manager->schedule_multi_job(multiply_by_2, { in_handle }, { out_handle }, static_cast<u32>(in.size()));
+	i64 res = 0;
+	for (const i32 x : nested_manager->get_resource_value_blocking<std::vector<i32>>(out_handle)) {
+		res += x;
+	}
+	return { res };
+}
+
 int main() {
 	const u32 threads = std::thread::hardware_concurrency();
 	log().debug("Threads: {}", threads);
@@ -77,5 +91,26 @@ int main() {
 		log().debug("Serial: {}", result);
 	}
 
+	{
+		// more outer jobs than workers, each waiting on a nested job; this requires waiting threads to help
+		log().debug("Start nested");
+		nested_manager = &jman;
+		const u32 num_outer_jobs = threads * 4;
+		std::vector<i32> nested_inputs(inputs.begin(), inputs.begin() + std::min<usize>(inputs.size(), 100000));
+		job_system::resource_handle in = jman.create_resource_with_value<std::vector<i32>>(nested_inputs);
+		std::vector<job_system::resource_handle> outs;
+		for (u32 i = 0; i < num_outer_jobs; ++i) {
+			job_system::resource_handle out = jman.create_resource<i64>();
+			jman.schedule_mono_job(&sum_with_nested_job, { in }, { out });
+			outs.emplace_back(std::move(out));
+		}
+		i64 result = 0;
+		for (const job_system::resource_handle &out : outs) {
+			result += jman.get_resource_value_blocking<i64>(out);
+		}
+		nested_manager = nullptr;
+		log().debug("Nested: {}", result);
+	}
+
 	return 0;
 }
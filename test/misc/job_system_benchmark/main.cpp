@@ -0,0 +1,170 @@
+#include <chrono>
+#include <new>
+
+#include "lotus/types.h"
+#include "lotus/utils/job_system.h"
+#include "lotus/logging.h"
+
+using namespace lotus;
+
+std::atomic<u64> num_allocations = 0; ///< The number of allocations made through \p operator new.
+
+#ifndef LOTUS_USE_MIMALLOC // mimalloc replaces these operators itself
+/// Counts the allocation and allocates memory using \p std::malloc().
+void *operator new(std::size_t size) {
+	num_allocations.fetch_add(1, std::memory_order::relaxed);
+	if (void *ptr = std::malloc(std::max<std::size_t>(size, 1))) {
+		return ptr;
+	}
+	throw std::bad_alloc();
+}
+/// Frees memory allocated by \p operator new.
+void operator delete(void *ptr) noexcept {
+	std::free(ptr);
+}
+/// \overload
+void operator delete(void *ptr, std::size_t) noexcept {
+	std::free(ptr);
+}
+#endif
+
+/// A small amount of busy work for each leaf job.
+std::tuple<u64> leaf_job(const u64 &seed) {
+	u64 x = seed;
+	for (u32 i = 0; i < 256; ++i) {
+		x ^= x << 13;
+		x ^= x >> 7;
+		x ^= x << 17;
+	}
+	return { x };
+}
+
+/// Combines the result of two jobs.
+std::tuple<u64> combine_job(const u64 &lhs, const u64 &rhs) {
+	return { lhs * 31 + rhs };
+}
+
+/// Per-element function for multi jobs.
+std::tuple<i32> scale_element(u32, i32 x) {
+	return { x * 3 + 1 };
+}
+
+/// Range function for parallel-for jobs.
+void scale_range(
+	job_system::index_range range, std::tuple<std::span<const i32>> inputs, std::tuple<std::span<i32>> outputs
+) {
+	auto [in] = inputs;
+	auto [out] = outputs;
+	for (u32 i = range.begin; i < range.end; ++i) {
+		out[i] = in[i] * 3 + 1;
+	}
+}
+
+/// Transforms \p count elements using either a multi job or a parallel-for job. Returns the elapsed time in seconds.
+f64 run_element_wise(job_system::manager &jman, const std::vector<i32> &data, bool use_parallel_for, i64 &result) {
+	const auto count = static_cast<u32>(data.size());
+	const auto start = std::chrono::high_resolution_clock::now();
+
+	job_system::resource_handle in = jman.create_resource_with_value<std::vector<i32>>(data);
+	job_system::resource_handle out = jman.create_resource<std::vector<i32>>();
+	if (use_parallel_for) {
+		jman.schedule_parallel_for(&scale_range, { in }, { out }, count);
+	} else {
+		jman.schedule_multi_job(&scale_element, { in }, { out }, count);
+	}
+	const std::vector<i32> &values = jman.get_resource_value_blocking<std::vector<i32>>(out);
+
+	const auto end = std::chrono::high_resolution_clock::now();
+	result = 0;
+	for (const i32 v : values) {
+		result += v;
+	}
+	return std::chrono::duration<f64>(end - start).count();
+}
+
+/// Schedules \p num_leaves fine-grained jobs that all depend on a single resource, followed by a binary reduction
+/// tree, and waits for the final result. Handles are stored in \p handles, which should have enough capacity for
+/// all of them so that only allocations made by the job system are counted. Returns the elapsed time in seconds.
+f64 run_fan_out_fan_in(
+	job_system::manager &jman, u32 num_leaves, std::vector<job_system::resource_handle> &handles,
+	u64 &result, u64 &allocations
+) {
+	handles.clear();
+	const u64 allocations_before = num_allocations.load();
+	const auto start = std::chrono::high_resolution_clock::now();
+
+	job_system::resource_handle seed = jman.create_resource_with_value<u64>(0x12345678u);
+	for (u32 i = 0; i < num_leaves; ++i) {
+		job_system::resource_handle &out = handles.emplace_back(jman.create_resource<u64>());
+		jman.schedule_mono_job(&leaf_job, { seed }, { out });
+	}
+	usize level_begin = 0;
+	usize level_end = handles.size();
+	while (level_end - level_begin > 1) {
+		for (usize i = level_begin; i + 1 < level_end; i += 2) {
+			job_system::resource_handle out = jman.create_resource<u64>();
+			jman.schedule_mono_job(&combine_job, { handles[i], handles[i + 1] }, { out });
+			handles.emplace_back(std::move(out));
+		}
+		if ((level_end - level_begin) % 2 == 1) {
+			handles.emplace_back(handles[level_end - 1]);
+		}
+		level_begin = level_end;
+		level_end = handles.size();
+	}
+	result = jman.get_resource_value_blocking<u64>(handles.back());
+
+	const auto end = std::chrono::high_resolution_clock::now();
+	allocations = num_allocations.load() - allocations_before;
+	return std::chrono::duration<f64>(end - start).count();
+}
+
+int main(int argc, char **argv) {
+	const u32 max_threads = std::max(std::thread::hardware_concurrency(), 1u);
+	const u32 num_leaves = argc > 1 ? static_cast<u32>(std::atoi(argv[1])) : 100000;
+	const u32 num_elements = argc > 2 ? static_cast<u32>(std::atoi(argv[2])) : 10000000;
+	const u32 num_repeats = 5;
+	const u32 num_jobs = 2 * num_leaves - 1;
+	log().info("Jobs per run: {}, elements per run: {}, max threads: {}", num_jobs, num_elements, max_threads);
+
+	std::vector<i32> elements(num_elements);
+	for (u32 i = 0; i < num_elements; ++i) {
+		elements[i] = static_cast<i32>(i % 1000);
+	}
+
+	for (u32 threads = 1; ; threads = std::min(threads * 2, max_threads)) {
+		auto jman = job_system::manager::spawn_workers(threads);
+		std::vector<job_system::resource_handle> handles;
+		handles.reserve(2 * num_leaves + 64);
+		f64 best_time = std::numeric_limits<f64>::max();
+		u64 result = 0;
+		u64 allocations = 0;
+		for (u32 i = 0; i < num_repeats; ++i) {
+			// the last run is measured after the job system has warmed up
+			best_time = std::min(best_time, run_fan_out_fan_in(jman, num_leaves, handles, result, allocations));
+		}
+		log().info(
+			"Threads: {:3}  Time: {:8.3f} ms  Throughput: {:12.0f} jobs/s  Allocations: {:.3f}/job  Result: {:x}",
+			threads, best_time * 1000.0, num_jobs / best_time,
+			static_cast<f64>(allocations) / num_jobs, result
+		);
+		handles.clear();
+		for (const bool use_parallel_for : { false, true }) {
+			f64 best_element_time = std::numeric_limits<f64>::max();
+			i64 sum = 0;
+			for (u32 i = 0; i < num_repeats; ++i) {
+				best_element_time = std::min(best_element_time, run_element_wise(jman, elements, use_parallel_for, sum));
+			}
+			log().info(
+				"    {:12}  Time: {:8.3f} ms  Throughput: {:12.0f} elements/s  Result: {}",
+				use_parallel_for ? "Parallel for" : "Multi job",
+				best_element_time * 1000.0, num_elements / best_element_time, sum
+			);
+		}
+		if (threads == max_threads) {
+			break;
+		}
+	}
+
+	return 0;
+}
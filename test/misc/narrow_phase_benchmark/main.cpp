@@ -0,0 +1,268 @@
+#include <chrono>
+#include <optional>
+#include <random>
+
+#include "lotus/types.h"
+#include "lotus/collision/contact.h"
+#include "lotus/collision/algorithms/epa.h"
+#include "lotus/collision/algorithms/gjk.h"
+#include "lotus/physics/world.h"
+#include "lotus/logging.h"
+
+#include "physics_utils.h"
+
+using namespace lotus;
+using namespace lotus::collision::types;
+
+/// Creates a roughly spherical polyhedron with the given number of random points on its surface.
+[[nodiscard]] std::pair<
+	collision::shapes::convex_polyhedron, collision::shapes::convex_polyhedron::properties
+> create_round_shape(u32 num_points) {
+	std::mt19937 rng(6789);
+	std::normal_distribution<scalar> dist;
+	std::vector<vec3> verts;
+	for (u32 i = 0; i < num_points; ++i) {
+		verts.emplace_back(vecu::normalize(vec3(dist(rng), dist(rng), dist(rng))) * 0.6f);
+	}
+	return collision::shapes::convex_polyhedron::bake(verts);
+}
+
+/// Adds a grid of slightly overlapping, randomly rotated boxes to the world.
+void add_boxes(physics::world &w, collision::shape &shape, physics::body_properties props, u32 count_per_axis) {
+	std::mt19937 rng(12345);
+	std::uniform_real_distribution<scalar> angle_dist(-0.3f, 0.3f);
+	const auto material = physics::material_properties(0.5f, 0.4f, 0.0f);
+	for (u32 z = 0; z < count_per_axis; ++z) {
+		for (u32 y = 0; y < count_per_axis; ++y) {
+			for (u32 x = 0; x < count_per_axis; ++x) {
+				const vec3 pos = vec3(static_cast<scalar>(x), static_cast<scalar>(y), static_cast<scalar>(z)) * 0.95f;
+				const uquats rot =
+					quat::from_normalized_axis_angle(vec3(1.0f, 0.0f, 0.0f), angle_dist(rng)) *
+					quat::from_normalized_axis_angle(vec3(0.0f, 1.0f, 0.0f), angle_dist(rng));
+				w.add_body(physics::body::create(shape, material, props, physics::body_state::stationary_at(pos, rot)));
+			}
+		}
+	}
+}
+
+/// Collects the contact points of all overlaps, used to check that parallel results match serial results.
+[[nodiscard]] std::vector<vec3> collect_contacts(const physics::world &w) {
+	std::vector<vec3> result;
+	for (const physics::world::overlap_data &overlap : w.get_overlaps()) {
+		if (overlap.contact) {
+			for (const physics::constraints::rigid_body_contact::point &pt : overlap.contact->contact_points) {
+				result.emplace_back(pt.local_position1);
+				result.emplace_back(pt.local_position2);
+			}
+		} else {
+			result.emplace_back(vec3::filled(std::numeric_limits<scalar>::max()));
+		}
+	}
+	return result;
+}
+
+/// Moves two boxes past each other in small steps, and checks that GJK gives the same result with and without
+/// warm starting.
+void check_gjk_warm_start(const collision::shapes::convex_polyhedron &box) {
+	std::mt19937 rng(54321);
+	std::uniform_real_distribution<scalar> offset_dist(-0.02f, 0.02f);
+	std::uniform_real_distribution<scalar> angle_dist(-0.05f, 0.05f);
+	u32 num_intersections = 0;
+	collision::gjk::persistent_result state = zero;
+	const collision::body_position pos1(zero, uquats::identity());
+	collision::body_position pos2(vec3(-2.0f, 0.0f, 0.0f), uquats::identity());
+	for (u32 i = 0; i < 400; ++i) {
+		pos2.position += vec3(0.01f + offset_dist(rng), offset_dist(rng), offset_dist(rng));
+		pos2.orientation =
+			quat::from_normalized_axis_angle(vecu::normalize(vec3(1.0f, 2.0f, 3.0f)), angle_dist(rng)) *
+			pos2.orientation;
+		const collision::polyhedron_pair pair(box, pos1, box, pos2);
+		const collision::gjk::result warm = collision::gjk::gjk(pair, state);
+		const collision::gjk::result cold = collision::gjk::gjk(pair);
+		crash_if(warm.has_intersection != cold.has_intersection);
+		state = warm.persistent;
+		num_intersections += warm.has_intersection ? 1 : 0;
+	}
+	// the boxes should have passed through each other
+	crash_if(num_intersections == 0);
+}
+
+/// Checks support vertices returned by \ref collision::shapes::convex_polyhedron::get_support_vertex() against
+/// testing all vertices, with and without hints.
+void check_support_vertices(const collision::shapes::convex_polyhedron &poly) {
+	std::mt19937 rng(13579);
+	std::normal_distribution<scalar> dir_dist;
+	std::uniform_int_distribution<usize> vert_dist(0, poly.vertices.size() - 1);
+	for (u32 i = 0; i < 1000; ++i) {
+		const vec3 dir(dir_dist(rng), dir_dist(rng), dir_dist(rng));
+		scalar expected = -std::numeric_limits<scalar>::infinity();
+		for (const vec3 v : poly.vertices) {
+			expected = std::max(expected, vec::dot(v, dir));
+		}
+		for (const auto hint : { collision::vertex_id::invalid, static_cast<collision::vertex_id>(vert_dist(rng)) }) {
+			const auto [vert, dot] = poly.get_support_vertex(dir, hint);
+			crash_if(std::abs(dot - expected) > 1e-5f);
+			crash_if(std::abs(vec::dot(poly.get_vertex(vert), dir) - expected) > 1e-5f);
+		}
+	}
+}
+
+/// Runs EPA on two overlapping copies of the given polyhedron with increasingly large vertex limits, including ones
+/// that are reached before the algorithm converges, and checks that the results are consistent. The polyhedron is
+/// expected to approximate a sphere with the given radius.
+void check_epa_vertex_limit(const collision::shapes::convex_polyhedron &poly, scalar radius) {
+	std::mt19937 rng(97531);
+	std::uniform_real_distribution<scalar> offset_dist(-0.5f, 0.5f);
+	std::uniform_real_distribution<scalar> angle_dist(-collision::constants::pi, collision::constants::pi);
+	const collision::body_position pos1(zero, uquats::identity());
+	for (u32 i = 0; i < 100; ++i) {
+		const collision::body_position pos2(
+			vec3(offset_dist(rng), offset_dist(rng), offset_dist(rng)),
+			quat::from_normalized_axis_angle(vecu::normalize(vec3(3.0f, 2.0f, 1.0f)), angle_dist(rng))
+		);
+		const collision::polyhedron_pair pair(poly, pos1, poly, pos2);
+		const collision::gjk::result gjk_res = collision::gjk::gjk(pair);
+		if (!gjk_res.has_intersection) {
+			continue;
+		}
+		// the penetration depth cannot exceed that of the two spheres
+		const scalar max_depth = 2.0f * radius - pos2.position.norm() + 1e-4f;
+		scalar prev_depth = -std::numeric_limits<scalar>::infinity();
+		const std::array<usize, 5> vertex_limits{ 5, 6, 16, 64, collision::epa::max_num_vertices };
+		for (const usize max_vertices : vertex_limits) {
+			const collision::epa::result res = collision::epa::epa(pair, gjk_res, max_vertices);
+			crash_if(res.normal.has_nan());
+			crash_if(std::abs(res.normal.norm() - 1.0f) > 1e-4f);
+			// the result face must be a face of the final polytope at the reported distance
+			for (const vec3 &p : res.simplex_positions) {
+				crash_if(std::abs(vec::dot(res.normal, p) - res.penetration_depth) > 1e-4f);
+			}
+			for (usize j = 0; j < 3; ++j) {
+				const vec3 expected = pair.simplex_vertex_position(res.vertices[j]);
+				crash_if((expected - res.simplex_positions[j]).norm() > 1e-4f);
+			}
+			// expanding the polytope can only move its closest face further from the origin
+			crash_if(res.penetration_depth < prev_depth - 1e-4f);
+			crash_if(res.penetration_depth > max_depth);
+			prev_depth = res.penetration_depth;
+		}
+	}
+}
+
+/// Checks sphere-box contacts against clamping the center of the sphere to the box. The box is centered at the
+/// origin and has the given half size.
+void check_sphere_box(const collision::shapes::convex_polyhedron &box, vec3 half_size) {
+	std::mt19937 rng(24680);
+	std::uniform_real_distribution<scalar> pos_dist(-1.5f, 1.5f);
+	std::uniform_real_distribution<scalar> angle_dist(-collision::constants::pi, collision::constants::pi);
+	collision::shapes::sphere sphere = collision::shapes::sphere::from_radius(0.4f);
+	sphere.offset = vec3(0.1f, -0.2f, 0.05f);
+	const collision::body_position box_pos(zero, uquats::identity());
+	for (u32 i = 0; i < 10000; ++i) {
+		const collision::body_position sphere_pos(
+			vec3(pos_dist(rng), pos_dist(rng), pos_dist(rng)),
+			quat::from_normalized_axis_angle(vecu::normalize(vec3(1.0f, 2.0f, 3.0f)), angle_dist(rng))
+		);
+		const vec3 center = sphere_pos.local_to_global(sphere.offset);
+		const vec3 clamped = matm::min(matm::max(center, -half_size), half_size);
+		const std::optional<collision::contact_manifold> manifold =
+			collision::contact::detect(sphere, sphere_pos, box, box_pos);
+		if (clamped == center) { // the center is inside the box
+			crash_if(!manifold);
+			continue;
+		}
+		const scalar dist = (clamped - center).norm();
+		// skip cases that are too close to call
+		if (std::abs(dist - sphere.radius) < 1e-4f) {
+			continue;
+		}
+		crash_if(manifold.has_value() != (dist < sphere.radius));
+		if (manifold) {
+			crash_if(manifold->points.size() != 1);
+			crash_if((manifold->points[0].local_position2 - clamped).norm() > 1e-4f);
+			crash_if((manifold->normal - (clamped - center) / dist).norm() > 1e-3f);
+			const vec3 sphere_point = sphere_pos.local_to_global(manifold->points[0].local_position1);
+			crash_if(std::abs((sphere_point - center).norm() - sphere.radius) > 1e-4f);
+		}
+	}
+}
+
+/// Fills a world with the given shape, then measures the time it takes to update all contacts using different
+/// numbers of threads.
+void benchmark_shape(
+	const char *name, collision::shape &shape, physics::body_properties props,
+	u32 count_per_axis, u32 num_iterations, u32 max_threads
+) {
+	physics::world w;
+	add_boxes(w, shape, props, count_per_axis);
+	w.update_contact_constraints(); // build overlaps
+	// the first update starts GJK from scratch, while later ones are warm started and may converge differently
+	w.update_contact_constraints();
+	const std::vector<vec3> reference = collect_contacts(w);
+	const usize num_pairs = w.get_overlaps().size();
+	log().info("{}: {} bodies, {} overlapping pairs", name, w.get_bodies().size(), num_pairs);
+
+	for (u32 num_threads = 1; ; num_threads = std::min(num_threads * 2, max_threads)) {
+		// the calling thread also participates, so spawn one fewer worker
+		std::optional<job_system::manager> manager;
+		if (num_threads > 1) {
+			manager.emplace(job_system::manager::spawn_workers(num_threads - 1));
+		}
+		w.job_manager = manager ? &manager.value() : nullptr;
+
+		const auto begin = std::chrono::high_resolution_clock::now();
+		for (u32 i = 0; i < num_iterations; ++i) {
+			w.update_contact_constraints();
+		}
+		const auto end = std::chrono::high_resolution_clock::now();
+		const f64 seconds = std::chrono::duration<f64>(end - begin).count();
+
+		crash_if(collect_contacts(w) != reference);
+		log().info(
+			"{}, {} threads: {} pairs/s ({} ms per update)",
+			name, num_threads, static_cast<u64>(static_cast<f64>(num_pairs * num_iterations) / seconds),
+			seconds * 1000.0 / num_iterations
+		);
+		w.job_manager = nullptr;
+
+		if (num_threads == max_threads) {
+			break;
+		}
+	}
+}
+
+int main(int argc, char **argv) {
+	const u32 count_per_axis = argc > 1 ? static_cast<u32>(std::atoi(argv[1])) : 16;
+	const u32 num_iterations = argc > 2 ? static_cast<u32>(std::atoi(argv[2])) : 20;
+	const u32 max_threads =
+		argc > 3 ? static_cast<u32>(std::atoi(argv[3])) : std::max(std::thread::hardware_concurrency(), 1u);
+
+	auto [box_poly, box_poly_props] = create_box_shape(vec3::filled(1.0f));
+	check_gjk_warm_start(box_poly);
+	check_support_vertices(box_poly);
+	check_sphere_box(box_poly, vec3::filled(0.5f));
+	collision::shape box_shape = collision::shape::create(std::move(box_poly));
+	benchmark_shape(
+		"box", box_shape, box_poly_props.get_body_properties(1.0f), count_per_axis, num_iterations, max_threads
+	);
+
+	for (const u32 num_points : { 24u, 256u }) {
+		auto [round_poly, round_poly_props] = create_round_shape(num_points);
+		check_support_vertices(round_poly);
+		check_epa_vertex_limit(round_poly, 0.6f);
+		const usize num_vertices = round_poly.vertices.size();
+		collision::shape round_shape = collision::shape::create(std::move(round_poly));
+		benchmark_shape(
+			num_vertices < collision::shapes::convex_polyhedron::hill_climbing_threshold ? "small hull" : "large hull",
+			round_shape, round_poly_props.get_body_properties(1.0f), count_per_axis, num_iterations, max_threads
+		);
+	}
+
+	// spheres use closed-form tests and should be the cheapest shape
+	const collision::shapes::sphere sphere = collision::shapes::sphere::from_radius(0.5f);
+	const physics::body_properties sphere_props = sphere.get_body_properties(1.0f);
+	collision::shape sphere_shape = collision::shape::create(sphere);
+	benchmark_shape("sphere", sphere_shape, sphere_props, count_per_axis, num_iterations, max_threads);
+
+	return 0;
+}
@@ -0,0 +1,313 @@
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+#include <cstdlib>
+
+#include "lotus/types.h"
+#include "lotus/utils/profiler.h"
+#include "lotus/physics/world.h"
+#include "lotus/physics/solvers/avbd/solver.h"
+#include "lotus/physics/solvers/sequential_impulse/solver.h"
+#include "lotus/physics/solvers/xpbd/solver.h"
+
+#include "physics_utils.h"
+
+using namespace lotus;
+using namespace lotus::collision::types;
+
+namespace avbd = lotus::physics::solvers::avbd;
+namespace sequential_impulse = lotus::physics::solvers::sequential_impulse;
+namespace xpbd = lotus::physics::solvers::xpbd;
+
+constexpr scalar pi = collision::constants::pi; ///< Pi.
+constexpr scalar time_step = 1.0f / 60.0f; ///< Duration of a single frame.
+
+/// A scene from the testbed with its default settings, set up without the renderer.
+struct scene {
+	/// Adds a shape to this scene. The shape is kept alive for as long as this scene.
+	collision::shape &add_shape(collision::shape s) {
+		return shapes.emplace_back(std::move(s));
+	}
+	/// Adds an infinite kinematic ground plane facing +Y.
+	void add_ground(physics::material_properties material) {
+		collision::shape &plane = add_shape(collision::shape::create(collision::shapes::plane()));
+		world.add_body(physics::body::create(
+			plane, material, physics::body_properties::kinematic(), physics::body_state::stationary_at(
+				zero, quat::from_normalized_axis_angle(vec3(1.0f, 0.0f, 0.0f), -0.5f * pi)
+			)
+		));
+	}
+
+	std::deque<collision::shape> shapes; ///< All shapes used by bodies in \ref world.
+	physics::world world; ///< The world.
+	/// Called with the time step before each frame, to move kinematic objects and to apply inputs.
+	std::function<void(scalar)> before_timestep;
+};
+
+
+/// The box stack test: a pyramid of boxes resting on the ground.
+void create_box_stack_scene(scene &s) {
+	constexpr u32 base_count = 20;
+	constexpr u32 num_rows = 10;
+	constexpr scalar gap = 0.02f;
+
+	s.world.gravity = vec3(0.0f, -9.8f, 0.0f);
+	const auto material = physics::material_properties(0.4f, 0.35f, 0.0f);
+	s.add_ground(material);
+
+	auto [box_poly, box_poly_props] = create_box_shape(vec3::filled(1.0f));
+	collision::shape &box_shape = s.add_shape(collision::shape::create(std::move(box_poly)));
+	const physics::body_properties box_props = box_poly_props.get_body_properties(1.0f);
+
+	scalar x = -(1.0f + gap) * (static_cast<scalar>(base_count) - 1.0f) / 2.0f;
+	scalar y = 0.5f + gap;
+	for (u32 yi = 0; yi < num_rows; ++yi, y += 1.0f + gap, x += 0.5f * (1.0f + gap)) {
+		scalar cx = x;
+		for (u32 xi = 0; xi + yi < base_count; ++xi, cx += 1.0f + gap) {
+			s.world.add_body(physics::body::create(
+				box_shape, material, box_props, physics::body_state::stationary_at(vec3(cx, y, 0.0f), uquats::identity())
+			));
+		}
+	}
+}
+
+/// The car test: a body with four suspended wheels that are driven forward.
+void create_car_scene(scene &s) {
+	constexpr scalar power = 1000.0f;
+
+	s.world.gravity = vec3(0.0f, -9.8f, 0.0f);
+	car new_car = create_car(s.world, s.shapes, car_parameters());
+	s.add_ground(physics::material_properties(0.5f, 0.4f, 0.0f));
+
+	// hold the accelerator for the entire run
+	s.before_timestep = [wheels = std::move(new_car.wheels)](scalar dt) {
+		const scalar torque = power * dt;
+		for (const car_wheel &wheel : wheels) {
+			wheel.body->applied_torque += wheel.body->state.position.orientation.rotate(vec3(-torque, 0.0f, 0.0f));
+		}
+	};
+}
+
+/// The FEM cloth test: a cloth held at two corners, pushed around by a moving kinematic sphere.
+void create_fem_cloth_scene(scene &s, xpbd::solver &solver) {
+	constexpr scalar sphere_travel = 1.5f;
+	constexpr scalar sphere_period = 3.0f;
+
+	s.world.gravity = vec3(0.0f, -10.0f, 0.0f);
+	solver.face_constraint_projection_type = xpbd::constraints::face::projection_type::gauss_seidel;
+	create_fem_cloth(solver, fem_cloth_parameters());
+
+	const auto material = physics::material_properties(0.5f, 0.45f, 0.2f);
+	collision::shape &sphere_shape = s.add_shape(collision::shape::create(collision::shapes::sphere::from_radius(0.25f)));
+	physics::body *sphere = &s.world.add_body(physics::body::create(
+		sphere_shape, material, physics::body_properties::kinematic(),
+		physics::body_state::stationary_at(zero, uquats::identity())
+	))->this_body;
+	s.add_ground(material);
+
+	s.before_timestep = [sphere, time = 0.0f](scalar dt) mutable {
+		time += dt;
+		sphere->state.position.position =
+			vec3(sphere_travel * std::cos((2.0f * pi / sphere_period) * time), 0.5f, 0.0f);
+	};
+}
+
+/// The Cosserat rod test: a grid of rods hanging next to a kinematic sphere.
+template <typename Solver> void create_cosserat_rod_scene(scene &s, Solver &solver) {
+	constexpr u32 num_parts = 10;
+	constexpr scalar length = 0.2f;
+	constexpr scalar density = 1000.0f;
+	constexpr scalar diameter = 0.05f;
+	constexpr scalar stiffness = 1.0f;
+
+	s.world.gravity = vec3(0.0f, -9.8f, 0.0f);
+	collision::shape &sphere_shape = s.add_shape(collision::shape::create(collision::shapes::sphere::from_radius(0.03f)));
+	s.world.add_body(physics::body::create(
+		sphere_shape, physics::material_properties(1.0f, 1.0f, 0.0f), physics::body_properties::kinematic(),
+		physics::body_state::stationary_at(vec3(0.0f, 0.0f, 0.5f * length), uquats::identity())
+	));
+
+	for (u32 x = 0; x < 5; ++x) {
+		for (u32 y = 0; y < 5; ++y) {
+			const vec3 start(0.01f * static_cast<scalar>(x), 0.01f * static_cast<scalar>(y), 0.0f);
+			const vec3 end = start + vec3(0.0f, 0.0f, length);
+			if constexpr (std::is_same_v<Solver, avbd::solver>) {
+				create_straight_rod_avbd(solver, start, end, num_parts, density, diameter, stiffness, stiffness);
+			} else {
+				create_straight_rod_xpbd(solver, start, end, num_parts, density, diameter, stiffness, stiffness);
+			}
+		}
+	}
+}
+
+
+/// Writes the given string as a JSON string.
+void write_json_string(std::ostream &out, std::string_view str) {
+	constexpr char hex_digits[] = "0123456789abcdef";
+	out << '"';
+	for (const char c : str) {
+		if (c == '"' || c == '\\') {
+			out << '\\' << c;
+		} else if (static_cast<unsigned char>(c) < 0x20) {
+			const auto code = static_cast<unsigned char>(c);
+			out << "\\u00" << hex_digits[code >> 4] << hex_digits[code & 0xF];
+		} else {
+			out << c;
+		}
+	}
+	out << '"';
+}
+
+/// Writes all profiler stack frames below the given one as JSON object members, keyed by their paths. Times are
+/// averaged over the given number of frames.
+void write_phases(
+	std::ostream &out, const profiler::analysis_stack_frame &frame, const std::string &path,
+	f64 ms_per_tick, u32 num_frames, bool &first
+) {
+	for (const auto &[label, child] : frame.children) {
+		const std::string child_path =
+			(path.empty() ? "" : path + "/") + std::string(reinterpret_cast<const char*>(label));
+		// exclusive times are not reliable when samples are merged from multiple analyses, so compute them here
+		profiler::time_t exclusive = child.total_time_inclusive;
+		for (const auto &[grandchild_label, grandchild] : child.children) {
+			exclusive -= grandchild.total_time_inclusive;
+		}
+
+		out << (first ? "" : ",");
+		first = false;
+		write_json_string(out, child_path);
+		out <<
+			":{\"inclusive_ms\":" << static_cast<f64>(child.total_time_inclusive) * ms_per_tick / num_frames <<
+			",\"exclusive_ms\":" << static_cast<f64>(exclusive) * ms_per_tick / num_frames <<
+			",\"calls\":" << static_cast<f64>(child.count) / num_frames << "}";
+
+		write_phases(out, child, child_path, ms_per_tick, num_frames, first);
+	}
+}
+
+/// Sets up a scene using the given function, steps it for the given number of frames using the given solver, and
+/// prints timings and statistics as a single line of JSON.
+template <typename Solver, typename Setup> void run(
+	std::string_view scene_name, std::string_view solver_name, u32 num_frames, Setup &&setup
+) {
+	scene s;
+	Solver solver;
+	solver.physics_world = &s.world;
+	setup(s, solver);
+
+	// discard samples recorded during setup
+	profiler::thread_manager::get_thread_data().flush();
+	(void)profiler::thread_manager::instance().flush();
+
+	profiler::analysis_stack_frame phases;
+	u64 num_dropped_samples = 0;
+	f64 total_ms = 0.0;
+	f64 total_contacts = 0.0;
+	f64 total_contact_points = 0.0;
+	f64 total_sleeping_bodies = 0.0;
+	for (u32 i = 0; i < num_frames; ++i) {
+		if (s.before_timestep) {
+			s.before_timestep(time_step);
+		}
+
+		const auto begin = std::chrono::high_resolution_clock::now();
+		{
+			profiler::scope p(u8"Timestep");
+			solver.timestep(time_step);
+		}
+		const auto end = std::chrono::high_resolution_clock::now();
+		total_ms += std::chrono::duration<f64, std::milli>(end - begin).count();
+
+		// collect samples every frame so that the per-thread sample buffers do not overflow
+		profiler::thread_manager::get_thread_data().flush();
+		for (const profiler::thread_samples &thread : profiler::thread_manager::instance().flush()) {
+			for (const profiler::samples &batch : thread.batches) {
+				batch.analyze(phases);
+			}
+			num_dropped_samples += thread.num_dropped_samples;
+		}
+
+		for (const physics::world::overlap_data &overlap : s.world.get_overlaps()) {
+			if (overlap.contact && !overlap.contact->contact_points.empty()) {
+				total_contacts += 1.0;
+				total_contact_points += static_cast<f64>(overlap.contact->contact_points.size());
+			}
+		}
+		for (const std::unique_ptr<physics::world::body_data> &bdata : s.world.get_bodies()) {
+			total_sleeping_bodies += bdata->asleep ? 1.0 : 0.0;
+		}
+	}
+
+	std::ostream &out = std::cout;
+	out << "{\"scene\":";
+	write_json_string(out, scene_name);
+	out << ",\"solver\":";
+	write_json_string(out, solver_name);
+	out <<
+		",\"frames\":" << num_frames <<
+		",\"ms_per_frame\":" << total_ms / num_frames <<
+		",\"bodies\":" << s.world.get_bodies().size() <<
+		",\"sleeping_bodies\":" << total_sleeping_bodies / num_frames <<
+		",\"contacts\":" << total_contacts / num_frames <<
+		",\"contact_points\":" << total_contact_points / num_frames <<
+		",\"joints\":" << s.world.springs.size() + s.world.pins.size() + s.world.hinges.size();
+	if constexpr (std::is_same_v<Solver, xpbd::solver>) {
+		out <<
+			",\"particles\":" << solver.particles.size() <<
+			",\"orientations\":" << solver.orientations.size() <<
+			",\"particle_constraints\":" <<
+				solver.particle_spring_constraints.size() + solver.face_constraints.size() +
+				solver.bend_constraints.size() + solver.rod_stretch_shear_constraints.size() +
+				solver.rod_bend_twist_constraints.size();
+	} else if constexpr (std::is_same_v<Solver, avbd::solver>) {
+		out <<
+			",\"particles\":" << solver.particles.size() <<
+			",\"orientations\":" << solver.orientations.size() <<
+			",\"particle_constraints\":" <<
+				solver.rod_stretch_shear_constraints.size() + solver.rod_bend_twist_constraints.size();
+	}
+	out << ",\"dropped_samples\":" << num_dropped_samples << ",\"phases\":{";
+	bool first = true;
+	write_phases(out, phases, "", 1000.0 / static_cast<f64>(profiler::get_timer_frequency()), num_frames, first);
+	out << "}}" << std::endl;
+}
+
+/// Runs the given rigid body scene with all solvers.
+void run_rigid_body_scene(std::string_view name, u32 num_frames, void (*setup)(scene&)) {
+	const auto setup_world = [setup](scene &s, auto&) {
+		setup(s);
+	};
+	run<sequential_impulse::solver>(name, "sequential_impulse", num_frames, setup_world);
+	run<avbd::solver>(name, "avbd", num_frames, setup_world);
+	run<xpbd::solver>(name, "xpbd", num_frames, setup_world);
+}
+
+int main(int argc, char **argv) {
+	const u32 num_frames = argc > 1 ? static_cast<u32>(std::atoi(argv[1])) : 120;
+	// only run the scene with the given name if one is specified
+	const std::string_view filter = argc > 2 ? argv[2] : "";
+	const auto enabled = [&](std::string_view name) {
+		return filter.empty() || filter == name;
+	};
+
+	if (enabled("box_stack")) {
+		run_rigid_body_scene("box_stack", num_frames, create_box_stack_scene);
+	}
+	if (enabled("car")) {
+		run_rigid_body_scene("car", num_frames, create_car_scene);
+	}
+	if (enabled("fem_cloth")) {
+		run<xpbd::solver>("fem_cloth", "xpbd", num_frames, create_fem_cloth_scene);
+	}
+	if (enabled("cosserat_rod")) {
+		run<avbd::solver>("cosserat_rod", "avbd", num_frames, create_cosserat_rod_scene<avbd::solver>);
+		run<xpbd::solver>("cosserat_rod", "xpbd", num_frames, create_cosserat_rod_scene<xpbd::solver>);
+	}
+
+	return 0;
+}
@@ -0,0 +1,160 @@
+#include <atomic>
+#include <chrono>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include "lotus/types.h"
+#include "lotus/utils/profiler.h"
+#include "lotus/utils/profiler_trace.h"
+#include "lotus/logging.h"
+
+using namespace lotus;
+
+/// Converts the given number of timer ticks into nanoseconds.
+[[nodiscard]] f64 ticks_to_nanoseconds(profiler::time_t ticks) {
+	return static_cast<f64>(ticks) * 1e9 / static_cast<f64>(profiler::get_timer_frequency());
+}
+
+int main(int argc, char **argv) {
+	const u32 num_iterations = argc > 1 ? static_cast<u32>(std::atoi(argv[1])) : 1000000;
+	const u32 num_threads = argc > 2 ? static_cast<u32>(std::atoi(argv[2])) : 4;
+	const u32 batch_size = 1000; // number of scopes between flushes, similar to a busy frame
+
+	log().info("Timer frequency: {} Hz", profiler::get_timer_frequency());
+#ifdef LOTUS_PROFILER_USE_TSC
+	log().info("Invariant TSC: {}", profiler::_details::has_invariant_tsc());
+#endif
+
+	{ // check the timer against the standard library
+		const auto chrono_begin = std::chrono::steady_clock::now();
+		const profiler::time_t timer_begin = profiler::get_timer();
+		while (std::chrono::steady_clock::now() - chrono_begin < std::chrono::milliseconds(100)) {
+		}
+		const profiler::time_t timer_end = profiler::get_timer();
+		const auto chrono_end = std::chrono::steady_clock::now();
+		const f64 chrono_ns = std::chrono::duration<f64, std::nano>(chrono_end - chrono_begin).count();
+		log().info(
+			"Timer drift vs. steady_clock over 100ms: {:.3f}%",
+			(ticks_to_nanoseconds(timer_end - timer_begin) / chrono_ns - 1.0) * 100.0
+		);
+	}
+
+	{ // cost of reading the timer
+		profiler::time_t sink = 0;
+		const profiler::time_t begin = profiler::get_timer();
+		for (u32 i = 0; i < num_iterations; ++i) {
+			sink += profiler::get_timer();
+		}
+		const profiler::time_t end = profiler::get_timer();
+		log().info(
+			"get_timer(): {:.2f} ns/call (checksum {})", ticks_to_nanoseconds(end - begin) / num_iterations, sink & 1
+		);
+	}
+
+	{ // cost of an empty scope, including the periodic flush and collection
+		profiler::thread_manager::get_thread_data().flush();
+		u64 num_collected = 0;
+		u64 num_dropped = 0;
+		const profiler::time_t begin = profiler::get_timer();
+		for (u32 i = 0; i < num_iterations; ++i) {
+			{
+				profiler::scope p1(u8"Empty Scope");
+			}
+			if ((i + 1) % batch_size == 0) {
+				profiler::thread_manager::get_thread_data().flush();
+				for (const profiler::thread_samples &t : profiler::thread_manager::instance().flush()) {
+					num_collected += t.batches.size();
+					num_dropped += t.num_dropped_samples;
+				}
+			}
+		}
+		const profiler::time_t end = profiler::get_timer();
+		log().info(
+			"profiler::scope: {:.2f} ns/scope ({} batches collected, {} samples dropped)",
+			ticks_to_nanoseconds(end - begin) / num_iterations, num_collected, num_dropped
+		);
+	}
+
+	{ // multiple threads recording scopes while this thread collects them
+		std::atomic_bool start = false;
+		std::atomic_uint32_t num_running = num_threads;
+		std::vector<std::thread> threads;
+		for (u32 i = 0; i < num_threads; ++i) {
+			threads.emplace_back([&]() {
+				profiler::thread_accumulator &acc = profiler::thread_manager::get_thread_data();
+				while (!start.load()) {
+				}
+				for (u32 j = 0; j < num_iterations; ++j) {
+					{
+						profiler::scope p1(u8"Outer Scope");
+						profiler::scope p2(u8"Inner Scope");
+					}
+					if ((j + 1) % batch_size == 0) {
+						acc.flush();
+					}
+				}
+				--num_running;
+			});
+		}
+
+		u64 num_timestamps = 0;
+		u64 num_dropped = 0;
+		const auto collect = [&]() {
+			for (const profiler::thread_samples &t : profiler::thread_manager::instance().flush()) {
+				for (const profiler::samples &b : t.batches) {
+					num_timestamps += b.timestamps.size();
+				}
+				num_dropped += t.num_dropped_samples;
+			}
+		};
+		const profiler::time_t begin = profiler::get_timer();
+		start = true;
+		while (num_running.load() > 0) {
+			collect();
+			std::this_thread::yield();
+		}
+		const profiler::time_t end = profiler::get_timer();
+		for (std::thread &t : threads) {
+			t.join();
+		}
+		collect();
+
+		const u64 expected = static_cast<u64>(num_threads) * num_iterations * 4;
+		crash_if(num_timestamps + num_dropped != expected);
+		log().info(
+			"{} threads: {:.2f} ns/scope, {} of {} timestamps collected, {} dropped",
+			num_threads, ticks_to_nanoseconds(end - begin) / (num_iterations * 2.0),
+			num_timestamps, expected, num_dropped
+		);
+	}
+
+	{ // cost of exporting traces
+		(void)profiler::thread_manager::instance().flush();
+		for (u32 i = 0; i < batch_size * 10; ++i) {
+			profiler::scope p1(u8"Outer Scope");
+			profiler::scope p2(u8"Inner \"Scope\"");
+		}
+		profiler::thread_manager::get_thread_data().flush();
+		const std::vector<profiler::thread_samples> samples = profiler::thread_manager::instance().flush();
+
+		for (const auto [fmt, name] : {
+			std::pair(profiler::trace_format::chrome_json, "Chrome JSON"),
+			std::pair(profiler::trace_format::perfetto, "Perfetto"),
+		}) {
+			std::ostringstream out;
+			const profiler::time_t begin = profiler::get_timer();
+			profiler::trace_writer writer(out, fmt);
+			writer.write(samples);
+			writer.finish();
+			const profiler::time_t end = profiler::get_timer();
+			log().info(
+				"{} export: {:.2f} ns/event, {} bytes for {} events",
+				name, ticks_to_nanoseconds(end - begin) / writer.get_num_events(),
+				out.view().size(), writer.get_num_events()
+			);
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,146 @@
+#include <chrono>
+#include <optional>
+
+#include "lotus/types.h"
+#include "lotus/physics/world.h"
+#include "lotus/physics/solvers/xpbd/solver.h"
+#include "lotus/logging.h"
+
+using namespace lotus;
+using namespace lotus::collision::types;
+
+namespace xpbd = lotus::physics::solvers::xpbd;
+
+/// Adds a spring between the two particles with the given Young's modulus.
+void add_spring(xpbd::solver &solver, usize i1, usize i2, scalar youngs_modulus) {
+	auto &spring = solver.particle_spring_constraints.emplace_back(uninitialized);
+	spring.particle1 = i1;
+	spring.particle2 = i2;
+	spring.properties.length = (solver.particles[i1].state.position - solver.particles[i2].state.position).norm();
+	spring.properties.inverse_stiffness = 1.0f / (spring.properties.length * youngs_modulus);
+}
+
+/// Adds a face constraint for the given triangle.
+void add_face(xpbd::solver &solver, usize i1, usize i2, usize i3) {
+	constexpr scalar thickness = 0.001f;
+	auto &face = solver.face_constraints.emplace_back(uninitialized);
+	face.particle1 = i1;
+	face.particle2 = i2;
+	face.particle3 = i3;
+	face.state = xpbd::constraints::face::constraint_state::from_rest_pose(
+		solver.particles[i1].state.position,
+		solver.particles[i2].state.position,
+		solver.particles[i3].state.position,
+		thickness
+	);
+	face.properties = xpbd::constraints::face::constraint_properties::from_material_properties(1000000.0f, 0.3f);
+}
+
+/// Adds a bend constraint between the two triangles sharing the given edge.
+void add_bend(xpbd::solver &solver, usize e1, usize e2, usize x3, usize x4) {
+	constexpr scalar thickness = 0.001f;
+	auto &bend = solver.bend_constraints.emplace_back(uninitialized);
+	bend.particle_edge1 = e1;
+	bend.particle_edge2 = e2;
+	bend.particle3 = x3;
+	bend.particle4 = x4;
+	bend.state = xpbd::constraints::bend::constraint_state::from_rest_pose(
+		solver.particles[e1].state.position,
+		solver.particles[e2].state.position,
+		solver.particles[x3].state.position,
+		solver.particles[x4].state.position
+	);
+	bend.properties =
+		xpbd::constraints::bend::constraint_properties::from_material_properties(1000000.0f, 0.3f, thickness);
+}
+
+/// Creates a square cloth held at two corners, with spring, face, and bend constraints.
+void create_cloth(xpbd::solver &solver, u32 side_segments) {
+	const scalar segment_length = 1.0f / static_cast<scalar>(side_segments - 1);
+	const auto index = [&](u32 x, u32 y) {
+		return static_cast<usize>(y) * side_segments + x;
+	};
+	for (u32 y = 0; y < side_segments; ++y) {
+		for (u32 x = 0; x < side_segments; ++x) {
+			auto props = physics::particle_properties::from_mass(0.01f);
+			if (x == 0 && (y == 0 || y == side_segments - 1)) {
+				props = physics::particle_properties::kinematic();
+			}
+			const auto state = physics::particle_state::stationary_at(
+				vec3(static_cast<scalar>(x) * segment_length, 1.0f, static_cast<scalar>(y) * segment_length)
+			);
+			solver.particles.emplace_back(physics::particle::create(props, state));
+		}
+	}
+	for (u32 y = 0; y < side_segments; ++y) {
+		for (u32 x = 0; x < side_segments; ++x) {
+			if (x > 0) {
+				add_spring(solver, index(x - 1, y), index(x, y), 100000.0f);
+			}
+			if (y > 0) {
+				add_spring(solver, index(x, y - 1), index(x, y), 100000.0f);
+			}
+			if (x > 0 && y > 0) {
+				add_spring(solver, index(x - 1, y - 1), index(x, y), 10000.0f);
+				add_face(solver, index(x - 1, y - 1), index(x - 1, y), index(x, y - 1));
+				add_face(solver, index(x, y - 1), index(x - 1, y), index(x, y));
+				add_bend(solver, index(x, y - 1), index(x - 1, y), index(x - 1, y - 1), index(x, y));
+			}
+		}
+	}
+}
+
+int main(int argc, char **argv) {
+	const u32 side_segments = argc > 1 ? static_cast<u32>(std::atoi(argv[1])) : 128;
+	const u32 num_steps = argc > 2 ? static_cast<u32>(std::atoi(argv[2])) : 20;
+	const u32 max_threads =
+		argc > 3 ? static_cast<u32>(std::atoi(argv[3])) : std::max(std::thread::hardware_concurrency(), 2u);
+
+	std::optional<std::vector<vec3>> parallel_reference;
+	for (u32 num_threads = 1; ; num_threads = std::min(num_threads * 2, max_threads)) {
+		physics::world w;
+		w.gravity = vec3(0.0f, -10.0f, 0.0f);
+		xpbd::solver solver;
+		solver.physics_world = &w;
+		create_cloth(solver, side_segments);
+
+		// the calling thread also participates, so spawn one fewer worker
+		std::optional<job_system::manager> manager;
+		if (num_threads > 1) {
+			manager.emplace(job_system::manager::spawn_workers(num_threads - 1));
+		}
+		solver.job_manager = manager ? &manager.value() : nullptr;
+
+		const auto begin = std::chrono::high_resolution_clock::now();
+		for (u32 i = 0; i < num_steps; ++i) {
+			solver.timestep(1.0f / 60.0f);
+		}
+		const auto end = std::chrono::high_resolution_clock::now();
+		const f64 seconds = std::chrono::duration<f64>(end - begin).count();
+
+		// parallel results depend only on the coloring, not on the number of threads
+		if (manager) {
+			std::vector<vec3> positions;
+			for (const physics::particle &p : solver.particles) {
+				positions.emplace_back(p.state.position);
+			}
+			if (parallel_reference) {
+				crash_if(positions != parallel_reference.value());
+			} else {
+				parallel_reference.emplace(std::move(positions));
+			}
+		}
+
+		log().info(
+			"{} threads: {} ms per step, {} particles, {} springs, {} faces, {} bends",
+			num_threads, seconds * 1000.0 / num_steps, solver.particles.size(),
+			solver.particle_spring_constraints.size(), solver.face_constraints.size(), solver.bend_constraints.size()
+		);
+
+		if (num_threads == max_threads) {
+			break;
+		}
+	}
+
+	return 0;
+}
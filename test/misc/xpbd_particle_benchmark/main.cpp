@@ -0,0 +1,115 @@
+#include <chrono>
+#include <random>
+
+#include "lotus/types.h"
+#include "lotus/physics/world.h"
+#include "lotus/physics/solvers/xpbd/solver.h"
+#include "lotus/logging.h"
+
+using namespace lotus;
+using namespace lotus::collision::types;
+
+/// A world with a grid of static spheres, and a solver with a sheet of particles above them.
+struct scene {
+	/// Creates the scene.
+	scene(u32 spheres_per_axis, u32 particles_per_axis) {
+		w.gravity = vec3(0.0f, 0.0f, -10.0f);
+		solver.physics_world = &w;
+
+		const auto material = physics::material_properties(0.5f, 0.4f, 0.0f);
+		const auto props = physics::body_properties::kinematic();
+		const scalar sphere_spacing = size / static_cast<scalar>(spheres_per_axis);
+		for (u32 y = 0; y < spheres_per_axis; ++y) {
+			for (u32 x = 0; x < spheres_per_axis; ++x) {
+				const vec3 pos(
+					(static_cast<scalar>(x) + 0.5f) * sphere_spacing,
+					(static_cast<scalar>(y) + 0.5f) * sphere_spacing,
+					0.0f
+				);
+				w.add_body(physics::body::create(
+					sphere_shape, material, props, physics::body_state::stationary_at(pos, uquats::identity())
+				));
+			}
+		}
+
+		std::mt19937 rng(12345);
+		std::uniform_real_distribution<scalar> height_dist(sphere_radius, sphere_radius + 0.5f);
+		const scalar particle_spacing = size / static_cast<scalar>(particles_per_axis);
+		for (u32 y = 0; y < particles_per_axis; ++y) {
+			for (u32 x = 0; x < particles_per_axis; ++x) {
+				const vec3 pos(
+					static_cast<scalar>(x) * particle_spacing,
+					static_cast<scalar>(y) * particle_spacing,
+					height_dist(rng)
+				);
+				solver.particles.emplace_back(physics::particle::create(
+					physics::particle_properties::from_mass(1.0f), physics::particle_state::stationary_at(pos)
+				));
+			}
+		}
+	}
+
+	constexpr static scalar size = 32.0f; ///< Size of the scene along the X and Y axes.
+	constexpr static scalar sphere_radius = 1.5f; ///< Radius of all spheres.
+
+	/// Shape of all spheres.
+	collision::shape sphere_shape = collision::shape::create(collision::shapes::sphere::from_radius(sphere_radius));
+	physics::world w; ///< The world.
+	physics::solvers::xpbd::solver solver; ///< The solver.
+};
+
+/// Runs the given number of time steps and returns the time per step in milliseconds, along with the final particle
+/// positions.
+[[nodiscard]] std::pair<f64, std::vector<vec3>> run(
+	u32 spheres_per_axis, u32 particles_per_axis, u32 num_steps, scalar margin
+) {
+	scene s(spheres_per_axis, particles_per_axis);
+	s.solver.particle_collision_margin = margin;
+
+	const auto begin = std::chrono::high_resolution_clock::now();
+	for (u32 i = 0; i < num_steps; ++i) {
+		s.solver.timestep(1.0f / 60.0f);
+	}
+	const auto end = std::chrono::high_resolution_clock::now();
+
+	std::vector<vec3> positions;
+	for (const physics::particle &p : s.solver.particles) {
+		positions.emplace_back(p.state.position);
+	}
+	return { std::chrono::duration<f64, std::milli>(end - begin).count() / num_steps, std::move(positions) };
+}
+
+int main(int argc, char **argv) {
+	const u32 max_particles_per_axis = argc > 1 ? static_cast<u32>(std::atoi(argv[1])) : 128;
+	const u32 num_steps = argc > 2 ? static_cast<u32>(std::atoi(argv[2])) : 30;
+	// skip brute force runs that would take too long
+	const u64 max_brute_force_pairs = argc > 3 ? static_cast<u64>(std::atoll(argv[3])) : 4 * 1024 * 1024;
+
+	const scalar default_margin = physics::solvers::xpbd::solver().particle_collision_margin;
+	for (u32 particles_per_axis = 32; particles_per_axis <= max_particles_per_axis; particles_per_axis *= 2) {
+		for (u32 spheres_per_axis = 8; spheres_per_axis <= 32; spheres_per_axis *= 2) {
+			const u64 num_particles = static_cast<u64>(particles_per_axis) * particles_per_axis;
+			const u64 num_bodies = static_cast<u64>(spheres_per_axis) * spheres_per_axis;
+
+			const auto [broadphase_ms, broadphase_positions] =
+				run(spheres_per_axis, particles_per_axis, num_steps, default_margin);
+			if (num_particles * num_bodies > max_brute_force_pairs) {
+				log().info(
+					"{} particles, {} bodies: {} ms/step with broadphase", num_particles, num_bodies, broadphase_ms
+				);
+				continue;
+			}
+
+			// an infinite margin makes every static body a candidate for every particle
+			const auto [brute_force_ms, brute_force_positions] =
+				run(spheres_per_axis, particles_per_axis, num_steps, std::numeric_limits<scalar>::infinity());
+			crash_if(broadphase_positions != brute_force_positions);
+			log().info(
+				"{} particles, {} bodies: {} ms/step with broadphase, {} ms/step brute force",
+				num_particles, num_bodies, broadphase_ms, brute_force_ms
+			);
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,428 @@
+#pragma once
+
+/// \file
+/// Helpers for setting up physics scenes that are shared between the testbed and the benchmarks. Unlike
+/// \p utils.h, this does not depend on the renderer.
+
+#include <cmath>
+#include <deque>
+#include <utility>
+#include <vector>
+
+#include <lotus/math/vector.h>
+#include <lotus/collision/shape.h>
+#include <lotus/collision/shapes/convex_polyhedron.h>
+#include <lotus/physics/world.h>
+#include <lotus/physics/solvers/avbd/solver.h>
+#include <lotus/physics/solvers/xpbd/solver.h>
+
+using namespace lotus::types;
+using namespace lotus::vector_types;
+using namespace lotus::collision::types;
+
+/// Creates a box centered at the origin with the given size.
+inline std::pair<
+	lotus::collision::shapes::convex_polyhedron,
+	lotus::collision::shapes::convex_polyhedron::properties
+> create_box_shape(vec3 size) {
+	const vec3 half_size = size * 0.5f;
+	std::vector<vec3> box_verts;
+	box_verts.emplace_back( half_size[0],  half_size[1],  half_size[2]);
+	box_verts.emplace_back( half_size[0],  half_size[1], -half_size[2]);
+	box_verts.emplace_back( half_size[0], -half_size[1],  half_size[2]);
+	box_verts.emplace_back( half_size[0], -half_size[1], -half_size[2]);
+	box_verts.emplace_back(-half_size[0],  half_size[1],  half_size[2]);
+	box_verts.emplace_back(-half_size[0],  half_size[1], -half_size[2]);
+	box_verts.emplace_back(-half_size[0], -half_size[1],  half_size[2]);
+	box_verts.emplace_back(-half_size[0], -half_size[1], -half_size[2]);
+	return lotus::collision::shapes::convex_polyhedron::bake(box_verts);
+}
+
+/// Creates a straight Cosserat rod between the two points with the given number of particles. The first two
+/// particles and the first orientation are kinematic. \p bend_cb is called with the indices of two adjacent
+/// orientations and the initial bend between them, and \p stretch_cb is called with the indices of two adjacent
+/// particles, the orientation between them, and the initial length; these add the solver-specific constraints.
+template <typename Solver, typename BendCallback, typename StretchCallback> void create_straight_rod(
+	Solver &solver, BendCallback &&bend_cb, StretchCallback &&stretch_cb,
+	vec3 start, vec3 end, u32 num_parts, scalar density, scalar diameter
+) {
+	const float volume = 0.25f * static_cast<f32>(lotus::constants::pi) * diameter * diameter * (end - start).norm();
+	const float total_mass = volume * density;
+
+	const vec3 part_offset = (end - start) / static_cast<scalar>(num_parts - 1);
+	const scalar inv_part_mass = static_cast<scalar>(num_parts) / total_mass;
+	const scalar inv_inertia_mass = 8.0f * inv_part_mass / (diameter * diameter);
+
+	// add particles
+	const auto first_part = static_cast<u32>(solver.particles.size());
+	for (u32 i = 0; i < num_parts; ++i) {
+		lotus::physics::particle_properties props = lotus::uninitialized;
+		props.inverse_mass = i < 2 ? 0.0f : inv_part_mass;
+		solver.particles.emplace_back(lotus::physics::particle::create(
+			props, lotus::physics::particle_state::stationary_at(start + part_offset * static_cast<scalar>(i))
+		));
+	}
+
+	// add orientations
+	const auto first_ori = static_cast<u32>(solver.orientations.size());
+	const uquats all_ori = lotus::quat::from_normalized_from_to(
+		lotus::physics::solvers::avbd::constraints::cosserat_rod::direction_basis,
+		lotus::vecu::normalize(part_offset)
+	);
+	for (u32 i = 1; i < num_parts; ++i) {
+		lotus::physics::orientation &ori = solver.orientations.emplace_back(lotus::uninitialized);
+		ori.state            = lotus::physics::orientation_state::stationary_at(all_ori);
+		ori.prev_orientation = ori.state.orientation;
+		ori.inv_inertia      = i < 2 ? 0.0f : inv_inertia_mass;
+	}
+
+	// set up bending-twisting constraints
+	for (u32 i = 2; i < num_parts; ++i) {
+		const u32 ori1 = first_ori + i - 2;
+		const u32 ori2 = first_ori + i - 1;
+		const uquats init_bend =
+			solver.orientations[ori1].state.orientation.conjugate() *
+			solver.orientations[ori2].state.orientation;
+		bend_cb(ori1, ori2, init_bend);
+	}
+
+	// set up stretching-shearing constraints
+	// skip the first segment: all elements are kinematic
+	for (u32 i = 2; i < num_parts; ++i) {
+		stretch_cb(first_part + i - 1, first_part + i, first_ori + i - 1, part_offset.norm());
+	}
+}
+
+/// Creates a straight Cosserat rod simulated by the XPBD solver. See \ref create_straight_rod().
+inline void create_straight_rod_xpbd(
+	lotus::physics::solvers::xpbd::solver &solver,
+	vec3 start, vec3 end, u32 num_parts, scalar density, scalar diameter, scalar k_ss, scalar k_bt
+) {
+	create_straight_rod(
+		solver,
+		[&](u32 o1, u32 o2, uquats initial_bend) {
+			lotus::physics::solvers::xpbd::constraints::cosserat_rod::bend_twist &constraint =
+				solver.rod_bend_twist_constraints.emplace_back(lotus::uninitialized);
+			constraint.orientation1 = o1;
+			constraint.orientation2 = o2;
+			constraint.initial_bend = initial_bend;
+			constraint.compliance   = 1.0f / k_bt;
+		},
+		[&](u32 p1, u32 p2, u32 o, scalar len) {
+			lotus::physics::solvers::xpbd::constraints::cosserat_rod::stretch_shear &constraint =
+				solver.rod_stretch_shear_constraints.emplace_back(lotus::uninitialized);
+			constraint.particle1          = p1;
+			constraint.particle2          = p2;
+			constraint.orientation        = o;
+			constraint.inv_initial_length = 1.0f / len;
+			constraint.compliance         = 1.0f / k_ss;
+		},
+		start,
+		end,
+		num_parts,
+		density,
+		diameter
+	);
+}
+/// Creates a straight Cosserat rod simulated by the AVBD solver. See \ref create_straight_rod().
+inline void create_straight_rod_avbd(
+	lotus::physics::solvers::avbd::solver &solver,
+	vec3 start, vec3 end, u32 num_parts, scalar density, scalar diameter, scalar k_ss, scalar k_bt
+) {
+	create_straight_rod(
+		solver,
+		[&](u32 o1, u32 o2, uquats init_bend) {
+			lotus::physics::solvers::avbd::constraints::cosserat_rod::bend_twist &constraint =
+				solver.rod_bend_twist_constraints.emplace_back(lotus::uninitialized);
+			constraint.orientation1 = o1;
+			constraint.orientation2 = o2;
+			constraint.initial_bend = init_bend;
+			constraint.stiffness    = k_bt;
+		},
+		[&](u32 p1, u32 p2, u32 o, scalar len) {
+			lotus::physics::solvers::avbd::constraints::cosserat_rod::stretch_shear &constraint =
+				solver.rod_stretch_shear_constraints.emplace_back(lotus::uninitialized);
+			constraint.particle1      = p1;
+			constraint.particle2      = p2;
+			constraint.orientation    = o;
+			constraint.initial_length = len;
+			constraint.stiffness      = k_ss;
+		},
+		start,
+		end,
+		num_parts,
+		density,
+		diameter
+	);
+}
+
+
+/// The shape of the wheels created by \ref create_car().
+enum class car_wheel_type {
+	aligned_poly,   ///< A prism with the same vertices on both sides.
+	staggered_poly, ///< A prism with vertices on one side rotated by half a segment.
+	cylinder,       ///< Only the vertices on one side.
+
+	count ///< The number of wheel types.
+};
+/// Settings of the car created by \ref create_car(). The defaults match the car test in the testbed.
+struct car_parameters {
+	f32 body_lift = -0.2f; ///< Vertical offset of the suspension arms from the bottom of the body.
+	f32 body_size[3] = { 1.2f, 0.5f, 4.0f }; ///< Size of the body.
+	f32 body_density = 1000.0f; ///< Density of the body and the suspension arms.
+	f32 width = 2.0f; ///< Distance between the centers of the left and right wheels.
+	f32 initial_pos_y = 1.0f; ///< Initial height of the body.
+
+	f32 arm_length = 0.8f; ///< Length of the suspension arms.
+	f32 suspension_stiffness = 100000.0f; ///< Stiffness of the suspension springs.
+	f32 spring_length_initial = 0.5f; ///< Initial length of the suspension springs.
+	f32 spring_length_full = 0.6f; ///< Rest length of the suspension springs.
+	f32 spring_position = 0.1f; ///< Distance between the suspension springs and the wheels.
+
+	f32 wheel_spacing = 2.5f; ///< Distance between the front and rear wheels.
+	f32 wheel_pivot = 0.0f; ///< Offset of the wheel pins from the centers of the wheels.
+	f32 wheel_radius = 0.3f; ///< Radius of the wheels.
+	f32 wheel_width = 0.2f; ///< Width of the wheels.
+	car_wheel_type wheel_type = car_wheel_type::staggered_poly; ///< Shape of the wheels.
+	u32 wheel_subdivision = 20; ///< Number of vertices on each side of a wheel.
+	f32 wheel_static_friction = 1.2f; ///< Static friction coefficient of the wheels.
+	f32 wheel_dynamic_friction = 1.1f; ///< Dynamic friction coefficient of the wheels.
+	f32 wheel_density = 1000.0f; ///< Density of the wheels.
+};
+/// A wheel of a car created by \ref create_car().
+struct car_wheel {
+	u32 side = 0; ///< 0 for the right side, 1 for the left side.
+	u32 index = 0; ///< 0 for the front wheel, 1 for the rear wheel.
+	u32 hinge_index = 0; ///< Index of the hinge between the wheel and its suspension arm in the world.
+	lotus::physics::body *body = nullptr; ///< The wheel body.
+};
+/// Bodies of a car created by \ref create_car().
+struct car {
+	lotus::physics::body *body = nullptr; ///< The main body.
+	std::vector<car_wheel> wheels; ///< All wheels of the car.
+};
+
+/// Creates a car with four wheels, each attached to the body with a suspension arm. Shapes are added to \p shapes,
+/// which must outlive the world. The ground is not created.
+inline car create_car(
+	lotus::physics::world &world, std::deque<lotus::collision::shape> &shapes, const car_parameters &params
+) {
+	const lotus::physics::material_properties body_material(0.2f, 0.2f, 0.0f);
+	const lotus::physics::material_properties wheel_material(
+		params.wheel_static_friction, params.wheel_dynamic_friction, 0.2f
+	);
+
+	lotus::physics::body_properties arm_props = lotus::uninitialized;
+	lotus::collision::shape *arm_shape = nullptr;
+	{
+		auto [arm_poly, arm_poly_props] = create_box_shape(vec3(params.arm_length, 0.1f, 0.1f));
+		arm_shape = &shapes.emplace_back(lotus::collision::shape::create(std::move(arm_poly)));
+		arm_props = arm_poly_props.get_body_properties(params.body_density);
+	}
+
+	const vec3 body_size(params.body_size[0], params.body_size[1], params.body_size[2]);
+	lotus::physics::body_properties body_props = lotus::uninitialized;
+	lotus::collision::shape *body_shape = nullptr;
+	{
+		auto [body_poly, body_poly_props] = create_box_shape(body_size);
+		body_shape = &shapes.emplace_back(lotus::collision::shape::create(std::move(body_poly)));
+		body_props = body_poly_props.get_body_properties(params.body_density);
+	}
+
+	lotus::physics::body_properties wheel_props = lotus::uninitialized;
+	lotus::collision::shape *wheel_shape = nullptr;
+	{
+		std::vector<vec3> wheel_verts;
+		const scalar angle = 2.0f * lotus::physics::pi / static_cast<scalar>(params.wheel_subdivision);
+		for (u32 i = 0; i < params.wheel_subdivision; ++i) {
+			const scalar a1 = angle * static_cast<scalar>(i);
+			wheel_verts.emplace_back(0.5f * params.wheel_width, params.wheel_radius * vec2(std::cos(a1), std::sin(a1)));
+			if (params.wheel_type == car_wheel_type::aligned_poly) {
+				wheel_verts.emplace_back(-0.5f * params.wheel_width, params.wheel_radius * vec2(std::cos(a1), std::sin(a1)));
+			} else if (params.wheel_type == car_wheel_type::staggered_poly) {
+				const scalar a2 = angle * (static_cast<scalar>(i) + 0.5f);
+				wheel_verts.emplace_back(-0.5f * params.wheel_width, params.wheel_radius * vec2(std::cos(a2), std::sin(a2)));
+			}
+		}
+		auto [wheel_poly, wheel_poly_props] = lotus::collision::shapes::convex_polyhedron::bake(wheel_verts);
+		wheel_shape = &shapes.emplace_back(lotus::collision::shape::create(std::move(wheel_poly)));
+		wheel_props = wheel_poly_props.get_body_properties(params.wheel_density);
+	}
+
+	car result;
+	result.body = &world.add_body(lotus::physics::body::create(
+		*body_shape, body_material, body_props, lotus::physics::body_state::stationary_at(
+			vec3(0.0f, params.initial_pos_y, 0.0f), uquats::identity()
+		)
+	))->this_body;
+
+	const scalar suspension_y = params.initial_pos_y - 0.5f * body_size[1] - params.body_lift;
+	for (u32 side = 0; side < 2; ++side) {
+		const scalar side_sign = side == 0 ? 1.0f : -1.0f;
+		for (u32 index = 0; index < 2; ++index) {
+			const scalar z = -0.5f * params.wheel_spacing + static_cast<scalar>(index) * params.wheel_spacing;
+
+			// create arm
+			lotus::physics::body &arm = world.add_body(lotus::physics::body::create(
+				*arm_shape, body_material, arm_props, lotus::physics::body_state::stationary_at(
+					vec3(side_sign * 0.5f * (params.width - params.arm_length), suspension_y, z), uquats::identity()
+				)
+			))->this_body;
+
+			{ // attach arm to body
+				const vec3 pin_pos = arm.state.position.position - vec3(side_sign * 0.5f * params.arm_length, 0.0f, 0.0f);
+
+				lotus::physics::constraints::pin &pin = world.pins.emplace_back(lotus::zero);
+				pin.body1 = result.body;
+				pin.body2 = &arm;
+				pin.local_position1 = pin.body1->state.position.global_to_local(pin_pos);
+				pin.local_position2 = pin.body2->state.position.global_to_local(pin_pos);
+				pin.disable_collision = true;
+
+				lotus::physics::constraints::hinge &hinge = world.hinges.emplace_back(lotus::zero);
+				hinge.body1 = result.body;
+				hinge.body2 = &arm;
+				hinge.local_axis1 = vec3(0.0f, 0.0f, 1.0f);
+				hinge.local_axis2 = vec3(0.0f, 0.0f, 1.0f);
+
+				const vec3 spring_pos(side_sign * (0.5f * params.width - params.spring_position), suspension_y, z);
+				lotus::physics::constraints::spring &spring = world.springs.emplace_back(lotus::zero);
+				spring.body1 = result.body;
+				spring.body2 = &arm;
+				spring.local_position1 = spring.body1->state.position.global_to_local(
+					spring_pos + vec3(0.0f, params.spring_length_initial, 0.0f)
+				);
+				spring.local_position2 = spring.body2->state.position.global_to_local(spring_pos);
+				spring.initial_length = params.spring_length_full;
+				spring.compressed_stiffness = params.suspension_stiffness;
+				spring.stretched_stiffness = params.suspension_stiffness;
+			}
+
+			// create wheel
+			lotus::physics::body &wheel = world.add_body(lotus::physics::body::create(
+				*wheel_shape, wheel_material, wheel_props, lotus::physics::body_state::stationary_at(
+					vec3(side_sign * 0.5f * params.width, suspension_y, z), uquats::identity()
+				)
+			))->this_body;
+			car_wheel &new_wheel = result.wheels.emplace_back();
+			new_wheel.side = side;
+			new_wheel.index = index;
+			new_wheel.hinge_index = static_cast<u32>(world.hinges.size());
+			new_wheel.body = &wheel;
+
+			{ // attach wheel to arm
+				const vec3 pin_pos = wheel.state.position.position - vec3(side_sign * params.wheel_pivot, 0.0f, 0.0f);
+
+				lotus::physics::constraints::pin &pin = world.pins.emplace_back(lotus::zero);
+				pin.body1 = &arm;
+				pin.body2 = &wheel;
+				pin.local_position1 = pin.body1->state.position.global_to_local(pin_pos);
+				pin.local_position2 = pin.body2->state.position.global_to_local(pin_pos);
+				pin.disable_collision = true;
+
+				lotus::physics::constraints::hinge &hinge = world.hinges.emplace_back(lotus::zero);
+				hinge.body1 = &arm;
+				hinge.body2 = &wheel;
+				hinge.local_axis1 = vec3(1.0f, 0.0f, 0.0f);
+				hinge.local_axis2 = vec3(1.0f, 0.0f, 0.0f);
+			}
+		}
+	}
+
+	return result;
+}
+
+
+/// Settings of the cloth created by \ref create_fem_cloth(). The defaults match the FEM cloth test in the testbed.
+struct fem_cloth_parameters {
+	u32 side_segments = 10; ///< Number of particles along each side of the cloth.
+	f32 cloth_size = 1.0f; ///< Side length of the cloth.
+	f32 cloth_density = 1200.0f; ///< Density of the cloth.
+	f32 youngs_modulus = 10000000.0f; ///< Young's modulus of the cloth.
+	f32 poisson_ratio = 0.3f; ///< Poisson's ratio of the cloth.
+	f32 thickness = 0.02f; ///< Thickness of the cloth.
+	bool bend_constraints = true; ///< Whether to add bending constraints.
+};
+
+/// Creates a square cloth simulated with FEM face constraints, held at two corners. Returns the particle indices of
+/// all faces, three per face.
+inline std::vector<u32> create_fem_cloth(
+	lotus::physics::solvers::xpbd::solver &solver, const fem_cloth_parameters &params
+) {
+	namespace xpbd = lotus::physics::solvers::xpbd;
+
+	const u32 side_segs = params.side_segments;
+	const scalar cloth_mass = params.cloth_density * params.cloth_size * params.cloth_size * params.thickness;
+	const scalar node_mass = cloth_mass / static_cast<scalar>(side_segs * side_segs);
+	const scalar segment_length = params.cloth_size / static_cast<scalar>(side_segs - 1);
+
+	const auto first_particle = static_cast<u32>(solver.particles.size());
+	const auto pid = [&](u32 x, u32 y) {
+		return first_particle + y * side_segs + x;
+	};
+	for (u32 y = 0; y < side_segs; ++y) {
+		for (u32 x = 0; x < side_segs; ++x) {
+			auto prop = lotus::physics::particle_properties::from_mass(node_mass);
+			if (x == 0 && (y == 0 || y == side_segs - 1)) {
+				prop = lotus::physics::particle_properties::kinematic();
+			}
+			auto state = lotus::physics::particle_state::stationary_at({
+				static_cast<scalar>(x) * segment_length,
+				params.cloth_size,
+				static_cast<scalar>(y) * segment_length - 0.5f * params.cloth_size
+			});
+			solver.particles.emplace_back(lotus::physics::particle::create(prop, state));
+		}
+	}
+
+	std::vector<u32> triangles;
+	const auto add_face = [&](u32 i1, u32 i2, u32 i3) {
+		auto &face = solver.face_constraints.emplace_back(lotus::uninitialized);
+		face.particle1 = i1;
+		face.particle2 = i2;
+		face.particle3 = i3;
+		face.state = xpbd::constraints::face::constraint_state::from_rest_pose(
+			solver.particles[i1].state.position,
+			solver.particles[i2].state.position,
+			solver.particles[i3].state.position,
+			params.thickness
+		);
+		face.properties = xpbd::constraints::face::constraint_properties::from_material_properties(
+			params.youngs_modulus, params.poisson_ratio
+		);
+		triangles.append_range(std::vector{ i1, i2, i3 });
+	};
+	const auto add_bend = [&](u32 e1, u32 e2, u32 x3, u32 x4) {
+		auto &bend = solver.bend_constraints.emplace_back(lotus::uninitialized);
+		bend.particle_edge1 = e1;
+		bend.particle_edge2 = e2;
+		bend.particle3 = x3;
+		bend.particle4 = x4;
+		bend.state = xpbd::constraints::bend::constraint_state::from_rest_pose(
+			solver.particles[e1].state.position,
+			solver.particles[e2].state.position,
+			solver.particles[x3].state.position,
+			solver.particles[x4].state.position
+		);
+		bend.properties = xpbd::constraints::bend::constraint_properties::from_material_properties(
+			params.youngs_modulus, params.poisson_ratio, params.thickness
+		);
+	};
+	for (u32 y = 1; y < side_segs; ++y) {
+		for (u32 x = 1; x < side_segs; ++x) {
+			add_face(pid(x - 1, y - 1), pid(x - 1, y), pid(x, y - 1));
+			add_face(pid(x - 1, y), pid(x, y), pid(x, y - 1));
+
+			if (params.bend_constraints) {
+				add_bend(pid(x, y - 1), pid(x - 1, y), pid(x - 1, y - 1), pid(x, y));
+				if (x > 1) {
+					add_bend(pid(x - 1, y - 1), pid(x - 1, y), pid(x - 2, y), pid(x, y - 1));
+				}
+				if (y > 1) {
+					add_bend(pid(x - 1, y - 1), pid(x, y - 1), pid(x, y - 2), pid(x - 1, y));
+				}
+			}
+		}
+	}
+	return triangles;
+}
@@ -96,11 +96,13 @@ public:
 				const vec3 start(0.01f * static_cast<scalar>(x), 0.01f * static_cast<scalar>(y), 0.0f);
 				const vec3 end = start + vec3(0.0f, 0.0f, _length_m);
 
-				_create_straight_rod_avbd(
+				create_straight_rod_avbd(
+					_solver_avbd,
 					start + _pos_avbd, end + _pos_avbd, _segments, _density_kg_m3, _diameter_m, _k_ss, _k_bt
 				);
 
-				_create_straight_rod_xpbd(
+				create_straight_rod_xpbd(
+					_solver_xpbd,
 					start + _pos_xpbd, end + _pos_xpbd, _segments, _density_kg_m3, _diameter_m, _k_ss, _k_bt
 				);
 			}
@@ -158,114 +160,4 @@ private:
 
 	f32 _move_scale = 0.0f;
 	f32 _collider_move_scale = 0.0f;
-
-	template <typename Solver, typename BendCallback, typename StretchCallback> static void _create_straight_rod(
-		Solver &solver, BendCallback &&bend_cb, StretchCallback &&stretch_cb,
-		vec3 start, vec3 end, u32 num_parts, scalar density, scalar diameter
-	) {
-		const float volume = 0.25f * static_cast<f32>(lotus::constants::pi) * diameter * diameter * (end - start).norm();
-		const float total_mass = volume * density;
-
-		const vec3 part_offset = (end - start) / static_cast<scalar>(num_parts - 1);
-		const scalar inv_part_mass = static_cast<scalar>(num_parts) / total_mass;
-		const scalar inv_inertia_mass = 8.0f * inv_part_mass / (diameter * diameter);
-
-		// add particles
-		const auto first_part = static_cast<u32>(solver.particles.size());
-		for (u32 i = 0; i < num_parts; ++i) {
-			lotus::physics::particle_properties props = lotus::uninitialized;
-			props.inverse_mass = i < 2 ? 0.0f : inv_part_mass;
-			solver.particles.emplace_back(lotus::physics::particle::create(
-				props, lotus::physics::particle_state::stationary_at(start + part_offset * static_cast<scalar>(i))
-			));
-		}
-
-		// add orientations
-		const auto first_ori = static_cast<u32>(solver.orientations.size());
-		const uquats all_ori = lotus::quat::from_normalized_from_to(
-			lotus::physics::solvers::avbd::constraints::cosserat_rod::direction_basis,
-			lotus::vecu::normalize(part_offset)
-		);
-		for (u32 i = 1; i < num_parts; ++i) {
-			lotus::physics::orientation &ori = solver.orientations.emplace_back(lotus::uninitialized);
-			ori.state            = lotus::physics::orientation_state::stationary_at(all_ori);
-			ori.prev_orientation = ori.state.orientation;
-			ori.inv_inertia      = i < 2 ? 0.0f : inv_inertia_mass;
-		}
-
-		// set up bending-twisting constraints
-		for (u32 i = 2; i < num_parts; ++i) {
-			const u32 ori1 = first_ori + i - 2;
-			const u32 ori2 = first_ori + i - 1;
-			const uquats init_bend =
-				solver.orientations[ori1].state.orientation.conjugate() *
-				solver.orientations[ori2].state.orientation;
-			bend_cb(ori1, ori2, init_bend);
-		}
-
-		// set up stretching-shearing constraints
-		// skip the first segment: all elements are kinematic
-		for (u32 i = 2; i < num_parts; ++i) {
-			stretch_cb(first_part + i - 1, first_part + i, first_ori + i - 1, part_offset.norm());
-		}
-	}
-
-	void _create_straight_rod_xpbd(
-		vec3 start, vec3 end, u32 num_parts, scalar density, scalar diameter, scalar k_ss, scalar k_bt
-	) {
-		_create_straight_rod(
-			_solver_xpbd,
-			[&](u32 o1, u32 o2, uquats initial_bend) {
-				lotus::physics::solvers::xpbd::constraints::cosserat_rod::bend_twist &constraint =
-					_solver_xpbd.rod_bend_twist_constraints.emplace_back(lotus::uninitialized);
-				constraint.orientation1 = o1;
-				constraint.orientation2 = o2;
-				constraint.initial_bend = initial_bend;
-				constraint.compliance   = 1.0f / k_bt;
-			},
-			[&](u32 p1, u32 p2, u32 o, scalar len) {
-				lotus::physics::solvers::xpbd::constraints::cosserat_rod::stretch_shear &constraint =
-					_solver_xpbd.rod_stretch_shear_constraints.emplace_back(lotus::uninitialized);
-				constraint.particle1          = p1;
-				constraint.particle2          = p2;
-				constraint.orientation        = o;
-				constraint.inv_initial_length = 1.0f / len;
-				constraint.compliance         = 1.0f / k_ss;
-			},
-			start,
-			end,
-			num_parts,
-			density,
-			diameter
-		);
-	}
-	void _create_straight_rod_avbd(
-		vec3 start, vec3 end, u32 num_parts, scalar density, scalar diameter, scalar k_ss, scalar k_bt
-	) {
-		_create_straight_rod(
-			_solver_avbd,
-			[&](u32 o1, u32 o2, uquats init_bend) {
-				lotus::physics::solvers::avbd::constraints::cosserat_rod::bend_twist &constraint =
-					_solver_avbd.rod_bend_twist_constraints.emplace_back(lotus::uninitialized);
-				constraint.orientation1 = o1;
-				constraint.orientation2 = o2;
-				constraint.initial_bend = init_bend;
-				constraint.stiffness    = k_bt;
-			},
-			[&](u32 p1, u32 p2, u32 o, scalar len) {
-				lotus::physics::solvers::avbd::constraints::cosserat_rod::stretch_shear &constraint =
-					_solver_avbd.rod_stretch_shear_constraints.emplace_back(lotus::uninitialized);
-				constraint.particle1      = p1;
-				constraint.particle2      = p2;
-				constraint.orientation    = o;
-				constraint.initial_length = len;
-				constraint.stiffness      = k_ss;
-			},
-			start,
-			end,
-			num_parts,
-			density,
-			diameter
-		);
-	}
 };
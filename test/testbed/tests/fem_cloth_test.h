@@ -24,48 +24,9 @@ public:
 
 		_world_time = 0.0f;
 
-		const auto side_segs = static_cast<usize>(_side_segments);
-		scalar cloth_mass = _cloth_density * _cloth_size * _cloth_size * _thickness;
-		scalar node_mass = cloth_mass / static_cast<scalar>(side_segs * side_segs);
-		scalar segment_length = _cloth_size / static_cast<scalar>(side_segs - 1);
-
 		auto &surface = _render.surfaces.emplace_back();
 		surface.color = lotus::linear_rgba_f32(1.0f, 0.4f, 0.2f, 0.5f);
-		std::vector<std::vector<u32>> pid(side_segs, std::vector<u32>(side_segs));
-		for (usize y = 0; y < side_segs; ++y) {
-			for (usize x = 0; x < side_segs; ++x) {
-				auto prop = lotus::physics::particle_properties::from_mass(node_mass);
-				if (x == 0 && (y == 0 || y == side_segs - 1)) {
-					prop = lotus::physics::particle_properties::kinematic();
-				}
-				auto state = lotus::physics::particle_state::stationary_at({
-					static_cast<scalar>(x) * segment_length,
-					_cloth_size,
-					static_cast<scalar>(y) * segment_length - 0.5f * _cloth_size
-				});
-				pid[x][y] = static_cast<u32>(_engine.particles.size());
-				_engine.particles.emplace_back(lotus::physics::particle::create(prop, state));
-			}
-		}
-		for (usize y = 1; y < side_segs; ++y) {
-			for (usize x = 1; x < side_segs; ++x) {
-				_add_face(pid[x - 1][y - 1], pid[x - 1][y], pid[x][y - 1]);
-				_add_face(pid[x - 1][y], pid[x][y], pid[x][y - 1]);
-
-				if (_bend_constraints) {
-					_add_bend(pid[x][y - 1], pid[x - 1][y], pid[x - 1][y - 1], pid[x][y]);
-					if (x > 1) {
-						_add_bend(pid[x - 1][y - 1], pid[x - 1][y], pid[x - 2][y], pid[x][y - 1]);
-					}
-					if (y > 1) {
-						_add_bend(pid[x - 1][y - 1], pid[x][y - 1], pid[x][y - 2], pid[x - 1][y]);
-					}
-				}
-
-				surface.triangles.append_range(std::vector{ pid[x - 1][y - 1], pid[x - 1][y], pid[x][y - 1] });
-				surface.triangles.append_range(std::vector{ pid[x][y - 1], pid[x - 1][y], pid[x][y] });
-			}
-		}
+		surface.triangles = create_fem_cloth(_engine, _cloth_params);
 
 		_sphere_shape = lotus::collision::shape::create(lotus::collision::shapes::sphere::from_radius(0.25));
 		_plane_shape = lotus::collision::shape::create(lotus::collision::shapes::plane());
@@ -113,15 +74,15 @@ public:
 				static_cast<lotus::physics::solvers::xpbd::constraints::face::projection_type>(_face_projection);
 		}
 
-		ImGui::SliderInt("Cloth Partitions", &_side_segments, 2, 100);
-		ImGui::SliderFloat("Cloth Size", &_cloth_size, 0.0f, 3.0f);
-		ImGui::SliderFloat("Cloth Density", &_cloth_density, 0.0f, 20000.0f);
+		ImGui_SliderT<u32>("Cloth Partitions", &_cloth_params.side_segments, 2, 100);
+		ImGui::SliderFloat("Cloth Size", &_cloth_params.cloth_size, 0.0f, 3.0f);
+		ImGui::SliderFloat("Cloth Density", &_cloth_params.cloth_density, 0.0f, 20000.0f);
 		ImGui::SliderFloat(
-			"Young's Modulus", &_youngs_modulus, 0.0f, 1000000000.0f, "%.0f", ImGuiSliderFlags_Logarithmic
+			"Young's Modulus", &_cloth_params.youngs_modulus, 0.0f, 1000000000.0f, "%.0f", ImGuiSliderFlags_Logarithmic
 		);
-		ImGui::SliderFloat("Poisson's Ratio", &_poisson_ratio, 0.0f, 0.5f);
-		ImGui::SliderFloat("Thickness", &_thickness, 0.0f, 0.1f);
-		ImGui::Checkbox("Bending Constraints", &_bend_constraints);
+		ImGui::SliderFloat("Poisson's Ratio", &_cloth_params.poisson_ratio, 0.0f, 0.5f);
+		ImGui::SliderFloat("Thickness", &_cloth_params.thickness, 0.0f, 0.1f);
+		ImGui::Checkbox("Bending Constraints", &_cloth_params.bend_constraints);
 		ImGui::Separator();
 
 		ImGui::SliderFloat("Sphere Travel Distance", &_sphere_travel, 0.0f, 3.0f);
@@ -147,13 +108,7 @@ protected:
 
 	int _face_projection = static_cast<int>(lotus::physics::solvers::xpbd::constraints::face::projection_type::gauss_seidel);
 
-	int _side_segments = 10;
-	f32 _cloth_size = 1.0f;
-	f32 _cloth_density = 1200.0f;
-	f32 _youngs_modulus = 10000000.0f;
-	f32 _poisson_ratio = 0.3f;
-	f32 _thickness = 0.02f;
-	bool _bend_constraints = true;
+	fem_cloth_parameters _cloth_params;
 
 	lotus::physics::body *_sphere = nullptr;
 	f32 _sphere_travel = 1.5f;
@@ -162,38 +117,4 @@ protected:
 
 	lotus::collision::shape _sphere_shape;
 	lotus::collision::shape _plane_shape;
-
-
-	void _add_face(usize i1, usize i2, usize i3) {
-		auto &face = _engine.face_constraints.emplace_back(lotus::uninitialized);
-		face.particle1 = i1;
-		face.particle2 = i2;
-		face.particle3 = i3;
-		face.state = lotus::physics::solvers::xpbd::constraints::face::constraint_state::from_rest_pose(
-			_engine.particles[i1].state.position,
-			_engine.particles[i2].state.position,
-			_engine.particles[i3].state.position,
-			_thickness
-		);
-		face.properties = lotus::physics::solvers::xpbd::constraints::face::constraint_properties::from_material_properties(
-			_youngs_modulus, _poisson_ratio
-		);
-	}
-
-	void _add_bend(usize e1, usize e2, usize x3, usize x4) {
-		auto &bend = _engine.bend_constraints.emplace_back(lotus::uninitialized);
-		bend.particle_edge1 = e1;
-		bend.particle_edge2 = e2;
-		bend.particle3 = x3;
-		bend.particle4 = x4;
-		bend.state = lotus::physics::solvers::xpbd::constraints::bend::constraint_state::from_rest_pose(
-			_engine.particles[e1].state.position,
-			_engine.particles[e2].state.position,
-			_engine.particles[x3].state.position,
-			_engine.particles[x4].state.position
-		);
-		bend.properties = lotus::physics::solvers::xpbd::constraints::bend::constraint_properties::from_material_properties(
-			_youngs_modulus, _poisson_ratio, _thickness
-		);
-	}
 };